@@ -1,13 +1,28 @@
 #include "HDR.h"
 
-void HDR::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, VkCommandPool command_pool)
+void HDR::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, VulkanFrameConstants* frame_constants, VulkanPipelineBuilder* pipeline_builder)
 {
 	devices_ = devices;
+	frame_constants_ = frame_constants;
 
 	InitResources();
 	InitShaders(swap_chain);
-	InitPipelines(swap_chain);
-	InitCommandBuffers(command_pool);
+	InitPipelines(swap_chain, pipeline_builder);
+}
+
+void HDR::InitRenderTargets(VulkanDevices* devices, VulkanSwapChain* swap_chain)
+{
+	VkExtent2D swap_chain_dimensions = swap_chain->GetIntermediateImageExtent();
+
+	// the HDR render targets are transient, the renderer's render graph binds their memory before the pipelines are initialized
+	ldr_suppress_scene_ = new VulkanRenderTarget();
+	ldr_suppress_scene_->Init(devices, swap_chain->GetIntermediateImageFormat(), swap_chain_dimensions.width / 2, swap_chain_dimensions.height / 2, 1, false, VK_SAMPLE_COUNT_1_BIT, true);
+
+	blur_scene_ = new VulkanRenderTarget();
+	blur_scene_->Init(devices, swap_chain->GetIntermediateImageFormat(), swap_chain_dimensions.width / 2, swap_chain_dimensions.height / 2, 2, false, VK_SAMPLE_COUNT_1_BIT, true);
+
+	tonemap_scene_ = new VulkanRenderTarget();
+	tonemap_scene_->Init(devices, swap_chain->GetIntermediateImageFormat(), swap_chain_dimensions.width, swap_chain_dimensions.height, 1, false, VK_SAMPLE_COUNT_1_BIT, true);
 }
 
 void HDR::Cleanup()
@@ -29,11 +44,9 @@ void HDR::Cleanup()
 	vkDestroySampler(devices_->GetLogicalDevice(), buffer_sampler_, nullptr);
 
 	// clean up buffers
-	vkDestroyBuffer(devices_->GetLogicalDevice(), gaussian_blur_factors_buffer_, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), gaussian_blur_factors_buffer_memory_, nullptr);
-
-	vkDestroyBuffer(devices_->GetLogicalDevice(), tonemap_factors_buffer_, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), tonemap_factors_buffer_memory_, nullptr);
+	frame_constants_->RemoveBuffer(gaussian_blur_factors_constants_[0]);
+	frame_constants_->RemoveBuffer(gaussian_blur_factors_constants_[1]);
+	frame_constants_->RemoveBuffer(tonemap_factors_constants_);
 
 	// clean up render targets
 	ldr_suppress_scene_->Cleanup();
@@ -64,175 +77,46 @@ void HDR::Cleanup()
 	tonemap_pipeline_->CleanUp();
 	delete tonemap_pipeline_;
 	tonemap_pipeline_ = nullptr;
-
-	// clean up semaphores
-	vkDestroySemaphore(devices_->GetLogicalDevice(), ldr_suppress_semaphore_, nullptr);
-	vkDestroySemaphore(devices_->GetLogicalDevice(), gaussian_blur_semaphore_[0], nullptr);
-	vkDestroySemaphore(devices_->GetLogicalDevice(), gaussian_blur_semaphore_[1], nullptr);
-	vkDestroySemaphore(devices_->GetLogicalDevice(), hdr_semaphore_, nullptr);
 }
 
-void HDR::Render(VulkanSwapChain* swap_chain, VkSemaphore* wait_semaphore)
-{
-	VkQueue graphics_queue;
-	vkGetDeviceQueue(devices_->GetLogicalDevice(), devices_->GetQueueFamilyIndices().graphics_family, 0, &graphics_queue);
-
-	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-
-	VkSubmitInfo submit_info = {};
-	VkSemaphore signal_semaphores[1];
-
-	// clear the render targets
-	ldr_suppress_scene_->ClearImage();
-	blur_scene_->ClearImage();
-	tonemap_scene_->ClearImage();
-
-	// suppress low dynamic range pixels and downscaled image
-	// submit the draw command buffer
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 1;
-	submit_info.pWaitSemaphores = wait_semaphore;
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &ldr_suppress_command_buffer_;
-
-	signal_semaphores[0] = ldr_suppress_semaphore_;
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
-
-	VkResult result = vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to submit deferred command buffer!");
-	}
-
-	// apply a gaussian blur filter to the image
-	// horizontal filter
-	GaussianBlurFactors blur_factors =
-	{
-		8.0f,
-		glm::vec2(1.0f, 0.0f),
-		0.0f
-	};
-	devices_->CopyDataToBuffer(gaussian_blur_factors_buffer_memory_, &blur_factors, sizeof(GaussianBlurFactors));
-
-	// submit the draw command buffer
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 1;
-	submit_info.pWaitSemaphores = &ldr_suppress_semaphore_;
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &gaussian_blur_command_buffers_[0];
-
-	signal_semaphores[0] = gaussian_blur_semaphore_[0];
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
-
-	result = vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to submit deferred command buffer!");
-	}
-
-	// vertical filter
-	blur_factors.direction = glm::vec2(0.0f, 1.0f);
-	devices_->CopyDataToBuffer(gaussian_blur_factors_buffer_memory_, &blur_factors, sizeof(GaussianBlurFactors));
-
-	// submit the draw command buffer
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 1;
-	submit_info.pWaitSemaphores = &gaussian_blur_semaphore_[0];
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &gaussian_blur_command_buffers_[1];
-
-	signal_semaphores[0] = gaussian_blur_semaphore_[1];
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
-
-	result = vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to submit deferred command buffer!");
-	}
-
-	// tonemap the blurred image with the original
-	// update tonemapping data
-	devices_->CopyDataToBuffer(tonemap_factors_buffer_memory_, &tonemap_factors_, sizeof(TonemapFactors));
-
-	// submit the draw command buffer
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 1;
-	submit_info.pWaitSemaphores = &gaussian_blur_semaphore_[1];
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &tonemap_command_buffer_;
-
-	signal_semaphores[0] = hdr_semaphore_;
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
-
-	result = vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to submit deferred command buffer!");
-	}
-
-	// wait until tonemapping is complete
-	vkQueueWaitIdle(graphics_queue);
-
-	// copy the tonemapped image to the intermediate image
-	swap_chain->CopyToIntermediateImage(tonemap_scene_->GetImages()[0], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-}
-
-void HDR::InitPipelines(VulkanSwapChain* swap_chain)
+void HDR::InitPipelines(VulkanSwapChain* swap_chain, VulkanPipelineBuilder* pipeline_builder)
 {
 	VkExtent2D swap_chain_dimensions = swap_chain->GetIntermediateImageExtent();
 
-	// initialize the HDR render targets
-	ldr_suppress_scene_ = new VulkanRenderTarget();
-	ldr_suppress_scene_->Init(devices_, swap_chain->GetIntermediateImageFormat(), swap_chain_dimensions.width / 2, swap_chain_dimensions.height / 2, 1, false);
-
-	blur_scene_ = new VulkanRenderTarget();
-	blur_scene_->Init(devices_, swap_chain->GetIntermediateImageFormat(), swap_chain_dimensions.width / 2, swap_chain_dimensions.height / 2, 2, false);
-
-	tonemap_scene_ = new VulkanRenderTarget();
-	tonemap_scene_->Init(devices_, swap_chain->GetIntermediateImageFormat(), swap_chain_dimensions.width, swap_chain_dimensions.height, 1, false);
-
 	// initialize the ldr suppresssion pipeline
 	ldr_suppress_pipeline_ = new LDRSuppressPipeline();
 	ldr_suppress_pipeline_->SetShader(ldr_suppress_shader_);
 	ldr_suppress_pipeline_->SetOutputImage(ldr_suppress_scene_->GetImageViews()[0], ldr_suppress_scene_->GetRenderTargetFormat(), swap_chain_dimensions.width / 2, swap_chain_dimensions.height / 2);
 	ldr_suppress_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 0, buffer_sampler_);
 	ldr_suppress_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 1, swap_chain->GetIntermediateImageView());
-	ldr_suppress_pipeline_->Init(devices_, swap_chain, nullptr);
+	pipeline_builder->Add("ldr suppress", [=]() { ldr_suppress_pipeline_->Init(devices_, swap_chain, nullptr); });
 
 	// initialize the gaussian blur pipelines
 	gaussian_blur_pipeline_[0] = new GaussianBlurPipeline();
 	gaussian_blur_pipeline_[0]->SetShader(gaussian_blur_shader_);
 	gaussian_blur_pipeline_[0]->SetOutputImage(blur_scene_->GetImageViews()[0], blur_scene_->GetRenderTargetFormat(), swap_chain_dimensions.width / 2, swap_chain_dimensions.height / 2);
-	gaussian_blur_pipeline_[0]->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 0, gaussian_blur_factors_buffer_, sizeof(GaussianBlurFactors));
+	gaussian_blur_pipeline_[0]->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 0, frame_constants_->GetBuffer(gaussian_blur_factors_constants_[0]), sizeof(GaussianBlurFactors));
 	gaussian_blur_pipeline_[0]->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 1, buffer_sampler_);
 	gaussian_blur_pipeline_[0]->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 2, ldr_suppress_scene_->GetImageViews()[0]);
-	gaussian_blur_pipeline_[0]->Init(devices_, swap_chain, nullptr);
+	pipeline_builder->Add("horizontal blur", [=]() { gaussian_blur_pipeline_[0]->Init(devices_, swap_chain, nullptr); });
 
 	gaussian_blur_pipeline_[1] = new GaussianBlurPipeline();
 	gaussian_blur_pipeline_[1]->SetShader(gaussian_blur_shader_);
 	gaussian_blur_pipeline_[1]->SetOutputImage(blur_scene_->GetImageViews()[1], blur_scene_->GetRenderTargetFormat(), swap_chain_dimensions.width / 2, swap_chain_dimensions.height / 2);
-	gaussian_blur_pipeline_[1]->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 0, gaussian_blur_factors_buffer_, sizeof(GaussianBlurFactors));
+	gaussian_blur_pipeline_[1]->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 0, frame_constants_->GetBuffer(gaussian_blur_factors_constants_[1]), sizeof(GaussianBlurFactors));
 	gaussian_blur_pipeline_[1]->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 1, buffer_sampler_);
 	gaussian_blur_pipeline_[1]->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 2, blur_scene_->GetImageViews()[0]);
-	gaussian_blur_pipeline_[1]->Init(devices_, swap_chain, nullptr);
+	pipeline_builder->Add("vertical blur", [=]() { gaussian_blur_pipeline_[1]->Init(devices_, swap_chain, nullptr); });
 	
 	// intialize the tonemap pipeline
 	tonemap_pipeline_ = new TonemapPipeline();
 	tonemap_pipeline_->SetShader(tonemap_shader_);
 	tonemap_pipeline_->SetOutputImage(tonemap_scene_->GetImageViews()[0], tonemap_scene_->GetRenderTargetFormat(), swap_chain_dimensions.width, swap_chain_dimensions.height);
-	tonemap_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 0, tonemap_factors_buffer_, sizeof(TonemapFactors));
+	tonemap_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 0, frame_constants_->GetBuffer(tonemap_factors_constants_), sizeof(TonemapFactors));
 	tonemap_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 1, buffer_sampler_);
 	tonemap_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 2, swap_chain->GetIntermediateImageView());
 	tonemap_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 3, blur_scene_->GetImageViews()[1]);
-	tonemap_pipeline_->Init(devices_, swap_chain, nullptr);
+	pipeline_builder->Add("tonemap", [=]() { tonemap_pipeline_->Init(devices_, swap_chain, nullptr); });
 }
 
 void HDR::InitShaders(VulkanSwapChain* swap_chain)
@@ -273,11 +157,23 @@ void HDR::InitResources()
 		throw std::runtime_error("failed to create buffer sampler!");
 	}
 
-	// intialize the blur factors buffer
-	devices_->CreateBuffer(sizeof(GaussianBlurFactors), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, gaussian_blur_factors_buffer_, gaussian_blur_factors_buffer_memory_);
+	// intialize the blur factors buffers, one per filter direction so neither changes between passes
+	GaussianBlurFactors blur_factors =
+	{
+		8.0f,
+		glm::vec2(1.0f, 0.0f),
+		0.0f
+	};
+
+	gaussian_blur_factors_constants_[0] = frame_constants_->AddBuffer(sizeof(GaussianBlurFactors), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	frame_constants_->Write(gaussian_blur_factors_constants_[0], &blur_factors, sizeof(GaussianBlurFactors));
+
+	blur_factors.direction = glm::vec2(0.0f, 1.0f);
+	gaussian_blur_factors_constants_[1] = frame_constants_->AddBuffer(sizeof(GaussianBlurFactors), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	frame_constants_->Write(gaussian_blur_factors_constants_[1], &blur_factors, sizeof(GaussianBlurFactors));
 
 	// initialize the tonemap factors buffer
-	devices_->CreateBuffer(sizeof(TonemapFactors), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, tonemap_factors_buffer_, tonemap_factors_buffer_memory_);
+	tonemap_factors_constants_ = frame_constants_->AddBuffer(sizeof(TonemapFactors), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
 
 	// send the tonemap factors to the buffer
 	tonemap_factors_ =
@@ -288,18 +184,7 @@ void HDR::InitResources()
 		0.0f	// use special hdr
 	};
 
-	devices_->CopyDataToBuffer(tonemap_factors_buffer_memory_, &tonemap_factors_, sizeof(TonemapFactors));
-
-	// initialize semaphores
-	VkSemaphoreCreateInfo semaphore_info = {};
-	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-	if (vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &ldr_suppress_semaphore_) != VK_SUCCESS ||
-		vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &gaussian_blur_semaphore_[0]) != VK_SUCCESS ||
-		vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &gaussian_blur_semaphore_[1]) != VK_SUCCESS || 
-		vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &hdr_semaphore_) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create semaphores!");
-	}
+	frame_constants_->Write(tonemap_factors_constants_, &tonemap_factors_, sizeof(TonemapFactors));
 }
 
 void HDR::InitCommandBuffers(VkCommandPool command_pool)
@@ -395,4 +280,7 @@ void HDR::CycleHDRMode()
 	{
 		hdr_mode_ = 0;
 	}
+
+	// the new factors are copied with the next frame's constants
+	frame_constants_->Write(tonemap_factors_constants_, &tonemap_factors_, sizeof(TonemapFactors));
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 #include "gaussian_blur_pipeline.h"
 #include "tonemap_pipeline.h"
 #include "render_target.h"
+#include "frame_constants.h"
+#include "pipeline_builder.h"
 
 class HDR
 {
@@ -27,21 +29,29 @@ public:
 	};
 
 public:
-	void Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, VkCommandPool command_pool);
+	void InitRenderTargets(VulkanDevices* devices, VulkanSwapChain* swap_chain);
+	// the pipelines are queued on the builder, the command buffers are recorded once they have been built
+	void Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, VulkanFrameConstants* frame_constants, VulkanPipelineBuilder* pipeline_builder);
+	void InitCommandBuffers(VkCommandPool command_pool);
 	void Cleanup();
-	void Render(VulkanSwapChain* swap_chain, VkSemaphore* wait_semaphore);
 
-	inline VkSemaphore GetHDRSemaphore() { return hdr_semaphore_; }
+	// the passes are submitted by the renderer's render graph
+	inline VkCommandBuffer GetLDRSuppressCommandBuffer() { return ldr_suppress_command_buffer_; }
+	inline VkCommandBuffer GetGaussianBlurCommandBuffer(int direction) { return gaussian_blur_command_buffers_[direction]; }
+	inline VkCommandBuffer GetTonemapCommandBuffer() { return tonemap_command_buffer_; }
+	inline VkImage GetOutputImage() { return tonemap_scene_->GetImages()[0]; }
+	inline VulkanRenderTarget* GetLDRSuppressTarget() { return ldr_suppress_scene_; }
+	inline VulkanRenderTarget* GetBlurTarget() { return blur_scene_; }
+	inline VulkanRenderTarget* GetTonemapTarget() { return tonemap_scene_; }
 	inline VulkanRenderTarget* DebugBuffer() { return ldr_suppress_scene_; }
 
 	void CycleHDRMode();
 	inline int GetHDRMode() { return hdr_mode_; }
 
 protected:
-	void InitPipelines(VulkanSwapChain* swap_chain);
+	void InitPipelines(VulkanSwapChain* swap_chain, VulkanPipelineBuilder* pipeline_builder);
 	void InitShaders(VulkanSwapChain* swap_chain);
 	void InitResources();
-	void InitCommandBuffers(VkCommandPool command_pool);
 
 protected:
 	VulkanDevices* devices_;
@@ -52,10 +62,9 @@ protected:
 	GaussianBlurPipeline* gaussian_blur_pipeline_[2];
 	TonemapPipeline* tonemap_pipeline_;
 	VulkanRenderTarget *ldr_suppress_scene_, *blur_scene_, *tonemap_scene_;
-	VkBuffer gaussian_blur_factors_buffer_, tonemap_factors_buffer_;
-	VkDeviceMemory gaussian_blur_factors_buffer_memory_, tonemap_factors_buffer_memory_;
+	VulkanFrameConstants* frame_constants_;
+	FrameConstantHandle gaussian_blur_factors_constants_[2], tonemap_factors_constants_;
 	VkCommandBuffer ldr_suppress_command_buffer_, gaussian_blur_command_buffers_[2], tonemap_command_buffer_;
-	VkSemaphore ldr_suppress_semaphore_, gaussian_blur_semaphore_[2], hdr_semaphore_;
 
 	int hdr_mode_;
 	TonemapFactors tonemap_factors_;
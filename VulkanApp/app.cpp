@@ -1,9 +1,13 @@
 #include "app.h"
+#include "trace_profiler.h"
+#include "load_statistics.h"
 #include <chrono>
 #include <fstream>
 
 void App::Run()
 {
+	TRACE_THREAD_NAME("main");
+
 	if (InitWindow())
 	{
 		if (InitVulkan())
@@ -36,6 +40,12 @@ bool App::InitWindow()
 	std::cin >> multisample_level_;
 	multisample_level_ = std::max(1, std::min(8, multisample_level_));
 
+	// read in the number of frames the cpu may run ahead of the gpu
+	std::cout << "Enter frames in flight: ";
+	std::cin >> frames_in_flight_;
+	frames_in_flight_ = (frames_in_flight_ > 0) ? std::min(MAX_FRAMES_IN_FLIGHT, frames_in_flight_) : DEFAULT_FRAMES_IN_FLIGHT;
+	vertex_format_ = DEFAULT_VERTEX_FORMAT;
+
 	if (glfwInit() == GLFW_FALSE)
 		return false;
 
@@ -85,9 +95,12 @@ bool App::InitVulkan()
 
 	SetupDebugCallback();
 
-	// init the window surface
+	// init the window surface, without a window the frames are rendered offscreen
 	swap_chain_ = new VulkanSwapChain();
-	swap_chain_->Init(window_, vk_instance_);
+	if (window_ != nullptr)
+		swap_chain_->Init(window_, vk_instance_);
+	else
+		swap_chain_->InitHeadless(vk_instance_);
 
 	// init the physical and logical devices
 	InitDevices();
@@ -97,8 +110,7 @@ bool App::InitVulkan()
 	
 	// init the rendering pipeline
 	renderer_ = new VulkanRenderer();
-	renderer_->Init(devices_, swap_chain_, multisample_level_);
-	renderer_->LoadCapturePoints(mesh_filenames_);
+	renderer_->Init(devices_, swap_chain_, multisample_level_, frames_in_flight_, vertex_format_);
 
 	return true;
 }
@@ -140,16 +152,43 @@ bool App::InitResources()
 	size_t filename_end = filepaths[0].find_last_of('.');
 	std::string typeless_filename = (filepaths[0].substr(filename_begin + 1, (filename_end - 1) - filename_begin));
 	texture_dir = "../res/materials/" + typeless_filename + "/";
+
+	// a procedural scene is generated in place of loading models
+	ProceduralScene* procedural_scene = nullptr;
+	ProceduralSceneSettings procedural_settings;
+	if (ProceduralScene::ParseDescription(mesh_filenames_, procedural_settings))
+	{
+		procedural_scene = new ProceduralScene(procedural_settings);
+		texture_dir = PROCEDURAL_SCENE_TEXTURE_DIRECTORY;
+	}
+
 	renderer_->SetTextureDirectory(texture_dir);
 
 
-	for (std::string filepath : filepaths)
+	LoadStatistics::Begin(mesh_filenames_);
+	if (procedural_scene)
 	{
-		Mesh* loaded_mesh = new Mesh();
-		loaded_mesh->CreateModelMesh(devices_, renderer_, filepath);
-		loaded_meshes_.push_back(loaded_mesh);
-		renderer_->AddMesh(loaded_mesh);
+		Mesh* procedural_mesh = new Mesh();
+		procedural_mesh->CreateProceduralMesh(devices_, renderer_, *procedural_scene);
+		loaded_meshes_.push_back(procedural_mesh);
+		renderer_->AddMesh(procedural_mesh);
 	}
+	else
+	{
+		for (std::string filepath : filepaths)
+		{
+			Mesh* loaded_mesh = new Mesh();
+			loaded_mesh->CreateModelMesh(devices_, renderer_, filepath);
+			loaded_meshes_.push_back(loaded_mesh);
+			renderer_->AddMesh(loaded_mesh);
+		}
+	}
+	LoadStatistics::End();
+
+	// report how the scene data was uploaded
+	UploadStatistics upload_statistics = devices_->GetUploadManager()->GetStatistics();
+	std::cout << "Uploaded " << upload_statistics.bytes_uploaded << " bytes in " << upload_statistics.upload_count << " copies across " << upload_statistics.batches_submitted << " submissions";
+	std::cout << " (" << upload_statistics.ring_stalls << " staging stalls, " << upload_statistics.dedicated_staging_count << " dedicated staging buffers)" << std::endl;
 
 	// load lightmap
 
@@ -158,7 +197,17 @@ bool App::InitResources()
 
 	std::ifstream file;
 	file.open(lightmap_filepath, std::ios::in);
-	if (!file.is_open())
+	if (procedural_scene)
+	{
+		// generated lights are placed over the bounds of the generated shapes
+		glm::vec3 scene_min = loaded_meshes_[0]->GetMinVertex();
+		glm::vec3 scene_max = loaded_meshes_[0]->GetMaxVertex();
+		lights_ = procedural_scene->CreateLights(devices_, renderer_, scene_min, scene_max);
+
+		delete procedural_scene;
+		procedural_scene = nullptr;
+	}
+	else if (!file.is_open())
 	{
 		// if there is no lightmap for this file use default setup
 		Light* test_light = new Light();
@@ -251,12 +300,32 @@ bool App::InitResources()
 
 	renderer_->SetCamera(&camera_);
 
+	renderer_->InitPipelines();
+
+	// rendered once the primitive buffer is finalized, as the packed vertex format binds its shape buffer
 	for (Light* light : lights_)
 	{
 		light->GenerateShadowMap(renderer_->GetCommandPool(), renderer_->GetMeshes());
 	}
 
-	renderer_->InitPipelines();
+	// the primitive buffer is finalized as the pipelines are initialized
+	LoadStatistics::PrintSummary();
+	if (!load_report_filename_.empty())
+		LoadStatistics::AppendReport(load_report_filename_);
+
+	// report the pipeline creation cost, a warm cache skips most shader compilation
+	PipelineCacheStatistics cache_statistics = devices_->GetPipelineCacheStatistics();
+	std::cout << "Created " << cache_statistics.pipeline_count << " pipelines in " << cache_statistics.creation_time << "ms from a ";
+	if (cache_statistics.loaded_from_disk)
+		std::cout << "warm pipeline cache (" << cache_statistics.loaded_bytes << " bytes loaded)" << std::endl;
+	else
+		std::cout << "cold pipeline cache" << std::endl;
+
+	// report how device memory has been sub-allocated
+	devices_->GetMemoryAllocator()->PrintStatistics();
+
+	FrameConstantStatistics constant_statistics = renderer_->GetFrameConstants()->GetStatistics();
+	std::cout << "Frame constants are " << (constant_statistics.direct_device_writes ? "written directly to device local memory" : "staged into device local memory once per frame") << std::endl;
 
 	return true;
 }
@@ -302,8 +371,11 @@ void App::CleanUp()
 	vkDestroyInstance(vk_instance_, nullptr);
 
 	// cleanup glfw
-	glfwDestroyWindow(window_);
-	glfwTerminate();
+	if (window_ != nullptr)
+	{
+		glfwDestroyWindow(window_);
+		glfwTerminate();
+	}
 }
 
 void App::MainLoop()
@@ -316,6 +388,8 @@ void App::MainLoop()
 	}
 
 	vkDeviceWaitIdle(devices_->GetLogicalDevice());
+
+	PrintFrameStatistics();
 }
 
 void App::Update()
@@ -382,13 +456,45 @@ void App::Update()
 		input_->SetKeyUp(GLFW_KEY_H);
 	}
 
-	// renderer timing
+	// render path toggle
+	if (input_->IsKeyPressed(GLFW_KEY_M))
+	{
+		renderer_->CycleRenderMode();
+		input_->SetKeyUp(GLFW_KEY_M);
+	}
+
+	// buffer visualisation views, the last returns to the render path
+	if (input_->IsKeyPressed(GLFW_KEY_V))
+	{
+		renderer_->CycleBufferVisualisationMode();
+		input_->SetKeyUp(GLFW_KEY_V);
+	}
+
+	// renderer timing, the capture points are read at the start so points recorded this session are included
 	if (input_->IsKeyPressed(GLFW_KEY_ENTER))
 	{
+		renderer_->LoadCapturePoints(mesh_filenames_);
 		renderer_->StartPerformanceCapture();
 		input_->SetKeyUp(GLFW_KEY_ENTER);
 	}
 
+#if ENABLE_CPU_TRACE
+	// trace the next few frames, or write out every zone still held
+	if (input_->IsKeyPressed(GLFW_KEY_T))
+	{
+		renderer_->GetGpuProfiler()->CalibrateTimestamps();
+		TraceProfiler::CaptureFrames(TRACE_CAPTURE_FRAMES, TRACE_OUTPUT_DIRECTORY + mesh_filenames_ + "_trace_" + std::to_string(renderer_->GetFrameStatistics().frame_count) + ".json");
+		input_->SetKeyUp(GLFW_KEY_T);
+	}
+	else if (input_->IsKeyPressed(GLFW_KEY_P))
+	{
+		std::string filename = TRACE_OUTPUT_DIRECTORY + mesh_filenames_ + "_trace_recent.json";
+		if (TraceProfiler::WriteTrace(filename))
+			std::cout << "Wrote the recent trace zones to " << filename << std::endl;
+		input_->SetKeyUp(GLFW_KEY_P);
+	}
+#endif
+
 	// capture point recording
 	if (input_->IsKeyPressed(GLFW_KEY_TAB))
 	{
@@ -410,8 +516,11 @@ void App::Update()
 
 void App::DrawFrame()
 {
+	// wait for the gpu to release this frame's resources
+	renderer_->BeginFrame();
+
 	// acquire the next image in the swap chain
-	VkResult result = swap_chain_->PreRender();
+	VkResult result = swap_chain_->PreRender(renderer_->GetCurrentFrame());
 
 	// recreate the swap chain if it is out of date
 	if (result == VK_ERROR_OUT_OF_DATE_KHR)
@@ -430,6 +539,9 @@ void App::DrawFrame()
 	// present the swap chain image to the window
 	result = swap_chain_->PostRender(renderer_->GetSignalSemaphore());
 
+	// move on without waiting for the frame to complete
+	renderer_->EndFrame();
+
 	// recreate the swap chain if it is out of date or non-optimal
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
 	{
@@ -441,6 +553,36 @@ void App::DrawFrame()
 	}
 }
 
+void App::PrintFrameStatistics()
+{
+	FrameThroughputStatistics statistics = renderer_->GetFrameStatistics();
+	if (statistics.frame_count < 2)
+		return;
+
+	double frame_count = (double)statistics.frame_count;
+	double frame_interval = statistics.elapsed_time / (frame_count - 1.0);
+
+	std::cout << "Frames in flight: " << statistics.frames_in_flight << std::endl;
+	std::cout << "Frames rendered: " << statistics.frame_count << std::endl;
+	std::cout << "Average frame interval: " << frame_interval << "ms (" << (1000.0 / frame_interval) << " fps)" << std::endl;
+	std::cout << "Average cpu frame time: " << (statistics.cpu_frame_time / frame_count) << "ms" << std::endl;
+	std::cout << "Average frame fence wait: " << (statistics.fence_wait_time / frame_count) << "ms" << std::endl;
+	std::cout << "Frames overlapping gpu work: " << (100.0 * statistics.overlapped_frames / frame_count) << "%" << std::endl;
+
+	RenderGraphStatistics graph_statistics = renderer_->GetRenderGraph()->GetStatistics();
+	std::cout << "Render graph passes: " << graph_statistics.pass_count << " (" << graph_statistics.culled_pass_count << " culled)" << std::endl;
+	std::cout << "Render graph barriers: " << graph_statistics.barrier_count << ", semaphores: " << graph_statistics.semaphore_count << ", submits per frame: " << graph_statistics.submit_count << std::endl;
+
+	FrameStats frame_stats = renderer_->GetFrameStats();
+	std::cout << "Last frame: " << frame_stats.visible_shapes << " of " << frame_stats.shape_count << " shapes visible (frame " << frame_stats.culling_frame_number << "), "
+		<< frame_stats.drawn_indices << " indices drawn, " << frame_stats.shadow_casting_lights << " of " << frame_stats.light_count << " lights casting shadows" << std::endl;
+	std::cout << "Last frame: " << frame_stats.queue_submits << " queue submits, " << frame_stats.idle_waits << " idle waits, " << frame_stats.uploaded_bytes << " bytes uploaded, "
+		<< frame_stats.constant_bytes << " constant bytes written" << std::endl;
+
+	renderer_->GetGpuProfiler()->PrintStatistics();
+	renderer_->GetPipelineStatistics()->PrintStatistics();
+}
+
 bool App::CreateInstance()
 {
 	VkApplicationInfo app_info = {};
@@ -601,6 +743,12 @@ void App::InitDevices()
 	// create the physical device
 	devices_ = new VulkanDevices(vk_instance_, swap_chain_->GetSurface(), device_features, device_extensions_);
 
+	// the pass statistics queries are optional, they are enabled when the chosen device supports them
+	VkPhysicalDeviceFeatures supported_features;
+	vkGetPhysicalDeviceFeatures(devices_->GetPhysicalDevice(), &supported_features);
+	device_features.pipelineStatisticsQuery = supported_features.pipelineStatisticsQuery;
+	device_features.occlusionQueryPrecise = supported_features.occlusionQueryPrecise;
+
 	// setup requirements for logical device
 	QueueFamilyIndices indices = devices_->GetQueueFamilyIndices();
 	std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
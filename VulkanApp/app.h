@@ -52,6 +52,7 @@ protected:
 
 	virtual void Update();
 	virtual void DrawFrame();
+	void PrintFrameStatistics();
 
 	virtual bool CreateInstance();
 	bool ValidateExtensions();
@@ -71,9 +72,12 @@ protected:
 
 	Camera camera_;
 	std::string mesh_filenames_;
+	std::string load_report_filename_;		// a row per load phase is appended when set
 	std::vector<Mesh*> loaded_meshes_;
 	std::vector<Light*> lights_;
 	int multisample_level_;
+	int frames_in_flight_;
+	VertexFormat vertex_format_;
 
 	float current_time_;
 	float prev_time_;
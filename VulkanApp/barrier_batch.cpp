@@ -0,0 +1,176 @@
+#include "barrier_batch.h"
+
+VulkanBarrierBatch::VulkanBarrierBatch()
+{
+	memory_barrier_ = {};
+	memory_barrier_.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	transition_src_stages_ = 0;
+	transition_dst_stages_ = 0;
+	recorded_barrier_count_ = 0;
+}
+
+void VulkanBarrierBatch::TransitionImage(VkImage image, VkImageAspectFlags aspect, VkImageLayout old_layout, VkImageLayout new_layout, VkPipelineStageFlags wait_stage)
+{
+	VkImageSubresourceRange range = {};
+	range.aspectMask = aspect;
+	range.baseMipLevel = 0;
+	range.levelCount = 1;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+
+	transition_src_stages_ |= wait_stage;
+	transitions_.push_back(CreateBarrier(image, range, old_layout, new_layout, transition_src_stages_, transition_dst_stages_));
+}
+
+void VulkanBarrierBatch::ClearColorImage(VkImage image, VkImageLayout layout, VkClearColorValue clear_color)
+{
+	ImageClear clear = {};
+	clear.image = image;
+	clear.layout = layout;
+	clear.range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	clear.range.levelCount = 1;
+	clear.range.layerCount = 1;
+	clear.clear_value.color = clear_color;
+
+	clears_.push_back(clear);
+}
+
+void VulkanBarrierBatch::ClearDepthImage(VkImage image, VkImageLayout layout, VkClearDepthStencilValue clear_value, VkImageAspectFlags aspect)
+{
+	ImageClear clear = {};
+	clear.image = image;
+	clear.layout = layout;
+	clear.range.aspectMask = aspect;
+	clear.range.levelCount = 1;
+	clear.range.layerCount = 1;
+	clear.clear_value.depthStencil = clear_value;
+
+	clears_.push_back(clear);
+}
+
+void VulkanBarrierBatch::AddMemoryBarrier(VkPipelineStageFlags src_stages, VkAccessFlags src_access, VkPipelineStageFlags dst_stages, VkAccessFlags dst_access)
+{
+	memory_barrier_.srcAccessMask |= src_access;
+	memory_barrier_.dstAccessMask |= dst_access;
+	transition_src_stages_ |= src_stages;
+	transition_dst_stages_ |= dst_stages;
+}
+
+void VulkanBarrierBatch::Record(VkCommandBuffer command_buffer)
+{
+	VkPipelineStageFlags src_stages = transition_src_stages_;
+	VkPipelineStageFlags dst_stages = transition_dst_stages_;
+
+	// every transition and every image about to be cleared share one barrier
+	barriers_ = transitions_;
+	for (const ImageClear& clear : clears_)
+	{
+		barriers_.push_back(CreateBarrier(clear.image, clear.range, clear.layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, src_stages, dst_stages));
+	}
+
+	// an execution only dependency has stages but no access masks
+	bool memory_dependency = (memory_barrier_.srcAccessMask != 0 || memory_barrier_.dstAccessMask != 0);
+
+	if (!barriers_.empty() || src_stages != 0)
+	{
+		vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0, memory_dependency ? 1 : 0, &memory_barrier_, 0, nullptr, static_cast<uint32_t>(barriers_.size()), barriers_.data());
+		recorded_barrier_count_++;
+	}
+
+	if (!clears_.empty())
+	{
+		for (const ImageClear& clear : clears_)
+		{
+			if (clear.range.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT)
+				vkCmdClearColorImage(command_buffer, clear.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear.clear_value.color, 1, &clear.range);
+			else
+				vkCmdClearDepthStencilImage(command_buffer, clear.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear.clear_value.depthStencil, 1, &clear.range);
+		}
+
+		// return the cleared images to the layouts the passes expect
+		src_stages = 0;
+		dst_stages = 0;
+		barriers_.clear();
+		for (const ImageClear& clear : clears_)
+		{
+			barriers_.push_back(CreateBarrier(clear.image, clear.range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, clear.layout, src_stages, dst_stages));
+		}
+
+		vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers_.size()), barriers_.data());
+		recorded_barrier_count_++;
+	}
+
+	Reset();
+}
+
+void VulkanBarrierBatch::Reset()
+{
+	transitions_.clear();
+	memory_barrier_.srcAccessMask = 0;
+	memory_barrier_.dstAccessMask = 0;
+	clears_.clear();
+	transition_src_stages_ = 0;
+	transition_dst_stages_ = 0;
+}
+
+VkImageMemoryBarrier VulkanBarrierBatch::CreateBarrier(VkImage image, const VkImageSubresourceRange& range, VkImageLayout old_layout, VkImageLayout new_layout, VkPipelineStageFlags& src_stages, VkPipelineStageFlags& dst_stages)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = old_layout;
+	barrier.newLayout = new_layout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = range;
+
+	VkPipelineStageFlags src_stage, dst_stage;
+	GetLayoutAccess(old_layout, barrier.srcAccessMask, src_stage);
+	GetLayoutAccess(new_layout, barrier.dstAccessMask, dst_stage);
+
+	src_stages |= src_stage;
+	dst_stages |= dst_stage;
+
+	return barrier;
+}
+
+void VulkanBarrierBatch::GetLayoutAccess(VkImageLayout layout, VkAccessFlags& access_mask, VkPipelineStageFlags& stage_mask)
+{
+	switch (layout)
+	{
+	case VK_IMAGE_LAYOUT_UNDEFINED:
+		access_mask = 0;
+		stage_mask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		access_mask = VK_ACCESS_TRANSFER_READ_BIT;
+		stage_mask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+		access_mask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		stage_mask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+		// color attachments are also sampled by later passes without changing layout
+		access_mask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
+		stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		access_mask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
+		stage_mask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		access_mask = VK_ACCESS_SHADER_READ_BIT;
+		stage_mask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		break;
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		// presentation is ordered by semaphores, nothing to wait on or make visible
+		access_mask = 0;
+		stage_mask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		break;
+	default:
+		access_mask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		break;
+	}
+}
\ No newline at end of file
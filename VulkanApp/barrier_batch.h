@@ -0,0 +1,59 @@
+#ifndef _BARRIER_BATCH_H_
+#define _BARRIER_BATCH_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+// collects image transitions and clears so they are recorded into an existing command buffer
+// as a single pipeline barrier rather than submitted one at a time
+class VulkanBarrierBatch
+{
+protected:
+	struct ImageClear
+	{
+		VkImage image;
+		VkImageLayout layout;
+		VkImageSubresourceRange range;
+		VkClearValue clear_value;
+	};
+
+public:
+	VulkanBarrierBatch();
+
+	// queue a layout transition, the access masks and stages are derived from the layouts
+	// wait_stage orders the transition after a semaphore wait on that stage, e.g. for a freshly acquired swap chain image
+	void TransitionImage(VkImage image, VkImageAspectFlags aspect, VkImageLayout old_layout, VkImageLayout new_layout, VkPipelineStageFlags wait_stage = 0);
+
+	// queue a clear, the image is returned to its layout once cleared
+	void ClearColorImage(VkImage image, VkImageLayout layout, VkClearColorValue clear_color = { 0.0f, 0.0f, 0.0f, 0.0f });
+	void ClearDepthImage(VkImage image, VkImageLayout layout, VkClearDepthStencilValue clear_value = { 1.0f, 0 }, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_DEPTH_BIT);
+
+	// queue a global memory dependency, merged into the same barrier as the transitions
+	void AddMemoryBarrier(VkPipelineStageFlags src_stages, VkAccessFlags src_access, VkPipelineStageFlags dst_stages, VkAccessFlags dst_access);
+
+	// record the transitions in one barrier, then the clears and one barrier returning the cleared images
+	void Record(VkCommandBuffer command_buffer);
+	void Reset();
+
+	inline bool IsEmpty() { return transitions_.empty() && clears_.empty() && transition_src_stages_ == 0; }
+	inline uint32_t GetRecordedBarrierCount() { return recorded_barrier_count_; }
+
+	static void GetLayoutAccess(VkImageLayout layout, VkAccessFlags& access_mask, VkPipelineStageFlags& stage_mask);
+
+protected:
+	VkImageMemoryBarrier CreateBarrier(VkImage image, const VkImageSubresourceRange& range, VkImageLayout old_layout, VkImageLayout new_layout, VkPipelineStageFlags& src_stages, VkPipelineStageFlags& dst_stages);
+
+protected:
+	std::vector<VkImageMemoryBarrier> transitions_;
+	VkMemoryBarrier memory_barrier_;
+	VkPipelineStageFlags transition_src_stages_;
+	VkPipelineStageFlags transition_dst_stages_;
+
+	std::vector<ImageClear> clears_;
+	std::vector<VkImageMemoryBarrier> barriers_;
+
+	// vkCmdPipelineBarrier calls made since construction
+	uint32_t recorded_barrier_count_;
+};
+
+#endif
\ No newline at end of file
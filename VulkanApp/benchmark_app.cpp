@@ -0,0 +1,577 @@
+#include "benchmark_app.h"
+#include "trace_profiler.h"
+#include "mesh_optimizer.h"
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+
+// split a comma separated argument value
+static std::vector<std::string> SplitArgumentList(const std::string& value)
+{
+	std::vector<std::string> values;
+
+	size_t start = 0;
+	while (start <= value.length())
+	{
+		size_t end = value.find(',', start);
+		if (end == std::string::npos)
+			end = value.length();
+
+		if (end > start)
+			values.push_back(value.substr(start, end - start));
+
+		start = end + 1;
+	}
+
+	return values;
+}
+
+static int ParseArgumentInteger(const std::string& argument, const std::string& value)
+{
+	if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+	{
+		throw std::runtime_error("invalid value " + value + " for benchmark argument " + argument + "!");
+	}
+
+	return std::stoi(value);
+}
+
+static float ParseArgumentFloat(const std::string& argument, const std::string& value)
+{
+	if (value.empty() || value.find_first_not_of("0123456789.") != std::string::npos || value.find('.') != value.find_last_of('.'))
+	{
+		throw std::runtime_error("invalid value " + value + " for benchmark argument " + argument + "!");
+	}
+
+	return std::stof(value);
+}
+
+BenchmarkApp::BenchmarkApp(const BenchmarkSettings& settings)
+{
+	settings_ = settings;
+	window_ = nullptr;
+	input_ = nullptr;
+	vertex_stride_ = 0;
+	vertex_buffer_bytes_ = 0;
+}
+
+bool BenchmarkApp::ParseArguments(int argc, char* argv[], BenchmarkSettings& settings)
+{
+	settings = {};
+	settings.warmup_frames = BENCHMARK_DEFAULT_WARMUP_FRAMES;
+	settings.sample_frames = BENCHMARK_DEFAULT_SAMPLE_FRAMES;
+	settings.frames_in_flight = DEFAULT_FRAMES_IN_FLIGHT;
+	settings.output_path = BENCHMARK_DEFAULT_OUTPUT;
+	settings.tolerance = REGRESSION_DEFAULT_TOLERANCE;
+	settings.max_differing_percentage = REGRESSION_DEFAULT_MAX_DIFFERING_PERCENTAGE;
+	settings.mesh_optimization = MESH_OPTIMIZATION_ENABLED;
+	settings.vertex_format = DEFAULT_VERTEX_FORMAT;
+
+	bool benchmark = false;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--benchmark")
+		{
+			benchmark = true;
+			continue;
+		}
+		if (argument == "--update-references")
+		{
+			settings.update_references = true;
+			continue;
+		}
+
+		// every other argument takes a value
+		if (i + 1 >= argc)
+		{
+			throw std::runtime_error("missing value for benchmark argument " + argument + "!");
+		}
+		std::string value = argv[++i];
+
+		if (argument == "--model")
+		{
+			settings.model = value;
+		}
+		else if (argument == "--resolution")
+		{
+			// each resolution is given as widthxheight
+			for (const std::string& resolution : SplitArgumentList(value))
+			{
+				size_t separator = resolution.find('x');
+				if (separator == std::string::npos)
+				{
+					throw std::runtime_error("invalid resolution " + resolution + ", expected widthxheight!");
+				}
+
+				VkExtent2D extent = {};
+				extent.width = ParseArgumentInteger(argument, resolution.substr(0, separator));
+				extent.height = ParseArgumentInteger(argument, resolution.substr(separator + 1));
+				if (extent.width == 0 || extent.height == 0)
+				{
+					throw std::runtime_error("invalid resolution " + resolution + "!");
+				}
+				settings.resolutions.push_back(extent);
+			}
+		}
+		else if (argument == "--msaa")
+		{
+			for (const std::string& level : SplitArgumentList(value))
+			{
+				int multisample_level = ParseArgumentInteger(argument, level);
+				if (multisample_data.find(multisample_level) == multisample_data.end())
+				{
+					throw std::runtime_error("unsupported multisample level " + level + "!");
+				}
+				settings.multisample_levels.push_back(multisample_level);
+			}
+		}
+		else if (argument == "--mode")
+		{
+			// underscores stand in for spaces in the render path names
+			for (std::string mode : SplitArgumentList(value))
+			{
+				std::replace(mode.begin(), mode.end(), '_', ' ');
+
+				VulkanRenderer::RenderMode render_mode;
+				if (!VulkanRenderer::FindRenderMode(mode, render_mode))
+				{
+					throw std::runtime_error("unsupported render mode " + mode + "!");
+				}
+				settings.render_modes.push_back(mode);
+			}
+		}
+		else if (argument == "--warmup")
+		{
+			settings.warmup_frames = ParseArgumentInteger(argument, value);
+		}
+		else if (argument == "--samples")
+		{
+			settings.sample_frames = ParseArgumentInteger(argument, value);
+		}
+		else if (argument == "--frames-in-flight")
+		{
+			settings.frames_in_flight = ParseArgumentInteger(argument, value);
+		}
+		else if (argument == "--output")
+		{
+			settings.output_path = value;
+		}
+		else if (argument == "--trace")
+		{
+			settings.trace_frames = ParseArgumentInteger(argument, value);
+		}
+		else if (argument == "--load-report")
+		{
+			settings.load_report_path = value;
+		}
+		else if (argument == "--mesh-optimization")
+		{
+			settings.mesh_optimization = ParseArgumentInteger(argument, value) != 0;
+		}
+		else if (argument == "--vertex-format")
+		{
+			if (!VertexPacker::FindFormat(value, settings.vertex_format))
+			{
+				throw std::runtime_error("unsupported vertex format " + value + ", expected float or packed!");
+			}
+		}
+		else if (argument == "--regression")
+		{
+			settings.reference_directory = value;
+		}
+		else if (argument == "--tolerance")
+		{
+			settings.tolerance = ParseArgumentFloat(argument, value);
+		}
+		else if (argument == "--max-differing")
+		{
+			settings.max_differing_percentage = ParseArgumentFloat(argument, value);
+		}
+		else
+		{
+			throw std::runtime_error("unknown benchmark argument " + argument + "!");
+		}
+	}
+
+	// a regression run is a benchmark that compares images rather than times
+	if (!benchmark && settings.reference_directory.empty())
+		return false;
+
+	if (settings.model.empty())
+	{
+		throw std::runtime_error("a benchmark requires a model, pass --model!");
+	}
+
+	if (settings.update_references && settings.reference_directory.empty())
+	{
+		throw std::runtime_error("updating references requires a reference directory, pass --regression!");
+	}
+
+	if (settings.sample_frames == 0)
+	{
+		throw std::runtime_error("a benchmark requires at least one sample frame!");
+	}
+
+	// anything not requested is benchmarked with the interactive defaults
+	if (settings.resolutions.empty())
+		settings.resolutions.push_back({ 1920, 1080 });
+	if (settings.multisample_levels.empty())
+		settings.multisample_levels.push_back(1);
+	if (settings.render_modes.empty())
+		settings.render_modes.push_back(VulkanRenderer::GetRenderModeName(DEFAULT_RENDER_MODE));
+
+	settings.frames_in_flight = std::max(1, std::min(MAX_FRAMES_IN_FLIGHT, settings.frames_in_flight));
+
+	return true;
+}
+
+void BenchmarkApp::Run()
+{
+	// the swap chain and renderer do not support being resized, so each configuration starts from a new device,
+	// the render modes are switched within a configuration so the model is loaded once for all of them
+	for (VkExtent2D resolution : settings_.resolutions)
+	{
+		for (int multisample_level : settings_.multisample_levels)
+		{
+			window_width_ = resolution.width;
+			window_height_ = resolution.height;
+			multisample_level_ = multisample_level;
+
+			App::Run();
+		}
+	}
+
+	WriteResults();
+}
+
+bool BenchmarkApp::InitWindow()
+{
+	// nothing is shown, the swap chain renders offscreen
+	window_ = nullptr;
+	input_ = nullptr;
+	mesh_filenames_ = settings_.model;
+	load_report_filename_ = settings_.load_report_path;
+	Mesh::SetShapeOptimization(settings_.mesh_optimization);
+	vertex_format_ = settings_.vertex_format;
+	frames_in_flight_ = settings_.frames_in_flight;
+
+	current_time_ = 0.0f;
+	prev_time_ = 0.0f;
+	frame_time_ = 0.0f;
+
+	return true;
+}
+
+void BenchmarkApp::MainLoop()
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(devices_->GetPhysicalDevice(), &properties);
+	device_name_ = properties.deviceName;
+	vertex_stride_ = renderer_->GetPrimitiveBuffer()->GetVertexStride();
+	vertex_buffer_bytes_ = renderer_->GetPrimitiveBuffer()->GetVertexBufferSize();
+
+	// a procedural scene has no recorded capture points and is measured from the starting camera
+	std::vector<PerformanceCapturePoint> capture_points;
+	ProceduralSceneSettings procedural_settings;
+	if (!ProceduralScene::ParseDescription(settings_.model, procedural_settings))
+	{
+		renderer_->LoadCapturePoints(settings_.model);
+		capture_points = renderer_->GetCapturePoints();
+	}
+	else
+	{
+		PerformanceCapturePoint capture_point = {};
+		capture_point.capture_position = camera_.GetPosition();
+		capture_point.capture_rotation = camera_.GetRotation();
+		capture_points.push_back(capture_point);
+	}
+
+	for (const std::string& render_mode : settings_.render_modes)
+	{
+		VulkanRenderer::RenderMode mode;
+		VulkanRenderer::FindRenderMode(render_mode, mode);
+		renderer_->SetRenderMode(mode);
+		render_mode_ = render_mode;
+
+		std::cout << "Benchmarking " << settings_.model << " with the " << render_mode_ << " path at " << window_width_ << "x" << window_height_ << ", " << multisample_level_ << "x msaa" << std::endl;
+
+		for (uint32_t i = 0; i < capture_points.size(); i++)
+			RunCapturePoint(i, capture_points[i]);
+	}
+
+	vkDeviceWaitIdle(devices_->GetLogicalDevice());
+
+	PrintFrameStatistics();
+}
+
+std::vector<const char*> BenchmarkApp::GetRequiredExtensions()
+{
+	// no surface is created so glfw's instance extensions are not needed
+	std::vector<const char*> extensions;
+
+	if (ENABLE_VALIDATION_LAYERS)
+	{
+		extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+	}
+
+	return extensions;
+}
+
+void BenchmarkApp::RunCapturePoint(uint32_t index, const PerformanceCapturePoint& capture_point)
+{
+	camera_.SetPosition(capture_point.capture_position);
+	camera_.SetRotation(capture_point.capture_rotation);
+
+	// the stage times read back while recording a frame were written a frame in flight earlier, the warm up must cover them
+	FrameTimeStatistics statistics;
+	statistics.Begin(std::max(settings_.warmup_frames, (uint32_t)frames_in_flight_), settings_.sample_frames);
+
+	VulkanPipelineStatistics* pipeline_statistics = renderer_->GetPipelineStatistics();
+	pipeline_statistics->ResetTotals();
+	FrameStats frame_stats_total = {};
+
+	// the calibration waits for the gpu so is done ahead of the warm up rather than the traced frames
+	bool trace = ENABLE_CPU_TRACE && settings_.trace_frames > 0;
+	if (trace)
+		renderer_->GetGpuProfiler()->CalibrateTimestamps();
+
+	while (statistics.IsActive())
+	{
+		if (trace && !statistics.IsWarmingUp())
+		{
+			std::string mode = render_mode_;
+			std::replace(mode.begin(), mode.end(), ' ', '_');
+			TraceProfiler::CaptureFrames(std::min(settings_.trace_frames, settings_.sample_frames), settings_.output_path + "_" + mode + "_" + std::to_string(window_width_) + "x" +
+				std::to_string(window_height_) + "_msaa" + std::to_string(multisample_level_) + "_capture" + std::to_string(index) + "_trace.json");
+			trace = false;
+		}
+
+		auto frame_start = std::chrono::high_resolution_clock::now();
+		DrawFrame();
+		double frame_time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frame_start).count();
+
+		RenderStageTimes stage_times = renderer_->GetLastStageTimes();
+		double frame_times[FRAME_TIME_STAGE_COUNT] = {};
+		frame_times[static_cast<int>(FrameTimeStage::CPU_FRAME)] = frame_time;
+		frame_times[static_cast<int>(FrameTimeStage::VISIBILITY)] = stage_times.visibility;
+		frame_times[static_cast<int>(FrameTimeStage::SHADING)] = stage_times.shading;
+		frame_times[static_cast<int>(FrameTimeStage::TRANSPARENCY)] = stage_times.transparency;
+		frame_times[static_cast<int>(FrameTimeStage::POST_PROCESS)] = stage_times.post_process;
+		frame_times[static_cast<int>(FrameTimeStage::GPU_TOTAL)] = stage_times.visibility + stage_times.shading + stage_times.transparency + stage_times.post_process;
+
+		if (!statistics.IsWarmingUp())
+		{
+			pipeline_statistics->AddLastResultsToTotals();
+
+			FrameStats frame_stats = renderer_->GetFrameStats();
+			frame_stats_total.frame_number = frame_stats.frame_number;
+			frame_stats_total.culling_frame_number = frame_stats.culling_frame_number;
+			frame_stats_total.shape_count = frame_stats.shape_count;
+			frame_stats_total.visible_shapes += frame_stats.visible_shapes;
+			frame_stats_total.culled_shapes += frame_stats.culled_shapes;
+			frame_stats_total.drawn_indices += frame_stats.drawn_indices;
+			frame_stats_total.light_count = frame_stats.light_count;
+			frame_stats_total.shadow_casting_lights = frame_stats.shadow_casting_lights;
+			frame_stats_total.shadow_map_faces_rendered += frame_stats.shadow_map_faces_rendered;
+			frame_stats_total.queue_submits += frame_stats.queue_submits;
+			frame_stats_total.submitted_batches += frame_stats.submitted_batches;
+			frame_stats_total.idle_waits += frame_stats.idle_waits;
+			frame_stats_total.uploaded_bytes += frame_stats.uploaded_bytes;
+			frame_stats_total.constant_bytes += frame_stats.constant_bytes;
+		}
+		statistics.AddFrame(frame_times);
+	}
+
+	// the trace is written once the gpu zones of its last frames have been read back
+	while (TraceProfiler::IsCapturing())
+		DrawFrame();
+
+	BenchmarkResult result = {};
+	result.render_mode = render_mode_;
+	result.width = window_width_;
+	result.height = window_height_;
+	result.multisample_level = multisample_level_;
+	result.capture_point = index;
+	result.position = capture_point.capture_position;
+	result.rotation = capture_point.capture_rotation;
+	result.sample_count = settings_.sample_frames;
+	for (int i = 0; i < FRAME_TIME_STAGE_COUNT; i++)
+		result.metrics[i] = statistics.Summarize(static_cast<FrameTimeStage>(i));
+	result.outlier_frames = statistics.GetOutlierFrames(FrameTimeStage::GPU_TOTAL);
+
+	uint32_t sample_count = std::max(settings_.sample_frames, 1u);
+	result.frame_stats = frame_stats_total;
+	result.frame_stats.visible_shapes /= sample_count;
+	result.frame_stats.culled_shapes /= sample_count;
+	result.frame_stats.drawn_indices /= sample_count;
+	result.frame_stats.shadow_map_faces_rendered /= sample_count;
+	result.frame_stats.queue_submits /= sample_count;
+	result.frame_stats.submitted_batches /= sample_count;
+	result.frame_stats.idle_waits /= sample_count;
+	result.frame_stats.uploaded_bytes /= sample_count;
+	result.frame_stats.constant_bytes /= sample_count;
+
+	uint32_t statistics_frames = pipeline_statistics->GetTotalFrameCount();
+	for (PipelineStatisticsScope scope = 0; scope < pipeline_statistics->GetScopeCount() && statistics_frames > 0; scope++)
+	{
+		PipelineStatisticsResult total = pipeline_statistics->GetTotal(scope);
+		if (total.input_primitives == 0 && total.fragment_invocations == 0 && total.compute_invocations == 0)
+			continue;
+
+		PipelineStatisticsResult average = {};
+		average.input_primitives = total.input_primitives / statistics_frames;
+		average.clipping_invocations = total.clipping_invocations / statistics_frames;
+		average.clipping_primitives = total.clipping_primitives / statistics_frames;
+		average.vertex_invocations = total.vertex_invocations / statistics_frames;
+		average.fragment_invocations = total.fragment_invocations / statistics_frames;
+		average.compute_invocations = total.compute_invocations / statistics_frames;
+		average.samples_passed = total.samples_passed / statistics_frames;
+		result.pipeline_statistics.push_back(std::make_pair(pipeline_statistics->GetScopeName(scope), average));
+	}
+
+	results_.push_back(result);
+
+	const FrameTimeSummary& gpu_total = result.metrics[static_cast<int>(FrameTimeStage::GPU_TOTAL)];
+	std::cout << "Capture point " << index << ": " << result.metrics[0].mean << "ms frame time, " << gpu_total.mean << "ms gpu, "
+		<< gpu_total.p99 << "ms gpu p99, " << gpu_total.outlier_count << " outliers" << std::endl;
+}
+
+void BenchmarkApp::WriteResults()
+{
+	std::ofstream json_file(settings_.output_path + ".json", std::ios::out | std::ios::trunc);
+	std::ofstream csv_file(settings_.output_path + ".csv", std::ios::out | std::ios::trunc);
+	if (!json_file.is_open() || !csv_file.is_open())
+	{
+		throw std::runtime_error("failed to open benchmark output " + settings_.output_path + "!");
+	}
+
+	json_file << "{\n";
+	json_file << "\t\"model\": " << JsonString(settings_.model) << ",\n";
+	json_file << "\t\"device\": " << JsonString(device_name_) << ",\n";
+	json_file << "\t\"frames_in_flight\": " << settings_.frames_in_flight << ",\n";
+	json_file << "\t\"warmup_frames\": " << settings_.warmup_frames << ",\n";
+	json_file << "\t\"sample_frames\": " << settings_.sample_frames << ",\n";
+	json_file << "\t\"mesh_optimization\": " << (settings_.mesh_optimization ? "true" : "false") << ",\n";
+	json_file << "\t\"vertex_format\": " << JsonString(VertexPacker::GetFormatName(settings_.vertex_format)) << ",\n";
+	json_file << "\t\"vertex_stride\": " << vertex_stride_ << ",\n";
+	json_file << "\t\"vertex_buffer_bytes\": " << vertex_buffer_bytes_ << ",\n";
+	json_file << "\t\"results\": [";
+
+	csv_file << "model,device,render_mode,width,height,msaa,capture_point";
+	for (int i = 0; i < FRAME_TIME_STAGE_COUNT; i++)
+	{
+		std::string name = FrameTimeStatistics::GetStageName(static_cast<FrameTimeStage>(i));
+		csv_file << "," << name << "_mean," << name << "_median," << name << "_min," << name << "_max," << name << "_p95," << name << "_p99,"
+			<< name << "_std_dev," << name << "_outliers";
+	}
+	csv_file << ",shapes,visible_shapes,culled_shapes,drawn_indices,lights,shadow_casting_lights,shadow_map_faces,queue_submits,submitted_batches,idle_waits,uploaded_bytes,constant_bytes";
+	csv_file << "\n";
+
+	for (size_t r = 0; r < results_.size(); r++)
+	{
+		const BenchmarkResult& result = results_[r];
+
+		json_file << ((r > 0) ? ",\n" : "\n") << "\t\t{\n";
+		json_file << "\t\t\t\"render_mode\": " << JsonString(result.render_mode) << ",\n";
+		json_file << "\t\t\t\"width\": " << result.width << ",\n";
+		json_file << "\t\t\t\"height\": " << result.height << ",\n";
+		json_file << "\t\t\t\"msaa\": " << result.multisample_level << ",\n";
+		json_file << "\t\t\t\"capture_point\": " << result.capture_point << ",\n";
+		json_file << "\t\t\t\"position\": [" << result.position.x << ", " << result.position.y << ", " << result.position.z << "],\n";
+		json_file << "\t\t\t\"rotation\": [" << result.rotation.x << ", " << result.rotation.y << ", " << result.rotation.z << "],\n";
+		json_file << "\t\t\t\"samples\": " << result.sample_count;
+
+		csv_file << CsvString(settings_.model) << "," << CsvString(device_name_) << "," << CsvString(result.render_mode) << "," << result.width << "," << result.height << "," << result.multisample_level << "," << result.capture_point;
+
+		for (int i = 0; i < FRAME_TIME_STAGE_COUNT; i++)
+		{
+			const FrameTimeSummary& metric = result.metrics[i];
+			json_file << ",\n\t\t\t" << JsonString(FrameTimeStatistics::GetStageName(static_cast<FrameTimeStage>(i))) << ": { \"mean\": " << metric.mean << ", \"median\": " << metric.median
+				<< ", \"min\": " << metric.min << ", \"max\": " << metric.max << ", \"p95\": " << metric.p95 << ", \"p99\": " << metric.p99 << ", \"std_dev\": " << metric.std_dev
+				<< ", \"outliers\": " << metric.outlier_count << ", \"upper_fence\": " << metric.upper_fence << ", \"trimmed_mean\": " << metric.trimmed_mean << " }";
+			csv_file << "," << metric.mean << "," << metric.median << "," << metric.min << "," << metric.max << "," << metric.p95 << "," << metric.p99 << ","
+				<< metric.std_dev << "," << metric.outlier_count;
+		}
+
+		const FrameStats& frame_stats = result.frame_stats;
+		json_file << ",\n\t\t\t\"frame_stats\": { \"shapes\": " << frame_stats.shape_count << ", \"visible_shapes\": " << frame_stats.visible_shapes
+			<< ", \"culled_shapes\": " << frame_stats.culled_shapes << ", \"drawn_indices\": " << frame_stats.drawn_indices << ", \"lights\": " << frame_stats.light_count
+			<< ", \"shadow_casting_lights\": " << frame_stats.shadow_casting_lights << ", \"shadow_map_faces\": " << frame_stats.shadow_map_faces_rendered
+			<< ", \"queue_submits\": " << frame_stats.queue_submits << ", \"submitted_batches\": " << frame_stats.submitted_batches << ", \"idle_waits\": " << frame_stats.idle_waits
+			<< ", \"uploaded_bytes\": " << frame_stats.uploaded_bytes << ", \"constant_bytes\": " << frame_stats.constant_bytes << " }";
+		csv_file << "," << frame_stats.shape_count << "," << frame_stats.visible_shapes << "," << frame_stats.culled_shapes << "," << frame_stats.drawn_indices << "," << frame_stats.light_count
+			<< "," << frame_stats.shadow_casting_lights << "," << frame_stats.shadow_map_faces_rendered << "," << frame_stats.queue_submits << "," << frame_stats.submitted_batches
+			<< "," << frame_stats.idle_waits << "," << frame_stats.uploaded_bytes << "," << frame_stats.constant_bytes;
+
+		json_file << ",\n\t\t\t\"outlier_frames\": [";
+		for (size_t i = 0; i < result.outlier_frames.size(); i++)
+			json_file << ((i > 0) ? ", " : "") << result.outlier_frames[i];
+		json_file << "]";
+
+		json_file << ",\n\t\t\t\"pipeline_statistics\": {";
+		for (size_t i = 0; i < result.pipeline_statistics.size(); i++)
+		{
+			const PipelineStatisticsResult& pass = result.pipeline_statistics[i].second;
+			json_file << ((i > 0) ? ",\n" : "\n") << "\t\t\t\t" << JsonString(result.pipeline_statistics[i].first) << ": { \"input_primitives\": " << pass.input_primitives
+				<< ", \"clipping_invocations\": " << pass.clipping_invocations << ", \"clipping_primitives\": " << pass.clipping_primitives
+				<< ", \"vertex_invocations\": " << pass.vertex_invocations << ", \"vertex_fetch_bytes\": " << pass.vertex_invocations * vertex_stride_
+				<< ", \"fragment_invocations\": " << pass.fragment_invocations
+				<< ", \"compute_invocations\": " << pass.compute_invocations << ", \"samples_passed\": " << pass.samples_passed << " }";
+		}
+		json_file << (result.pipeline_statistics.empty() ? "}" : "\n\t\t\t}");
+
+		json_file << "\n\t\t}";
+		csv_file << "\n";
+	}
+
+	json_file << "\n\t]\n}\n";
+
+	std::cout << "Wrote " << results_.size() << " benchmark results to " << settings_.output_path << ".json and .csv" << std::endl;
+}
+
+std::string BenchmarkApp::JsonString(const std::string& value)
+{
+	std::string quoted = "\"";
+	for (char c : value)
+	{
+		switch (c)
+		{
+		case '"': quoted += "\\\""; break;
+		case '\\': quoted += "\\\\"; break;
+		case '\b': quoted += "\\b"; break;
+		case '\f': quoted += "\\f"; break;
+		case '\n': quoted += "\\n"; break;
+		case '\r': quoted += "\\r"; break;
+		case '\t': quoted += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				// the remaining control characters have no short escape
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+				quoted += escaped;
+			}
+			else
+			{
+				quoted += c;
+			}
+		}
+	}
+
+	return quoted + "\"";
+}
+
+std::string BenchmarkApp::CsvString(const std::string& value)
+{
+	// a quote inside a quoted csv field is written twice
+	std::string quoted = "\"";
+	for (char c : value)
+	{
+		if (c == '"')
+			quoted += '"';
+		quoted += c;
+	}
+
+	return quoted + "\"";
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef _BENCHMARK_APP_H_
+#define _BENCHMARK_APP_H_
+
+#include "app.h"
+
+#define BENCHMARK_DEFAULT_WARMUP_FRAMES 16
+#define BENCHMARK_DEFAULT_SAMPLE_FRAMES 64
+#define BENCHMARK_DEFAULT_OUTPUT "../res/data/performance_data/benchmark"
+#define REGRESSION_DEFAULT_TOLERANCE 0.01f
+#define REGRESSION_DEFAULT_MAX_DIFFERING_PERCENTAGE 0.1f
+
+struct BenchmarkSettings
+{
+	std::string model;							// comma separated, as entered in the interactive prompt
+	std::vector<VkExtent2D> resolutions;
+	std::vector<int> multisample_levels;
+	std::vector<std::string> render_modes;
+	uint32_t warmup_frames;						// frames rendered at each capture point before sampling
+	uint32_t sample_frames;
+	int frames_in_flight;
+	std::string output_path;					// written with .json and .csv extensions
+	uint32_t trace_frames;						// sample frames traced at each capture point, none when zero
+	std::string load_report_path;				// load phase rows are appended here for every configuration when set
+	bool mesh_optimization;						// reorder the loaded shapes for the vertex cache and overdraw
+	VertexFormat vertex_format;					// of the primitive buffer
+
+	// a regression run compares the output of each capture point with the reference images in this directory instead of timing it
+	std::string reference_directory;
+	bool update_references;						// write the references rather than compare against them
+	float tolerance;							// largest channel difference of a matching pixel
+	float max_differing_percentage;				// of the pixels, above which a capture point fails
+};
+
+struct BenchmarkResult
+{
+	std::string render_mode;
+	uint32_t width, height;
+	int multisample_level;
+	uint32_t capture_point;
+	glm::vec3 position, rotation;
+	uint32_t sample_count;
+
+	// milliseconds, the cpu frame time followed by the gpu stage times and their total
+	FrameTimeSummary metrics[FRAME_TIME_STAGE_COUNT];
+	std::vector<uint32_t> outlier_frames;	// sample window positions of the frames outside the gpu total's fences
+
+	// per frame averages over the sample frames, the frame and culling frame numbers are those of the last sample
+	FrameStats frame_stats;
+
+	// per frame averages of the passes that did work, empty when pipeline statistics queries are unsupported
+	std::vector<std::pair<std::string, PipelineStatisticsResult>> pipeline_statistics;
+};
+
+// renders every capture point of a model offscreen for each combination of the requested resolutions,
+// multisample levels and render modes, then writes the frame and gpu stage times as json and csv
+class BenchmarkApp : public App
+{
+public:
+	BenchmarkApp(const BenchmarkSettings& settings);
+
+	// returns false when the arguments do not request a benchmark, throws on a malformed argument
+	static bool ParseArguments(int argc, char* argv[], BenchmarkSettings& settings);
+
+	virtual void Run();
+
+protected:
+	virtual bool InitWindow();
+	virtual void MainLoop();
+	virtual std::vector<const char*> GetRequiredExtensions();
+
+	virtual void RunCapturePoint(uint32_t index, const PerformanceCapturePoint& capture_point);
+	virtual void WriteResults();
+
+	// quote a string field for the json and csv outputs, paths and device names may hold quotes or backslashes
+	static std::string JsonString(const std::string& value);
+	static std::string CsvString(const std::string& value);
+
+protected:
+	BenchmarkSettings settings_;
+	std::string render_mode_;
+	std::string device_name_;
+	uint32_t vertex_stride_;
+	uint64_t vertex_buffer_bytes_;
+	std::vector<BenchmarkResult> results_;
+};
+
+#endif
\ No newline at end of file
@@ -6,9 +6,9 @@ void BufferVisualisationPipeline::RecordCommands(VkCommandBuffer& command_buffer
 	VkRenderPassBeginInfo render_pass_info = {};
 	render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	render_pass_info.renderPass = render_pass_;
-	render_pass_info.framebuffer = framebuffers_[buffer_index];
+	render_pass_info.framebuffer = framebuffers_[0];
 	render_pass_info.renderArea.offset = { 0, 0 };
-	render_pass_info.renderArea.extent = swap_chain_->GetSwapChainExtent();
+	render_pass_info.renderArea.extent = swap_chain_->GetIntermediateImageExtent();
 	render_pass_info.clearValueCount = 0;
 	render_pass_info.pClearValues = nullptr;
 
@@ -20,8 +20,8 @@ void BufferVisualisationPipeline::RecordCommands(VkCommandBuffer& command_buffer
 	VkViewport viewport = {};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = (float)(swap_chain_->GetSwapChainExtent().width);
-	viewport.height = (float)(swap_chain_->GetSwapChainExtent().height);
+	viewport.width = (float)(swap_chain_->GetIntermediateImageExtent().width);
+	viewport.height = (float)(swap_chain_->GetIntermediateImageExtent().height);
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 	vkCmdSetViewport(command_buffer, 0, 1, &viewport);
@@ -29,7 +29,7 @@ void BufferVisualisationPipeline::RecordCommands(VkCommandBuffer& command_buffer
 	// set the dynamic scissor data
 	VkRect2D scissor = {};
 	scissor.offset = { 0, 0 };
-	scissor.extent = swap_chain_->GetSwapChainExtent();
+	scissor.extent = swap_chain_->GetIntermediateImageExtent();
 	vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 	
 	// bind the descriptor set to the pipeline
@@ -83,7 +83,7 @@ void BufferVisualisationPipeline::CreatePipeline()
 	pipeline_info.basePipelineIndex = -1;
 	pipeline_info.flags = 0;
 
-	if (vkCreateGraphicsPipelines(devices_->GetLogicalDevice(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline_) != VK_SUCCESS)
+	if (devices_->CreateGraphicsPipelines(1, &pipeline_info, &pipeline_) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create buffer visualisation pipeline!");
 	}
@@ -92,26 +92,23 @@ void BufferVisualisationPipeline::CreatePipeline()
 
 void BufferVisualisationPipeline::CreateFramebuffers()
 {
-	std::vector<VkImageView>& image_views = swap_chain_->GetSwapChainImageViews();
-	framebuffers_.resize(image_views.size());
+	VkImageView image_view = swap_chain_->GetIntermediateImageView();
+	framebuffers_.resize(1);
 
-	for (size_t i = 0; i < image_views.size(); i++)
+	std::array<VkImageView, 1> attachments = { image_view };
+
+	VkFramebufferCreateInfo framebuffer_info = {};
+	framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebuffer_info.renderPass = render_pass_;
+	framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+	framebuffer_info.pAttachments = attachments.data();
+	framebuffer_info.width = swap_chain_->GetIntermediateImageExtent().width;
+	framebuffer_info.height = swap_chain_->GetIntermediateImageExtent().height;
+	framebuffer_info.layers = 1;
+
+	if (vkCreateFramebuffer(devices_->GetLogicalDevice(), &framebuffer_info, nullptr, &framebuffers_[0]) != VK_SUCCESS)
 	{
-		std::array<VkImageView, 1> attachments = { image_views[i] };
-
-		VkFramebufferCreateInfo framebuffer_info = {};
-		framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebuffer_info.renderPass = render_pass_;
-		framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
-		framebuffer_info.pAttachments = attachments.data();
-		framebuffer_info.width = swap_chain_->GetSwapChainExtent().width;
-		framebuffer_info.height = swap_chain_->GetSwapChainExtent().height;
-		framebuffer_info.layers = 1;
-
-		if (vkCreateFramebuffer(devices_->GetLogicalDevice(), &framebuffer_info, nullptr, &framebuffers_[i]) != VK_SUCCESS)
-		{
-			throw std::runtime_error("failed to create framebuffer!");
-		}
+		throw std::runtime_error("failed to create framebuffer!");
 	}
 }
 
@@ -119,14 +116,14 @@ void BufferVisualisationPipeline::CreateRenderPass()
 {
 	// setup the color buffer attachment
 	VkAttachmentDescription color_attachment = {};
-	color_attachment.format = swap_chain_->GetSwapChainImageFormat();
+	color_attachment.format = swap_chain_->GetIntermediateImageFormat();
 	color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	color_attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	color_attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 	// setup the subpass attachment description
 	VkAttachmentReference color_attachment_ref = {};
@@ -3,6 +3,30 @@
 
 #include "pipeline.h"
 
+#define BUFFER_VISUALISATION_MODE_COUNT 8
+
+// the views of the buffer visualisation, the values are the shader's view indices
+enum class BufferVisualisationMode
+{
+	DEPTH,
+	OVERDRAW,				// fragments the visibility pass wrote to each pixel
+	LIGHT_COUNT,			// lights evaluated for the nearest surface
+	PEEL_OCCUPANCY,			// peel layers holding a surface
+	SHAPE_ID,
+	TRIANGLE_ID,
+	CULLING,				// drawn surfaces and the bounds of the culled shapes
+	SHADOW_TEXEL_DENSITY	// shadow map texels per pixel of the worst sampled shadow
+};
+
+struct BufferVisualisationData
+{
+	glm::vec4 screen_dimensions;
+	glm::mat4 invView;
+	glm::mat4 invProj;
+	glm::uvec4 view_data;	// mode, shape count
+};
+
+// draws a false colour view of the peeled visibility buffers over the intermediate image
 class BufferVisualisationPipeline : public VulkanPipeline
 {
 public:
@@ -50,7 +50,7 @@ void DeferredComputePipeline::CreatePipeline()
 	pipeline_info.basePipelineIndex = -1;
 	pipeline_info.flags = 0;
 
-	if (vkCreateComputePipelines(devices_->GetLogicalDevice(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline_) != VK_SUCCESS)
+	if (devices_->CreateComputePipelines(1, &pipeline_info, &pipeline_) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create deferred compute pipeline!");
 	}
@@ -1,11 +1,26 @@
 #include "device.h"
+#include "trace_profiler.h"
 #include "app.h"
+#include "barrier_batch.h"
 #include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+
+#define PIPELINE_CACHE_MAGIC 0x48435056
 
 VulkanDevices::VulkanDevices(VkInstance instance, VkSurfaceKHR surface, VkPhysicalDeviceFeatures required_features, std::vector<const char*> required_extensions)
 {
 	physical_device_ = VK_NULL_HANDLE;
 	logical_device_ = VK_NULL_HANDLE;
+	upload_manager_ = nullptr;
+	queue_submit_count_ = 0;
+	submitted_batch_count_ = 0;
+	idle_wait_count_ = 0;
+	memory_allocator_ = nullptr;
+	pipeline_cache_ = VK_NULL_HANDLE;
+	pipeline_cache_statistics_ = {};
+	enabled_features_ = {};
 
 	// initialize physical device
 	PickPhysicalDevice(instance, surface, required_features, required_extensions);
@@ -13,6 +28,29 @@ VulkanDevices::VulkanDevices(VkInstance instance, VkSurfaceKHR surface, VkPhysic
 
 VulkanDevices::~VulkanDevices()
 {
+	if (upload_manager_)
+	{
+		upload_manager_->Cleanup();
+		delete upload_manager_;
+		upload_manager_ = nullptr;
+	}
+
+	// write the pipeline cache back so the next run starts warm
+	if (pipeline_cache_ != VK_NULL_HANDLE)
+	{
+		SavePipelineCache();
+		vkDestroyPipelineCache(logical_device_, pipeline_cache_, nullptr);
+		pipeline_cache_ = VK_NULL_HANDLE;
+	}
+
+	// every resource has freed its allocation by now, release the blocks before the device
+	if (memory_allocator_)
+	{
+		memory_allocator_->Cleanup();
+		delete memory_allocator_;
+		memory_allocator_ = nullptr;
+	}
+
 	vkDestroyCommandPool(logical_device_, transient_command_pool_, nullptr);
 	vkDestroyDevice(logical_device_, nullptr);
 }
@@ -69,6 +107,7 @@ void VulkanDevices::CreateLogicalDevice(VkPhysicalDeviceFeatures required_featur
 	create_info.queueCreateInfoCount = static_cast<uint32_t>(required_queues.size());
 	create_info.pQueueCreateInfos = required_queues.data();
 	create_info.pEnabledFeatures = &required_features;
+	enabled_features_ = required_features;
 	create_info.enabledExtensionCount = static_cast<uint32_t>(required_extensions.size());
 	create_info.ppEnabledExtensionNames = required_extensions.data();
 
@@ -88,8 +127,17 @@ void VulkanDevices::CreateLogicalDevice(VkPhysicalDeviceFeatures required_featur
 	}
 
 	CreateCopyCommandPool();
+	CreatePipelineCache();
+
+	// create the allocator all buffers and images are sub-allocated from
+	memory_allocator_ = new VulkanMemoryAllocator();
+	memory_allocator_->Init(physical_device_, logical_device_);
 
 	vkGetDeviceQueue(logical_device_, queue_family_indices_.graphics_family, 0, &copy_queue_);
+
+	// create the upload manager used for batched staging copies
+	upload_manager_ = new VulkanUploadManager();
+	upload_manager_->Init(this, copy_queue_, queue_family_indices_.graphics_family);
 }
 
 void VulkanDevices::CreateCopyCommandPool()
@@ -105,6 +153,133 @@ void VulkanDevices::CreateCopyCommandPool()
 	}
 }
 
+void VulkanDevices::CreatePipelineCache()
+{
+	TRACE_FUNCTION();
+
+	pipeline_cache_statistics_ = {};
+
+	// load the cache written by the previous run, if it was written by this device and driver
+	std::vector<char> cache_data;
+	std::ifstream file(PIPELINE_CACHE_FILE, std::ios::ate | std::ios::binary);
+
+	if (file.is_open() && static_cast<size_t>(file.tellg()) >= sizeof(PipelineCacheFileHeader))
+	{
+		size_t file_size = static_cast<size_t>(file.tellg());
+		file.seekg(0);
+
+		PipelineCacheFileHeader file_header = {};
+		file.read(reinterpret_cast<char*>(&file_header), sizeof(PipelineCacheFileHeader));
+
+		PipelineCacheFileHeader device_header = {};
+		FillPipelineCacheHeader(device_header);
+		device_header.data_size = file_size - sizeof(PipelineCacheFileHeader);
+
+		if (memcmp(&file_header, &device_header, sizeof(PipelineCacheFileHeader)) == 0)
+		{
+			cache_data.resize(static_cast<size_t>(file_header.data_size));
+			file.read(cache_data.data(), cache_data.size());
+		}
+		else
+		{
+			std::cout << "Discarding pipeline cache written by a different device or driver" << std::endl;
+		}
+	}
+	file.close();
+
+	VkPipelineCacheCreateInfo cache_info = {};
+	cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cache_info.initialDataSize = cache_data.size();
+	cache_info.pInitialData = cache_data.empty() ? nullptr : cache_data.data();
+
+	// the driver rejects data it can not use, start cold rather than failing
+	if (vkCreatePipelineCache(logical_device_, &cache_info, nullptr, &pipeline_cache_) != VK_SUCCESS)
+	{
+		cache_info.initialDataSize = 0;
+		cache_info.pInitialData = nullptr;
+		cache_data.clear();
+
+		if (vkCreatePipelineCache(logical_device_, &cache_info, nullptr, &pipeline_cache_) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create pipeline cache!");
+		}
+	}
+
+	pipeline_cache_statistics_.loaded_from_disk = !cache_data.empty();
+	pipeline_cache_statistics_.loaded_bytes = cache_data.size();
+}
+
+void VulkanDevices::FillPipelineCacheHeader(PipelineCacheFileHeader& header)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physical_device_, &properties);
+
+	header.magic = PIPELINE_CACHE_MAGIC;
+	header.vendor_id = properties.vendorID;
+	header.device_id = properties.deviceID;
+	header.driver_version = properties.driverVersion;
+	memcpy(header.pipeline_cache_uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+void VulkanDevices::SavePipelineCache()
+{
+	TRACE_FUNCTION();
+
+	size_t data_size = 0;
+	if (vkGetPipelineCacheData(logical_device_, pipeline_cache_, &data_size, nullptr) != VK_SUCCESS || data_size == 0)
+		return;
+
+	std::vector<char> cache_data(data_size);
+	if (vkGetPipelineCacheData(logical_device_, pipeline_cache_, &data_size, cache_data.data()) != VK_SUCCESS)
+		return;
+
+	PipelineCacheFileHeader header = {};
+	FillPipelineCacheHeader(header);
+	header.data_size = data_size;
+
+	std::ofstream file(PIPELINE_CACHE_FILE, std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		return;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(PipelineCacheFileHeader));
+	file.write(cache_data.data(), data_size);
+
+	file.close();
+}
+
+VkResult VulkanDevices::CreateGraphicsPipelines(uint32_t count, const VkGraphicsPipelineCreateInfo* create_infos, VkPipeline* pipelines)
+{
+	TRACE_FUNCTION();
+
+	auto start_time = std::chrono::high_resolution_clock::now();
+	VkResult result = vkCreateGraphicsPipelines(logical_device_, pipeline_cache_, count, create_infos, nullptr, pipelines);
+	auto end_time = std::chrono::high_resolution_clock::now();
+
+	std::unique_lock<std::mutex> lock(pipeline_statistics_mutex_);
+	pipeline_cache_statistics_.pipeline_count += count;
+	pipeline_cache_statistics_.creation_time += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+
+	return result;
+}
+
+VkResult VulkanDevices::CreateComputePipelines(uint32_t count, const VkComputePipelineCreateInfo* create_infos, VkPipeline* pipelines)
+{
+	TRACE_FUNCTION();
+
+	auto start_time = std::chrono::high_resolution_clock::now();
+	VkResult result = vkCreateComputePipelines(logical_device_, pipeline_cache_, count, create_infos, nullptr, pipelines);
+	auto end_time = std::chrono::high_resolution_clock::now();
+
+	std::unique_lock<std::mutex> lock(pipeline_statistics_mutex_);
+	pipeline_cache_statistics_.pipeline_count += count;
+	pipeline_cache_statistics_.creation_time += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+
+	return result;
+}
+
 VkImageView VulkanDevices::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect_flags)
 {
 	VkImageViewCreateInfo view_info = {};
@@ -143,9 +318,9 @@ bool VulkanDevices::IsDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surfa
 	// check the device supports required extensions
 	bool extensions_supported = CheckDeviceExtensionSupport(device, required_extensions);
 	
-	// check the device supports the correct swap chain features
-	bool swap_chain_adequate = false;
-	if (extensions_supported)
+	// check the device supports the correct swap chain features, a headless device renders offscreen without one
+	bool swap_chain_adequate = (surface == VK_NULL_HANDLE);
+	if (extensions_supported && surface != VK_NULL_HANDLE)
 	{
 		SwapChainSupportDetails swap_chain_support = QuerySwapChainSupport(device, surface);
 		swap_chain_adequate = !swap_chain_support.formats.empty() && !swap_chain_support.present_modes.empty();
@@ -231,8 +406,10 @@ void VulkanDevices::CreateCommandBuffers(VkCommandPool command_pool, VkCommandBu
 	}
 }
 
-void VulkanDevices::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& buffer_memory)
+void VulkanDevices::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& buffer_memory, AllocationStrategy strategy)
 {
+	TRACE_FUNCTION();
+
 	VkResult result;
 
 	VkBufferCreateInfo buffer_info = {};
@@ -250,21 +427,29 @@ void VulkanDevices::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, Vk
 	VkMemoryRequirements mem_requirements;
 	vkGetBufferMemoryRequirements(logical_device_, buffer, &mem_requirements);
 
-	VkMemoryAllocateInfo alloc_info = {};
-	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	alloc_info.allocationSize = mem_requirements.size;
-	alloc_info.memoryTypeIndex = FindMemoryType(mem_requirements.memoryTypeBits, properties, mem_requirements.size);
+	uint32_t memory_type = FindMemoryType(mem_requirements.memoryTypeBits, properties, mem_requirements.size);
+	buffer_memory = memory_allocator_->Allocate(mem_requirements, memory_type, false, strategy);
 
-	result = vkAllocateMemory(logical_device_, &alloc_info, nullptr, &buffer_memory);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to allocate buffer memory!");
-	}
+	vkBindBufferMemory(logical_device_, buffer, buffer_memory.memory, buffer_memory.offset);
+}
 
-	vkBindBufferMemory(logical_device_, buffer, buffer_memory, 0);
+void VulkanDevices::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkSampleCountFlagBits sample_count, VkImage& image, MemoryAllocation& image_memory, AllocationStrategy strategy)
+{
+	TRACE_FUNCTION();
+
+	CreateUnboundImage(width, height, format, tiling, usage, sample_count, image);
+
+	VkMemoryRequirements mem_requirements;
+	vkGetImageMemoryRequirements(logical_device_, image, &mem_requirements);
+
+	// linear tiled images can share blocks with buffers without breaking bufferImageGranularity
+	uint32_t memory_type = FindMemoryType(mem_requirements.memoryTypeBits, properties, mem_requirements.size);
+	image_memory = memory_allocator_->Allocate(mem_requirements, memory_type, tiling == VK_IMAGE_TILING_OPTIMAL, strategy);
+
+	vkBindImageMemory(logical_device_, image, image_memory.memory, image_memory.offset);
 }
 
-void VulkanDevices::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkSampleCountFlagBits sample_count, VkImage& image, VkDeviceMemory& image_memory)
+void VulkanDevices::CreateUnboundImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkSampleCountFlagBits sample_count, VkImage& image)
 {
 	VkImageCreateInfo image_info = {};
 	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -286,28 +471,17 @@ void VulkanDevices::CreateImage(uint32_t width, uint32_t height, VkFormat format
 	{
 		throw std::runtime_error("failed to create image!");
 	}
+}
 
-	VkMemoryRequirements mem_requirements;
-	vkGetImageMemoryRequirements(logical_device_, image, &mem_requirements);
-
-	VkMemoryAllocateInfo alloc_info = {};
-	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	alloc_info.allocationSize = mem_requirements.size;
-	alloc_info.memoryTypeIndex = FindMemoryType(mem_requirements.memoryTypeBits, properties, mem_requirements.size);
-
-	VkResult result = vkAllocateMemory(logical_device_, &alloc_info, nullptr, &image_memory);
-	if ( result != VK_SUCCESS)
-	{
-		std::cout << result << std::endl;
-		std::cin.ignore();
-		throw std::runtime_error("failed to allocate image memory!");
-	}
-
-	vkBindImageMemory(logical_device_, image, image_memory, 0);
+void VulkanDevices::FreeMemory(MemoryAllocation& memory)
+{
+	memory_allocator_->Free(memory);
 }
 
 void VulkanDevices::TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout)
 {
+	TRACE_FUNCTION();
+
 	VkCommandBuffer command_buffer = BeginSingleTimeCommands();
 
 	VkImageMemoryBarrier barrier = {};
@@ -433,6 +607,8 @@ void VulkanDevices::TransitionImageLayout(VkImage image, VkFormat format, VkImag
 
 void VulkanDevices::CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size, VkDeviceSize offset)
 {
+	TRACE_FUNCTION();
+
 	VkCommandBuffer command_buffer = BeginSingleTimeCommands();
 
 	VkBufferCopy copy_region = {};
@@ -447,6 +623,8 @@ void VulkanDevices::CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDevic
 
 void VulkanDevices::CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
 {
+	TRACE_FUNCTION();
+
 	VkCommandBuffer command_buffer = BeginSingleTimeCommands();
 
 	VkBufferImageCopy region = {};
@@ -472,16 +650,57 @@ void VulkanDevices::CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t w
 	EndSingleTimeCommands(command_buffer);
 }
 
-void VulkanDevices::CopyDataToBuffer(VkDeviceMemory dst_buffer_memory, void* data, VkDeviceSize size, VkDeviceSize offset)
+void VulkanDevices::CopyImageToBuffer(VkImage image, VkImageLayout image_layout, VkBuffer buffer, uint32_t width, uint32_t height)
+{
+	TRACE_FUNCTION();
+
+	VkCommandBuffer command_buffer = BeginSingleTimeCommands();
+
+	VulkanBarrierBatch barrier_batch;
+	barrier_batch.TransitionImage(image, VK_IMAGE_ASPECT_COLOR_BIT, image_layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	barrier_batch.Record(command_buffer);
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent =
+	{
+		width,
+		height,
+		1
+	};
+
+	vkCmdCopyImageToBuffer(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+	barrier_batch.TransitionImage(image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image_layout);
+	barrier_batch.Record(command_buffer);
+
+	EndSingleTimeCommands(command_buffer);
+}
+
+void VulkanDevices::CopyDataToBuffer(MemoryAllocation& dst_buffer_memory, void* data, VkDeviceSize size, VkDeviceSize offset)
 {
-	void* mapped_data; 
-	vkMapMemory(logical_device_, dst_buffer_memory, offset, size, 0, &mapped_data);
-	memcpy(mapped_data, data, size);
-	vkUnmapMemory(logical_device_, dst_buffer_memory);
+	// host visible allocations are persistently mapped by the allocator
+	if (!dst_buffer_memory.mapped_data)
+	{
+		throw std::runtime_error("failed to copy data to buffer, memory is not host visible!");
+	}
+
+	memcpy(static_cast<char*>(dst_buffer_memory.mapped_data) + offset, data, size);
 }
 
 void VulkanDevices::CopyImage(VkImage src, VkImage dst, VkImageLayout src_layout, VkImageLayout dst_layout, VkOffset3D dim)
 {
+	TRACE_FUNCTION();
+
 	// start the copy command buffer
 	VkCommandBuffer blit_buffer = BeginSingleTimeCommands();
 
@@ -508,6 +727,8 @@ void VulkanDevices::CopyImage(VkImage src, VkImage dst, VkImageLayout src_layout
 
 void VulkanDevices::ClearImage(VkImage image, VkImageLayout image_layout, VkClearColorValue clear_color)
 {
+	TRACE_FUNCTION();
+
 	// clear the image
 	VkCommandBuffer clear_buffer = BeginSingleTimeCommands();
 
@@ -543,6 +764,8 @@ VkCommandBuffer VulkanDevices::BeginSingleTimeCommands()
 
 void VulkanDevices::EndSingleTimeCommands(VkCommandBuffer command_buffer, VkSemaphore wait_semaphore)
 {
+	TRACE_FUNCTION();
+
 	vkEndCommandBuffer(command_buffer);
 
 	VkSubmitInfo submit_info = {};
@@ -560,10 +783,21 @@ void VulkanDevices::EndSingleTimeCommands(VkCommandBuffer command_buffer, VkSema
 
 	vkQueueSubmit(copy_queue_, 1, &submit_info, VK_NULL_HANDLE);
 	vkQueueWaitIdle(copy_queue_);
+	CountQueueSubmit();
+	CountIdleWait();
 
 	vkFreeCommandBuffers(logical_device_, transient_command_pool_, 1, &command_buffer);
 }
 
+DeviceActivity VulkanDevices::GetActivity()
+{
+	DeviceActivity activity = {};
+	activity.queue_submits = queue_submit_count_.load();
+	activity.submitted_batches = submitted_batch_count_.load();
+	activity.idle_waits = idle_wait_count_.load();
+	return activity;
+}
+
 QueueFamilyIndices VulkanDevices::FindQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface)
 {
 	QueueFamilyIndices indices;
@@ -596,9 +830,12 @@ QueueFamilyIndices VulkanDevices::FindQueueFamilies(VkPhysicalDevice device, VkS
 			indices.compute_family = i;
 		}
 
-		// check for present queue support
+		// check for present queue support, without a surface the graphics queue finishes each frame
 		VkBool32 present_support = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present_support);
+		if (surface != VK_NULL_HANDLE)
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present_support);
+		else
+			present_support = (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
 		if (queue_family.queueCount > 0 && present_support)
 		{
 			indices.present_family = i;
@@ -3,6 +3,14 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+
+#include "upload_manager.h"
+#include "memory_allocator.h"
+
+#define PIPELINE_CACHE_FILE "pipeline_cache.bin"
 
 typedef bool(*check_function)(void);
 
@@ -26,6 +34,22 @@ struct QueueFamilyIndices
 	}
 };
 
+struct PipelineCacheStatistics
+{
+	bool loaded_from_disk;		// the cache was warm when the device was created
+	size_t loaded_bytes;
+	uint32_t pipeline_count;	// pipelines created through the cache
+	double creation_time;		// milliseconds spent creating them
+};
+
+// totals since the device was created, counted wherever the renderer submits work or blocks on the device
+struct DeviceActivity
+{
+	uint64_t queue_submits;		// vkQueueSubmit calls
+	uint64_t submitted_batches;	// submit infos across those calls
+	uint64_t idle_waits;		// queue and device idle waits and blocking fence waits, the frame fences are not counted
+};
+
 struct SwapChainSupportDetails
 {
 	VkSurfaceCapabilitiesKHR capabilities;
@@ -41,14 +65,23 @@ public:
 
 	void CreateLogicalDevice(VkPhysicalDeviceFeatures, std::vector<VkDeviceQueueCreateInfo>, std::vector<const char*>, std::vector<const char*>);
 
-	void CreateBuffer(VkDeviceSize, VkBufferUsageFlags, VkMemoryPropertyFlags, VkBuffer&, VkDeviceMemory&);
-	void CreateImage(uint32_t, uint32_t, VkFormat, VkImageTiling, VkImageUsageFlags, VkMemoryPropertyFlags, VkSampleCountFlagBits, VkImage&, VkDeviceMemory&);
+	void CreateBuffer(VkDeviceSize, VkBufferUsageFlags, VkMemoryPropertyFlags, VkBuffer&, MemoryAllocation&, AllocationStrategy = AllocationStrategy::BUDDY);
+	void CreateImage(uint32_t, uint32_t, VkFormat, VkImageTiling, VkImageUsageFlags, VkMemoryPropertyFlags, VkSampleCountFlagBits, VkImage&, MemoryAllocation&, AllocationStrategy = AllocationStrategy::BUDDY);
+	void CreateUnboundImage(uint32_t, uint32_t, VkFormat, VkImageTiling, VkImageUsageFlags, VkSampleCountFlagBits, VkImage&);
+	void FreeMemory(MemoryAllocation&);
 	VkImageView CreateImageView(VkImage, VkFormat, VkImageAspectFlags);
 	void CreateCommandBuffers(VkCommandPool command_pool, VkCommandBuffer* buffers, uint8_t count = 1);
 
+	// every pipeline is created through the device's pipeline cache
+	VkResult CreateGraphicsPipelines(uint32_t count, const VkGraphicsPipelineCreateInfo* create_infos, VkPipeline* pipelines);
+	VkResult CreateComputePipelines(uint32_t count, const VkComputePipelineCreateInfo* create_infos, VkPipeline* pipelines);
+	void SavePipelineCache();
+
 	void CopyBuffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size, VkDeviceSize offset = 0);
 	void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-	void CopyDataToBuffer(VkDeviceMemory dst_buffer_memory, void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+	// the image is returned to its layout once copied
+	void CopyImageToBuffer(VkImage image, VkImageLayout image_layout, VkBuffer buffer, uint32_t width, uint32_t height);
+	void CopyDataToBuffer(MemoryAllocation& dst_buffer_memory, void* data, VkDeviceSize size, VkDeviceSize offset = 0);
 	void CopyImage(VkImage src_image, VkImage dst_image, VkImageLayout src_layout, VkImageLayout dst_layout, VkOffset3D dimensions);
 	void ClearImage(VkImage image, VkImageLayout image_layout, VkClearColorValue clear_color);
 
@@ -57,6 +90,16 @@ public:
 	VkPhysicalDevice GetPhysicalDevice() { return physical_device_; }
 	VkDevice GetLogicalDevice() { return logical_device_; }
 	QueueFamilyIndices GetQueueFamilyIndices() { return queue_family_indices_; }
+	VulkanUploadManager* GetUploadManager() { return upload_manager_; }
+	VulkanMemoryAllocator* GetMemoryAllocator() { return memory_allocator_; }
+	VkPipelineCache GetPipelineCache() { return pipeline_cache_; }
+	PipelineCacheStatistics GetPipelineCacheStatistics() { return pipeline_cache_statistics_; }
+	const VkPhysicalDeviceFeatures& GetEnabledFeatures() { return enabled_features_; }
+
+	// cheap enough to call on every submit or wait from any thread
+	inline void CountQueueSubmit(uint32_t batch_count = 1) { queue_submit_count_++; submitted_batch_count_ += batch_count; }
+	inline void CountIdleWait() { idle_wait_count_++; }
+	DeviceActivity GetActivity();
 
 	uint32_t FindMemoryType(uint32_t, VkMemoryPropertyFlags, VkDeviceSize);
 	VkFormat FindSupportedFormat(const std::vector<VkFormat>&, VkImageTiling, VkFormatFeatureFlags);
@@ -68,8 +111,22 @@ public:
 	VkCommandBuffer BeginSingleTimeCommands();
 	void EndSingleTimeCommands(VkCommandBuffer, VkSemaphore = VK_NULL_HANDLE);
 
+protected:
+	// prefixed to the cache data on disk, the data is discarded when the device or driver differs
+	struct PipelineCacheFileHeader
+	{
+		uint32_t magic;
+		uint32_t vendor_id;
+		uint32_t device_id;
+		uint32_t driver_version;
+		uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+		uint64_t data_size;
+	};
+
 protected:
 	void CreateCopyCommandPool();
+	void CreatePipelineCache();
+	void FillPipelineCacheHeader(PipelineCacheFileHeader& header);
 
 	bool HasStencilComponent(VkFormat format);
 
@@ -82,10 +139,22 @@ protected:
 	VkPhysicalDevice physical_device_;
 	VkDevice logical_device_;
 	QueueFamilyIndices queue_family_indices_;
+	VkPhysicalDeviceFeatures enabled_features_;
 
 	VkCommandPool transient_command_pool_;
 	VkQueue copy_queue_;
 
+	VulkanUploadManager* upload_manager_;
+	VulkanMemoryAllocator* memory_allocator_;
+
+	VkPipelineCache pipeline_cache_;
+	PipelineCacheStatistics pipeline_cache_statistics_;
+	std::mutex pipeline_statistics_mutex_;	// pipelines are created from several threads
+
+	std::atomic<uint64_t> queue_submit_count_;
+	std::atomic<uint64_t> submitted_batch_count_;
+	std::atomic<uint64_t> idle_wait_count_;
+
 public:
 	static std::vector<char> ReadFile(const std::string& filename);
 	static void AppendFile(const std::string& filename, const std::string& contents);
@@ -0,0 +1,294 @@
+#include "frame_constants.h"
+#include "device.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+VulkanFrameConstants::VulkanFrameConstants()
+{
+	devices_ = nullptr;
+	logical_device_ = VK_NULL_HANDLE;
+	queue_ = VK_NULL_HANDLE;
+	command_pool_ = VK_NULL_HANDLE;
+	current_slot_ = 0;
+	offset_alignment_ = 256;
+	direct_device_writes_ = false;
+	statistics_ = {};
+}
+
+void VulkanFrameConstants::Init(VulkanDevices* devices, VkQueue queue, uint32_t queue_family, bool allow_direct_writes)
+{
+	devices_ = devices;
+	logical_device_ = devices->GetLogicalDevice();
+	queue_ = queue;
+
+	// frame slices are aligned so each one is a valid uniform or storage buffer offset
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(devices_->GetPhysicalDevice(), &properties);
+	offset_alignment_ = std::max(properties.limits.minUniformBufferOffsetAlignment, properties.limits.minStorageBufferOffsetAlignment);
+	offset_alignment_ = std::max(offset_alignment_, properties.limits.nonCoherentAtomSize);
+
+	direct_device_writes_ = allow_direct_writes && FindDeviceHostMemory();
+	statistics_.direct_device_writes = direct_device_writes_;
+
+	// create the copy command pool
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.queueFamilyIndex = queue_family;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	if (vkCreateCommandPool(logical_device_, &pool_info, nullptr, &command_pool_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create frame constant command pool!");
+	}
+
+	// create the per slot command buffers and synchronisation objects
+	VkFenceCreateInfo fence_info = {};
+	fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkSemaphoreCreateInfo semaphore_info = {};
+	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (int i = 0; i < FRAME_CONSTANT_SLOT_COUNT; i++)
+	{
+		devices_->CreateCommandBuffers(command_pool_, &frame_slots_[i].command_buffer);
+		frame_slots_[i].submitted = false;
+
+		if (vkCreateFence(logical_device_, &fence_info, nullptr, &frame_slots_[i].fence) != VK_SUCCESS ||
+			vkCreateSemaphore(logical_device_, &semaphore_info, nullptr, &copy_semaphores_[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create frame constant synchronisation objects!");
+		}
+	}
+}
+
+void VulkanFrameConstants::Cleanup()
+{
+	// removing the buffers waits for any outstanding copies
+	for (FrameConstantHandle i = 0; i < buffers_.size(); i++)
+	{
+		RemoveBuffer(i);
+	}
+	buffers_.clear();
+
+	for (int i = 0; i < FRAME_CONSTANT_SLOT_COUNT; i++)
+	{
+		vkDestroyFence(logical_device_, frame_slots_[i].fence, nullptr);
+		vkDestroySemaphore(logical_device_, copy_semaphores_[i], nullptr);
+	}
+
+	vkDestroyCommandPool(logical_device_, command_pool_, nullptr);
+}
+
+FrameConstantHandle VulkanFrameConstants::AddBuffer(VkDeviceSize size, VkBufferUsageFlags usage)
+{
+	ConstantBuffer constant_buffer = {};
+	constant_buffer.active = true;
+	constant_buffer.size = size;
+	constant_buffer.slot_stride = (size + offset_alignment_ - 1) & ~(offset_alignment_ - 1);
+	constant_buffer.dirty_begin = size;
+	constant_buffer.dirty_end = 0;
+
+	if (direct_device_writes_)
+	{
+		// the host writes straight into video memory, no staging copy is required
+		devices_->CreateBuffer(size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, constant_buffer.buffer, constant_buffer.buffer_memory);
+	}
+	else
+	{
+		// device local copy for the shaders and a mapped staging ring it is refreshed from
+		devices_->CreateBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, constant_buffer.buffer, constant_buffer.buffer_memory);
+		devices_->CreateBuffer(constant_buffer.slot_stride * FRAME_CONSTANT_SLOT_COUNT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, constant_buffer.staging_buffer, constant_buffer.staging_buffer_memory);
+	}
+
+	// reuse a removed slot if there is one
+	for (FrameConstantHandle i = 0; i < buffers_.size(); i++)
+	{
+		if (!buffers_[i].active)
+		{
+			buffers_[i] = constant_buffer;
+			return i;
+		}
+	}
+
+	buffers_.push_back(constant_buffer);
+	return static_cast<FrameConstantHandle>(buffers_.size() - 1);
+}
+
+void VulkanFrameConstants::RemoveBuffer(FrameConstantHandle handle)
+{
+	ConstantBuffer& constant_buffer = buffers_[handle];
+	if (!constant_buffer.active)
+		return;
+
+	// a pending copy may still target the buffer
+	for (int i = 0; i < FRAME_CONSTANT_SLOT_COUNT; i++)
+	{
+		if (frame_slots_[i].submitted)
+		{
+			vkWaitForFences(logical_device_, 1, &frame_slots_[i].fence, VK_TRUE, UINT64_MAX);
+			vkResetFences(logical_device_, 1, &frame_slots_[i].fence);
+			devices_->CountIdleWait();
+			frame_slots_[i].submitted = false;
+		}
+	}
+
+	vkDestroyBuffer(logical_device_, constant_buffer.buffer, nullptr);
+	devices_->FreeMemory(constant_buffer.buffer_memory);
+
+	if (constant_buffer.staging_buffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(logical_device_, constant_buffer.staging_buffer, nullptr);
+		devices_->FreeMemory(constant_buffer.staging_buffer_memory);
+	}
+
+	constant_buffer = {};
+}
+
+void VulkanFrameConstants::BeginFrame()
+{
+	uint32_t previous_slot = current_slot_;
+	current_slot_ = (current_slot_ + 1) % FRAME_CONSTANT_SLOT_COUNT;
+	statistics_.frame_count++;
+
+	// the slot's staging slices are free once its last copy has executed
+	FrameSlot& slot = frame_slots_[current_slot_];
+	if (slot.submitted)
+	{
+		if (vkGetFenceStatus(logical_device_, slot.fence) != VK_SUCCESS)
+		{
+			statistics_.slot_stalls++;
+			vkWaitForFences(logical_device_, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+			devices_->CountIdleWait();
+		}
+
+		vkResetFences(logical_device_, 1, &slot.fence);
+		slot.submitted = false;
+	}
+
+	if (direct_device_writes_)
+		return;
+
+	// carry over anything written outside of a frame so it is copied from the new slot
+	for (ConstantBuffer& constant_buffer : buffers_)
+	{
+		if (!constant_buffer.active || constant_buffer.dirty_end <= constant_buffer.dirty_begin)
+			continue;
+
+		char* staging_data = static_cast<char*>(constant_buffer.staging_buffer_memory.mapped_data);
+		memcpy(staging_data + (current_slot_ * constant_buffer.slot_stride) + constant_buffer.dirty_begin,
+			staging_data + (previous_slot * constant_buffer.slot_stride) + constant_buffer.dirty_begin,
+			constant_buffer.dirty_end - constant_buffer.dirty_begin);
+	}
+}
+
+void VulkanFrameConstants::Write(FrameConstantHandle handle, const void* data, VkDeviceSize size, VkDeviceSize offset)
+{
+	ConstantBuffer& constant_buffer = buffers_[handle];
+	if (offset + size > constant_buffer.size)
+	{
+		throw std::runtime_error("failed to write frame constants, write is out of range!");
+	}
+
+	statistics_.bytes_written += size;
+
+	if (direct_device_writes_)
+	{
+		memcpy(static_cast<char*>(constant_buffer.buffer_memory.mapped_data) + offset, data, size);
+		return;
+	}
+
+	// write into this frame's slice and grow the range to copy
+	char* slice = static_cast<char*>(constant_buffer.staging_buffer_memory.mapped_data) + (current_slot_ * constant_buffer.slot_stride);
+	memcpy(slice + offset, data, size);
+
+	constant_buffer.dirty_begin = std::min(constant_buffer.dirty_begin, offset);
+	constant_buffer.dirty_end = std::max(constant_buffer.dirty_end, offset + size);
+}
+
+VkSemaphore VulkanFrameConstants::Submit()
+{
+	if (direct_device_writes_)
+		return VK_NULL_HANDLE;
+
+	FrameSlot& slot = frame_slots_[current_slot_];
+	if (slot.submitted)
+	{
+		throw std::runtime_error("failed to submit frame constants, slot was already submitted this frame!");
+	}
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkResetCommandBuffer(slot.command_buffer, 0);
+	vkBeginCommandBuffer(slot.command_buffer, &begin_info);
+
+	// earlier frames may still be reading the device local copies, hold the copies until their shaders are done
+	vkCmdPipelineBarrier(slot.command_buffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	for (ConstantBuffer& constant_buffer : buffers_)
+	{
+		if (!constant_buffer.active || constant_buffer.dirty_end <= constant_buffer.dirty_begin)
+			continue;
+
+		// one copy per buffer covering everything written this frame
+		VkBufferCopy copy_region = {};
+		copy_region.srcOffset = (current_slot_ * constant_buffer.slot_stride) + constant_buffer.dirty_begin;
+		copy_region.dstOffset = constant_buffer.dirty_begin;
+		copy_region.size = constant_buffer.dirty_end - constant_buffer.dirty_begin;
+
+		vkCmdCopyBuffer(slot.command_buffer, constant_buffer.staging_buffer, constant_buffer.buffer, 1, &copy_region);
+
+		statistics_.bytes_copied += copy_region.size;
+		statistics_.copy_commands++;
+
+		constant_buffer.dirty_begin = constant_buffer.size;
+		constant_buffer.dirty_end = 0;
+	}
+
+	// make the new constants visible to every shader stage of the following passes
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(slot.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	if (vkEndCommandBuffer(slot.command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record frame constant command buffer!");
+	}
+
+	VkSubmitInfo submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &slot.command_buffer;
+	submit_info.signalSemaphoreCount = 1;
+	submit_info.pSignalSemaphores = &copy_semaphores_[current_slot_];
+
+	if (vkQueueSubmit(queue_, 1, &submit_info, slot.fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit frame constant command buffer!");
+	}
+	devices_->CountQueueSubmit();
+
+	slot.submitted = true;
+	return copy_semaphores_[current_slot_];
+}
+
+bool VulkanFrameConstants::FindDeviceHostMemory()
+{
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	vkGetPhysicalDeviceMemoryProperties(devices_->GetPhysicalDevice(), &memory_properties);
+
+	VkMemoryPropertyFlags required = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+	{
+		if ((memory_properties.memoryTypes[i].propertyFlags & required) == required)
+			return true;
+	}
+
+	return false;
+}
\ No newline at end of file
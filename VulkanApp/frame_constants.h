@@ -0,0 +1,101 @@
+#ifndef _FRAME_CONSTANTS_H_
+#define _FRAME_CONSTANTS_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "memory_allocator.h"
+
+#define FRAME_CONSTANT_SLOT_COUNT 3
+
+class VulkanDevices;
+
+typedef uint32_t FrameConstantHandle;
+
+struct FrameConstantStatistics
+{
+	uint64_t frame_count;
+	uint64_t bytes_written;
+	uint64_t bytes_copied;
+	uint64_t copy_commands;
+	uint64_t slot_stalls;
+	bool direct_device_writes;
+};
+
+class VulkanFrameConstants
+{
+protected:
+	struct ConstantBuffer
+	{
+		bool active;
+		VkDeviceSize size;
+		VkDeviceSize slot_stride;
+
+		// device local copy bound by the pipelines
+		VkBuffer buffer;
+		MemoryAllocation buffer_memory;
+
+		// persistently mapped ring with one slice per frame slot, unused with device local host visible memory
+		VkBuffer staging_buffer;
+		MemoryAllocation staging_buffer_memory;
+
+		// range written since the last submit
+		VkDeviceSize dirty_begin;
+		VkDeviceSize dirty_end;
+	};
+
+	struct FrameSlot
+	{
+		VkCommandBuffer command_buffer;
+		VkFence fence;
+		bool submitted;
+	};
+
+public:
+	VulkanFrameConstants();
+
+	// direct writes are only safe when the previous frame has finished reading the buffers before the next one writes them
+	void Init(VulkanDevices* devices, VkQueue queue, uint32_t queue_family, bool allow_direct_writes = true);
+	void Cleanup();
+
+	// create a constant buffer, the returned handle's buffer never changes and can be baked into descriptor sets
+	FrameConstantHandle AddBuffer(VkDeviceSize size, VkBufferUsageFlags usage);
+	void RemoveBuffer(FrameConstantHandle handle);
+	VkBuffer GetBuffer(FrameConstantHandle handle) { return buffers_[handle].buffer; }
+
+	// move to the next frame slot, waiting only if the gpu is still copying from it
+	void BeginFrame();
+
+	// write into the current frame slot, no map calls are made
+	void Write(FrameConstantHandle handle, const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+	// copy every written range to its device local buffer, work submitted to the same queue afterwards sees the new data
+	// the copies wait for shaders submitted earlier on the queue, so the returned semaphore also orders other queues after them
+	// returns VK_NULL_HANDLE when writes go directly to device memory
+	VkSemaphore Submit();
+
+	FrameConstantStatistics GetStatistics() { return statistics_; }
+
+protected:
+	bool FindDeviceHostMemory();
+
+protected:
+	VulkanDevices* devices_;
+	VkDevice logical_device_;
+	VkQueue queue_;
+
+	VkCommandPool command_pool_;
+	FrameSlot frame_slots_[FRAME_CONSTANT_SLOT_COUNT];
+	VkSemaphore copy_semaphores_[FRAME_CONSTANT_SLOT_COUNT];
+	uint32_t current_slot_;
+
+	std::vector<ConstantBuffer> buffers_;
+	VkDeviceSize offset_alignment_;
+
+	// set when the device exposes device local memory the host can write directly (resizable bar or uma)
+	bool direct_device_writes_;
+
+	FrameConstantStatistics statistics_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "frame_time_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+FrameTimeStatistics::FrameTimeStatistics()
+{
+	active_ = false;
+	warmup_remaining_ = 0;
+	sample_frames_ = 0;
+}
+
+void FrameTimeStatistics::Begin(uint32_t warmup_frames, uint32_t sample_frames)
+{
+	for (std::vector<double>& samples : samples_)
+	{
+		samples.clear();
+		samples.reserve(sample_frames);
+	}
+
+	warmup_remaining_ = warmup_frames;
+	sample_frames_ = sample_frames;
+	active_ = sample_frames > 0;
+}
+
+void FrameTimeStatistics::Stop()
+{
+	active_ = false;
+	warmup_remaining_ = 0;
+}
+
+bool FrameTimeStatistics::AddFrame(const double stage_times[FRAME_TIME_STAGE_COUNT])
+{
+	if (!active_)
+		return false;
+
+	// frames rendered while caches, clocks and the frames in flight settle are not representative
+	if (warmup_remaining_ > 0)
+	{
+		warmup_remaining_--;
+		return false;
+	}
+
+	for (int i = 0; i < FRAME_TIME_STAGE_COUNT; i++)
+		samples_[i].push_back(stage_times[i]);
+
+	if (samples_[0].size() < sample_frames_)
+		return false;
+
+	active_ = false;
+	return true;
+}
+
+FrameTimeSummary FrameTimeStatistics::Summarize(FrameTimeStage stage) const
+{
+	return Summarize(samples_[static_cast<int>(stage)]);
+}
+
+std::vector<uint32_t> FrameTimeStatistics::GetOutlierFrames(FrameTimeStage stage) const
+{
+	const std::vector<double>& samples = samples_[static_cast<int>(stage)];
+	FrameTimeSummary summary = Summarize(samples);
+
+	std::vector<uint32_t> outlier_frames;
+	for (uint32_t i = 0; i < samples.size(); i++)
+	{
+		if (samples[i] < summary.lower_fence || samples[i] > summary.upper_fence)
+			outlier_frames.push_back(i);
+	}
+
+	return outlier_frames;
+}
+
+FrameTimeSummary FrameTimeStatistics::Summarize(const std::vector<double>& samples)
+{
+	FrameTimeSummary summary = {};
+	if (samples.empty())
+		return summary;
+
+	std::vector<double> sorted_samples = samples;
+	std::sort(sorted_samples.begin(), sorted_samples.end());
+
+	double total = 0.0;
+	for (double sample : sorted_samples)
+		total += sample;
+
+	summary.sample_count = static_cast<uint32_t>(sorted_samples.size());
+	summary.min = sorted_samples.front();
+	summary.max = sorted_samples.back();
+	summary.mean = total / sorted_samples.size();
+	summary.median = Percentile(sorted_samples, 0.5);
+	summary.p95 = Percentile(sorted_samples, 0.95);
+	summary.p99 = Percentile(sorted_samples, 0.99);
+
+	// sample standard deviation, the window is a sample of every frame rendered from the capture point
+	if (sorted_samples.size() > 1)
+	{
+		double squared_deviation = 0.0;
+		for (double sample : sorted_samples)
+			squared_deviation += (sample - summary.mean) * (sample - summary.mean);
+		summary.std_dev = std::sqrt(squared_deviation / (sorted_samples.size() - 1));
+	}
+
+	// tukey's fences, unlike a deviation based threshold they are not widened by the outliers themselves
+	double lower_quartile = Percentile(sorted_samples, 0.25);
+	double upper_quartile = Percentile(sorted_samples, 0.75);
+	double interquartile_range = upper_quartile - lower_quartile;
+	summary.lower_fence = lower_quartile - FRAME_TIME_OUTLIER_FENCE * interquartile_range;
+	summary.upper_fence = upper_quartile + FRAME_TIME_OUTLIER_FENCE * interquartile_range;
+
+	double trimmed_total = 0.0;
+	for (double sample : sorted_samples)
+	{
+		if (sample < summary.lower_fence || sample > summary.upper_fence)
+			summary.outlier_count++;
+		else
+			trimmed_total += sample;
+	}
+
+	// the median always lies within the fences so at least one sample remains
+	summary.trimmed_mean = trimmed_total / (summary.sample_count - summary.outlier_count);
+
+	return summary;
+}
+
+std::string FrameTimeStatistics::GetStageName(FrameTimeStage stage)
+{
+	switch (stage)
+	{
+	case FrameTimeStage::CPU_FRAME:
+		return "frame_time";
+	case FrameTimeStage::VISIBILITY:
+		return "visibility";
+	case FrameTimeStage::SHADING:
+		return "shading";
+	case FrameTimeStage::TRANSPARENCY:
+		return "transparency";
+	case FrameTimeStage::POST_PROCESS:
+		return "post_process";
+	case FrameTimeStage::GPU_TOTAL:
+		return "gpu_total";
+	}
+
+	return "";
+}
+
+double FrameTimeStatistics::Percentile(const std::vector<double>& sorted_samples, double percentile)
+{
+	double rank = percentile * (sorted_samples.size() - 1);
+	size_t lower = static_cast<size_t>(rank);
+	size_t upper = std::min(lower + 1, sorted_samples.size() - 1);
+
+	return sorted_samples[lower] + (sorted_samples[upper] - sorted_samples[lower]) * (rank - lower);
+}
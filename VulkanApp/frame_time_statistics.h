@@ -0,0 +1,76 @@
+#ifndef _FRAME_TIME_STATISTICS_H_
+#define _FRAME_TIME_STATISTICS_H_
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#define FRAME_TIME_STAGE_COUNT 6
+#define FRAME_TIME_OUTLIER_FENCE 1.5	// interquartile ranges outside the quartiles a sample is flagged as an outlier
+
+// the cpu frame time followed by the gpu stage times and their total
+enum class FrameTimeStage
+{
+	CPU_FRAME,
+	VISIBILITY,
+	SHADING,
+	TRANSPARENCY,
+	POST_PROCESS,
+	GPU_TOTAL
+};
+
+// milliseconds, over every sample in the window including the outliers
+struct FrameTimeSummary
+{
+	uint32_t sample_count;
+	double min;
+	double max;
+	double mean;
+	double median;
+	double p95;
+	double p99;
+	double std_dev;
+
+	// samples outside the fences, the upper fence separates hitches from ordinary frames
+	uint32_t outlier_count;
+	double lower_fence, upper_fence;
+	double trimmed_mean;	// mean of the samples within the fences
+};
+
+// collects per frame timings over a warm up window, whose frames are discarded, followed by a sample window
+class FrameTimeStatistics
+{
+public:
+	FrameTimeStatistics();
+
+	// start a new window, discarding the samples of the previous one
+	void Begin(uint32_t warmup_frames, uint32_t sample_frames);
+	void Stop();
+
+	// stage times in milliseconds, returns true when the frame completes the sample window
+	bool AddFrame(const double stage_times[FRAME_TIME_STAGE_COUNT]);
+
+	inline bool IsActive() { return active_; }
+	inline bool IsWarmingUp() { return active_ && warmup_remaining_ > 0; }
+	inline uint32_t GetSampleCount() { return static_cast<uint32_t>(samples_[0].size()); }
+
+	FrameTimeSummary Summarize(FrameTimeStage stage) const;
+
+	// positions in the sample window of the frames outside the stage's fences
+	std::vector<uint32_t> GetOutlierFrames(FrameTimeStage stage) const;
+
+	static FrameTimeSummary Summarize(const std::vector<double>& samples);
+	static std::string GetStageName(FrameTimeStage stage);
+
+protected:
+	// linearly interpolated between the closest ranks of sorted samples
+	static double Percentile(const std::vector<double>& sorted_samples, double percentile);
+
+protected:
+	bool active_;
+	uint32_t warmup_remaining_;
+	uint32_t sample_frames_;
+	std::vector<double> samples_[FRAME_TIME_STAGE_COUNT];
+};
+
+#endif
\ No newline at end of file
@@ -113,7 +113,7 @@ void GBufferPipeline::CreatePipeline()
 	pipeline_info.basePipelineIndex = -1;
 	pipeline_info.flags = 0;
 
-	if (vkCreateGraphicsPipelines(devices_->GetLogicalDevice(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline_) != VK_SUCCESS)
+	if (devices_->CreateGraphicsPipelines(1, &pipeline_info, &pipeline_) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create graphics pipeline!");
 	}
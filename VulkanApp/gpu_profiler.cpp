@@ -0,0 +1,287 @@
+#include "gpu_profiler.h"
+#include "device.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+VulkanGpuProfiler::VulkanGpuProfiler()
+{
+	devices_ = nullptr;
+	timestamp_period_ = 1.0f;
+	calibration_query_pool_ = VK_NULL_HANDLE;
+	calibration_timestamp_ = 0;
+	calibration_time_ = -1;
+	current_frame_ = 0;
+}
+
+void VulkanGpuProfiler::Init(VulkanDevices* devices, uint32_t frame_count)
+{
+	devices_ = devices;
+	current_frame_ = 0;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(devices_->GetPhysicalDevice(), &properties);
+	timestamp_period_ = properties.limits.timestampPeriod;
+
+	// queue families report zero valid bits when they can not write timestamps
+	uint32_t queue_family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(devices_->GetPhysicalDevice(), &queue_family_count, nullptr);
+	std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(devices_->GetPhysicalDevice(), &queue_family_count, queue_families.data());
+
+	timestamp_valid_bits_.resize(queue_family_count);
+	for (uint32_t i = 0; i < queue_family_count; i++)
+		timestamp_valid_bits_[i] = queue_families[i].timestampValidBits;
+
+	// each scope writes a begin and end timestamp into every frame's pool
+	VkQueryPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	pool_info.queryCount = GPU_PROFILER_MAX_SCOPES * 2;
+
+	frames_.resize(frame_count);
+	for (FrameQueries& frame : frames_)
+	{
+		if (vkCreateQueryPool(devices_->GetLogicalDevice(), &pool_info, nullptr, &frame.query_pool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create timestamp query pool!");
+		}
+	}
+
+	pool_info.queryCount = 1;
+	if (vkCreateQueryPool(devices_->GetLogicalDevice(), &pool_info, nullptr, &calibration_query_pool_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create timestamp query pool!");
+	}
+
+	CalibrateTimestamps();
+}
+
+void VulkanGpuProfiler::Cleanup()
+{
+	for (Scope& scope : scopes_)
+	{
+		if (!scope.begin_command_buffers.empty())
+		{
+			vkFreeCommandBuffers(devices_->GetLogicalDevice(), scope.command_pool, static_cast<uint32_t>(scope.begin_command_buffers.size()), scope.begin_command_buffers.data());
+			vkFreeCommandBuffers(devices_->GetLogicalDevice(), scope.command_pool, static_cast<uint32_t>(scope.end_command_buffers.size()), scope.end_command_buffers.data());
+		}
+	}
+	scopes_.clear();
+
+	for (FrameQueries& frame : frames_)
+		vkDestroyQueryPool(devices_->GetLogicalDevice(), frame.query_pool, nullptr);
+	frames_.clear();
+
+	vkDestroyQueryPool(devices_->GetLogicalDevice(), calibration_query_pool_, nullptr);
+	calibration_query_pool_ = VK_NULL_HANDLE;
+}
+
+GpuProfilerScope VulkanGpuProfiler::AddScope(std::string name, uint32_t queue_family)
+{
+	if (scopes_.size() >= GPU_PROFILER_MAX_SCOPES)
+		return GPU_PROFILER_NO_SCOPE;
+
+	Scope scope = {};
+	scope.name = name;
+	scope.trace_name = TraceProfiler::InternName(name);
+	scope.queue_family = queue_family;
+	scope.command_pool = VK_NULL_HANDLE;
+	scopes_.push_back(scope);
+
+	return static_cast<GpuProfilerScope>(scopes_.size() - 1);
+}
+
+void VulkanGpuProfiler::CreateScopeCommandBuffers(GpuProfilerScope scope, VkCommandPool command_pool)
+{
+	if (!IsTimed(scope) || !scopes_[scope].begin_command_buffers.empty())
+		return;
+
+	Scope& profiler_scope = scopes_[scope];
+
+	uint32_t frame_count = static_cast<uint32_t>(frames_.size());
+	profiler_scope.command_pool = command_pool;
+	profiler_scope.begin_command_buffers.resize(frame_count);
+	profiler_scope.end_command_buffers.resize(frame_count);
+
+	VkCommandBufferAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocate_info.commandPool = command_pool;
+	allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocate_info.commandBufferCount = frame_count;
+
+	if (vkAllocateCommandBuffers(devices_->GetLogicalDevice(), &allocate_info, profiler_scope.begin_command_buffers.data()) != VK_SUCCESS ||
+		vkAllocateCommandBuffers(devices_->GetLogicalDevice(), &allocate_info, profiler_scope.end_command_buffers.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate timestamp command buffers!");
+	}
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+
+	for (uint32_t i = 0; i < frame_count; i++)
+	{
+		vkBeginCommandBuffer(profiler_scope.begin_command_buffers[i], &begin_info);
+		RecordBeginQueries(profiler_scope.begin_command_buffers[i], frames_[i].query_pool, scope);
+		vkEndCommandBuffer(profiler_scope.begin_command_buffers[i]);
+
+		vkBeginCommandBuffer(profiler_scope.end_command_buffers[i], &begin_info);
+		RecordEndQuery(profiler_scope.end_command_buffers[i], frames_[i].query_pool, scope);
+		vkEndCommandBuffer(profiler_scope.end_command_buffers[i]);
+	}
+}
+
+VkCommandBuffer VulkanGpuProfiler::GetBeginCommandBuffer(GpuProfilerScope scope)
+{
+	if (!IsTimed(scope) || scopes_[scope].begin_command_buffers.empty())
+		return VK_NULL_HANDLE;
+
+	MarkWritten(scope);
+	return scopes_[scope].begin_command_buffers[current_frame_];
+}
+
+VkCommandBuffer VulkanGpuProfiler::GetEndCommandBuffer(GpuProfilerScope scope)
+{
+	if (!IsTimed(scope) || scopes_[scope].end_command_buffers.empty())
+		return VK_NULL_HANDLE;
+
+	return scopes_[scope].end_command_buffers[current_frame_];
+}
+
+void VulkanGpuProfiler::RecordBegin(VkCommandBuffer command_buffer, GpuProfilerScope scope)
+{
+	if (!IsTimed(scope))
+		return;
+
+	MarkWritten(scope);
+	RecordBeginQueries(command_buffer, frames_[current_frame_].query_pool, scope);
+}
+
+void VulkanGpuProfiler::RecordEnd(VkCommandBuffer command_buffer, GpuProfilerScope scope)
+{
+	if (!IsTimed(scope))
+		return;
+
+	RecordEndQuery(command_buffer, frames_[current_frame_].query_pool, scope);
+}
+
+void VulkanGpuProfiler::BeginFrame(uint32_t frame)
+{
+	current_frame_ = frame;
+	FrameQueries& frame_queries = frames_[frame];
+
+	// the frame's fence has signalled so its queries are normally available, any that are not are skipped rather than waited on
+	for (GpuProfilerScope scope : frame_queries.written_scopes)
+	{
+		uint64_t results[4];
+		VkResult result = vkGetQueryPoolResults(devices_->GetLogicalDevice(), frame_queries.query_pool, scope * 2, 2, sizeof(results), results, sizeof(uint64_t) * 2,
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		if (result != VK_SUCCESS || results[1] == 0 || results[3] == 0)
+			continue;
+
+		Scope& profiler_scope = scopes_[scope];
+		uint32_t valid_bits = timestamp_valid_bits_[profiler_scope.queue_family];
+		uint64_t mask = (valid_bits >= 64) ? ~0ull : ((1ull << valid_bits) - 1);
+		uint64_t ticks = (results[2] - results[0]) & mask;
+
+		profiler_scope.last_time = static_cast<double>(ticks) * timestamp_period_ / 1000000.0;
+		profiler_scope.times[profiler_scope.next_time] = profiler_scope.last_time;
+		profiler_scope.next_time = (profiler_scope.next_time + 1) % GPU_PROFILER_HISTORY;
+		profiler_scope.time_count = std::min(profiler_scope.time_count + 1, (uint32_t)GPU_PROFILER_HISTORY);
+
+		// placed on the trace timeline relative to the calibration timestamp
+		if (calibration_time_ >= 0)
+		{
+			int64_t begin = calibration_time_ + static_cast<int64_t>(((results[0] - calibration_timestamp_) & mask) * timestamp_period_);
+			int64_t end = begin + static_cast<int64_t>(ticks * timestamp_period_);
+			TRACE_GPU_EVENT(profiler_scope.queue_family, profiler_scope.trace_name, begin, end);
+		}
+	}
+
+	frame_queries.written_scopes.clear();
+}
+
+double VulkanGpuProfiler::GetScopeTime(GpuProfilerScope scope)
+{
+	if (scope >= scopes_.size() || scopes_[scope].time_count == 0)
+		return 0.0;
+
+	const Scope& profiler_scope = scopes_[scope];
+
+	double total_time = 0.0;
+	for (uint32_t i = 0; i < profiler_scope.time_count; i++)
+		total_time += profiler_scope.times[i];
+
+	return total_time / profiler_scope.time_count;
+}
+
+double VulkanGpuProfiler::GetLastScopeTime(GpuProfilerScope scope)
+{
+	if (scope >= scopes_.size())
+		return 0.0;
+
+	return scopes_[scope].last_time;
+}
+
+void VulkanGpuProfiler::PrintStatistics()
+{
+	std::cout << "Gpu pass times (average of the last " << GPU_PROFILER_HISTORY << " frames):" << std::endl;
+	for (GpuProfilerScope scope = 0; scope < scopes_.size(); scope++)
+	{
+		if (scopes_[scope].time_count > 0)
+			std::cout << "\t" << scopes_[scope].name << ": " << GetScopeTime(scope) << "ms" << std::endl;
+	}
+}
+
+void VulkanGpuProfiler::CalibrateTimestamps()
+{
+	uint32_t graphics_family = devices_->GetQueueFamilyIndices().graphics_family;
+	if (timestamp_valid_bits_[graphics_family] == 0)
+		return;
+
+	VkCommandBuffer command_buffer = devices_->BeginSingleTimeCommands();
+	vkCmdResetQueryPool(command_buffer, calibration_query_pool_, 0, 1);
+	vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, calibration_query_pool_, 0);
+
+	// the timestamp is written between the submit and the queue idling, taken as halfway between the two
+	int64_t submit_time = TraceProfiler::GetTime();
+	devices_->EndSingleTimeCommands(command_buffer);
+	int64_t idle_time = TraceProfiler::GetTime();
+
+	if (vkGetQueryPoolResults(devices_->GetLogicalDevice(), calibration_query_pool_, 0, 1, sizeof(uint64_t), &calibration_timestamp_, sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS)
+	{
+		calibration_time_ = submit_time + (idle_time - submit_time) / 2;
+	}
+}
+
+bool VulkanGpuProfiler::IsTimed(GpuProfilerScope scope)
+{
+	if (scope >= scopes_.size())
+		return false;
+
+	uint32_t queue_family = scopes_[scope].queue_family;
+	return queue_family < timestamp_valid_bits_.size() && timestamp_valid_bits_[queue_family] > 0;
+}
+
+void VulkanGpuProfiler::RecordBeginQueries(VkCommandBuffer command_buffer, VkQueryPool query_pool, GpuProfilerScope scope)
+{
+	// the queries are reset alongside the write so each frame slot can reuse them
+	vkCmdResetQueryPool(command_buffer, query_pool, scope * 2, 2);
+	vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, scope * 2);
+}
+
+void VulkanGpuProfiler::RecordEndQuery(VkCommandBuffer command_buffer, VkQueryPool query_pool, GpuProfilerScope scope)
+{
+	vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, scope * 2 + 1);
+}
+
+void VulkanGpuProfiler::MarkWritten(GpuProfilerScope scope)
+{
+	std::vector<GpuProfilerScope>& written_scopes = frames_[current_frame_].written_scopes;
+	if (std::find(written_scopes.begin(), written_scopes.end(), scope) == written_scopes.end())
+		written_scopes.push_back(scope);
+}
@@ -0,0 +1,101 @@
+#ifndef _GPU_PROFILER_H_
+#define _GPU_PROFILER_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+
+#include "trace_profiler.h"
+
+#define GPU_PROFILER_MAX_SCOPES 128
+#define GPU_PROFILER_HISTORY 32
+#define GPU_PROFILER_NO_SCOPE 0xFFFFFFFF
+
+class VulkanDevices;
+
+// identifies a timed region of gpu work
+typedef uint32_t GpuProfilerScope;
+
+// times gpu work with timestamp queries written into one query pool per frame in flight, a frame's
+// results are read back without waiting once its fence has signalled and the frame slot is reused
+class VulkanGpuProfiler
+{
+protected:
+	struct Scope
+	{
+		std::string name;
+		const char* trace_name;
+		uint32_t queue_family;
+
+		// begin and end timestamps recorded once per frame slot, for scopes around pre-recorded work
+		std::vector<VkCommandBuffer> begin_command_buffers;
+		std::vector<VkCommandBuffer> end_command_buffers;
+		VkCommandPool command_pool;
+
+		// milliseconds, the most recent result and the recent history it is averaged with
+		double last_time;
+		double times[GPU_PROFILER_HISTORY];
+		uint32_t time_count;
+		uint32_t next_time;
+	};
+
+	struct FrameQueries
+	{
+		VkQueryPool query_pool;
+		std::vector<GpuProfilerScope> written_scopes;	// scopes whose timestamps the frame will write
+	};
+
+public:
+	VulkanGpuProfiler();
+
+	void Init(VulkanDevices* devices, uint32_t frame_count);
+	void Cleanup();
+
+	// returns GPU_PROFILER_NO_SCOPE once every query is in use, work in that scope is not timed
+	GpuProfilerScope AddScope(std::string name, uint32_t queue_family);
+	inline const std::string& GetScopeName(GpuProfilerScope scope) { return scopes_[scope].name; }
+	inline uint32_t GetScopeCount() { return static_cast<uint32_t>(scopes_.size()); }
+
+	// record the scope's timestamps into command buffers for every frame slot, submitted either side of the timed work
+	void CreateScopeCommandBuffers(GpuProfilerScope scope, VkCommandPool command_pool);
+	VkCommandBuffer GetBeginCommandBuffer(GpuProfilerScope scope);
+	VkCommandBuffer GetEndCommandBuffer(GpuProfilerScope scope);
+
+	// write the scope's timestamps into a command buffer recorded for the current frame, outside of a render pass
+	void RecordBegin(VkCommandBuffer command_buffer, GpuProfilerScope scope);
+	void RecordEnd(VkCommandBuffer command_buffer, GpuProfilerScope scope);
+
+	// called once the frame slot's fence has been waited on, collects the results it wrote when it was last used
+	void BeginFrame(uint32_t frame);
+
+	double GetScopeTime(GpuProfilerScope scope);
+	double GetLastScopeTime(GpuProfilerScope scope);
+
+	void PrintStatistics();
+
+	// pairs a gpu timestamp with the trace profiler's clock so gpu zones can be traced alongside the cpu's,
+	// waits for the graphics queue to idle
+	void CalibrateTimestamps();
+
+protected:
+	bool IsTimed(GpuProfilerScope scope);
+	void RecordBeginQueries(VkCommandBuffer command_buffer, VkQueryPool query_pool, GpuProfilerScope scope);
+	void RecordEndQuery(VkCommandBuffer command_buffer, VkQueryPool query_pool, GpuProfilerScope scope);
+	void MarkWritten(GpuProfilerScope scope);
+
+protected:
+	VulkanDevices* devices_;
+	std::vector<uint32_t> timestamp_valid_bits_;	// per queue family, 0 when timestamps are unsupported
+	float timestamp_period_;						// nanoseconds per timestamp tick
+
+	// a graphics queue timestamp and the trace time it was written at
+	VkQueryPool calibration_query_pool_;
+	uint64_t calibration_timestamp_;
+	int64_t calibration_time_;
+
+	uint32_t current_frame_;
+	std::vector<FrameQueries> frames_;
+	std::vector<Scope> scopes_;
+};
+
+#endif
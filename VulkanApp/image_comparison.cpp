@@ -0,0 +1,118 @@
+#include "image_comparison.h"
+
+#include <fstream>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+ImageComparisonResult ImageComparison::Compare(const std::vector<glm::vec3>& image, const std::vector<glm::vec3>& reference, float tolerance)
+{
+	ImageComparisonResult result = {};
+	if (image.empty() || image.size() != reference.size())
+	{
+		result.max_error = std::numeric_limits<float>::infinity();
+		result.mean_squared_error = std::numeric_limits<double>::infinity();
+		result.differing_pixel_count = static_cast<uint32_t>(std::max(image.size(), reference.size()));
+		result.differing_percentage = 100.0;
+		return result;
+	}
+
+	// hdr references can exceed one, so the peak is the brightest reference channel
+	float peak = 1.0f;
+	double squared_error = 0.0;
+	for (size_t i = 0; i < image.size(); i++)
+	{
+		glm::vec3 error = glm::abs(image[i] - reference[i]);
+		float pixel_error = std::max(error.x, std::max(error.y, error.z));
+
+		// nan never compares greater, so is counted as differing explicitly
+		if (!(pixel_error <= tolerance))
+			result.differing_pixel_count++;
+		if (!(pixel_error <= result.max_error))
+			result.max_error = pixel_error;
+
+		squared_error += (double)error.x * error.x + (double)error.y * error.y + (double)error.z * error.z;
+		peak = std::max(peak, std::max(reference[i].x, std::max(reference[i].y, reference[i].z)));
+	}
+
+	result.mean_squared_error = squared_error / (image.size() * 3.0);
+	result.psnr = (result.mean_squared_error > 0.0) ? 10.0 * std::log10((double)peak * peak / result.mean_squared_error) : std::numeric_limits<double>::infinity();
+	result.differing_percentage = 100.0 * result.differing_pixel_count / image.size();
+
+	return result;
+}
+
+bool ImageComparison::ReadImage(const std::string& filename, uint32_t& width, uint32_t& height, std::vector<glm::vec3>& pixels)
+{
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	std::string format;
+	float scale;
+	file >> format >> width >> height >> scale;
+	file.get();
+
+	// only little endian colour maps are written
+	if (!file.good() || format != "PF" || scale >= 0.0f || width == 0 || height == 0)
+		return false;
+
+	// portable float maps store their rows bottom to top
+	pixels.resize(width * height);
+	for (uint32_t y = 0; y < height; y++)
+		file.read(reinterpret_cast<char*>(&pixels[(height - 1 - y) * width]), width * sizeof(glm::vec3));
+
+	return file.good();
+}
+
+bool ImageComparison::WriteImage(const std::string& filename, uint32_t width, uint32_t height, const std::vector<glm::vec3>& pixels)
+{
+	std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	file << "PF\n" << width << " " << height << "\n-1.0\n";
+	for (uint32_t y = 0; y < height; y++)
+		file.write(reinterpret_cast<const char*>(&pixels[(height - 1 - y) * width]), width * sizeof(glm::vec3));
+
+	return file.good();
+}
+
+bool ImageComparison::WriteDiffImage(const std::string& filename, uint32_t width, uint32_t height, const std::vector<glm::vec3>& image, const std::vector<glm::vec3>& reference, float tolerance)
+{
+	if (image.size() != reference.size() || image.size() != width * height)
+		return false;
+
+	std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	std::vector<uint8_t> diff(width * height * 3);
+	for (size_t i = 0; i < image.size(); i++)
+	{
+		glm::vec3 error = glm::abs(image[i] - reference[i]);
+		float pixel_error = std::max(error.x, std::max(error.y, error.z));
+
+		if (pixel_error <= tolerance)
+		{
+			// matching pixels are dimmed so the differences stand out
+			float luminance = glm::dot(glm::clamp(reference[i], 0.0f, 1.0f), glm::vec3(0.2126f, 0.7152f, 0.0722f));
+			uint8_t grey = static_cast<uint8_t>(luminance * 96.0f);
+			diff[i * 3 + 0] = grey;
+			diff[i * 3 + 1] = grey;
+			diff[i * 3 + 2] = grey;
+		}
+		else
+		{
+			float intensity = std::isnan(pixel_error) ? 1.0f : std::min(1.0f, 0.5f + pixel_error);
+			diff[i * 3 + 0] = static_cast<uint8_t>(intensity * 255.0f);
+			diff[i * 3 + 1] = 0;
+			diff[i * 3 + 2] = 0;
+		}
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+	file.write(reinterpret_cast<const char*>(diff.data()), diff.size());
+
+	return file.good();
+}
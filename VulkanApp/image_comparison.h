@@ -0,0 +1,33 @@
+#ifndef _IMAGE_COMPARISON_H_
+#define _IMAGE_COMPARISON_H_
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include <string>
+
+struct ImageComparisonResult
+{
+	float max_error;				// largest difference of any channel
+	double mean_squared_error;
+	double psnr;					// decibels against the reference's peak, infinite for identical images
+	uint32_t differing_pixel_count;	// pixels with a channel differing by more than the tolerance
+	double differing_percentage;
+};
+
+// per pixel comparison of rendered images against references, the images are linear rgb floats stored
+// as portable float maps so the hdr values the renderer produces are kept exactly
+class ImageComparison
+{
+public:
+	static ImageComparisonResult Compare(const std::vector<glm::vec3>& image, const std::vector<glm::vec3>& reference, float tolerance);
+
+	// returns false when the file can not be read, rows are top to bottom
+	static bool ReadImage(const std::string& filename, uint32_t& width, uint32_t& height, std::vector<glm::vec3>& pixels);
+	static bool WriteImage(const std::string& filename, uint32_t width, uint32_t height, const std::vector<glm::vec3>& pixels);
+
+	// an 8 bit ppm of the reference's luminance with the differing pixels in red, brighter for larger errors
+	static bool WriteDiffImage(const std::string& filename, uint32_t width, uint32_t height, const std::vector<glm::vec3>& image, const std::vector<glm::vec3>& reference, float tolerance);
+};
+
+#endif
\ No newline at end of file
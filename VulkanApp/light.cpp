@@ -1,4 +1,5 @@
 #include "light.h"
+#include "trace_profiler.h"
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "device.h"
@@ -17,6 +18,10 @@ Light::Light()
 	stationary_ = true;
 	light_buffer_index_ = 0;
 	shadow_map_ = nullptr;
+	shadow_matrix_buffer_ = VK_NULL_HANDLE;
+	profiler_ = nullptr;
+	pipeline_statistics_ = nullptr;
+	shadow_matrix_buffer_memory_ = {};
 }
 
 void Light::Init(VulkanDevices* devices, VulkanRenderer* renderer)
@@ -27,14 +32,15 @@ void Light::Init(VulkanDevices* devices, VulkanRenderer* renderer)
 	shadow_map_ = new VulkanRenderTarget();
 	shadow_map_->Init(devices, VK_FORMAT_R32_SFLOAT, SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION, (type_ == 1.0f) ? 6 : 1, true);
 
+	// the shadow passes get their own matrix buffer as the renderer's is refreshed once per frame
+	devices->CreateBuffer(sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, shadow_matrix_buffer_, shadow_matrix_buffer_memory_);
+
 	// create the shadow mapping pipeline
-	VkBuffer matrix_buffer;
-	renderer->GetMatrixBuffer(matrix_buffer, matrix_buffer_memory_);
 	if (type_ != 1.0f)
 	{
 		shadow_map_pipelines_.resize(1);
 		shadow_map_pipelines_[0] = new ShadowMapPipeline();
-		shadow_map_pipelines_[0]->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 0, matrix_buffer, sizeof(UniformBufferObject));
+		shadow_map_pipelines_[0]->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 0, shadow_matrix_buffer_, sizeof(UniformBufferObject));
 		shadow_map_pipelines_[0]->SetImageViews(shadow_map_->GetRenderTargetFormat(), shadow_map_->GetRenderTargetDepthFormat(), shadow_map_->GetImageViews()[0], shadow_map_->GetDepthImageView());
 		shadow_map_pipelines_[0]->SetShader(renderer->GetShadowMapShader());
 		shadow_map_pipelines_[0]->Init(devices, renderer->GetSwapChain(), renderer->GetPrimitiveBuffer());
@@ -46,13 +52,23 @@ void Light::Init(VulkanDevices* devices, VulkanRenderer* renderer)
 		{
 			shadow_map_pipelines_[i] = new ShadowMapPipeline();
 			shadow_map_pipelines_[i]->SetShader(renderer->GetShadowMapShader());
-			shadow_map_pipelines_[i]->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 0, matrix_buffer, sizeof(UniformBufferObject));
+			shadow_map_pipelines_[i]->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 0, shadow_matrix_buffer_, sizeof(UniformBufferObject));
 			shadow_map_pipelines_[i]->SetImageViews(shadow_map_->GetRenderTargetFormat(), shadow_map_->GetRenderTargetDepthFormat(), shadow_map_->GetImageViews()[i], shadow_map_->GetDepthImageView());
 			shadow_map_pipelines_[i]->Init(devices, renderer->GetSwapChain(), renderer->GetPrimitiveBuffer());
 		}
 	}
 	
 	renderer->AddLight(this);
+
+	// time each face of the shadow map on the gpu
+	profiler_ = renderer->GetGpuProfiler();
+	for (int i = 0; i < shadow_map_pipelines_.size(); i++)
+		shadow_map_scopes_.push_back(profiler_->AddScope("shadow map " + std::to_string(light_buffer_index_) + " face " + std::to_string(i), devices->GetQueueFamilyIndices().graphics_family));
+
+	// the faces are submitted and waited on one at a time so their statistics are collected straight after
+	pipeline_statistics_ = renderer->GetPipelineStatistics();
+	for (int i = 0; i < shadow_map_pipelines_.size(); i++)
+		shadow_map_statistics_scopes_.push_back(pipeline_statistics_->AddScope("shadow map " + std::to_string(light_buffer_index_) + " face " + std::to_string(i), true));
 }
 
 void Light::Cleanup()
@@ -70,10 +86,16 @@ void Light::Cleanup()
 		shadow_map_pipelines_[i] = nullptr;
 	}
 	shadow_map_pipelines_.clear();
+
+	// clean up the shadow matrix buffer
+	vkDestroyBuffer(devices_->GetLogicalDevice(), shadow_matrix_buffer_, nullptr);
+	devices_->FreeMemory(shadow_matrix_buffer_memory_);
 }
 
 void Light::GenerateShadowMap(VkCommandPool command_pool, std::vector<Mesh*>& meshes)
 {
+	TRACE_FUNCTION();
+
 	RecordShadowMapCommands(command_pool, meshes);
 
 	// send transform data to the gpu
@@ -90,7 +112,7 @@ void Light::GenerateShadowMap(VkCommandPool command_pool, std::vector<Mesh*>& me
 		shadow_map_->ClearImage(clear_color, i);
 		shadow_map_->ClearDepthBuffer();
 
-		devices_->CopyDataToBuffer(matrix_buffer_memory_, &ubo, sizeof(UniformBufferObject));
+		devices_->CopyDataToBuffer(shadow_matrix_buffer_memory_, &ubo, sizeof(UniformBufferObject));
 
 		// submit the shadow map command buffer
 		VkSubmitInfo submit_info = {};
@@ -114,12 +136,20 @@ void Light::GenerateShadowMap(VkCommandPool command_pool, std::vector<Mesh*>& me
 			throw std::runtime_error("failed to submit draw command buffer!");
 		}
 
-		vkQueueWaitIdle(graphics_queue);
+		{
+			TRACE_SCOPE("wait for shadow map face");
+			vkQueueWaitIdle(graphics_queue);
+		}
+		devices_->CountQueueSubmit();
+		devices_->CountIdleWait();
+		pipeline_statistics_->Collect(shadow_map_statistics_scopes_[i]);
 	}
 }
 
-void Light::SendLightData(VulkanDevices* devices, VkDeviceMemory light_buffer_memory)
+void Light::SendLightData(VulkanFrameConstants* frame_constants, FrameConstantHandle light_buffer)
 {
+	TRACE_FUNCTION();
+
 	LightData light_data = {};
 	light_data.position = glm::vec4(position_);
 	light_data.direction = glm::vec4(direction_);
@@ -138,7 +168,7 @@ void Light::SendLightData(VulkanDevices* devices, VkDeviceMemory light_buffer_me
 	light_data.padding[2] = 0;
 	VkDeviceSize offset = sizeof(SceneLightData) + (light_buffer_index_ * sizeof(LightData));
 
-	devices_->CopyDataToBuffer(light_buffer_memory, &light_data, sizeof(LightData), offset);
+	frame_constants->Write(light_buffer, &light_data, sizeof(LightData), offset);
 }
 
 glm::mat4 Light::GetViewMatrix(int index)
@@ -225,6 +255,8 @@ void Light::CalculateProjectionMatrix()
 
 void Light::RecordShadowMapCommands(VkCommandPool command_pool, std::vector<Mesh*>& meshes)
 {
+	TRACE_FUNCTION();
+
 	shadow_map_command_buffers_.resize((type_ == 1.0f) ? 6 : 1);
 
 	// use this access to mesh data to set the scene size vertices
@@ -270,6 +302,8 @@ void Light::RecordShadowMapCommands(VkCommandPool command_pool, std::vector<Mesh
 		begin_info.pInheritanceInfo = nullptr;
 
 		vkBeginCommandBuffer(shadow_map_command_buffers_[i], &begin_info);
+		profiler_->RecordBegin(shadow_map_command_buffers_[i], shadow_map_scopes_[i]);
+		pipeline_statistics_->RecordBegin(shadow_map_command_buffers_[i], shadow_map_statistics_scopes_[i]);
 
 		if (shadow_map_pipelines_[i])
 		{
@@ -287,6 +321,9 @@ void Light::RecordShadowMapCommands(VkCommandPool command_pool, std::vector<Mesh
 			vkCmdEndRenderPass(shadow_map_command_buffers_[i]);
 		}
 
+		pipeline_statistics_->RecordEnd(shadow_map_command_buffers_[i], shadow_map_statistics_scopes_[i]);
+		profiler_->RecordEnd(shadow_map_command_buffers_[i], shadow_map_scopes_[i]);
+
 		if (vkEndCommandBuffer(shadow_map_command_buffers_[i]) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to record shadow map command buffer!");
@@ -7,6 +7,9 @@
 #include "shadow_map_pipeline.h"
 #include "render_target.h"
 #include "mesh.h"
+#include "frame_constants.h"
+#include "gpu_profiler.h"
+#include "pipeline_statistics.h"
 
 class VulkanDevices;
 class VulkanRenderer;
@@ -71,7 +74,7 @@ public:
 
 	inline void SetShadowMapIndex(uint32_t index) { shadow_map_index_ = index; }
 
-	void SendLightData(VulkanDevices* devices, VkDeviceMemory light_buffer_memory);
+	void SendLightData(VulkanFrameConstants* frame_constants, FrameConstantHandle light_buffer);
 
 	glm::mat4 GetViewMatrix(int index = 0);
 	glm::mat4 GetProjectionMatrix();
@@ -113,7 +116,12 @@ protected:
 	uint32_t shadow_map_index_;
 
 	std::vector<VkCommandBuffer> shadow_map_command_buffers_;
-	VkDeviceMemory matrix_buffer_memory_;
+	VulkanGpuProfiler* profiler_;
+	std::vector<GpuProfilerScope> shadow_map_scopes_;	// one per face
+	VulkanPipelineStatistics* pipeline_statistics_;
+	std::vector<PipelineStatisticsScope> shadow_map_statistics_scopes_;	// one per face
+	VkBuffer shadow_matrix_buffer_;
+	MemoryAllocation shadow_matrix_buffer_memory_;
 	glm::vec3 scene_min_vertex_;
 	glm::vec3 scene_max_vertex_;
 
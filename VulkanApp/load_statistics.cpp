@@ -0,0 +1,116 @@
+#include "load_statistics.h"
+#include "device.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <ctime>
+
+std::mutex LoadStatistics::mutex_;
+std::string LoadStatistics::asset_;
+LoadPhaseStatistics LoadStatistics::phases_[LOAD_PHASE_COUNT] = {};
+std::chrono::high_resolution_clock::time_point LoadStatistics::begin_time_;
+double LoadStatistics::load_time_ = 0.0;
+
+void LoadStatistics::Begin(const std::string& asset)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	asset_ = asset;
+	for (LoadPhaseStatistics& phase : phases_)
+		phase = {};
+
+	load_time_ = 0.0;
+	begin_time_ = std::chrono::high_resolution_clock::now();
+}
+
+void LoadStatistics::End()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	load_time_ = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin_time_).count();
+}
+
+void LoadStatistics::Add(LoadPhase phase, double time, uint64_t bytes, uint64_t items)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	LoadPhaseStatistics& statistics = phases_[static_cast<int>(phase)];
+	statistics.time += time;
+	statistics.bytes += bytes;
+	statistics.items += items;
+	statistics.count++;
+}
+
+LoadPhaseStatistics LoadStatistics::GetPhase(LoadPhase phase)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return phases_[static_cast<int>(phase)];
+}
+
+void LoadStatistics::PrintSummary()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	std::cout << "Load phases for " << asset_ << " (" << load_time_ << "ms to load the models, phase times are summed over threads):" << std::endl;
+	std::cout << "\t" << std::left << std::setw(18) << "phase" << std::right << std::setw(12) << "ms" << std::setw(14) << "MB" << std::setw(12) << "items" << std::setw(12) << "MB/s" << std::endl;
+
+	for (int i = 0; i < LOAD_PHASE_COUNT; i++)
+	{
+		const LoadPhaseStatistics& phase = phases_[i];
+		double megabytes = phase.bytes / (1024.0 * 1024.0);
+		double throughput = (phase.time > 0.0) ? megabytes / (phase.time / 1000.0) : 0.0;
+
+		std::cout << "\t" << std::left << std::setw(18) << GetPhaseName(static_cast<LoadPhase>(i)) << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(12) << phase.time << std::setw(14) << megabytes << std::setw(12) << phase.items << std::setw(12) << throughput << std::endl;
+	}
+
+	std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+void LoadStatistics::AppendReport(const std::string& filename)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	std::string report = "";
+	if (!std::ifstream(filename).good())
+		report += "asset,time,load_time,phase,phase_time,bytes,items,count\n";
+
+	// the load is identified by when it was reported so regressions can be followed across runs
+	std::string time = std::to_string(static_cast<long long>(std::time(nullptr)));
+
+	for (int i = 0; i < LOAD_PHASE_COUNT; i++)
+	{
+		const LoadPhaseStatistics& phase = phases_[i];
+		report += "\"" + asset_ + "\"," + time + "," + std::to_string(load_time_) + "," + GetPhaseName(static_cast<LoadPhase>(i)) + ",";
+		report += std::to_string(phase.time) + "," + std::to_string(phase.bytes) + "," + std::to_string(phase.items) + "," + std::to_string(phase.count) + "\n";
+	}
+
+	VulkanDevices::AppendFile(filename, report);
+}
+
+std::string LoadStatistics::GetPhaseName(LoadPhase phase)
+{
+	switch (phase)
+	{
+	case LoadPhase::PARSE:
+		return "parse";
+	case LoadPhase::MATERIALS:
+		return "materials";
+	case LoadPhase::TEXTURE_DECODE:
+		return "texture_decode";
+	case LoadPhase::TEXTURE_UPLOAD:
+		return "texture_upload";
+	case LoadPhase::VERTEX_DEDUP:
+		return "vertex_dedup";
+	case LoadPhase::SHAPE_UPLOAD:
+		return "shape_upload";
+	case LoadPhase::PRIMITIVE_BUFFER:
+		return "primitive_buffer";
+	case LoadPhase::MESH_CACHE:
+		return "mesh_cache";
+	case LoadPhase::MESH_OPTIMIZE:
+		return "mesh_optimize";
+	}
+
+	return "";
+}
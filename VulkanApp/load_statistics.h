@@ -0,0 +1,82 @@
+#ifndef _LOAD_STATISTICS_H_
+#define _LOAD_STATISTICS_H_
+
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+#define LOAD_PHASE_COUNT 9
+
+// the stages of loading a model, material creation includes the textures it decodes and uploads,
+// the mesh cache phase is hashing the source and mapping or writing its cache
+enum class LoadPhase
+{
+	PARSE,
+	MATERIALS,
+	TEXTURE_DECODE,
+	TEXTURE_UPLOAD,
+	VERTEX_DEDUP,
+	SHAPE_UPLOAD,
+	PRIMITIVE_BUFFER,
+	MESH_CACHE,
+	MESH_OPTIMIZE
+};
+
+struct LoadPhaseStatistics
+{
+	double time;		// milliseconds, summed over every thread that ran the phase
+	uint64_t bytes;
+	uint64_t items;		// shapes, materials, textures or indices depending on the phase
+	uint32_t count;		// times the phase was entered
+};
+
+// collects the time, bytes and item counts of each load phase from every loading thread
+class LoadStatistics
+{
+public:
+	// start collecting for a new set of assets, discarding the previous statistics
+	static void Begin(const std::string& asset);
+	static void End();
+
+	static void Add(LoadPhase phase, double time, uint64_t bytes, uint64_t items);
+	static LoadPhaseStatistics GetPhase(LoadPhase phase);
+	inline static double GetLoadTime() { return load_time_; }
+
+	static void PrintSummary();
+
+	// appends a row per phase, so loads of the same asset can be compared over time
+	static void AppendReport(const std::string& filename);
+
+	static std::string GetPhaseName(LoadPhase phase);
+
+protected:
+	static std::mutex mutex_;
+	static std::string asset_;
+	static LoadPhaseStatistics phases_[LOAD_PHASE_COUNT];
+	static std::chrono::high_resolution_clock::time_point begin_time_;
+	static double load_time_;	// milliseconds between begin and end
+};
+
+// times a phase from its construction to its destruction
+class LoadPhaseTimer
+{
+public:
+	inline LoadPhaseTimer(LoadPhase phase) : phase_(phase), bytes_(0), items_(0), start_time_(std::chrono::high_resolution_clock::now()) {}
+	inline ~LoadPhaseTimer()
+	{
+		double time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start_time_).count();
+		LoadStatistics::Add(phase_, time, bytes_, items_);
+	}
+
+	inline void AddBytes(uint64_t bytes) { bytes_ += bytes; }
+	inline void AddItems(uint64_t items) { items_ += items; }
+
+protected:
+	LoadPhase phase_;
+	uint64_t bytes_;
+	uint64_t items_;
+	std::chrono::high_resolution_clock::time_point start_time_;
+};
+
+#endif
\ No newline at end of file
@@ -1,11 +1,41 @@
 #include "app.h"
+#include "benchmark_app.h"
+#include "regression_app.h"
+#include "vertex_welder.h"
 
-int main() 
+int main(int argc, char* argv[]) 
 {
-	App app;
-
 	try {
-		app.Run();
+		// the vertex welding microbenchmark only loads the obj, it needs no window or device
+		if (argc == 3 && std::string(argv[1]) == "--weld-benchmark")
+		{
+			VertexWelder::RunBenchmark(argv[2]);
+			return EXIT_SUCCESS;
+		}
+
+		// a benchmark runs offscreen from the command line arguments, otherwise the app is interactive
+		BenchmarkSettings benchmark_settings;
+		if (BenchmarkApp::ParseArguments(argc, argv, benchmark_settings))
+		{
+			// a regression run fails the process when any capture point differs from its reference
+			if (!benchmark_settings.reference_directory.empty())
+			{
+				RegressionApp regression(benchmark_settings);
+				regression.Run();
+				if (!regression.Passed())
+					return EXIT_FAILURE;
+			}
+			else
+			{
+				BenchmarkApp benchmark(benchmark_settings);
+				benchmark.Run();
+			}
+		}
+		else
+		{
+			App app;
+			app.Run();
+		}
 	}
 	catch (const std::runtime_error& e) {
 		std::cerr << e.what() << std::endl;
@@ -13,4 +43,4 @@ int main()
 	}
 
 	return EXIT_SUCCESS;
-} 
\ No newline at end of file
+}
\ No newline at end of file
@@ -18,28 +18,15 @@ void VulkanMaterialBuffer::CleanUp()
 {
 	// clean up the buffer
 	vkDestroyBuffer(devices_->GetLogicalDevice(), material_buffer_, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), material_buffer_memory_, nullptr);
+	devices_->FreeMemory(material_buffer_memory_);
 }
 
 void VulkanMaterialBuffer::AddMaterialData(void* material_data, uint32_t material_count, uint32_t& material_offset)
 {
-	// create a temp staging buffer for the material data
-	VkBuffer staging_buffer;
-	VkDeviceMemory staging_buffer_memory;
-
 	VkDeviceSize buffer_size = material_count * material_size_;
 
-	devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory);
-
-	// copy the data to the staging buffer
-	devices_->CopyDataToBuffer(staging_buffer_memory, material_data, buffer_size, 0);
-
-	// copy the staging buffer to the material buffer
-	devices_->CopyBuffer(staging_buffer, material_buffer_, buffer_size, material_count_ * material_size_);
-
-	// delete the staging buffer now it is no longer needed
-	vkDestroyBuffer(devices_->GetLogicalDevice(), staging_buffer, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), staging_buffer_memory, nullptr);
+	// stage the material data into the material buffer
+	devices_->GetUploadManager()->UploadToBuffer(material_buffer_, material_data, buffer_size, material_count_ * material_size_);
 
 	// increment material count
 	material_offset = material_count_;
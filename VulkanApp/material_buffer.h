@@ -22,7 +22,7 @@ protected:
 	uint32_t material_count_;
 
 	VkBuffer material_buffer_;
-	VkDeviceMemory material_buffer_memory_;
+	MemoryAllocation material_buffer_memory_;
 };
 
 #endif
\ No newline at end of file
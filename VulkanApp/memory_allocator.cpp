@@ -0,0 +1,395 @@
+#include "memory_allocator.h"
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+
+VulkanMemoryAllocator::VulkanMemoryAllocator()
+{
+	logical_device_ = VK_NULL_HANDLE;
+	buffer_image_granularity_ = 1;
+	max_device_allocation_count_ = 0;
+	dedicated_allocation_count_ = 0;
+	dedicated_bytes_ = 0;
+}
+
+void VulkanMemoryAllocator::Init(VkPhysicalDevice physical_device, VkDevice logical_device)
+{
+	logical_device_ = logical_device;
+
+	vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties_);
+
+	VkPhysicalDeviceProperties device_properties;
+	vkGetPhysicalDeviceProperties(physical_device, &device_properties);
+	buffer_image_granularity_ = device_properties.limits.bufferImageGranularity;
+	max_device_allocation_count_ = device_properties.limits.maxMemoryAllocationCount;
+}
+
+void VulkanMemoryAllocator::Cleanup()
+{
+	std::unique_lock<std::mutex> lock(allocator_mutex_);
+
+	for (MemoryBlock* block : blocks_)
+	{
+		if (!block)
+			continue;
+
+		if (block->allocation_count > 0)
+		{
+			std::cout << "Memory block of type " << block->memory_type << " still has " << block->allocation_count << " live allocations" << std::endl;
+		}
+
+		vkFreeMemory(logical_device_, block->memory, nullptr);
+		delete block;
+	}
+	blocks_.clear();
+}
+
+MemoryAllocation VulkanMemoryAllocator::Allocate(VkMemoryRequirements requirements, uint32_t memory_type, bool image, AllocationStrategy strategy)
+{
+	std::unique_lock<std::mutex> lock(allocator_mutex_);
+
+	// large resources such as the primitive buffers get their own allocation
+	if (requirements.size > MEMORY_BLOCK_SIZE / 2)
+	{
+		return AllocateDedicated(requirements, memory_type);
+	}
+
+	MemoryAllocation allocation = {};
+	allocation.size = requirements.size;
+	allocation.memory_type = memory_type;
+
+	// buffers and optimal images never share a block so bufferImageGranularity can not be violated
+	for (int32_t i = 0; i < static_cast<int32_t>(blocks_.size()); i++)
+	{
+		MemoryBlock* block = blocks_[i];
+		if (!block || block->memory_type != memory_type || block->image_block != image || block->strategy != strategy)
+			continue;
+
+		if (AllocateFromBlock(block, requirements, allocation.offset))
+		{
+			allocation.memory = block->memory;
+			allocation.mapped_data = block->mapped_data ? static_cast<char*>(block->mapped_data) + allocation.offset : nullptr;
+			allocation.block_index = i;
+			return allocation;
+		}
+	}
+
+	// no existing block has space so create a new one, reusing an empty slot if there is one
+	MemoryBlock* block = CreateBlock(memory_type, image, strategy);
+
+	int32_t block_index = -1;
+	for (int32_t i = 0; i < static_cast<int32_t>(blocks_.size()); i++)
+	{
+		if (!blocks_[i])
+		{
+			blocks_[i] = block;
+			block_index = i;
+			break;
+		}
+	}
+
+	if (block_index < 0)
+	{
+		block_index = static_cast<int32_t>(blocks_.size());
+		blocks_.push_back(block);
+	}
+
+	if (!AllocateFromBlock(block, requirements, allocation.offset))
+	{
+		throw std::runtime_error("failed to sub-allocate from new memory block!");
+	}
+
+	allocation.memory = block->memory;
+	allocation.mapped_data = block->mapped_data ? static_cast<char*>(block->mapped_data) + allocation.offset : nullptr;
+	allocation.block_index = block_index;
+	return allocation;
+}
+
+void VulkanMemoryAllocator::Free(MemoryAllocation& allocation)
+{
+	if (allocation.memory == VK_NULL_HANDLE)
+		return;
+
+	std::unique_lock<std::mutex> lock(allocator_mutex_);
+
+	if (allocation.block_index < 0)
+	{
+		vkFreeMemory(logical_device_, allocation.memory, nullptr);
+		dedicated_allocation_count_--;
+		dedicated_bytes_ -= allocation.size;
+	}
+	else
+	{
+		MemoryBlock* block = blocks_[allocation.block_index];
+		FreeFromBlock(block, allocation.offset, allocation.size);
+
+		// release empty blocks back to the driver, keeping one per memory type to avoid churn
+		if (block->allocation_count == 0)
+		{
+			bool other_block = false;
+			for (MemoryBlock* other : blocks_)
+			{
+				if (other && other != block && other->memory_type == block->memory_type && other->image_block == block->image_block && other->strategy == block->strategy)
+					other_block = true;
+			}
+
+			if (other_block)
+			{
+				vkFreeMemory(logical_device_, block->memory, nullptr);
+				delete block;
+				blocks_[allocation.block_index] = nullptr;
+			}
+		}
+	}
+
+	allocation.memory = VK_NULL_HANDLE;
+	allocation.mapped_data = nullptr;
+}
+
+MemoryStatistics VulkanMemoryAllocator::GetStatistics()
+{
+	std::unique_lock<std::mutex> lock(allocator_mutex_);
+
+	MemoryStatistics statistics = {};
+	statistics.dedicated_allocation_count = dedicated_allocation_count_;
+	statistics.allocation_count = dedicated_allocation_count_;
+	statistics.device_allocation_count = dedicated_allocation_count_;
+	statistics.max_device_allocation_count = max_device_allocation_count_;
+	statistics.reserved_bytes = dedicated_bytes_;
+	statistics.used_bytes = dedicated_bytes_;
+
+	VkDeviceSize largest_free_total = 0;
+
+	for (MemoryBlock* block : blocks_)
+	{
+		if (!block)
+			continue;
+
+		MemoryBlockStatistics block_statistics = {};
+		block_statistics.memory_type = block->memory_type;
+		block_statistics.strategy = block->strategy;
+		block_statistics.image_block = block->image_block;
+		block_statistics.allocation_count = block->allocation_count;
+		block_statistics.block_size = block->size;
+		block_statistics.used_bytes = block->used_bytes;
+		block_statistics.free_bytes = block->size - block->used_bytes;
+		block_statistics.largest_free_range = GetLargestFreeRange(block);
+
+		// fragmentation is the share of free memory that is not part of the largest free range
+		block_statistics.fragmentation = (block_statistics.free_bytes > 0) ? 1.0f - (float)block_statistics.largest_free_range / (float)block_statistics.free_bytes : 0.0f;
+
+		statistics.blocks.push_back(block_statistics);
+		statistics.block_count++;
+		statistics.allocation_count += block->allocation_count;
+		statistics.device_allocation_count++;
+		statistics.reserved_bytes += block->size;
+		statistics.used_bytes += block->used_bytes;
+		statistics.free_bytes += block_statistics.free_bytes;
+		largest_free_total += block_statistics.largest_free_range;
+	}
+
+	statistics.fragmentation = (statistics.free_bytes > 0) ? 1.0f - (float)largest_free_total / (float)statistics.free_bytes : 0.0f;
+
+	return statistics;
+}
+
+void VulkanMemoryAllocator::PrintStatistics()
+{
+	MemoryStatistics statistics = GetStatistics();
+
+	std::cout << "Device memory: " << statistics.allocation_count << " allocations in " << statistics.block_count << " blocks and " << statistics.dedicated_allocation_count << " dedicated allocations" << std::endl;
+	std::cout << "Device memory: " << statistics.device_allocation_count << " of " << statistics.max_device_allocation_count << " driver allocations used, buffer image granularity " << buffer_image_granularity_ << std::endl;
+	std::cout << "Device memory: " << statistics.used_bytes / 1048576 << "MB used of " << statistics.reserved_bytes / 1048576 << "MB reserved, fragmentation " << statistics.fragmentation * 100.0f << "%" << std::endl;
+
+	for (const MemoryBlockStatistics& block : statistics.blocks)
+	{
+		std::cout << "    type " << block.memory_type << ((block.strategy == AllocationStrategy::LINEAR) ? " linear" : " buddy") << (block.image_block ? " image" : " buffer");
+		std::cout << " block: " << block.allocation_count << " allocations, " << block.used_bytes / 1024 << "KB used, " << block.free_bytes / 1024 << "KB free, ";
+		std::cout << "largest free " << block.largest_free_range / 1024 << "KB, fragmentation " << block.fragmentation * 100.0f << "%" << std::endl;
+	}
+}
+
+MemoryAllocation VulkanMemoryAllocator::AllocateDedicated(VkMemoryRequirements requirements, uint32_t memory_type)
+{
+	VkMemoryAllocateInfo alloc_info = {};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = requirements.size;
+	alloc_info.memoryTypeIndex = memory_type;
+
+	MemoryAllocation allocation = {};
+	allocation.offset = 0;
+	allocation.size = requirements.size;
+	allocation.memory_type = memory_type;
+	allocation.block_index = -1;
+
+	VkResult result = vkAllocateMemory(logical_device_, &alloc_info, nullptr, &allocation.memory);
+	if (result != VK_SUCCESS)
+	{
+		std::cout << result << std::endl;
+		throw std::runtime_error("failed to allocate dedicated memory!");
+	}
+
+	// host visible memory stays mapped for its whole lifetime
+	if (memory_properties_.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		vkMapMemory(logical_device_, allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped_data);
+	}
+
+	dedicated_allocation_count_++;
+	dedicated_bytes_ += requirements.size;
+
+	return allocation;
+}
+
+VulkanMemoryAllocator::MemoryBlock* VulkanMemoryAllocator::CreateBlock(uint32_t memory_type, bool image, AllocationStrategy strategy)
+{
+	MemoryBlock* block = new MemoryBlock();
+	block->size = MEMORY_BLOCK_SIZE;
+	block->mapped_data = nullptr;
+	block->memory_type = memory_type;
+	block->strategy = strategy;
+	block->image_block = image;
+	block->allocation_count = 0;
+	block->used_bytes = 0;
+	block->linear_offset = 0;
+
+	VkMemoryAllocateInfo alloc_info = {};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = block->size;
+	alloc_info.memoryTypeIndex = memory_type;
+
+	VkResult result = vkAllocateMemory(logical_device_, &alloc_info, nullptr, &block->memory);
+	if (result != VK_SUCCESS)
+	{
+		delete block;
+		std::cout << result << std::endl;
+		throw std::runtime_error("failed to allocate memory block!");
+	}
+
+	if (memory_properties_.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		vkMapMemory(logical_device_, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped_data);
+	}
+
+	// the whole block starts as a single free node of the highest order
+	if (strategy == AllocationStrategy::BUDDY)
+	{
+		uint32_t max_order = GetBuddyOrder(block->size);
+		block->free_lists.resize(max_order + 1);
+		block->free_lists[max_order].insert(0);
+	}
+
+	return block;
+}
+
+bool VulkanMemoryAllocator::AllocateFromBlock(MemoryBlock* block, VkMemoryRequirements requirements, VkDeviceSize& offset)
+{
+	if (block->strategy == AllocationStrategy::LINEAR)
+	{
+		VkDeviceSize aligned_offset = (block->linear_offset + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+		if (aligned_offset + requirements.size > block->size)
+			return false;
+
+		offset = aligned_offset;
+		block->linear_offset = aligned_offset + requirements.size;
+		block->used_bytes += requirements.size;
+		block->allocation_count++;
+		return true;
+	}
+
+	// buddy nodes are aligned to their own size so the alignment is covered by rounding up the order
+	uint32_t order = GetBuddyOrder(std::max(requirements.size, requirements.alignment));
+
+	uint32_t free_order = order;
+	while (free_order < block->free_lists.size() && block->free_lists[free_order].empty())
+	{
+		free_order++;
+	}
+
+	if (free_order >= block->free_lists.size())
+		return false;
+
+	VkDeviceSize node_offset = *block->free_lists[free_order].begin();
+	block->free_lists[free_order].erase(block->free_lists[free_order].begin());
+
+	// split the node until it matches the requested order
+	while (free_order > order)
+	{
+		free_order--;
+		block->free_lists[free_order].insert(node_offset + ((VkDeviceSize)MIN_BUDDY_ALLOCATION_SIZE << free_order));
+	}
+
+	offset = node_offset;
+	block->allocation_orders[node_offset] = order;
+	block->used_bytes += (VkDeviceSize)MIN_BUDDY_ALLOCATION_SIZE << order;
+	block->allocation_count++;
+	return true;
+}
+
+void VulkanMemoryAllocator::FreeFromBlock(MemoryBlock* block, VkDeviceSize offset, VkDeviceSize size)
+{
+	block->allocation_count--;
+
+	if (block->strategy == AllocationStrategy::LINEAR)
+	{
+		block->used_bytes -= size;
+
+		// linear blocks are reclaimed all at once
+		if (block->allocation_count == 0)
+		{
+			block->linear_offset = 0;
+			block->used_bytes = 0;
+		}
+		return;
+	}
+
+	auto order_it = block->allocation_orders.find(offset);
+	if (order_it == block->allocation_orders.end())
+	{
+		throw std::runtime_error("failed to find memory allocation in block!");
+	}
+
+	uint32_t order = order_it->second;
+	block->allocation_orders.erase(order_it);
+	block->used_bytes -= (VkDeviceSize)MIN_BUDDY_ALLOCATION_SIZE << order;
+
+	// merge with free buddies as far up the tree as possible
+	VkDeviceSize node_offset = offset;
+	while (order + 1 < block->free_lists.size())
+	{
+		VkDeviceSize buddy_offset = node_offset ^ ((VkDeviceSize)MIN_BUDDY_ALLOCATION_SIZE << order);
+		auto buddy_it = block->free_lists[order].find(buddy_offset);
+		if (buddy_it == block->free_lists[order].end())
+			break;
+
+		block->free_lists[order].erase(buddy_it);
+		node_offset = std::min(node_offset, buddy_offset);
+		order++;
+	}
+
+	block->free_lists[order].insert(node_offset);
+}
+
+VkDeviceSize VulkanMemoryAllocator::GetLargestFreeRange(MemoryBlock* block)
+{
+	if (block->strategy == AllocationStrategy::LINEAR)
+		return block->size - block->linear_offset;
+
+	for (int order = static_cast<int>(block->free_lists.size()) - 1; order >= 0; order--)
+	{
+		if (!block->free_lists[order].empty())
+			return (VkDeviceSize)MIN_BUDDY_ALLOCATION_SIZE << order;
+	}
+
+	return 0;
+}
+
+uint32_t VulkanMemoryAllocator::GetBuddyOrder(VkDeviceSize size)
+{
+	uint32_t order = 0;
+	while (((VkDeviceSize)MIN_BUDDY_ALLOCATION_SIZE << order) < size)
+	{
+		order++;
+	}
+	return order;
+}
\ No newline at end of file
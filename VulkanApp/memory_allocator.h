@@ -0,0 +1,111 @@
+#ifndef _MEMORY_ALLOCATOR_H_
+#define _MEMORY_ALLOCATOR_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <set>
+#include <map>
+#include <mutex>
+
+#define MEMORY_BLOCK_SIZE 67108864
+#define MIN_BUDDY_ALLOCATION_SIZE 256
+
+enum class AllocationStrategy
+{
+	LINEAR,	// bump allocation, space is reclaimed once every allocation in the block is freed
+	BUDDY	// power of two buddy allocation with free list reuse
+};
+
+struct MemoryAllocation
+{
+	VkDeviceMemory memory;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	void* mapped_data;
+	uint32_t memory_type;
+	int32_t block_index;	// -1 for dedicated allocations
+};
+
+struct MemoryBlockStatistics
+{
+	uint32_t memory_type;
+	AllocationStrategy strategy;
+	bool image_block;
+	uint32_t allocation_count;
+	VkDeviceSize block_size;
+	VkDeviceSize used_bytes;
+	VkDeviceSize free_bytes;
+	VkDeviceSize largest_free_range;
+	float fragmentation;
+};
+
+struct MemoryStatistics
+{
+	std::vector<MemoryBlockStatistics> blocks;
+	uint32_t block_count;
+	uint32_t dedicated_allocation_count;
+	uint32_t allocation_count;
+	uint32_t device_allocation_count;
+	uint32_t max_device_allocation_count;
+	VkDeviceSize reserved_bytes;
+	VkDeviceSize used_bytes;
+	VkDeviceSize free_bytes;
+	float fragmentation;
+};
+
+class VulkanMemoryAllocator
+{
+protected:
+	struct MemoryBlock
+	{
+		VkDeviceMemory memory;
+		VkDeviceSize size;
+		void* mapped_data;
+		uint32_t memory_type;
+		AllocationStrategy strategy;
+		bool image_block;
+		uint32_t allocation_count;
+		VkDeviceSize used_bytes;
+
+		// linear strategy
+		VkDeviceSize linear_offset;
+
+		// buddy strategy, free offsets per order and the order of each live allocation
+		std::vector<std::set<VkDeviceSize>> free_lists;
+		std::map<VkDeviceSize, uint32_t> allocation_orders;
+	};
+
+public:
+	VulkanMemoryAllocator();
+
+	void Init(VkPhysicalDevice physical_device, VkDevice logical_device);
+	void Cleanup();
+
+	MemoryAllocation Allocate(VkMemoryRequirements requirements, uint32_t memory_type, bool image, AllocationStrategy strategy);
+	void Free(MemoryAllocation& allocation);
+
+	MemoryStatistics GetStatistics();
+	void PrintStatistics();
+
+protected:
+	MemoryAllocation AllocateDedicated(VkMemoryRequirements requirements, uint32_t memory_type);
+	MemoryBlock* CreateBlock(uint32_t memory_type, bool image, AllocationStrategy strategy);
+	bool AllocateFromBlock(MemoryBlock* block, VkMemoryRequirements requirements, VkDeviceSize& offset);
+	void FreeFromBlock(MemoryBlock* block, VkDeviceSize offset, VkDeviceSize size);
+	VkDeviceSize GetLargestFreeRange(MemoryBlock* block);
+	uint32_t GetBuddyOrder(VkDeviceSize size);
+
+protected:
+	VkDevice logical_device_;
+	VkPhysicalDeviceMemoryProperties memory_properties_;
+	VkDeviceSize buffer_image_granularity_;
+	uint32_t max_device_allocation_count_;
+
+	std::vector<MemoryBlock*> blocks_;
+	uint32_t dedicated_allocation_count_;
+	VkDeviceSize dedicated_bytes_;
+
+	std::mutex allocator_mutex_;
+};
+
+#endif
\ No newline at end of file
@@ -1,11 +1,24 @@
 #include "mesh.h"
+#include "trace_profiler.h"
+#include "load_statistics.h"
+#include "mesh_cache.h"
+#include "vertex_welder.h"
+#include "mesh_optimizer.h"
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 #include <unordered_map>
 #include <iostream>
+#include <fstream>
+#include <chrono>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
 #include "renderer.h"
 
+bool Mesh::optimize_shapes_ = MESH_OPTIMIZATION_ENABLED;
+
 Mesh::Mesh()
 {
 	world_matrix_ = glm::mat4(1.0f);
@@ -44,18 +57,61 @@ void Mesh::UpdateWorldMatrix(glm::mat4 world_matrix)
 
 void Mesh::CreateModelMesh(VulkanDevices* devices, VulkanRenderer* renderer, std::string filename)
 {
+	TRACE_FUNCTION();
+
 	vk_device_handle_ = devices->GetLogicalDevice();
 
+	std::cout << "Loading model file: " << filename << std::endl;
+
+	std::string mat_dir = "../res/materials/";
+	std::string texture_dir = renderer ? renderer->GetTextureDirectory() : mat_dir;
+
+	// the obj and its material libraries are hashed to find a cache of this version of the model
+	std::string cache_filename = MeshCache::GetCacheFilename(filename);
+	uint64_t source_hash = 0;
+	{
+		TRACE_SCOPE("hash source");
+		LoadPhaseTimer cache_timer(LoadPhase::MESH_CACHE);
+		uint64_t source_bytes = 0;
+		source_hash = MeshCache::HashSource(filename, mat_dir, source_bytes);
+		cache_timer.AddBytes(source_bytes);
+	}
+
+	// the obj is only parsed when there is no cache of it
+	if (!LoadCachedMesh(devices, renderer, cache_filename, source_hash, texture_dir))
+		LoadObjMesh(devices, renderer, filename, mat_dir, texture_dir, cache_filename, source_hash);
+
+	// submit the remaining staged uploads and wait for them to reach the device
+	{
+		LoadPhaseTimer upload_timer(LoadPhase::SHAPE_UPLOAD);
+		devices->GetUploadManager()->WaitIdle();
+	}
+
+	std::cout << "The most complex shape contains " << most_complex_shape_size_ << " triangles.\n";
+}
+
+void Mesh::LoadObjMesh(VulkanDevices* devices, VulkanRenderer* renderer, const std::string& filename, const std::string& mat_dir, const std::string& texture_dir, const std::string& cache_filename, uint64_t source_hash)
+{
+	TRACE_FUNCTION();
+
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
 	std::string err;
 
-	std::cout << "Loading model file: " << filename << std::endl;
-
-	std::string mat_dir = "../res/materials/";
+	bool loaded;
+	{
+		TRACE_SCOPE("parse obj");
+		LoadPhaseTimer parse_timer(LoadPhase::PARSE);
+		loaded = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename.c_str(), mat_dir.c_str());
+
+		std::ifstream obj_file(filename, std::ios::binary | std::ios::ate);
+		if (obj_file.is_open())
+			parse_timer.AddBytes(static_cast<uint64_t>(obj_file.tellg()));
+		parse_timer.AddItems(shapes.size());
+	}
 
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename.c_str(), mat_dir.c_str()))
+	if (!loaded)
 	{
 		throw std::runtime_error(err);
 	}
@@ -73,60 +129,320 @@ void Mesh::CreateModelMesh(VulkanDevices* devices, VulkanRenderer* renderer, std
 
 	std::cout << "Model contains " << index_count << " indices" << std::endl;
 
-	if(renderer)
-		mat_dir = renderer->GetTextureDirectory();
+	CreateMaterials(devices, renderer, materials, texture_dir);
+
+	// faces look their material up by id, so the loading threads never touch the material map
+	std::vector<Material*> id_materials;
+	for (const tinyobj::material_t& material : materials)
+		id_materials.push_back(mesh_materials_[material.name]);
 
-	// create the mesh materials
-	for (tinyobj::material_t material : materials)
+	// the shapes are written to a cache as they are uploaded, so the next load can skip the obj
+	std::vector<uint32_t> material_indices;
+	for (Material* material : id_materials)
+		material_indices.push_back(material->GetMaterialIndex());
+
+	MeshCacheWriter cache_writer;
+	uint32_t cache_flags = optimize_shapes_ ? MESH_CACHE_FLAG_OPTIMIZED : 0;
+	if (!cache_writer.Begin(cache_filename, source_hash, cache_flags, materials, material_indices))
+		std::cout << "Unable to write mesh cache: " << cache_filename << std::endl;
+
+	// large shapes are split so a single shape cannot hold up the other threads
+	std::vector<ShapeLoadTask> tasks;
+	std::vector<ShapeLoadResult> results(shapes.size());
+	for (uint32_t shape_index = 0; shape_index < shapes.size(); shape_index++)
 	{
-		if (mesh_materials_.find(material.name) == mesh_materials_.end())
+		size_t shape_index_count = shapes[shape_index].mesh.indices.size();
+		uint32_t chunk_count = std::max(static_cast<uint32_t>((shape_index_count + SHAPE_TASK_INDEX_COUNT - 1) / SHAPE_TASK_INDEX_COUNT), 1u);
+
+		results[shape_index].chunks.resize(chunk_count);
+		results[shape_index].remaining_chunks = chunk_count;
+		results[shape_index].ready = false;
+		results[shape_index].original_cache_misses = 0;
+		results[shape_index].optimized_cache_misses = 0;
+		results[shape_index].optimized_vertex_count = 0;
+
+		for (uint32_t chunk_index = 0; chunk_index < chunk_count; chunk_index++)
 		{
-			mesh_materials_[material.name] = new Material();
-			mesh_materials_[material.name]->InitMaterial(devices, renderer, material, mat_dir);
+			ShapeLoadTask task = {};
+			task.shape_index = shape_index;
+			task.chunk_index = chunk_index;
+			task.first_index = static_cast<size_t>(chunk_index) * SHAPE_TASK_INDEX_COUNT;
+			task.index_count = std::min(shape_index_count - task.first_index, static_cast<size_t>(SHAPE_TASK_INDEX_COUNT));
+			tasks.push_back(task);
 		}
 	}
 
-	// multithread shape loading
-	const int thread_count = 1;
-	std::thread shape_threads[thread_count];
+	std::vector<std::exception_ptr> exceptions(tasks.size());
+	std::exception_ptr upload_exception;
+	std::atomic<size_t> next_task(0);
+	std::atomic<bool> load_failed(false);
+
+	// signalled whenever a shape has been merged and is ready for the upload stage
+	std::mutex ready_mutex;
+	std::condition_variable shape_ready;
+
+	auto process_task = [&](size_t task_index)
+	{
+		const ShapeLoadTask& task = tasks[task_index];
+		ShapeLoadResult& result = results[task.shape_index];
+
+		try
+		{
+			LoadShapeRange(attrib, shapes[task.shape_index], id_materials, task.first_index, task.index_count, result.chunks[task.chunk_index]);
+		}
+		catch (...)
+		{
+			exceptions[task_index] = std::current_exception();
+			load_failed = true;
+		}
+
+		// the last of the shape's chunks to finish merges them and hands the shape to the upload stage
+		if (result.remaining_chunks.fetch_sub(1) != 1)
+			return;
 
-	// determine how many shapes are calculated per thread
-	const int shapes_per_thread = shapes.size() / thread_count;
-	int leftover_shapes = shapes.size() % thread_count;
+		try
+		{
+			MergeShapeChunks(result);
+			OptimizeShape(result);
+		}
+		catch (...)
+		{
+			exceptions[task_index] = std::current_exception();
+			load_failed = true;
+		}
 
-	// create mutex for sending shape data to the renderer
-	std::mutex shape_mutex;
+		{
+			std::lock_guard<std::mutex> ready_lock(ready_mutex);
+			result.ready = true;
+		}
+		shape_ready.notify_one();
+	};
 
-	int shape_index = 0;
+	// each worker takes the next task until none are left
+	auto worker = [&]()
+	{
+		for (size_t i = next_task++; i < tasks.size(); i = next_task++)
+			process_task(i);
+	};
 
-	// send the shapes to the threads
-	for (int thread_index = 0; thread_index < thread_count; thread_index++)
+	uint32_t thread_count = std::min(std::max(std::thread::hardware_concurrency(), 1u), static_cast<uint32_t>(tasks.size()));
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < thread_count; i++)
 	{
-		std::vector<tinyobj::shape_t*> thread_shapes;
+		threads.push_back(std::thread([&]()
+		{
+			TRACE_THREAD_NAME("shape loader");
+			worker();
+		}));
+	}
+
+	// the calling thread is the upload stage, shapes are uploaded in file order so their
+	// primitive buffer order does not depend on the thread timing, between uploads it takes tasks too
+	{
+		TRACE_SCOPE("load shapes");
+		size_t next_upload = 0;
+		while (next_upload < results.size())
+		{
+			if (results[next_upload].ready)
+			{
+				try
+				{
+					if (!load_failed)
+						UploadShape(devices, renderer, results[next_upload], &cache_writer);
+				}
+				catch (...)
+				{
+					upload_exception = std::current_exception();
+					load_failed = true;
+				}
+				next_upload++;
+				continue;
+			}
+
+			size_t task_index = next_task++;
+			if (task_index < tasks.size())
+			{
+				process_task(task_index);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> ready_lock(ready_mutex);
+			shape_ready.wait(ready_lock, [&]() { return results[next_upload].ready.load(); });
+		}
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	// report the first failure once every thread has finished with the shapes
+	if (upload_exception)
+		std::rethrow_exception(upload_exception);
+
+	for (std::exception_ptr& exception : exceptions)
+	{
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+
+	if (optimize_shapes_)
+	{
+		// summed over the shapes, every welded vertex is used so the optimizer keeps the vertex counts
+		double original_cache_misses = 0.0, optimized_cache_misses = 0.0, vertex_count = 0.0;
+		for (const ShapeLoadResult& result : results)
+		{
+			original_cache_misses += result.original_cache_misses;
+			optimized_cache_misses += result.optimized_cache_misses;
+			vertex_count += result.optimized_vertex_count;
+		}
+
+		double triangle_count = std::max(index_count / 3.0, 1.0);
+		vertex_count = std::max(vertex_count, 1.0);
+		std::cout << "Optimized for a " << MESH_OPTIMIZER_CACHE_SIZE << " entry vertex cache: acmr " << original_cache_misses / triangle_count << " -> " << optimized_cache_misses / triangle_count
+			<< ", atvr " << original_cache_misses / vertex_count << " -> " << optimized_cache_misses / vertex_count << std::endl;
+	}
+
+	if (cache_writer.IsWriting())
+	{
+		LoadPhaseTimer cache_timer(LoadPhase::MESH_CACHE);
+		if (cache_writer.End())
+			std::cout << "Wrote mesh cache: " << cache_filename << std::endl;
+	}
+}
+
+bool Mesh::LoadCachedMesh(VulkanDevices* devices, VulkanRenderer* renderer, const std::string& cache_filename, uint64_t source_hash, const std::string& texture_dir)
+{
+	TRACE_FUNCTION();
+
+	MeshCacheReader cache;
+	{
+		LoadPhaseTimer cache_timer(LoadPhase::MESH_CACHE);
+		if (!cache.Open(cache_filename, source_hash, optimize_shapes_ ? MESH_CACHE_FLAG_OPTIMIZED : 0))
+			return false;
+
+		cache_timer.AddBytes(cache.GetSize());
+	}
+
+	std::cout << "Loading mesh cache: " << cache_filename << std::endl;
+	std::cout << "Model contains " << cache.GetShapeCount() << " shapes" << std::endl;
+	std::cout << "Model contains " << cache.GetMaterials().size() << " unique materials" << std::endl;
+
+	std::vector<tinyobj::material_t>& materials = cache.GetMaterials();
+	CreateMaterials(devices, renderer, materials, texture_dir);
+
+	// the cached vertices hold the material buffer indices from when the cache was written,
+	// they are only rewritten when the materials were added to the buffer in a different order
+	std::unordered_map<uint32_t, float> material_remap;
+	bool remap_materials = false;
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		uint32_t material_index = mesh_materials_[materials[i].name]->GetMaterialIndex();
+		material_remap[cache.GetMaterialIndices()[i]] = static_cast<float>(material_index);
+		if (material_index != cache.GetMaterialIndices()[i])
+			remap_materials = true;
+	}
+
+	// the shapes are staged straight from the mapped cache
+	std::vector<Vertex> remapped_vertices;
+	for (uint32_t i = 0; i < cache.GetShapeCount(); i++)
+	{
+		const MeshCacheShape& cached_shape = cache.GetShape(i);
+		const Vertex* vertices = cache.GetVertices(cached_shape);
+		if (remap_materials)
+		{
+			remapped_vertices.assign(vertices, vertices + cached_shape.vertex_count);
+			for (Vertex& vertex : remapped_vertices)
+			{
+				auto remapped_index = material_remap.find(static_cast<uint32_t>(vertex.pos_mat_index.w));
+				if (remapped_index != material_remap.end())
+					vertex.pos_mat_index.w = remapped_index->second;
+			}
+			vertices = remapped_vertices.data();
+		}
 
-		
-		// determine the shapes that will be sent to this thread
-		for (int i = 0; i < shapes_per_thread; i++)
+		min_vertex_ = glm::min(min_vertex_, glm::vec3(cached_shape.min_vertex));
+		max_vertex_ = glm::max(max_vertex_, glm::vec3(cached_shape.max_vertex));
+		most_complex_shape_size_ = std::max(most_complex_shape_size_, cached_shape.index_count / 3);
+
+		BoundingBox shape_bounding_box = { cached_shape.min_vertex, cached_shape.max_vertex };
+
+		LoadPhaseTimer upload_timer(LoadPhase::SHAPE_UPLOAD);
+		upload_timer.AddBytes(cached_shape.vertex_count * sizeof(Vertex) + cached_shape.index_count * sizeof(uint32_t));
+		upload_timer.AddItems(1);
+
+		Shape* mesh_shape = new Shape();
+		mesh_shape->InitShape(devices, renderer, vertices, cached_shape.vertex_count, cache.GetIndices(cached_shape), cached_shape.index_count, shape_bounding_box, cached_shape.transparency_enabled != 0);
+		mesh_shapes_.push_back(mesh_shape);
+	}
+
+	return true;
+}
+
+void Mesh::CreateMaterials(VulkanDevices* devices, VulkanRenderer* renderer, std::vector<tinyobj::material_t>& materials, const std::string& texture_dir)
+{
+	TRACE_SCOPE("load materials");
+	LoadPhaseTimer materials_timer(LoadPhase::MATERIALS);
+	for (tinyobj::material_t& material : materials)
+	{
+		if (mesh_materials_.find(material.name) == mesh_materials_.end())
 		{
-			thread_shapes.push_back(&shapes[shape_index]);
-			shape_index++;
+			materials_timer.AddItems(1);
+			mesh_materials_[material.name] = new Material();
+			mesh_materials_[material.name]->InitMaterial(devices, renderer, material, texture_dir);
 		}
+	}
+}
+
+void Mesh::CreateProceduralMesh(VulkanDevices* devices, VulkanRenderer* renderer, ProceduralScene& scene)
+{
+	TRACE_FUNCTION();
+
+	vk_device_handle_ = devices->GetLogicalDevice();
+
+	const ProceduralSceneSettings& settings = scene.GetSettings();
+	std::cout << "Generating procedural scene with " << settings.shape_count << " shapes and " << settings.material_count << " materials" << std::endl;
 
-		// if there are still leftover shapes add one to this vector
-		if (leftover_shapes > 0)
+	// the materials are kept in generation order so shapes can look them up by index
+	std::vector<Material*> materials;
+	{
+		TRACE_SCOPE("create materials");
+		LoadPhaseTimer materials_timer(LoadPhase::MATERIALS);
+		std::vector<tinyobj::material_t> scene_materials = scene.CreateMaterials();
+		for (tinyobj::material_t& material : scene_materials)
 		{
-			thread_shapes.push_back(&shapes[shape_index]);
-			shape_index++;
-			leftover_shapes--;
+			materials_timer.AddItems(1);
+			Material* mesh_material = new Material();
+			mesh_material->InitMaterial(devices, renderer, material, PROCEDURAL_SCENE_TEXTURE_DIRECTORY);
+			mesh_materials_[material.name] = mesh_material;
+			materials.push_back(mesh_material);
 		}
+	}
+
+	// the shapes are generated already indexed, so go straight to the upload
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	for (uint32_t i = 0; i < settings.shape_count; i++)
+	{
+		Material* material = materials[scene.GetShapeMaterial(i)];
+		BoundingBox shape_bounding_box = {};
+		scene.CreateShape(i, static_cast<float>(material->GetMaterialIndex()), vertices, indices, shape_bounding_box);
 
-		// start the thread for this set of shapes
-		shape_threads[thread_index] = std::thread(&Mesh::LoadShapeThreaded, this, &shape_mutex, devices, renderer, &attrib, &materials, thread_shapes);
+		min_vertex_ = glm::min(min_vertex_, glm::vec3(shape_bounding_box.min_vertex));
+		max_vertex_ = glm::max(max_vertex_, glm::vec3(shape_bounding_box.max_vertex));
+		most_complex_shape_size_ = std::max(most_complex_shape_size_, (uint32_t)indices.size() / 3);
+
+		LoadPhaseTimer upload_timer(LoadPhase::SHAPE_UPLOAD);
+		upload_timer.AddBytes(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(uint32_t));
+		upload_timer.AddItems(1);
+
+		Shape* mesh_shape = new Shape();
+		mesh_shape->InitShape(devices, renderer, vertices, indices, shape_bounding_box, material->GetTransparencyEnabled());
+		mesh_shapes_.push_back(mesh_shape);
 	}
 
-	for (int i = 0; i < thread_count; i++)
+	// submit the remaining staged uploads and wait for them to reach the device
 	{
-		shape_threads[i].join();
+		LoadPhaseTimer upload_timer(LoadPhase::SHAPE_UPLOAD);
+		devices->GetUploadManager()->WaitIdle();
 	}
 
 	std::cout << "The most complex shape contains " << most_complex_shape_size_ << " triangles.\n";
@@ -140,138 +456,194 @@ glm::vec2 Mesh::SpheremapEncode(glm::vec3 normal)
 	return enc;
 }
 
-void Mesh::LoadShapeThreaded(std::mutex* shape_mutex, VulkanDevices* devices, VulkanRenderer* renderer, tinyobj::attrib_t* attrib, std::vector<tinyobj::material_t>* materials, std::vector<tinyobj::shape_t*> shapes)
+Vertex Mesh::CreateVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index)
 {
-	for (const auto& shape : shapes)
+	Vertex vertex = {};
+
+	if (index.vertex_index >= 0)
 	{
-		std::unordered_map<Vertex, uint32_t> unique_vertices = {};
-		std::vector<Vertex> vertices;
-		std::vector<uint32_t> indices; 
-		glm::vec4 shape_min_vertex = glm::vec4(1e9f, 1e9f, 1e9f, 0.0f);
-		glm::vec4 shape_max_vertex = glm::vec4(-1e9f, -1e9f, -1e9f, 0.0f);
+		vertex.pos_mat_index.x = attrib.vertices[3 * index.vertex_index + 0];
+		vertex.pos_mat_index.y = attrib.vertices[3 * index.vertex_index + 2];
+		vertex.pos_mat_index.z = attrib.vertices[3 * index.vertex_index + 1];
+	}
+	else
+	{
+		vertex.pos_mat_index.x = 0;
+		vertex.pos_mat_index.y = 0;
+		vertex.pos_mat_index.z = 0;
+	}
 
-		Shape* mesh_shape = new Shape();
+	if (index.texcoord_index >= 0)
+	{
+		vertex.encoded_normal_tex.z = attrib.texcoords[2 * index.texcoord_index + 0];
+		vertex.encoded_normal_tex.w = 1.0f - attrib.texcoords[2 * index.texcoord_index + 1];
+	}
+	else
+	{
+		vertex.encoded_normal_tex.z = 0;
+		vertex.encoded_normal_tex.w = 0;
+	}
 
-		int face_index = 0;
-		bool transparency_enabled = false;
+	if (index.normal_index >= 0)
+	{
+		glm::vec3 normal = {
+			-attrib.normals[3 * index.normal_index + 0],
+			attrib.normals[3 * index.normal_index + 2],
+			attrib.normals[3 * index.normal_index + 1]
+		};
+
+		glm::vec2 encoded_normal = SpheremapEncode(normal);
+		vertex.encoded_normal_tex.x = encoded_normal.x;
+		vertex.encoded_normal_tex.y = encoded_normal.y;
+	}
+	else
+	{
+		vertex.encoded_normal_tex.x = 0;
+		vertex.encoded_normal_tex.y = 0;
+	}
 
-		for (const auto& index : shape->mesh.indices)
-		{
-			Vertex vertex = {};
+	return vertex;
+}
 
-			if (index.vertex_index >= 0)
-			{
-				vertex.pos_mat_index.x = attrib->vertices[3 * index.vertex_index + 0];
-				vertex.pos_mat_index.y = attrib->vertices[3 * index.vertex_index + 2];
-				vertex.pos_mat_index.z = attrib->vertices[3 * index.vertex_index + 1];
-			}
-			else
+void Mesh::LoadShapeRange(const tinyobj::attrib_t& attrib, const tinyobj::shape_t& shape, const std::vector<Material*>& materials, size_t first_index, size_t index_count, ShapeChunk& chunk)
+{
+	TRACE_FUNCTION();
+
+	// the chunk's vertices are deduplicated against each other only, so no other thread is involved
+	VertexWelder welder;
+	welder.Reset(index_count, &chunk.vertices);
+	chunk.indices.clear();
+	chunk.indices.reserve(index_count);
+	chunk.min_vertex = glm::vec4(1e9f, 1e9f, 1e9f, 0.0f);
+	chunk.max_vertex = glm::vec4(-1e9f, -1e9f, -1e9f, 0.0f);
+	chunk.transparency_enabled = false;
+
+	auto dedup_start = std::chrono::high_resolution_clock::now();
+	float material_index = 0.0f;
+	for (size_t i = first_index; i < first_index + index_count; i++)
+	{
+		// the material is looked up once per face
+		if (i % 3 == 0)
+		{
+			material_index = 0.0f;
+			int material_id = shape.mesh.material_ids[i / 3];
+			if (material_id >= 0 && material_id < static_cast<int>(materials.size()) && materials[material_id])
 			{
-				vertex.pos_mat_index.x = 0;
-				vertex.pos_mat_index.y = 0;
-				vertex.pos_mat_index.z = 0;
+				material_index = static_cast<float>(materials[material_id]->GetMaterialIndex());
+				if (!chunk.transparency_enabled)
+					chunk.transparency_enabled = materials[material_id]->GetTransparencyEnabled();
 			}
+		}
 
-			if (index.texcoord_index >= 0)
-			{
-				vertex.encoded_normal_tex.z = attrib->texcoords[2 * index.texcoord_index + 0];
-				vertex.encoded_normal_tex.w = 1.0f - attrib->texcoords[2 * index.texcoord_index + 1];
-			}
-			else
-			{
-				vertex.encoded_normal_tex.z = 0;
-				vertex.encoded_normal_tex.w = 0;
-			}
+		Vertex vertex = CreateVertex(attrib, shape.mesh.indices[i]);
+		vertex.pos_mat_index.w = material_index;
 
-			if (index.normal_index >= 0)
-			{
-				glm::vec3 normal = {
-					-attrib->normals[3 * index.normal_index + 0],
-					attrib->normals[3 * index.normal_index + 2],
-					attrib->normals[3 * index.normal_index + 1]
-				};
-
-				glm::vec2 encoded_normal = SpheremapEncode(normal);
-				vertex.encoded_normal_tex.x = encoded_normal.x;
-				vertex.encoded_normal_tex.y = encoded_normal.y;
-			}
-			else
-			{
-				vertex.encoded_normal_tex.x = 0;
-				vertex.encoded_normal_tex.y = 0;
-			}
+		size_t vertex_count = chunk.vertices.size();
+		uint32_t vertex_index = welder.Weld(vertex);
+		if (chunk.vertices.size() > vertex_count)
+		{
+			// grow the chunk bounds by the new vertex
+			chunk.min_vertex = glm::min(chunk.min_vertex, glm::vec4(glm::vec3(vertex.pos_mat_index), 0.0f));
+			chunk.max_vertex = glm::max(chunk.max_vertex, glm::vec4(glm::vec3(vertex.pos_mat_index), 0.0f));
+		}
 
-			// material index
-			vertex.pos_mat_index.w = 0;
-			if (mesh_materials_.size() > 0)
-			{
-				Material* face_material = mesh_materials_[(*materials)[shape->mesh.material_ids[face_index]].name];
-				if (face_material)
-				{
-					if (face_material->GetMaterialIndex() >= 0)
-					{
-						vertex.pos_mat_index.w = face_material->GetMaterialIndex();
-						if (!transparency_enabled)
-							transparency_enabled = face_material->GetTransparencyEnabled();
-					}
-				}
-			}
+		chunk.indices.push_back(vertex_index);
+	}
 
-			if (unique_vertices.count(vertex) == 0)
-			{
-				unique_vertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
-
-				// test to see if this vertex is outside the current shape bounds
-				if (vertex.pos_mat_index.x < shape_min_vertex.x)
-					shape_min_vertex.x = vertex.pos_mat_index.x;
-				else if (vertex.pos_mat_index.x > shape_max_vertex.x)
-					shape_max_vertex.x = vertex.pos_mat_index.x;
-
-				if (vertex.pos_mat_index.y < shape_min_vertex.y)
-					shape_min_vertex.y = vertex.pos_mat_index.y;
-				else if (vertex.pos_mat_index.y > shape_max_vertex.y)
-					shape_max_vertex.y = vertex.pos_mat_index.y;
-
-				if (vertex.pos_mat_index.z < shape_min_vertex.z)
-					shape_min_vertex.z = vertex.pos_mat_index.z;
-				else if (vertex.pos_mat_index.z > shape_max_vertex.z)
-					shape_max_vertex.z = vertex.pos_mat_index.z;
-			}
+	// the bytes are those of the unique vertices kept
+	double dedup_time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - dedup_start).count();
+	LoadStatistics::Add(LoadPhase::VERTEX_DEDUP, dedup_time, chunk.vertices.size() * sizeof(Vertex), index_count);
+}
 
-			indices.push_back(unique_vertices[vertex]);
+void Mesh::MergeShapeChunks(ShapeLoadResult& result)
+{
+	if (result.chunks.size() == 1)
+		return;
 
-			if (indices.size() % 3 == 0)
-				face_index++;
-		}
+	TRACE_FUNCTION();
 
-		// test to see if this shape is outside the current mesh bounds
-		if (shape_min_vertex.x < min_vertex_.x)
-			min_vertex_.x = shape_min_vertex.x;
-		
-		if (shape_max_vertex.x > max_vertex_.x)
-			max_vertex_.x = shape_max_vertex.x;
+	// only the chunks' unique vertices are hashed again, vertices shared across a chunk boundary are merged here
+	ShapeChunk merged = {};
+	merged.min_vertex = glm::vec4(1e9f, 1e9f, 1e9f, 0.0f);
+	merged.max_vertex = glm::vec4(-1e9f, -1e9f, -1e9f, 0.0f);
+	merged.transparency_enabled = false;
 
-		if (shape_min_vertex.y < min_vertex_.y)
-			min_vertex_.y = shape_min_vertex.y;
-		
-		if (shape_max_vertex.y > max_vertex_.y)
-			max_vertex_.y = shape_max_vertex.y;
+	size_t chunk_vertex_count = 0;
+	for (ShapeChunk& chunk : result.chunks)
+		chunk_vertex_count += chunk.vertices.size();
 
-		if (shape_min_vertex.z < min_vertex_.z)
-			min_vertex_.z = shape_min_vertex.z;
-		
-		if (shape_max_vertex.z > max_vertex_.z)
-			max_vertex_.z = shape_max_vertex.z;
+	VertexWelder welder;
+	welder.Reset(chunk_vertex_count, &merged.vertices);
 
+	std::vector<uint32_t> remap;
+	for (ShapeChunk& chunk : result.chunks)
+	{
+		remap.resize(chunk.vertices.size());
+		for (size_t v = 0; v < chunk.vertices.size(); v++)
+			remap[v] = welder.Weld(chunk.vertices[v]);
 
-		most_complex_shape_size_ = std::max(most_complex_shape_size_, (uint32_t)indices.size() / 3);
-		BoundingBox shape_bounding_box = {shape_min_vertex, shape_max_vertex};
-		std::unique_lock<std::mutex> shape_lock(*shape_mutex);
-		mesh_shape->InitShape(devices, renderer, vertices, indices, shape_bounding_box, transparency_enabled);
+		for (uint32_t index : chunk.indices)
+			merged.indices.push_back(remap[index]);
+
+		merged.min_vertex = glm::min(merged.min_vertex, chunk.min_vertex);
+		merged.max_vertex = glm::max(merged.max_vertex, chunk.max_vertex);
+		merged.transparency_enabled = merged.transparency_enabled || chunk.transparency_enabled;
+	}
+
+	result.chunks.clear();
+	result.chunks.push_back(std::move(merged));
+}
+
+void Mesh::OptimizeShape(ShapeLoadResult& result)
+{
+	if (!optimize_shapes_)
+		return;
+
+	TRACE_FUNCTION();
+	LoadPhaseTimer optimize_timer(LoadPhase::MESH_OPTIMIZE);
+
+	ShapeChunk& shape_data = result.chunks[0];
+	uint32_t vertex_count = static_cast<uint32_t>(shape_data.vertices.size());
+	result.original_cache_misses = MeshOptimizer::AnalyzeVertexCache(shape_data.indices, vertex_count).cache_misses;
+
+	MeshOptimizer::Optimize(shape_data.vertices, shape_data.indices);
+	result.optimized_cache_misses = MeshOptimizer::AnalyzeVertexCache(shape_data.indices, vertex_count).cache_misses;
+	result.optimized_vertex_count = vertex_count;
+
+	optimize_timer.AddBytes(shape_data.vertices.size() * sizeof(Vertex) + shape_data.indices.size() * sizeof(uint32_t));
+	optimize_timer.AddItems(shape_data.indices.size());
+}
+
+void Mesh::UploadShape(VulkanDevices* devices, VulkanRenderer* renderer, ShapeLoadResult& result, MeshCacheWriter* cache_writer)
+{
+	ShapeChunk& shape_data = result.chunks[0];
+
+	// the mesh bounds are only grown by the upload stage, so no thread races on them
+	min_vertex_ = glm::min(min_vertex_, glm::vec3(shape_data.min_vertex));
+	max_vertex_ = glm::max(max_vertex_, glm::vec3(shape_data.max_vertex));
+	most_complex_shape_size_ = std::max(most_complex_shape_size_, (uint32_t)shape_data.indices.size() / 3);
+
+	BoundingBox shape_bounding_box = { shape_data.min_vertex, shape_data.max_vertex };
+
+	{
+		LoadPhaseTimer upload_timer(LoadPhase::SHAPE_UPLOAD);
+		upload_timer.AddBytes(shape_data.vertices.size() * sizeof(Vertex) + shape_data.indices.size() * sizeof(uint32_t));
+		upload_timer.AddItems(1);
+
+		Shape* mesh_shape = new Shape();
+		mesh_shape->InitShape(devices, renderer, shape_data.vertices, shape_data.indices, shape_bounding_box, shape_data.transparency_enabled);
 		mesh_shapes_.push_back(mesh_shape);
-		shape_lock.unlock();
 	}
+
+	if (cache_writer && cache_writer->IsWriting())
+	{
+		LoadPhaseTimer cache_timer(LoadPhase::MESH_CACHE);
+		cache_writer->AddShape(shape_data.vertices, shape_data.indices, shape_bounding_box, shape_data.transparency_enabled);
+	}
+
+	// the data has been staged, so release it while the other shapes are still loading
+	result.chunks.clear();
+	result.chunks.shrink_to_fit();
 }
 
 void Mesh::RecordRenderCommands(VkCommandBuffer& command_buffer, RenderStage render_stage)
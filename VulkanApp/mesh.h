@@ -11,10 +11,17 @@
 #include <string>
 #include <map>
 #include <mutex>
+#include <atomic>
+#include <cstring>
 
 #include "device.h"
 #include "primitive_buffer.h"
 #include "shape.h"
+#include "procedural_scene.h"
+
+class MeshCacheWriter;
+
+#define SHAPE_TASK_INDEX_COUNT (3 * 65536)	// shapes with more indices are split into several loading tasks, a multiple of 3 so tasks hold whole faces
 
 struct Vertex
 {
@@ -60,9 +67,27 @@ namespace std
 {
 	template<> struct hash<Vertex>
 	{
+		// every component is hashed, -0.0 and 0.0 compare equal so they are hashed as the same value
 		size_t operator()(Vertex const& vertex) const
 		{
-			return (hash<glm::vec3>()(vertex.pos_mat_index) ^ (hash<glm::vec2>()(vertex.encoded_normal_tex) << 1));
+			uint64_t hash = 0x9E3779B97F4A7C15ull;
+			for (int i = 0; i < 8; i++)
+			{
+				float component = (i < 4) ? vertex.pos_mat_index[i] : vertex.encoded_normal_tex[i - 4];
+				if (component == 0.0f)
+					component = 0.0f;
+
+				uint32_t bits;
+				memcpy(&bits, &component, sizeof(bits));
+				hash = (hash ^ bits) * 0xFF51AFD7ED558CCDull;
+				hash ^= hash >> 32;
+			}
+
+			// murmur3 finaliser, so the low bits used to index a table depend on every component
+			hash ^= hash >> 33;
+			hash *= 0xC4CEB9FE1A85EC53ull;
+			hash ^= hash >> 33;
+			return static_cast<size_t>(hash);
 		}
 	};
 }
@@ -73,6 +98,7 @@ public:
 	~Mesh();
 	
 	void CreateModelMesh(VulkanDevices* devices, VulkanRenderer* renderer, std::string filename);
+	void CreateProceduralMesh(VulkanDevices* devices, VulkanRenderer* renderer, ProceduralScene& scene);
 
 	void UpdateWorldMatrix(glm::mat4 world_matrix);
 	
@@ -83,8 +109,54 @@ public:
 
 	static glm::vec2 SpheremapEncode(glm::vec3 normal);
 
+	// loaded shapes are reordered by the mesh optimizer when enabled, a cache is rebuilt when this changes
+	inline static void SetShapeOptimization(bool enabled) { optimize_shapes_ = enabled; }
+	inline static bool GetShapeOptimization() { return optimize_shapes_; }
+
+	// the vertex of an obj index, without its material
+	static Vertex CreateVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index);
+
 protected:
-	void LoadShapeThreaded(std::mutex* shape_mutex, VulkanDevices* devices, VulkanRenderer* renderer, tinyobj::attrib_t* attrib, std::vector<tinyobj::material_t>* materials, std::vector<tinyobj::shape_t*> shapes);
+	// a range of one shape's indices, deduplicated by whichever loading thread takes it
+	struct ShapeLoadTask
+	{
+		uint32_t shape_index;
+		uint32_t chunk_index;
+		size_t first_index;
+		size_t index_count;
+	};
+
+	struct ShapeChunk
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		glm::vec4 min_vertex;
+		glm::vec4 max_vertex;
+		bool transparency_enabled;
+	};
+
+	// a shape's chunks are merged by the thread that finishes its last chunk, then the shape is ready to upload
+	struct ShapeLoadResult
+	{
+		std::vector<ShapeChunk> chunks;
+		std::atomic<uint32_t> remaining_chunks;
+		std::atomic<bool> ready;
+		uint64_t original_cache_misses;		// post transform cache misses before and after the shape was optimized
+		uint64_t optimized_cache_misses;
+		uint64_t optimized_vertex_count;
+	};
+
+	void LoadObjMesh(VulkanDevices* devices, VulkanRenderer* renderer, const std::string& filename, const std::string& mat_dir, const std::string& texture_dir, const std::string& cache_filename, uint64_t source_hash);
+
+	// returns false when there is no cache of this version of the model
+	bool LoadCachedMesh(VulkanDevices* devices, VulkanRenderer* renderer, const std::string& cache_filename, uint64_t source_hash, const std::string& texture_dir);
+
+	void CreateMaterials(VulkanDevices* devices, VulkanRenderer* renderer, std::vector<tinyobj::material_t>& materials, const std::string& texture_dir);
+
+	void LoadShapeRange(const tinyobj::attrib_t& attrib, const tinyobj::shape_t& shape, const std::vector<Material*>& materials, size_t first_index, size_t index_count, ShapeChunk& chunk);
+	static void MergeShapeChunks(ShapeLoadResult& result);
+	static void OptimizeShape(ShapeLoadResult& result);
+	void UploadShape(VulkanDevices* devices, VulkanRenderer* renderer, ShapeLoadResult& result, MeshCacheWriter* cache_writer);
 
 protected:
 	VkDevice vk_device_handle_;
@@ -97,5 +169,7 @@ protected:
 
 	std::vector<Shape*> mesh_shapes_;
 	std::map<std::string, Material*> mesh_materials_;
+
+	static bool optimize_shapes_;
 };
 #endif
\ No newline at end of file
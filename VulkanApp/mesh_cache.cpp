@@ -0,0 +1,424 @@
+#include "mesh_cache.h"
+#include "mesh.h"
+
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define MESH_CACHE_HASH_OFFSET 14695981039346656037ull	// 64 bit fnv-1a
+#define MESH_CACHE_HASH_PRIME 1099511628211ull
+#define MESH_CACHE_DATA_ALIGNMENT 16
+
+std::string MeshCache::GetCacheFilename(const std::string& filename)
+{
+	return filename + MESH_CACHE_EXTENSION;
+}
+
+uint64_t MeshCache::HashSource(const std::string& filename, const std::string& material_directory, uint64_t& source_bytes)
+{
+	std::ifstream obj_file(filename, std::ios::in | std::ios::binary);
+	if (!obj_file.is_open())
+		return 0;
+
+	uint64_t hash = MESH_CACHE_HASH_OFFSET;
+	std::vector<std::string> material_libraries;
+
+	// the obj is hashed a line at a time so the material libraries it uses are found in the same pass
+	std::string line;
+	while (std::getline(obj_file, line))
+	{
+		hash = HashBytes(hash, line.data(), line.size());
+		hash = HashBytes(hash, "\n", 1);
+		source_bytes += line.size() + 1;
+
+		if (line.compare(0, 7, "mtllib ") == 0)
+		{
+			std::istringstream names(line.substr(7));
+			std::string name;
+			while (names >> name)
+				material_libraries.push_back(name);
+		}
+	}
+
+	// the cache holds the resolved materials, so editing a material library must rebuild it too
+	std::vector<char> buffer(64 * 1024);
+	for (const std::string& material_library : material_libraries)
+	{
+		std::ifstream mtl_file(material_directory + material_library, std::ios::in | std::ios::binary);
+		while (mtl_file.read(buffer.data(), buffer.size()) || mtl_file.gcount() > 0)
+		{
+			hash = HashBytes(hash, buffer.data(), static_cast<size_t>(mtl_file.gcount()));
+			source_bytes += mtl_file.gcount();
+		}
+	}
+
+	return hash;
+}
+
+uint64_t MeshCache::HashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= MESH_CACHE_HASH_PRIME;
+	}
+
+	return hash;
+}
+
+MeshCacheReader::MeshCacheReader()
+{
+	data_ = nullptr;
+	size_ = 0;
+
+#ifdef _WIN32
+	file_handle_ = INVALID_HANDLE_VALUE;
+	mapping_handle_ = nullptr;
+#else
+	file_descriptor_ = -1;
+#endif
+
+	shapes_ = nullptr;
+	shape_count_ = 0;
+}
+
+MeshCacheReader::~MeshCacheReader()
+{
+	Close();
+}
+
+bool MeshCacheReader::Open(const std::string& filename, uint64_t source_hash, uint32_t flags)
+{
+	Close();
+
+	if (!Map(filename))
+		return false;
+
+	// the header is checked before any offset in the file is trusted
+	MeshCacheHeader header = {};
+	if (size_ < sizeof(MeshCacheHeader))
+	{
+		Close();
+		return false;
+	}
+	memcpy(&header, data_, sizeof(MeshCacheHeader));
+
+	bool valid = memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) == 0 && header.version == MESH_CACHE_VERSION && header.source_hash == source_hash && header.flags == flags
+		&& header.vertex_size == sizeof(Vertex) && header.file_size == size_ && header.shape_offset % alignof(MeshCacheShape) == 0
+		&& header.shape_offset <= size_ && header.shape_count <= (size_ - header.shape_offset) / sizeof(MeshCacheShape);
+
+	if (valid)
+	{
+		shapes_ = reinterpret_cast<const MeshCacheShape*>(data_ + header.shape_offset);
+		shape_count_ = header.shape_count;
+
+		for (uint32_t i = 0; i < shape_count_ && valid; i++)
+		{
+			const MeshCacheShape& shape = shapes_[i];
+			valid = shape.vertex_offset % alignof(Vertex) == 0 && shape.index_offset % alignof(uint32_t) == 0
+				&& shape.vertex_offset <= size_ && shape.vertex_count <= (size_ - shape.vertex_offset) / sizeof(Vertex)
+				&& shape.index_offset <= size_ && shape.index_count <= (size_ - shape.index_offset) / sizeof(uint32_t);
+		}
+	}
+
+	if (!valid || !ReadMaterials(header))
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MeshCacheReader::Close()
+{
+#ifdef _WIN32
+	if (data_)
+		UnmapViewOfFile(data_);
+	if (mapping_handle_)
+		CloseHandle(mapping_handle_);
+	if (file_handle_ != INVALID_HANDLE_VALUE)
+		CloseHandle(file_handle_);
+
+	file_handle_ = INVALID_HANDLE_VALUE;
+	mapping_handle_ = nullptr;
+#else
+	if (data_)
+		munmap(const_cast<uint8_t*>(data_), static_cast<size_t>(size_));
+	if (file_descriptor_ >= 0)
+		close(file_descriptor_);
+
+	file_descriptor_ = -1;
+#endif
+
+	data_ = nullptr;
+	size_ = 0;
+	shapes_ = nullptr;
+	shape_count_ = 0;
+	materials_.clear();
+	material_indices_.clear();
+}
+
+bool MeshCacheReader::Map(const std::string& filename)
+{
+#ifdef _WIN32
+	file_handle_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file_handle_ == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size = {};
+	if (!GetFileSizeEx(file_handle_, &file_size) || file_size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mapping_handle_ = CreateFileMappingA(file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping_handle_)
+	{
+		Close();
+		return false;
+	}
+
+	data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+	if (!data_)
+	{
+		Close();
+		return false;
+	}
+
+	size_ = static_cast<uint64_t>(file_size.QuadPart);
+#else
+	file_descriptor_ = open(filename.c_str(), O_RDONLY);
+	if (file_descriptor_ < 0)
+		return false;
+
+	struct stat file_stat = {};
+	if (fstat(file_descriptor_, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file_descriptor_, 0);
+	if (data == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	// the shapes are read from start to end once
+	madvise(data, static_cast<size_t>(file_stat.st_size), MADV_SEQUENTIAL);
+
+	data_ = static_cast<const uint8_t*>(data);
+	size_ = static_cast<uint64_t>(file_stat.st_size);
+#endif
+
+	return true;
+}
+
+bool MeshCacheReader::ReadMaterials(const MeshCacheHeader& header)
+{
+	uint64_t offset = header.material_offset;
+	for (uint32_t i = 0; i < header.material_count; i++)
+	{
+		MeshCacheMaterial record = {};
+		if (offset > size_ || size_ - offset < sizeof(MeshCacheMaterial))
+			return false;
+
+		memcpy(&record, data_ + offset, sizeof(MeshCacheMaterial));
+		offset += sizeof(MeshCacheMaterial);
+
+		std::string strings[MESH_CACHE_MATERIAL_STRING_COUNT];
+		for (uint32_t s = 0; s < MESH_CACHE_MATERIAL_STRING_COUNT; s++)
+		{
+			if (size_ - offset < record.string_lengths[s])
+				return false;
+
+			strings[s].assign(reinterpret_cast<const char*>(data_ + offset), record.string_lengths[s]);
+			offset += record.string_lengths[s];
+		}
+
+		tinyobj::material_t material = {};
+		memcpy(material.ambient, record.ambient, sizeof(record.ambient));
+		memcpy(material.diffuse, record.diffuse, sizeof(record.diffuse));
+		memcpy(material.specular, record.specular, sizeof(record.specular));
+		memcpy(material.transmittance, record.transmittance, sizeof(record.transmittance));
+		memcpy(material.emission, record.emission, sizeof(record.emission));
+		material.shininess = record.shininess;
+		material.ior = record.ior;
+		material.dissolve = record.dissolve;
+		material.illum = record.illum;
+
+		material.name = strings[0];
+		material.ambient_texname = strings[1];
+		material.diffuse_texname = strings[2];
+		material.specular_texname = strings[3];
+		material.specular_highlight_texname = strings[4];
+		material.emissive_texname = strings[5];
+		material.bump_texname = strings[6];
+		material.displacement_texname = strings[7];
+		material.alpha_texname = strings[8];
+		material.reflection_texname = strings[9];
+
+		materials_.push_back(material);
+		material_indices_.push_back(record.material_index);
+	}
+
+	return true;
+}
+
+MeshCacheWriter::MeshCacheWriter()
+{
+	header_ = {};
+}
+
+MeshCacheWriter::~MeshCacheWriter()
+{
+	if (file_.is_open())
+		Discard();
+}
+
+bool MeshCacheWriter::Begin(const std::string& filename, uint64_t source_hash, uint32_t flags, const std::vector<tinyobj::material_t>& materials, const std::vector<uint32_t>& material_indices)
+{
+	filename_ = filename;
+	shapes_.clear();
+
+	file_.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file_.is_open())
+		return false;
+
+	// the header is written without its magic until every shape is in the file
+	header_ = {};
+	header_.version = MESH_CACHE_VERSION;
+	header_.source_hash = source_hash;
+	header_.flags = flags;
+	header_.vertex_size = sizeof(Vertex);
+	header_.material_count = static_cast<uint32_t>(materials.size());
+	header_.material_offset = sizeof(MeshCacheHeader);
+	file_.write(reinterpret_cast<const char*>(&header_), sizeof(MeshCacheHeader));
+
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		const tinyobj::material_t& material = materials[i];
+		const std::string* strings[MESH_CACHE_MATERIAL_STRING_COUNT] = {
+			&material.name,
+			&material.ambient_texname,
+			&material.diffuse_texname,
+			&material.specular_texname,
+			&material.specular_highlight_texname,
+			&material.emissive_texname,
+			&material.bump_texname,
+			&material.displacement_texname,
+			&material.alpha_texname,
+			&material.reflection_texname
+		};
+
+		MeshCacheMaterial record = {};
+		memcpy(record.ambient, material.ambient, sizeof(record.ambient));
+		memcpy(record.diffuse, material.diffuse, sizeof(record.diffuse));
+		memcpy(record.specular, material.specular, sizeof(record.specular));
+		memcpy(record.transmittance, material.transmittance, sizeof(record.transmittance));
+		memcpy(record.emission, material.emission, sizeof(record.emission));
+		record.shininess = material.shininess;
+		record.ior = material.ior;
+		record.dissolve = material.dissolve;
+		record.illum = material.illum;
+		record.material_index = material_indices[i];
+		for (uint32_t s = 0; s < MESH_CACHE_MATERIAL_STRING_COUNT; s++)
+			record.string_lengths[s] = static_cast<uint32_t>(strings[s]->size());
+
+		file_.write(reinterpret_cast<const char*>(&record), sizeof(MeshCacheMaterial));
+		for (uint32_t s = 0; s < MESH_CACHE_MATERIAL_STRING_COUNT; s++)
+			file_.write(strings[s]->data(), strings[s]->size());
+	}
+
+	if (!file_.good())
+	{
+		Discard();
+		return false;
+	}
+
+	return true;
+}
+
+void MeshCacheWriter::AddShape(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, BoundingBox bounding_box, bool transparency_enabled)
+{
+	if (!file_.is_open())
+		return;
+
+	MeshCacheShape shape = {};
+	shape.vertex_count = static_cast<uint32_t>(vertices.size());
+	shape.index_count = static_cast<uint32_t>(indices.size());
+	shape.transparency_enabled = transparency_enabled ? 1 : 0;
+	shape.min_vertex = bounding_box.min_vertex;
+	shape.max_vertex = bounding_box.max_vertex;
+
+	// the vertices are aligned for reading them in place from the mapped file
+	Align(MESH_CACHE_DATA_ALIGNMENT);
+	shape.vertex_offset = static_cast<uint64_t>(file_.tellp());
+	file_.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(Vertex));
+
+	Align(alignof(uint32_t));
+	shape.index_offset = static_cast<uint64_t>(file_.tellp());
+	file_.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint32_t));
+
+	shapes_.push_back(shape);
+
+	if (!file_.good())
+		Discard();
+}
+
+bool MeshCacheWriter::End()
+{
+	if (!file_.is_open())
+		return false;
+
+	Align(MESH_CACHE_DATA_ALIGNMENT);
+	header_.shape_offset = static_cast<uint64_t>(file_.tellp());
+	header_.shape_count = static_cast<uint32_t>(shapes_.size());
+	file_.write(reinterpret_cast<const char*>(shapes_.data()), shapes_.size() * sizeof(MeshCacheShape));
+	header_.file_size = static_cast<uint64_t>(file_.tellp());
+
+	// the cache is only valid once the magic is written over the placeholder header
+	memcpy(header_.magic, MESH_CACHE_MAGIC, sizeof(header_.magic));
+	file_.seekp(0);
+	file_.write(reinterpret_cast<const char*>(&header_), sizeof(MeshCacheHeader));
+
+	if (!file_.good())
+	{
+		Discard();
+		return false;
+	}
+
+	file_.close();
+	shapes_.clear();
+	return true;
+}
+
+void MeshCacheWriter::Align(uint64_t alignment)
+{
+	const char padding[MESH_CACHE_DATA_ALIGNMENT] = {};
+	uint64_t offset = static_cast<uint64_t>(file_.tellp());
+	uint64_t padding_size = (alignment - offset % alignment) % alignment;
+	file_.write(padding, static_cast<std::streamsize>(padding_size));
+}
+
+void MeshCacheWriter::Discard()
+{
+	file_.close();
+	std::remove(filename_.c_str());
+	shapes_.clear();
+}
@@ -0,0 +1,140 @@
+#ifndef _MESH_CACHE_H_
+#define _MESH_CACHE_H_
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <fstream>
+
+#include "shape.h"
+
+#define MESH_CACHE_MAGIC "VKMC"
+#define MESH_CACHE_VERSION 2
+#define MESH_CACHE_EXTENSION ".meshcache"
+#define MESH_CACHE_MATERIAL_STRING_COUNT 10
+#define MESH_CACHE_FLAG_OPTIMIZED 0x1		// the shapes were stored in the mesh optimizer's order
+
+struct Vertex;
+
+struct MeshCacheHeader
+{
+	char magic[4];				// written last, so a cache that was never finished is not read
+	uint32_t version;
+	uint64_t source_hash;
+	uint32_t vertex_size;		// a cache written with a different vertex layout is rebuilt
+	uint32_t material_count;
+	uint32_t shape_count;
+	uint32_t flags;				// a cache written with different flags is rebuilt
+	uint64_t material_offset;	// offsets are bytes from the start of the file
+	uint64_t shape_offset;
+	uint64_t file_size;
+};
+
+// followed by the name and texture names, their lengths are in the order of the strings
+struct MeshCacheMaterial
+{
+	float ambient[3];
+	float diffuse[3];
+	float specular[3];
+	float transmittance[3];
+	float emission[3];
+	float shininess;
+	float ior;
+	float dissolve;
+	int32_t illum;
+	uint32_t material_index;	// the material's buffer index when the cache was written
+	uint32_t string_lengths[MESH_CACHE_MATERIAL_STRING_COUNT];
+};
+
+// a shape's deduplicated vertices and indices, the indices are relative to the shape's first vertex
+struct MeshCacheShape
+{
+	uint64_t vertex_offset;
+	uint64_t index_offset;
+	uint32_t vertex_count;
+	uint32_t index_count;
+	uint32_t transparency_enabled;
+	uint32_t padding;
+	glm::vec4 min_vertex;
+	glm::vec4 max_vertex;
+};
+
+// a model's loaded shapes and materials, stored next to the obj and keyed by a hash of the obj and its material libraries
+class MeshCache
+{
+public:
+	static std::string GetCacheFilename(const std::string& filename);
+
+	// returns 0 when the obj can not be read
+	static uint64_t HashSource(const std::string& filename, const std::string& material_directory, uint64_t& source_bytes);
+
+protected:
+	static uint64_t HashBytes(uint64_t hash, const void* data, size_t size);
+};
+
+// maps a cache into memory so its vertices and indices are staged straight from the file
+class MeshCacheReader
+{
+public:
+	MeshCacheReader();
+	~MeshCacheReader();
+
+	// returns false when there is no complete cache of this version of the source
+	bool Open(const std::string& filename, uint64_t source_hash, uint32_t flags);
+	void Close();
+
+	inline uint64_t GetSize() { return size_; }
+	inline std::vector<tinyobj::material_t>& GetMaterials() { return materials_; }
+	inline const std::vector<uint32_t>& GetMaterialIndices() { return material_indices_; }
+	inline uint32_t GetShapeCount() { return shape_count_; }
+	inline const MeshCacheShape& GetShape(uint32_t index) { return shapes_[index]; }
+	inline const Vertex* GetVertices(const MeshCacheShape& shape) { return reinterpret_cast<const Vertex*>(data_ + shape.vertex_offset); }
+	inline const uint32_t* GetIndices(const MeshCacheShape& shape) { return reinterpret_cast<const uint32_t*>(data_ + shape.index_offset); }
+
+protected:
+	bool Map(const std::string& filename);
+	bool ReadMaterials(const MeshCacheHeader& header);
+
+protected:
+	const uint8_t* data_;
+	uint64_t size_;
+
+#ifdef _WIN32
+	void* file_handle_;
+	void* mapping_handle_;
+#else
+	int file_descriptor_;
+#endif
+
+	const MeshCacheShape* shapes_;
+	uint32_t shape_count_;
+	std::vector<tinyobj::material_t> materials_;
+	std::vector<uint32_t> material_indices_;
+};
+
+// streams shapes to a new cache as they are uploaded, a cache that is not ended is deleted
+class MeshCacheWriter
+{
+public:
+	MeshCacheWriter();
+	~MeshCacheWriter();
+
+	bool Begin(const std::string& filename, uint64_t source_hash, uint32_t flags, const std::vector<tinyobj::material_t>& materials, const std::vector<uint32_t>& material_indices);
+	void AddShape(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, BoundingBox bounding_box, bool transparency_enabled);
+	bool End();
+
+	inline bool IsWriting() { return file_.is_open(); }
+
+protected:
+	void Align(uint64_t alignment);
+	void Discard();
+
+protected:
+	std::string filename_;
+	std::ofstream file_;
+	MeshCacheHeader header_;
+	std::vector<MeshCacheShape> shapes_;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+
+#define MESH_OPTIMIZER_UNUSED_VERTEX 0xFFFFFFFF
+
+void MeshOptimizer::Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	if (indices.empty() || indices.size() % 3 != 0)
+		return;
+
+	std::vector<uint32_t> cluster_starts;
+	OptimizeVertexCache(indices, static_cast<uint32_t>(vertices.size()), cluster_starts);
+	OptimizeOverdraw(vertices, indices, cluster_starts);
+	OptimizeVertexFetch(vertices, indices);
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size)
+{
+	VertexCacheStatistics statistics = {};
+	statistics.triangle_count = indices.size() / 3;
+	statistics.vertex_count = vertex_count;
+
+	// a vertex is still cached while fewer than cache_size misses have happened since it was added
+	std::vector<uint32_t> cache_timestamps(vertex_count, 0);
+	uint32_t timestamp = cache_size + 1;
+	for (uint32_t index : indices)
+	{
+		if (timestamp - cache_timestamps[index] > cache_size)
+		{
+			cache_timestamps[index] = timestamp++;
+			statistics.cache_misses++;
+		}
+	}
+
+	return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertex_count, std::vector<uint32_t>& cluster_starts, uint32_t cache_size)
+{
+	cluster_starts.clear();
+	if (indices.empty() || indices.size() % 3 != 0)
+		return;
+
+	// the triangles that use each vertex, a vertex used twice by a degenerate triangle lists it twice
+	std::vector<uint32_t> live_triangles(vertex_count, 0);
+	for (uint32_t index : indices)
+		live_triangles[index]++;
+
+	std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+	for (uint32_t v = 0; v < vertex_count; v++)
+		adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> adjacency_fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+		adjacency[adjacency_fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+	std::vector<uint32_t> cache_timestamps(vertex_count, 0);
+	std::vector<bool> emitted(indices.size() / 3, false);
+	std::vector<uint32_t> dead_ends;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> optimized_indices;
+	optimized_indices.reserve(indices.size());
+
+	uint32_t timestamp = cache_size + 1;
+	uint32_t cursor = 0;
+	int32_t fanning_vertex = 0;
+	cluster_starts.push_back(0);
+
+	while (fanning_vertex >= 0)
+	{
+		// emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (uint32_t a = adjacency_offsets[fanning_vertex]; a < adjacency_offsets[fanning_vertex + 1]; a++)
+		{
+			uint32_t triangle = adjacency[a];
+			if (emitted[triangle])
+				continue;
+
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				uint32_t vertex = indices[triangle * 3 + corner];
+				optimized_indices.push_back(vertex);
+				dead_ends.push_back(vertex);
+				candidates.push_back(vertex);
+				live_triangles[vertex]--;
+
+				if (timestamp - cache_timestamps[vertex] > cache_size)
+					cache_timestamps[vertex] = timestamp++;
+			}
+
+			emitted[triangle] = true;
+		}
+
+		// fan next around the candidate that has been in the cache longest but will still be in it once its triangles are emitted
+		int32_t next_vertex = -1;
+		int32_t best_priority = -1;
+		for (uint32_t candidate : candidates)
+		{
+			if (live_triangles[candidate] == 0)
+				continue;
+
+			int32_t priority = 0;
+			uint32_t age = timestamp - cache_timestamps[candidate];
+			if (age + 2 * live_triangles[candidate] <= cache_size)
+				priority = static_cast<int32_t>(age);
+
+			if (priority > best_priority)
+			{
+				best_priority = priority;
+				next_vertex = static_cast<int32_t>(candidate);
+			}
+		}
+
+		if (next_vertex < 0)
+		{
+			next_vertex = SkipDeadEnd(dead_ends, live_triangles, cursor, vertex_count);
+
+			// restarting on a vertex that is no longer cached is where the clusters are split for the overdraw order
+			uint32_t emitted_triangles = static_cast<uint32_t>(optimized_indices.size() / 3);
+			if (next_vertex >= 0 && timestamp - cache_timestamps[next_vertex] > cache_size && emitted_triangles > cluster_starts.back())
+				cluster_starts.push_back(emitted_triangles);
+		}
+
+		fanning_vertex = next_vertex;
+	}
+
+	indices.swap(optimized_indices);
+}
+
+int32_t MeshOptimizer::SkipDeadEnd(std::vector<uint32_t>& dead_ends, const std::vector<uint32_t>& live_triangles, uint32_t& cursor, uint32_t vertex_count)
+{
+	// the most recently used vertex with triangles left, then the first such vertex in input order
+	while (!dead_ends.empty())
+	{
+		uint32_t vertex = dead_ends.back();
+		dead_ends.pop_back();
+		if (live_triangles[vertex] > 0)
+			return static_cast<int32_t>(vertex);
+	}
+
+	while (cursor < vertex_count)
+	{
+		uint32_t vertex = cursor++;
+		if (live_triangles[vertex] > 0)
+			return static_cast<int32_t>(vertex);
+	}
+
+	return -1;
+}
+
+void MeshOptimizer::OptimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::vector<uint32_t>& cluster_starts)
+{
+	if (cluster_starts.size() < 2)
+		return;
+
+	uint32_t cluster_count = static_cast<uint32_t>(cluster_starts.size());
+	uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+
+	// the area weighted centre and summed normal of each cluster
+	std::vector<glm::vec3> cluster_centroids(cluster_count, glm::vec3(0.0f));
+	std::vector<glm::vec3> cluster_normals(cluster_count, glm::vec3(0.0f));
+	glm::vec3 shape_centroid = glm::vec3(0.0f);
+	float shape_area = 0.0f;
+	float signed_volume = 0.0f;
+
+	for (uint32_t c = 0; c < cluster_count; c++)
+	{
+		uint32_t cluster_end = (c + 1 < cluster_count) ? cluster_starts[c + 1] : triangle_count;
+		float cluster_area = 0.0f;
+		for (uint32_t t = cluster_starts[c]; t < cluster_end; t++)
+		{
+			glm::vec3 p0 = glm::vec3(vertices[indices[t * 3 + 0]].pos_mat_index);
+			glm::vec3 p1 = glm::vec3(vertices[indices[t * 3 + 1]].pos_mat_index);
+			glm::vec3 p2 = glm::vec3(vertices[indices[t * 3 + 2]].pos_mat_index);
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+
+			cluster_centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+			cluster_normals[c] += normal;
+			cluster_area += area;
+			signed_volume += glm::dot(p0, glm::cross(p1, p2));
+		}
+
+		shape_centroid += cluster_centroids[c];
+		shape_area += cluster_area;
+		if (cluster_area > 0.0f)
+			cluster_centroids[c] /= cluster_area;
+	}
+
+	if (shape_area <= 0.0f)
+		return;
+
+	shape_centroid /= shape_area;
+
+	// the winding is taken from the sign of the enclosed volume, so the normals point out of the shape either way
+	float winding = (signed_volume < 0.0f) ? -1.0f : 1.0f;
+
+	std::vector<std::pair<float, uint32_t>> cluster_order(cluster_count);
+	for (uint32_t c = 0; c < cluster_count; c++)
+	{
+		float normal_length = glm::length(cluster_normals[c]);
+		float facing = (normal_length > 0.0f) ? glm::dot(cluster_centroids[c] - shape_centroid, cluster_normals[c] / normal_length) * winding : 0.0f;
+		cluster_order[c] = std::make_pair(facing, c);
+	}
+
+	std::stable_sort(cluster_order.begin(), cluster_order.end(), [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.first > b.first; });
+
+	std::vector<uint32_t> sorted_indices;
+	sorted_indices.reserve(indices.size());
+	for (const std::pair<float, uint32_t>& cluster : cluster_order)
+	{
+		uint32_t c = cluster.second;
+		uint32_t cluster_end = (c + 1 < cluster_count) ? cluster_starts[c + 1] : triangle_count;
+		sorted_indices.insert(sorted_indices.end(), indices.begin() + cluster_starts[c] * 3, indices.begin() + cluster_end * 3);
+	}
+
+	indices.swap(sorted_indices);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), MESH_OPTIMIZER_UNUSED_VERTEX);
+	std::vector<Vertex> fetched_vertices;
+	fetched_vertices.reserve(vertices.size());
+
+	// vertices no index uses are dropped
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == MESH_OPTIMIZER_UNUSED_VERTEX)
+		{
+			remap[index] = static_cast<uint32_t>(fetched_vertices.size());
+			fetched_vertices.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	vertices.swap(fetched_vertices);
+}
@@ -0,0 +1,44 @@
+#ifndef _MESH_OPTIMIZER_H_
+#define _MESH_OPTIMIZER_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "mesh.h"
+
+#define MESH_OPTIMIZATION_ENABLED true
+#define MESH_OPTIMIZER_CACHE_SIZE 16	// post transform cache entries the triangles are ordered for and analysed with
+
+// misses of a fifo post transform cache, the average cache miss ratio (acmr) is per triangle
+// and the average transform to vertex ratio (atvr) is per unique vertex, 1 being ideal
+struct VertexCacheStatistics
+{
+	uint64_t cache_misses;
+	uint64_t triangle_count;
+	uint64_t vertex_count;
+};
+
+// reorders a shape's triangles and vertices at load, the shape draws the same triangles with fewer
+// vertex shader invocations, less overdraw and more local vertex fetches
+class MeshOptimizer
+{
+public:
+	// runs every stage, triangle lists whose index count is not a multiple of 3 are left untouched
+	static void Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	static VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size = MESH_OPTIMIZER_CACHE_SIZE);
+
+	// tipsify, the triangle offsets where the fanning had to restart away from the cache are returned as cluster starts
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertex_count, std::vector<uint32_t>& cluster_starts, uint32_t cache_size = MESH_OPTIMIZER_CACHE_SIZE);
+
+	// sorts the clusters so those facing away from the shape's centre, which are the most likely to occlude the rest, are drawn first
+	static void OptimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::vector<uint32_t>& cluster_starts);
+
+	// renumbers the vertices in the order the indices first use them
+	static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+protected:
+	static int32_t SkipDeadEnd(std::vector<uint32_t>& dead_ends, const std::vector<uint32_t>& live_triangles, uint32_t& cursor, uint32_t vertex_count);
+};
+
+#endif
\ No newline at end of file
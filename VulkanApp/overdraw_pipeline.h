@@ -0,0 +1,24 @@
+#ifndef _OVERDRAW_PIPELINE_H_
+#define _OVERDRAW_PIPELINE_H_
+
+#include "pipeline.h"
+#include "render_target.h"
+
+// redraws the visibility pass's geometry counting the fragments that pass the depth test at each pixel
+class OverdrawPipeline : public VulkanPipeline
+{
+public:
+	void RecordCommands(VkCommandBuffer& command_buffer, uint32_t buffer_index);
+
+	inline void SetOverdrawBuffer(VulkanRenderTarget* overdraw_buffer) { overdraw_buffer_ = overdraw_buffer; }
+
+protected:
+	void CreatePipeline();
+	void CreateRenderPass();
+	void CreateFramebuffers();
+
+protected:
+	VulkanRenderTarget* overdraw_buffer_;
+};
+
+#endif
\ No newline at end of file
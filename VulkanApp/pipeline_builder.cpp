@@ -0,0 +1,108 @@
+#include "pipeline_builder.h"
+#include "trace_profiler.h"
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <algorithm>
+
+VulkanPipelineBuilder::VulkanPipelineBuilder()
+{
+	thread_count_ = 1;
+	statistics_ = {};
+}
+
+void VulkanPipelineBuilder::Init(uint32_t thread_count)
+{
+	if (thread_count == 0)
+		thread_count = std::thread::hardware_concurrency();
+
+	thread_count_ = std::max(thread_count, 1u);
+}
+
+void VulkanPipelineBuilder::Add(std::string name, std::function<void()> build)
+{
+	PipelineBuild pipeline_build = {};
+	pipeline_build.name = name;
+	pipeline_build.build = build;
+	builds_.push_back(pipeline_build);
+}
+
+void VulkanPipelineBuilder::Build()
+{
+	TRACE_FUNCTION();
+
+	uint32_t thread_count = std::min(thread_count_, static_cast<uint32_t>(builds_.size()));
+	std::vector<std::exception_ptr> exceptions(builds_.size());
+	std::atomic<size_t> next_build(0);
+
+	// each worker takes the next queued pipeline until none are left
+	auto worker = [&]()
+	{
+		for (size_t i = next_build++; i < builds_.size(); i = next_build++)
+		{
+			TRACE_SCOPE(TraceProfiler::InternName(builds_[i].name));
+			auto start_time = std::chrono::high_resolution_clock::now();
+
+			try
+			{
+				builds_[i].build();
+			}
+			catch (...)
+			{
+				exceptions[i] = std::current_exception();
+			}
+
+			auto end_time = std::chrono::high_resolution_clock::now();
+			builds_[i].time = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+		}
+	};
+
+	auto start_time = std::chrono::high_resolution_clock::now();
+
+	// the calling thread builds alongside the workers
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < thread_count; i++)
+	{
+		threads.push_back(std::thread([&]()
+		{
+			TRACE_THREAD_NAME("pipeline builder");
+			worker();
+		}));
+	}
+
+	worker();
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	auto end_time = std::chrono::high_resolution_clock::now();
+
+	statistics_.pipeline_count = static_cast<uint32_t>(builds_.size());
+	statistics_.thread_count = std::max(thread_count, 1u);
+	statistics_.build_time = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+	statistics_.total_pipeline_time = 0.0;
+	for (const PipelineBuild& pipeline_build : builds_)
+		statistics_.total_pipeline_time += pipeline_build.time;
+
+	completed_builds_ = builds_;
+	builds_.clear();
+
+	// report the first failure once every thread has finished with the pipelines
+	for (std::exception_ptr& exception : exceptions)
+	{
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+}
+
+void VulkanPipelineBuilder::PrintStatistics()
+{
+	std::cout << "Built " << statistics_.pipeline_count << " pipelines on " << statistics_.thread_count << " threads in " << statistics_.build_time << "ms";
+	std::cout << " (" << statistics_.total_pipeline_time << "ms of pipeline creation)" << std::endl;
+
+	for (const PipelineBuild& pipeline_build : completed_builds_)
+		std::cout << "\t" << pipeline_build.name << ": " << pipeline_build.time << "ms" << std::endl;
+}
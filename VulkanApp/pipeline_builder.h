@@ -0,0 +1,47 @@
+#ifndef _PIPELINE_BUILDER_H_
+#define _PIPELINE_BUILDER_H_
+
+#include <vector>
+#include <string>
+#include <functional>
+
+struct PipelineBuildStatistics
+{
+	uint32_t pipeline_count;
+	uint32_t thread_count;
+	double build_time;			// milliseconds from the first build starting to the last finishing
+	double total_pipeline_time;	// sum of every pipeline's own build time
+};
+
+// builds independent pipelines across worker threads, pipelines are configured on the calling
+// thread and queued, Build runs the queued descriptor and pipeline creation and waits for all of it
+class VulkanPipelineBuilder
+{
+protected:
+	struct PipelineBuild
+	{
+		std::string name;
+		std::function<void()> build;
+		double time;
+	};
+
+public:
+	VulkanPipelineBuilder();
+
+	// a thread count of 0 uses every hardware thread
+	void Init(uint32_t thread_count = 0);
+
+	void Add(std::string name, std::function<void()> build);
+	void Build();
+
+	void PrintStatistics();
+	inline PipelineBuildStatistics GetStatistics() { return statistics_; }
+
+protected:
+	uint32_t thread_count_;
+	std::vector<PipelineBuild> builds_;
+	std::vector<PipelineBuild> completed_builds_;
+	PipelineBuildStatistics statistics_;
+};
+
+#endif
@@ -0,0 +1,260 @@
+#include "pipeline_statistics.h"
+#include "device.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+// written in bit order, so input primitives, vertex invocations, clipping invocations, clipping primitives, fragment invocations, compute invocations
+#define PIPELINE_STATISTICS_FLAGS (VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | \
+	VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | \
+	VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT)
+#define PIPELINE_STATISTICS_VALUE_COUNT 6
+
+VulkanPipelineStatistics::VulkanPipelineStatistics()
+{
+	devices_ = nullptr;
+	enabled_ = false;
+	precise_occlusion_ = false;
+	current_frame_ = 0;
+	statistics_query_pool_ = VK_NULL_HANDLE;
+	occlusion_query_pool_ = VK_NULL_HANDLE;
+	total_frame_count_ = 0;
+}
+
+void VulkanPipelineStatistics::Init(VulkanDevices* devices, uint32_t frame_count)
+{
+	devices_ = devices;
+	current_frame_ = 0;
+	submitted_scopes_.resize(frame_count);
+
+	// pipeline statistics queries are an optional device feature, without them nothing is recorded
+	const VkPhysicalDeviceFeatures& features = devices_->GetEnabledFeatures();
+	enabled_ = features.pipelineStatisticsQuery == VK_TRUE;
+	precise_occlusion_ = features.occlusionQueryPrecise == VK_TRUE;
+
+	if (!enabled_)
+		return;
+
+	VkQueryPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	pool_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	pool_info.queryCount = PIPELINE_STATISTICS_MAX_SCOPES;
+	pool_info.pipelineStatistics = PIPELINE_STATISTICS_FLAGS;
+
+	if (vkCreateQueryPool(devices_->GetLogicalDevice(), &pool_info, nullptr, &statistics_query_pool_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create pipeline statistics query pool!");
+	}
+
+	pool_info.queryType = VK_QUERY_TYPE_OCCLUSION;
+	pool_info.pipelineStatistics = 0;
+
+	if (vkCreateQueryPool(devices_->GetLogicalDevice(), &pool_info, nullptr, &occlusion_query_pool_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create occlusion query pool!");
+	}
+}
+
+void VulkanPipelineStatistics::Cleanup()
+{
+	scopes_.clear();
+	submitted_scopes_.clear();
+
+	if (statistics_query_pool_ != VK_NULL_HANDLE)
+		vkDestroyQueryPool(devices_->GetLogicalDevice(), statistics_query_pool_, nullptr);
+	if (occlusion_query_pool_ != VK_NULL_HANDLE)
+		vkDestroyQueryPool(devices_->GetLogicalDevice(), occlusion_query_pool_, nullptr);
+
+	statistics_query_pool_ = VK_NULL_HANDLE;
+	occlusion_query_pool_ = VK_NULL_HANDLE;
+	enabled_ = false;
+}
+
+PipelineStatisticsScope VulkanPipelineStatistics::AddScope(std::string name, bool immediate)
+{
+	if (!enabled_ || scopes_.size() >= PIPELINE_STATISTICS_MAX_SCOPES)
+		return PIPELINE_STATISTICS_NO_SCOPE;
+
+	Scope scope = {};
+	scope.name = name;
+	scope.immediate = immediate;
+	scopes_.push_back(scope);
+
+	return static_cast<PipelineStatisticsScope>(scopes_.size() - 1);
+}
+
+void VulkanPipelineStatistics::RecordBegin(VkCommandBuffer command_buffer, PipelineStatisticsScope scope)
+{
+	if (!IsCounted(scope))
+		return;
+
+	// the queries are reset alongside the begin so every submission of the command buffer can reuse them
+	vkCmdResetQueryPool(command_buffer, statistics_query_pool_, scope, 1);
+	vkCmdResetQueryPool(command_buffer, occlusion_query_pool_, scope, 1);
+
+	vkCmdBeginQuery(command_buffer, statistics_query_pool_, scope, 0);
+	vkCmdBeginQuery(command_buffer, occlusion_query_pool_, scope, precise_occlusion_ ? VK_QUERY_CONTROL_PRECISE_BIT : 0);
+}
+
+void VulkanPipelineStatistics::RecordEnd(VkCommandBuffer command_buffer, PipelineStatisticsScope scope)
+{
+	if (!IsCounted(scope))
+		return;
+
+	vkCmdEndQuery(command_buffer, occlusion_query_pool_, scope);
+	vkCmdEndQuery(command_buffer, statistics_query_pool_, scope);
+}
+
+void VulkanPipelineStatistics::Collect(PipelineStatisticsScope scope)
+{
+	if (!IsCounted(scope))
+		return;
+
+	PipelineStatisticsResult result;
+	if (ReadResults(scope, true, result))
+		AddResult(scopes_[scope].current, result);
+}
+
+void VulkanPipelineStatistics::MarkSubmitted(PipelineStatisticsScope scope)
+{
+	if (!IsCounted(scope))
+		return;
+
+	std::vector<PipelineStatisticsScope>& submitted_scopes = submitted_scopes_[current_frame_];
+	if (std::find(submitted_scopes.begin(), submitted_scopes.end(), scope) == submitted_scopes.end())
+		submitted_scopes.push_back(scope);
+}
+
+void VulkanPipelineStatistics::BeginFrame(uint32_t frame)
+{
+	current_frame_ = frame;
+	if (!enabled_)
+		return;
+
+	std::vector<PipelineStatisticsScope>& submitted_scopes = submitted_scopes_[frame];
+
+	for (PipelineStatisticsScope scope = 0; scope < scopes_.size(); scope++)
+	{
+		Scope& statistics_scope = scopes_[scope];
+
+		// immediate scopes report everything collected since the last frame began
+		if (statistics_scope.immediate)
+		{
+			statistics_scope.last = statistics_scope.current;
+			statistics_scope.current = {};
+			continue;
+		}
+
+		// a scope the frame did not submit did no work, one whose queries a later frame in flight has
+		// already reset keeps its previous results rather than waiting
+		if (std::find(submitted_scopes.begin(), submitted_scopes.end(), scope) == submitted_scopes.end())
+		{
+			statistics_scope.last = {};
+			continue;
+		}
+
+		PipelineStatisticsResult result;
+		if (ReadResults(scope, false, result))
+			statistics_scope.last = result;
+	}
+
+	submitted_scopes.clear();
+}
+
+PipelineStatisticsResult VulkanPipelineStatistics::GetLastResult(PipelineStatisticsScope scope)
+{
+	if (scope >= scopes_.size())
+		return {};
+
+	return scopes_[scope].last;
+}
+
+void VulkanPipelineStatistics::ResetTotals()
+{
+	for (Scope& scope : scopes_)
+		scope.total = {};
+
+	total_frame_count_ = 0;
+}
+
+void VulkanPipelineStatistics::AddLastResultsToTotals()
+{
+	for (Scope& scope : scopes_)
+		AddResult(scope.total, scope.last);
+
+	total_frame_count_++;
+}
+
+PipelineStatisticsResult VulkanPipelineStatistics::GetTotal(PipelineStatisticsScope scope)
+{
+	if (scope >= scopes_.size())
+		return {};
+
+	return scopes_[scope].total;
+}
+
+void VulkanPipelineStatistics::PrintStatistics()
+{
+	if (!enabled_)
+	{
+		std::cout << "Pipeline statistics queries are not supported by this device" << std::endl;
+		return;
+	}
+
+	std::cout << "Pipeline statistics (last frame):" << std::endl;
+	for (const Scope& scope : scopes_)
+	{
+		const PipelineStatisticsResult& result = scope.last;
+		if (result.input_primitives == 0 && result.fragment_invocations == 0 && result.compute_invocations == 0)
+			continue;
+
+		std::cout << "\t" << scope.name << ": " << result.input_primitives << " primitives, " << result.clipping_primitives << " clipped primitives, "
+			<< result.vertex_invocations << " vertex, " << result.fragment_invocations << " fragment, " << result.compute_invocations << " compute invocations, "
+			<< result.samples_passed << " samples passed" << std::endl;
+	}
+}
+
+bool VulkanPipelineStatistics::IsCounted(PipelineStatisticsScope scope)
+{
+	return enabled_ && scope < scopes_.size();
+}
+
+bool VulkanPipelineStatistics::ReadResults(PipelineStatisticsScope scope, bool wait, PipelineStatisticsResult& result)
+{
+	VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | (wait ? VK_QUERY_RESULT_WAIT_BIT : VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+	// the statistics are followed by the availability value when not waiting
+	uint64_t statistics[PIPELINE_STATISTICS_VALUE_COUNT + 1] = {};
+	uint64_t occlusion[2] = {};
+
+	VkResult statistics_result = vkGetQueryPoolResults(devices_->GetLogicalDevice(), statistics_query_pool_, scope, 1, sizeof(statistics), statistics, sizeof(statistics), flags);
+	VkResult occlusion_result = vkGetQueryPoolResults(devices_->GetLogicalDevice(), occlusion_query_pool_, scope, 1, sizeof(occlusion), occlusion, sizeof(occlusion), flags);
+
+	if (statistics_result != VK_SUCCESS || occlusion_result != VK_SUCCESS)
+		return false;
+
+	if (!wait && (statistics[PIPELINE_STATISTICS_VALUE_COUNT] == 0 || occlusion[1] == 0))
+		return false;
+
+	result.input_primitives = statistics[0];
+	result.vertex_invocations = statistics[1];
+	result.clipping_invocations = statistics[2];
+	result.clipping_primitives = statistics[3];
+	result.fragment_invocations = statistics[4];
+	result.compute_invocations = statistics[5];
+	result.samples_passed = occlusion[0];
+
+	return true;
+}
+
+void VulkanPipelineStatistics::AddResult(PipelineStatisticsResult& total, const PipelineStatisticsResult& result)
+{
+	total.input_primitives += result.input_primitives;
+	total.clipping_invocations += result.clipping_invocations;
+	total.clipping_primitives += result.clipping_primitives;
+	total.vertex_invocations += result.vertex_invocations;
+	total.fragment_invocations += result.fragment_invocations;
+	total.compute_invocations += result.compute_invocations;
+	total.samples_passed += result.samples_passed;
+}
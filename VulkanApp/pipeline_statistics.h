@@ -0,0 +1,99 @@
+#ifndef _PIPELINE_STATISTICS_H_
+#define _PIPELINE_STATISTICS_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+
+#define PIPELINE_STATISTICS_MAX_SCOPES 128
+#define PIPELINE_STATISTICS_NO_SCOPE 0xFFFFFFFF
+
+class VulkanDevices;
+
+// identifies a region of gpu work whose pipeline statistics and samples passed are counted
+typedef uint32_t PipelineStatisticsScope;
+
+struct PipelineStatisticsResult
+{
+	uint64_t input_primitives;			// primitives read by the input assembler
+	uint64_t clipping_invocations;		// primitives reaching the clipping stage
+	uint64_t clipping_primitives;		// primitives output by the clipping stage
+	uint64_t vertex_invocations;
+	uint64_t fragment_invocations;
+	uint64_t compute_invocations;
+	uint64_t samples_passed;			// exact when the device supports precise occlusion queries
+};
+
+// counts the primitives, shader invocations and samples passed by recorded work with pipeline statistics
+// and occlusion queries, both queries must begin and end in the same command buffer outside of a render pass
+class VulkanPipelineStatistics
+{
+protected:
+	struct Scope
+	{
+		std::string name;
+		bool immediate;		// the owner waits for its submissions and collects the results itself
+
+		PipelineStatisticsResult current;	// immediate results collected during the current frame
+		PipelineStatisticsResult last;
+		PipelineStatisticsResult total;
+	};
+
+public:
+	VulkanPipelineStatistics();
+
+	// the queries are only recorded when the device was created with pipelineStatisticsQuery enabled
+	void Init(VulkanDevices* devices, uint32_t frame_count);
+	void Cleanup();
+
+	// returns PIPELINE_STATISTICS_NO_SCOPE once every query is in use or the queries are unsupported
+	PipelineStatisticsScope AddScope(std::string name, bool immediate = false);
+	inline const std::string& GetScopeName(PipelineStatisticsScope scope) { return scopes_[scope].name; }
+	inline uint32_t GetScopeCount() { return static_cast<uint32_t>(scopes_.size()); }
+	inline bool IsEnabled() { return enabled_; }
+
+	// reset and begin the scope's queries, then end them, recorded outside of a render pass
+	void RecordBegin(VkCommandBuffer command_buffer, PipelineStatisticsScope scope);
+	void RecordEnd(VkCommandBuffer command_buffer, PipelineStatisticsScope scope);
+
+	// add an immediate scope's results once the owner's submission has completed
+	void Collect(PipelineStatisticsScope scope);
+
+	// a pre-recorded scope's command buffer was submitted with the current frame
+	void MarkSubmitted(PipelineStatisticsScope scope);
+
+	// called once the frame slot's fence has been waited on, reads the results of the scopes it submitted
+	void BeginFrame(uint32_t frame);
+
+	PipelineStatisticsResult GetLastResult(PipelineStatisticsScope scope);
+
+	// sums of the last results over the frames added since the totals were reset
+	void ResetTotals();
+	void AddLastResultsToTotals();
+	PipelineStatisticsResult GetTotal(PipelineStatisticsScope scope);
+	inline uint32_t GetTotalFrameCount() { return total_frame_count_; }
+
+	void PrintStatistics();
+
+protected:
+	bool IsCounted(PipelineStatisticsScope scope);
+	bool ReadResults(PipelineStatisticsScope scope, bool wait, PipelineStatisticsResult& result);
+	static void AddResult(PipelineStatisticsResult& total, const PipelineStatisticsResult& result);
+
+protected:
+	VulkanDevices* devices_;
+	bool enabled_;
+	bool precise_occlusion_;
+	uint32_t current_frame_;
+
+	// one statistics and one occlusion query per scope, shared by every frame in flight as the
+	// pre-recorded command buffers they are written from are
+	VkQueryPool statistics_query_pool_;
+	VkQueryPool occlusion_query_pool_;
+
+	std::vector<Scope> scopes_;
+	std::vector<std::vector<PipelineStatisticsScope>> submitted_scopes_;	// per frame slot
+	uint32_t total_frame_count_;
+};
+
+#endif
\ No newline at end of file
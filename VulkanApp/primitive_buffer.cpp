@@ -1,6 +1,9 @@
 #include "primitive_buffer.h"
 #include "mesh.h"
 #include "shape.h"
+#include "load_statistics.h"
+
+#include <iostream>
 
 VulkanPrimitiveBuffer::VulkanPrimitiveBuffer()
 {
@@ -8,6 +11,8 @@ VulkanPrimitiveBuffer::VulkanPrimitiveBuffer()
 	last_index_ = 0;
 	vertex_count_ = 0;
 	index_count_ = 0;
+	vertex_format_ = VertexFormat::FLOAT;
+	vertex_stride_ = sizeof(Vertex);
 }
 
 VulkanPrimitiveBuffer::~VulkanPrimitiveBuffer()
@@ -15,11 +20,14 @@ VulkanPrimitiveBuffer::~VulkanPrimitiveBuffer()
 
 }
 
-void VulkanPrimitiveBuffer::Init(VulkanDevices* devices, VkVertexInputBindingDescription binding_description, std::vector<VkVertexInputAttributeDescription> attribute_descriptions)
+void VulkanPrimitiveBuffer::Init(VulkanDevices* devices, VertexFormat vertex_format)
 {
+	devices_ = devices;
 	device_handle_ = devices->GetLogicalDevice();
+	vertex_format_ = vertex_format;
+	vertex_stride_ = VertexPacker::GetVertexStride(vertex_format);
 
-	VkDeviceSize vertex_buffer_size = MAX_PRIMITIVE_VERTICES * sizeof(Vertex);
+	VkDeviceSize vertex_buffer_size = (VkDeviceSize)MAX_PRIMITIVE_VERTICES * vertex_stride_;
 	VkDeviceSize index_buffer_size = MAX_PRIMITIVE_INDICES * sizeof(uint32_t);
 	
 	devices->CreateBuffer(vertex_buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertex_buffer_, vertex_buffer_memory_);
@@ -28,26 +36,22 @@ void VulkanPrimitiveBuffer::Init(VulkanDevices* devices, VkVertexInputBindingDes
 
 void VulkanPrimitiveBuffer::InitShapeBuffer(VulkanDevices* devices)
 {
-	// create the shape buffer
-	VkDeviceSize shape_buffer_size = shape_data_.size() * sizeof(ShapeData);
-	devices->CreateBuffer(shape_buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, shape_buffer_, shape_buffer_memory_);
+	LoadPhaseTimer finalize_timer(LoadPhase::PRIMITIVE_BUFFER);
+	finalize_timer.AddBytes(shape_data_.size() * (sizeof(ShapeData) + sizeof(IndirectDrawCommand)));
+	finalize_timer.AddItems(shape_data_.size());
 
-	// use a staging buffer to copy shapes to the shape buffer
-	VkBuffer staging_buffer;
-	VkDeviceMemory staging_buffer_memory;
-	devices->CreateBuffer(shape_buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory);
-	devices->CopyDataToBuffer(staging_buffer_memory, shape_data_.data(), shape_buffer_size);
-	devices->CopyBuffer(staging_buffer, shape_buffer_, shape_buffer_size);
+	// create the shape buffer, the packed vertex format also reads it as a per instance vertex stream
+	VkDeviceSize shape_buffer_size = shape_data_.size() * sizeof(ShapeData);
+	devices->CreateBuffer(shape_buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, shape_buffer_, shape_buffer_memory_);
 
-	// delete the staging buffer now it is no longer needed
-	vkDestroyBuffer(devices->GetLogicalDevice(), staging_buffer, nullptr);
-	vkFreeMemory(devices->GetLogicalDevice(), staging_buffer_memory, nullptr);
+	// stage the shapes into the shape buffer
+	devices->GetUploadManager()->UploadToBuffer(shape_buffer_, shape_data_.data(), shape_buffer_size);
 
 	// create the indirect draw buffer
 	VkDeviceSize indirect_buffer_size = shape_data_.size() * sizeof(IndirectDrawCommand);
 	devices->CreateBuffer(indirect_buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indirect_draw_buffer_, indirect_draw_buffer_memory_);
 	
-	// use a staging buffer to copy indirect draw data to the shape buffer
+	// stage the indirect draw data into the indirect draw buffer
 	std::vector<IndirectDrawCommand> indirect_draw_commands;
 	for (ShapeData shape_data : shape_data_)
 	{
@@ -63,57 +67,63 @@ void VulkanPrimitiveBuffer::InitShapeBuffer(VulkanDevices* devices)
 		indirect_draw_commands.push_back(indirect_draw_command);
 	}
 	
-	devices->CreateBuffer(indirect_buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory);
-	devices->CopyDataToBuffer(staging_buffer_memory, indirect_draw_commands.data(), indirect_buffer_size);
-	devices->CopyBuffer(staging_buffer, indirect_draw_buffer_, indirect_buffer_size);
+	devices->GetUploadManager()->UploadToBuffer(indirect_draw_buffer_, indirect_draw_commands.data(), indirect_buffer_size);
 
-	// delete the staging buffer now it is no longer needed
-	vkDestroyBuffer(devices->GetLogicalDevice(), staging_buffer, nullptr);
-	vkFreeMemory(devices->GetLogicalDevice(), staging_buffer_memory, nullptr);
+	// all scene geometry must be resident before the culling and render passes read it
+	devices->GetUploadManager()->WaitIdle();
+
+	// the vertex fetch of every pass that draws the scene scales with the stride, so the buffer size compares the formats' bandwidth too
+	VkDeviceSize float_size = (VkDeviceSize)vertex_count_ * sizeof(Vertex);
+	VkDeviceSize vertex_size = GetVertexBufferSize();
+	std::cout << "Vertex buffer: " << vertex_count_ << " " << VertexPacker::GetFormatName(vertex_format_) << " vertices of " << vertex_stride_ << " bytes, "
+		<< vertex_size / (1024.0 * 1024.0) << "MB";
+	if (vertex_format_ != VertexFormat::FLOAT && float_size > 0)
+	{
+		std::cout << ", " << (float_size - vertex_size) / (1024.0 * 1024.0) << "MB (" << 100.0 * (float_size - vertex_size) / float_size << "%) less than the float format";
+	}
+	std::cout << std::endl;
 }
 
 void VulkanPrimitiveBuffer::Cleanup()
 {
 	// cleanup vertex buffer
 	vkDestroyBuffer(device_handle_, vertex_buffer_, nullptr);
-	vkFreeMemory(device_handle_, vertex_buffer_memory_, nullptr);
+	devices_->FreeMemory(vertex_buffer_memory_);
 
 	// cleanup index buffer
 	vkDestroyBuffer(device_handle_, index_buffer_, nullptr);
-	vkFreeMemory(device_handle_, index_buffer_memory_, nullptr);
+	devices_->FreeMemory(index_buffer_memory_);
 
 	// cleanup shape buffer
 	vkDestroyBuffer(device_handle_, shape_buffer_, nullptr);
-	vkFreeMemory(device_handle_, shape_buffer_memory_, nullptr);
+	devices_->FreeMemory(shape_buffer_memory_);
 
 	// cleanup indirect draw buffer
 	vkDestroyBuffer(device_handle_, indirect_draw_buffer_, nullptr);
-	vkFreeMemory(device_handle_, indirect_draw_buffer_memory_, nullptr);
+	devices_->FreeMemory(indirect_draw_buffer_memory_);
 }
 
 void VulkanPrimitiveBuffer::RecordBindingCommands(VkCommandBuffer& command_buffer)
 {
-	VkBuffer vertex_buffers[] = { vertex_buffer_ };
-	VkDeviceSize offsets[] = { 0 };
-	vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
+	// packed vertices are decoded with the bounds of their shape, which the draws' first instance selects
+	VkBuffer vertex_buffers[] = { vertex_buffer_, shape_buffer_ };
+	VkDeviceSize offsets[] = { 0, 0 };
+	uint32_t binding_count = (vertex_format_ == VertexFormat::PACKED) ? 2 : 1;
+	vkCmdBindVertexBuffers(command_buffer, 0, binding_count, vertex_buffers, offsets);
 	vkCmdBindIndexBuffer(command_buffer, index_buffer_, 0, VK_INDEX_TYPE_UINT32);
 }
 
 void VulkanPrimitiveBuffer::RecordIndirectDrawCommands(VkCommandBuffer& command_buffer)
 {
 	// bind the vertex and index buffers
-	VkBuffer vertex_buffers[] = { vertex_buffer_ };
-	VkDeviceSize offsets[] = { 0 };
-	vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
-	vkCmdBindIndexBuffer(command_buffer, index_buffer_, 0, VK_INDEX_TYPE_UINT32);
+	RecordBindingCommands(command_buffer);
 
 	// issue the multi draw indirect command
 	vkCmdDrawIndexedIndirect(command_buffer, indirect_draw_buffer_, 0, shape_data_.size(), sizeof(IndirectDrawCommand));
 }
 
-void VulkanPrimitiveBuffer::AddPrimitiveData(VulkanDevices* devices, uint32_t vertex_count, uint32_t index_count, VkBuffer vertices, VkBuffer indices, uint32_t& vertex_offset, uint32_t& index_offset, uint32_t& shape_index)
+void VulkanPrimitiveBuffer::AddPrimitiveData(VulkanDevices* devices, uint32_t vertex_count, uint32_t index_count, const Vertex* vertices, const uint32_t* indices, uint32_t& vertex_offset, uint32_t& index_offset, uint32_t& shape_index)
 {
-	VkDeviceSize vertex_size = vertex_count * sizeof(Vertex);
 	VkDeviceSize index_size = index_count * sizeof(uint32_t);
 
 	// return the vertex and index offsets for this primitive
@@ -130,11 +140,23 @@ void VulkanPrimitiveBuffer::AddPrimitiveData(VulkanDevices* devices, uint32_t ve
 		glm::vec4(0.0, 0.0, 0.0, 0.0),
 		glm::vec4(0.0, 0.0, 0.0, 0.0)
 	};
+
+	// packed vertices need the bounds they are quantized within
+	if (vertex_format_ == VertexFormat::PACKED && vertex_count > 0)
+	{
+		shape.min_bounding_vertex = vertices[0].pos_mat_index;
+		shape.max_bounding_vertex = vertices[0].pos_mat_index;
+		for (uint32_t i = 1; i < vertex_count; i++)
+		{
+			shape.min_bounding_vertex = glm::min(shape.min_bounding_vertex, vertices[i].pos_mat_index);
+			shape.max_bounding_vertex = glm::max(shape.max_bounding_vertex, vertices[i].pos_mat_index);
+		}
+	}
 	shape_data_.push_back(shape);
 	
-	// copy the vertex and index buffers
-	devices->CopyBuffer(vertices, vertex_buffer_, vertex_size, last_vertex_ * sizeof(Vertex));
-	devices->CopyBuffer(indices, index_buffer_, index_size, last_index_ * sizeof(uint32_t));
+	// stage the vertex and index data
+	StageVertices(devices, vertices, vertex_count, shape.min_bounding_vertex, shape.max_bounding_vertex);
+	devices->GetUploadManager()->UploadToBuffer(index_buffer_, indices, index_size, last_index_ * sizeof(uint32_t));
 
 	// increment the vertex and index counts
 	last_vertex_ += vertex_count;
@@ -143,9 +165,8 @@ void VulkanPrimitiveBuffer::AddPrimitiveData(VulkanDevices* devices, uint32_t ve
 	index_count_ += index_count;
 }
 
-void VulkanPrimitiveBuffer::AddPrimitiveData(VulkanDevices* devices, Shape* shape)
+void VulkanPrimitiveBuffer::AddPrimitiveData(VulkanDevices* devices, Shape* shape, const Vertex* vertices, const uint32_t* indices)
 {
-	VkDeviceSize vertex_size = shape->GetVertexCount() * sizeof(Vertex);
 	VkDeviceSize index_size = shape->GetIndexCount() * sizeof(uint32_t);
 
 	// return the vertex and index offsets for this primitive
@@ -168,13 +189,29 @@ void VulkanPrimitiveBuffer::AddPrimitiveData(VulkanDevices* devices, Shape* shap
 	};
 	shape_data_.push_back(shape_data);
 
-	// copy the vertex and index buffers
-	devices->CopyBuffer(shape->GetVertexBuffer(), vertex_buffer_, vertex_size, last_vertex_ * sizeof(Vertex));
-	devices->CopyBuffer(shape->GetIndexBuffer(), index_buffer_, index_size, last_index_ * sizeof(uint32_t));
+	// stage the vertex and index data
+	StageVertices(devices, vertices, shape->GetVertexCount(), shape_data.min_bounding_vertex, shape_data.max_bounding_vertex);
+	devices->GetUploadManager()->UploadToBuffer(index_buffer_, indices, index_size, last_index_ * sizeof(uint32_t));
 
 	// increment the vertex and index counts
 	last_vertex_ += shape->GetVertexCount();
 	last_index_ += shape->GetIndexCount();
 	vertex_count_ += shape->GetVertexCount();
 	index_count_ += shape->GetIndexCount();
+}
+
+void VulkanPrimitiveBuffer::StageVertices(VulkanDevices* devices, const Vertex* vertices, uint32_t vertex_count, const glm::vec4& min_vertex, const glm::vec4& max_vertex)
+{
+	VkDeviceSize vertex_offset = (VkDeviceSize)last_vertex_ * vertex_stride_;
+
+	if (vertex_format_ == VertexFormat::PACKED)
+	{
+		// shapes are uploaded one at a time by the loading thread, so the packed copy is reused
+		VertexPacker::Pack(vertices, vertex_count, min_vertex, max_vertex, packed_vertices_);
+		devices->GetUploadManager()->UploadToBuffer(vertex_buffer_, packed_vertices_.data(), vertex_count * sizeof(PackedVertex), vertex_offset);
+	}
+	else
+	{
+		devices->GetUploadManager()->UploadToBuffer(vertex_buffer_, vertices, vertex_count * sizeof(Vertex), vertex_offset);
+	}
 }
\ No newline at end of file
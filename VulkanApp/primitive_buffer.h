@@ -6,11 +6,13 @@
 #include <vector>
 
 #include "device.h"
+#include "vertex_format.h"
 
 #define MAX_PRIMITIVE_VERTICES 15000000
 #define MAX_PRIMITIVE_INDICES 30000000
 
 class Shape;
+struct Vertex;
 
 struct ShapeData
 {
@@ -35,18 +37,21 @@ public:
 	VulkanPrimitiveBuffer();
 	~VulkanPrimitiveBuffer();
 
-	void Init(VulkanDevices* devices, VkVertexInputBindingDescription binding_description, std::vector<VkVertexInputAttributeDescription> attribute_descriptions);
+	void Init(VulkanDevices* devices, VertexFormat vertex_format);
 	void InitShapeBuffer(VulkanDevices* devices);
 
 	void Cleanup();
 
-	void AddPrimitiveData(VulkanDevices* devices, uint32_t vertex_count, uint32_t index_count, VkBuffer vertices, VkBuffer indices, uint32_t& vertex_offset, uint32_t& index_offset, uint32_t& shape_index);
-	void AddPrimitiveData(VulkanDevices* devices, Shape* shape);
+	void AddPrimitiveData(VulkanDevices* devices, uint32_t vertex_count, uint32_t index_count, const Vertex* vertices, const uint32_t* indices, uint32_t& vertex_offset, uint32_t& index_offset, uint32_t& shape_index);
+	void AddPrimitiveData(VulkanDevices* devices, Shape* shape, const Vertex* vertices, const uint32_t* indices);
 
 	void RecordBindingCommands(VkCommandBuffer& command_buffer);
 	void RecordIndirectDrawCommands(VkCommandBuffer& command_buffer);
 
 	inline uint32_t GetVertexCount() { return vertex_count_; }
+	inline VertexFormat GetVertexFormat() { return vertex_format_; }
+	inline uint32_t GetVertexStride() { return vertex_stride_; }
+	inline VkDeviceSize GetVertexBufferSize() { return (VkDeviceSize)vertex_count_ * vertex_stride_; }
 	inline uint32_t GetIndexCount() { return index_count_; }
 	inline uint32_t GetShapeCount() { return shape_data_.size(); }
 	inline VkBuffer GetVertexBuffer() { return vertex_buffer_; }
@@ -55,20 +60,29 @@ public:
 	inline VkBuffer GetIndirectDrawBuffer() { return indirect_draw_buffer_; }
 
 protected:
+	void StageVertices(VulkanDevices* devices, const Vertex* vertices, uint32_t vertex_count, const glm::vec4& min_vertex, const glm::vec4& max_vertex);
+
+protected:
+	VulkanDevices* devices_;
 	VkDevice device_handle_;
 
+	// the vertices are converted to the format as they are staged
+	VertexFormat vertex_format_;
+	uint32_t vertex_stride_;
+	std::vector<PackedVertex> packed_vertices_;
+
 	VkBuffer vertex_buffer_;
-	VkDeviceMemory vertex_buffer_memory_;
+	MemoryAllocation vertex_buffer_memory_;
 
 	VkBuffer index_buffer_;
-	VkDeviceMemory index_buffer_memory_;
+	MemoryAllocation index_buffer_memory_;
 
 	VkBuffer indirect_draw_buffer_;
-	VkDeviceMemory indirect_draw_buffer_memory_;
+	MemoryAllocation indirect_draw_buffer_memory_;
 
 	// shape buffer components
 	VkBuffer shape_buffer_;
-	VkDeviceMemory shape_buffer_memory_;
+	MemoryAllocation shape_buffer_memory_;
 	std::vector<ShapeData> shape_data_;
 
 	uint32_t last_vertex_;
@@ -0,0 +1,301 @@
+#include "procedural_scene.h"
+#include "mesh.h"
+#include "light.h"
+#include "material_buffer.h"
+
+#include <stdexcept>
+#include <cmath>
+
+// separate random sequences for each kind of generated object
+#define PROCEDURAL_MATERIAL_STREAM 1
+#define PROCEDURAL_SHAPE_STREAM 2
+#define PROCEDURAL_LIGHT_STREAM 3
+
+ProceduralScene::ProceduralScene(const ProceduralSceneSettings& settings)
+{
+	settings_ = settings;
+	grid_width_ = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(settings_.shape_count))));
+}
+
+bool ProceduralScene::ParseDescription(const std::string& description, ProceduralSceneSettings& settings)
+{
+	// the settings are separated by underscores so the description can name the scene's data files
+	std::vector<std::string> tokens;
+	size_t start = 0;
+	while (start <= description.length())
+	{
+		size_t end = description.find('_', start);
+		if (end == std::string::npos)
+			end = description.length();
+
+		tokens.push_back(description.substr(start, end - start));
+		start = end + 1;
+	}
+
+	if (tokens.empty() || tokens[0] != PROCEDURAL_SCENE_NAME)
+		return false;
+
+	settings = GetDefaultSettings();
+	for (size_t i = 1; i < tokens.size(); i++)
+	{
+		size_t separator = tokens[i].find('=');
+		std::string key = tokens[i].substr(0, separator);
+		std::string value = (separator == std::string::npos) ? "" : tokens[i].substr(separator + 1);
+
+		if (key == "layout")
+		{
+			if (value == "grid")
+				settings.layout = ProceduralLayout::GRID;
+			else if (value == "random")
+				settings.layout = ProceduralLayout::RANDOM;
+			else
+				throw std::runtime_error("unknown procedural layout " + value + "!");
+			continue;
+		}
+
+		if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+		{
+			throw std::runtime_error("invalid value for procedural setting " + tokens[i] + "!");
+		}
+		uint32_t number = static_cast<uint32_t>(std::stoul(value));
+
+		if (key == "seed")
+			settings.seed = number;
+		else if (key == "shapes")
+			settings.shape_count = number;
+		else if (key == "spacing")
+			settings.spacing = number;
+		else if (key == "density")
+			settings.subdivisions = number;
+		else if (key == "materials")
+			settings.material_count = number;
+		else if (key == "transparent")
+			settings.transparent_percentage = number;
+		else if (key == "alpha")
+			settings.alpha_tested_percentage = number;
+		else if (key == "directional")
+			settings.directional_light_count = number;
+		else if (key == "point")
+			settings.point_light_count = number;
+		else if (key == "spot")
+			settings.spot_light_count = number;
+		else if (key == "shadows")
+			settings.shadows_enabled = number != 0;
+		else
+			throw std::runtime_error("unknown procedural setting " + key + "!");
+	}
+
+	if (settings.shape_count == 0 || settings.material_count == 0 || settings.subdivisions == 0 || settings.spacing == 0)
+	{
+		throw std::runtime_error("a procedural scene needs at least one shape, material, subdivision and unit of spacing!");
+	}
+
+	if (settings.material_count > MAX_MATERIAL_COUNT)
+	{
+		throw std::runtime_error("a procedural scene can not have more than " + std::to_string(MAX_MATERIAL_COUNT) + " materials!");
+	}
+
+	if (settings.transparent_percentage + settings.alpha_tested_percentage > 100)
+	{
+		throw std::runtime_error("the transparent and alpha tested percentages of a procedural scene exceed 100!");
+	}
+
+	return true;
+}
+
+ProceduralSceneSettings ProceduralScene::GetDefaultSettings()
+{
+	ProceduralSceneSettings settings = {};
+	settings.seed = 1;
+	settings.shape_count = 1024;
+	settings.layout = ProceduralLayout::GRID;
+	settings.spacing = 4;
+	settings.subdivisions = 1;
+	settings.material_count = 16;
+	settings.transparent_percentage = 0;
+	settings.alpha_tested_percentage = 0;
+	settings.directional_light_count = 1;
+	settings.point_light_count = 0;
+	settings.spot_light_count = 0;
+	settings.shadows_enabled = true;
+
+	return settings;
+}
+
+std::vector<tinyobj::material_t> ProceduralScene::CreateMaterials()
+{
+	uint32_t transparent_count = settings_.material_count * settings_.transparent_percentage / 100;
+	uint32_t alpha_tested_count = settings_.material_count * settings_.alpha_tested_percentage / 100;
+
+	std::vector<tinyobj::material_t> materials(settings_.material_count);
+	for (uint32_t i = 0; i < settings_.material_count; i++)
+	{
+		std::mt19937 random = CreateRandom(PROCEDURAL_MATERIAL_STREAM, i);
+
+		tinyobj::material_t& material = materials[i];
+		material.name = "procedural_" + std::to_string(i);
+		for (int c = 0; c < 3; c++)
+		{
+			material.ambient[c] = 0.0f;
+			material.diffuse[c] = RandomRange(random, 0.2f, 1.0f);
+			material.specular[c] = 0.5f;
+			material.transmittance[c] = 0.0f;
+			material.emission[c] = 0.0f;
+		}
+		material.shininess = RandomRange(random, 8.0f, 128.0f);
+		material.ior = 1.0f;
+		material.dissolve = 1.0f;
+		material.illum = 2;
+
+		// the transparent materials come first, followed by the alpha tested ones
+		if (i < transparent_count)
+			material.dissolve = RandomRange(random, 0.25f, 0.75f);
+		else if (i < transparent_count + alpha_tested_count)
+			material.alpha_texname = PROCEDURAL_ALPHA_TEXTURE;
+	}
+
+	return materials;
+}
+
+void ProceduralScene::CreateShape(uint32_t shape_index, float material_index, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, BoundingBox& bounding_box)
+{
+	std::mt19937 random = CreateRandom(PROCEDURAL_SHAPE_STREAM, shape_index);
+
+	float spacing = static_cast<float>(settings_.spacing);
+	float extent = grid_width_ * spacing;
+
+	// boxes of up to three quarters of a cell, resting on the ground in a grid or scattered through the same area
+	glm::vec3 half_size = glm::vec3(RandomRange(random, 0.125f, 0.375f), RandomRange(random, 0.125f, 0.375f), RandomRange(random, 0.125f, 0.375f)) * spacing;
+
+	glm::vec3 center;
+	if (settings_.layout == ProceduralLayout::GRID)
+	{
+		center.x = ((shape_index % grid_width_) + 0.5f) * spacing - extent * 0.5f;
+		center.y = ((shape_index / grid_width_) + 0.5f) * spacing - extent * 0.5f;
+		center.z = half_size.z;
+	}
+	else
+	{
+		center.x = RandomRange(random, -0.5f, 0.5f) * extent;
+		center.y = RandomRange(random, -0.5f, 0.5f) * extent;
+		center.z = RandomRange(random, 0.0f, 2.0f) * spacing + half_size.z;
+	}
+
+	uint32_t face_vertex_count = (settings_.subdivisions + 1) * (settings_.subdivisions + 1);
+	vertices.clear();
+	indices.clear();
+	vertices.reserve(face_vertex_count * 6);
+	indices.reserve(settings_.subdivisions * settings_.subdivisions * 36);
+
+	// each face's edges run along u and v, with u cross v pointing out of the box
+	AddBoxFace(center, half_size, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), material_index, vertices, indices);
+	AddBoxFace(center, half_size, glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f), material_index, vertices, indices);
+	AddBoxFace(center, half_size, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), material_index, vertices, indices);
+	AddBoxFace(center, half_size, glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), material_index, vertices, indices);
+	AddBoxFace(center, half_size, glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), material_index, vertices, indices);
+	AddBoxFace(center, half_size, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), material_index, vertices, indices);
+
+	bounding_box.min_vertex = glm::vec4(center - half_size, 0.0f);
+	bounding_box.max_vertex = glm::vec4(center + half_size, 0.0f);
+}
+
+std::vector<Light*> ProceduralScene::CreateLights(VulkanDevices* devices, VulkanRenderer* renderer, glm::vec3 scene_min, glm::vec3 scene_max)
+{
+	std::vector<Light*> lights;
+
+	uint32_t light_count = settings_.directional_light_count + settings_.point_light_count + settings_.spot_light_count;
+	for (uint32_t i = 0; i < light_count; i++)
+	{
+		std::mt19937 random = CreateRandom(PROCEDURAL_LIGHT_STREAM, i);
+
+		// point and spot lights hang above a random point of the scene
+		glm::vec3 position = glm::vec3(RandomRange(random, scene_min.x, scene_max.x), RandomRange(random, scene_min.y, scene_max.y), scene_max.z + settings_.spacing);
+		glm::vec3 direction = glm::normalize(glm::vec3(RandomRange(random, -0.5f, 0.5f), RandomRange(random, -0.5f, 0.5f), -1.0f));
+
+		Light* light = new Light();
+		if (i < settings_.directional_light_count)
+		{
+			light->SetType(0.0f);
+			light->SetRange(1.0f);
+		}
+		else if (i < settings_.directional_light_count + settings_.point_light_count)
+		{
+			light->SetType(1.0f);
+			light->SetRange(settings_.spacing * 8.0f);
+		}
+		else
+		{
+			light->SetType(2.0f);
+			light->SetRange(settings_.spacing * 16.0f);
+		}
+
+		light->SetPosition(glm::vec4(position, 1.0f));
+		light->SetDirection(glm::vec4(direction, 1.0f));
+		light->SetColor(glm::vec4(RandomRange(random, 0.7f, 1.0f), RandomRange(random, 0.7f, 1.0f), RandomRange(random, 0.7f, 1.0f), 1.0f));
+		light->SetIntensity(1.0f);
+		light->SetShadowsEnabled(settings_.shadows_enabled);
+		light->Init(devices, renderer);
+		lights.push_back(light);
+	}
+
+	return lights;
+}
+
+float ProceduralScene::RandomFloat(std::mt19937& random)
+{
+	// the top 24 bits fill a float's mantissa exactly
+	return (random() >> 8) * (1.0f / 16777216.0f);
+}
+
+float ProceduralScene::RandomRange(std::mt19937& random, float min, float max)
+{
+	return min + (max - min) * RandomFloat(random);
+}
+
+std::mt19937 ProceduralScene::CreateRandom(uint32_t stream, uint32_t index)
+{
+	std::seed_seq seed = { settings_.seed, stream, index };
+	return std::mt19937(seed);
+}
+
+void ProceduralScene::AddBoxFace(glm::vec3 center, glm::vec3 half_size, glm::vec3 normal, glm::vec3 u, glm::vec3 v, float material_index, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	uint32_t subdivisions = settings_.subdivisions;
+	uint32_t first_vertex = static_cast<uint32_t>(vertices.size());
+
+	// encoded as the model loader encodes the normals it converts from obj space
+	glm::vec2 encoded_normal = Mesh::SpheremapEncode(glm::vec3(-normal.x, normal.y, normal.z));
+
+	for (uint32_t j = 0; j <= subdivisions; j++)
+	{
+		for (uint32_t i = 0; i <= subdivisions; i++)
+		{
+			float s = static_cast<float>(i) / subdivisions;
+			float t = static_cast<float>(j) / subdivisions;
+
+			Vertex vertex = {};
+			glm::vec3 position = center + half_size * (normal + (s * 2.0f - 1.0f) * u + (t * 2.0f - 1.0f) * v);
+			vertex.pos_mat_index = glm::vec4(position, material_index);
+			vertex.encoded_normal_tex = glm::vec4(encoded_normal, s, t);
+			vertices.push_back(vertex);
+		}
+	}
+
+	// the loader's swap of the y and z axes mirrors obj geometry, so outward faces wind clockwise to match it
+	uint32_t row = subdivisions + 1;
+	for (uint32_t j = 0; j < subdivisions; j++)
+	{
+		for (uint32_t i = 0; i < subdivisions; i++)
+		{
+			uint32_t corner = first_vertex + j * row + i;
+
+			indices.push_back(corner);
+			indices.push_back(corner + row + 1);
+			indices.push_back(corner + 1);
+
+			indices.push_back(corner);
+			indices.push_back(corner + row);
+			indices.push_back(corner + row + 1);
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef _PROCEDURAL_SCENE_H_
+#define _PROCEDURAL_SCENE_H_
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <random>
+
+#include "shape.h"
+
+class VulkanDevices;
+class VulkanRenderer;
+class Light;
+
+// entered in place of a model as procedural followed by any of the settings, e.g. procedural_shapes=4096_layout=random_seed=7
+#define PROCEDURAL_SCENE_NAME "procedural"
+#define PROCEDURAL_SCENE_TEXTURE_DIRECTORY "../res/textures/"
+#define PROCEDURAL_ALPHA_TEXTURE "default.png"
+
+enum class ProceduralLayout
+{
+	GRID,
+	RANDOM
+};
+
+struct ProceduralSceneSettings
+{
+	uint32_t seed;
+
+	uint32_t shape_count;
+	ProceduralLayout layout;
+	uint32_t spacing;					// distance between grid cells, random layouts cover the same area
+	uint32_t subdivisions;				// per box edge, each shape has 12 * subdivisions^2 triangles
+
+	uint32_t material_count;
+	uint32_t transparent_percentage;	// of the materials, blended with a dissolve below one
+	uint32_t alpha_tested_percentage;	// of the materials, given an alpha map
+
+	uint32_t directional_light_count;
+	uint32_t point_light_count;
+	uint32_t spot_light_count;
+	bool shadows_enabled;
+};
+
+// generates a deterministic scene of boxes, materials and lights from a seed so scaling can be measured without model files,
+// each shape and light draws from its own random sequence so the scene does not depend on the order it is generated in
+class ProceduralScene
+{
+public:
+	ProceduralScene(const ProceduralSceneSettings& settings);
+
+	// returns false when the description does not name a procedural scene, unset settings keep their defaults
+	static bool ParseDescription(const std::string& description, ProceduralSceneSettings& settings);
+	static ProceduralSceneSettings GetDefaultSettings();
+
+	inline const ProceduralSceneSettings& GetSettings() { return settings_; }
+
+	std::vector<tinyobj::material_t> CreateMaterials();
+
+	// shapes cycle through the materials so every material covers the same share of the shapes
+	inline uint32_t GetShapeMaterial(uint32_t shape_index) { return shape_index % settings_.material_count; }
+	void CreateShape(uint32_t shape_index, float material_index, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, BoundingBox& bounding_box);
+
+	// lights are placed over the generated shapes, so are created once the scene bounds are known
+	std::vector<Light*> CreateLights(VulkanDevices* devices, VulkanRenderer* renderer, glm::vec3 scene_min, glm::vec3 scene_max);
+
+protected:
+	// the standard distributions differ between implementations, these do not
+	static float RandomFloat(std::mt19937& random);
+	static float RandomRange(std::mt19937& random, float min, float max);
+	std::mt19937 CreateRandom(uint32_t stream, uint32_t index);
+
+	void AddBoxFace(glm::vec3 center, glm::vec3 half_size, glm::vec3 normal, glm::vec3 u, glm::vec3 v, float material_index, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+protected:
+	ProceduralSceneSettings settings_;
+	uint32_t grid_width_;	// cells along each side of the square the shapes are placed in
+};
+
+#endif
\ No newline at end of file
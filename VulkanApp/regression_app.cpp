@@ -0,0 +1,147 @@
+#include "regression_app.h"
+#include <fstream>
+#include <cmath>
+
+RegressionApp::RegressionApp(const BenchmarkSettings& settings) : BenchmarkApp(settings)
+{
+}
+
+bool RegressionApp::Passed()
+{
+	for (const RegressionResult& result : regression_results_)
+	{
+		if (!result.passed)
+			return false;
+	}
+
+	return true;
+}
+
+void RegressionApp::RunCapturePoint(uint32_t index, const PerformanceCapturePoint& capture_point)
+{
+	camera_.SetPosition(capture_point.capture_position);
+	camera_.SetRotation(capture_point.capture_rotation);
+
+	// every frame in flight must have rendered from the new camera before the output is read back
+	uint32_t frame_count = std::max(std::max(settings_.warmup_frames, (uint32_t)frames_in_flight_), 1u);
+	for (uint32_t i = 0; i < frame_count; i++)
+		DrawFrame();
+
+	std::vector<glm::vec3> image;
+	renderer_->ReadBackOutputImage(image);
+
+	RegressionResult result = {};
+	result.render_mode = render_mode_;
+	result.width = window_width_;
+	result.height = window_height_;
+	result.multisample_level = multisample_level_;
+	result.capture_point = index;
+	result.image_name = GetImageName(index);
+
+	std::string reference_filename = settings_.reference_directory + "/" + result.image_name + ".pfm";
+	if (settings_.update_references)
+	{
+		if (!ImageComparison::WriteImage(reference_filename, window_width_, window_height_, image))
+		{
+			throw std::runtime_error("failed to write reference image " + reference_filename + "!");
+		}
+
+		result.reference_found = true;
+		result.passed = true;
+		regression_results_.push_back(result);
+
+		std::cout << "Capture point " << index << ": wrote reference " << reference_filename << std::endl;
+		return;
+	}
+
+	uint32_t reference_width = 0, reference_height = 0;
+	std::vector<glm::vec3> reference;
+	result.reference_found = ImageComparison::ReadImage(reference_filename, reference_width, reference_height, reference);
+	if (result.reference_found && (reference_width != (uint32_t)window_width_ || reference_height != (uint32_t)window_height_))
+		reference.clear();
+
+	result.comparison = ImageComparison::Compare(image, reference, settings_.tolerance);
+	result.passed = result.reference_found && result.comparison.differing_percentage <= settings_.max_differing_percentage;
+
+	// the output is kept alongside the diff so a deliberate change can be promoted to the new reference
+	if (!result.passed)
+	{
+		std::string failure_filename = settings_.output_path + "_" + result.image_name;
+		ImageComparison::WriteImage(failure_filename + "_output.pfm", window_width_, window_height_, image);
+		if (!reference.empty())
+			ImageComparison::WriteDiffImage(failure_filename + "_diff.ppm", window_width_, window_height_, image, reference, settings_.tolerance);
+	}
+
+	regression_results_.push_back(result);
+
+	if (!result.reference_found)
+	{
+		std::cout << "Capture point " << index << ": FAILED, no reference at " << reference_filename << std::endl;
+		return;
+	}
+
+	std::cout << "Capture point " << index << ": " << (result.passed ? "passed" : "FAILED") << ", " << result.comparison.differing_percentage << "% of pixels differ, "
+		<< result.comparison.max_error << " max error, " << result.comparison.psnr << "dB psnr" << std::endl;
+}
+
+void RegressionApp::WriteResults()
+{
+	std::ofstream json_file(settings_.output_path + "_regression.json", std::ios::out | std::ios::trunc);
+	if (!json_file.is_open())
+	{
+		throw std::runtime_error("failed to open regression output " + settings_.output_path + "!");
+	}
+
+	uint32_t failed_count = 0;
+
+	json_file << "{\n";
+	json_file << "\t\"model\": " << JsonString(settings_.model) << ",\n";
+	json_file << "\t\"device\": " << JsonString(device_name_) << ",\n";
+	json_file << "\t\"tolerance\": " << settings_.tolerance << ",\n";
+	json_file << "\t\"max_differing_percentage\": " << settings_.max_differing_percentage << ",\n";
+	json_file << "\t\"updated_references\": " << (settings_.update_references ? "true" : "false") << ",\n";
+	json_file << "\t\"results\": [";
+
+	for (size_t r = 0; r < regression_results_.size(); r++)
+	{
+		const RegressionResult& result = regression_results_[r];
+		if (!result.passed)
+			failed_count++;
+
+		// json has no infinity, identical images are written with a null psnr
+		std::string psnr = std::isinf(result.comparison.psnr) ? "null" : std::to_string(result.comparison.psnr);
+
+		json_file << ((r > 0) ? ",\n" : "\n") << "\t\t{ \"render_mode\": " << JsonString(result.render_mode) << ", \"width\": " << result.width << ", \"height\": " << result.height
+			<< ", \"msaa\": " << result.multisample_level << ", \"capture_point\": " << result.capture_point << ", \"image\": " << JsonString(result.image_name)
+			<< ", \"reference_found\": " << (result.reference_found ? "true" : "false") << ", \"passed\": " << (result.passed ? "true" : "false");
+
+		if (result.reference_found && !settings_.update_references)
+		{
+			json_file << ", \"max_error\": " << result.comparison.max_error << ", \"mean_squared_error\": " << result.comparison.mean_squared_error << ", \"psnr\": " << psnr
+				<< ", \"differing_pixels\": " << result.comparison.differing_pixel_count << ", \"differing_percentage\": " << result.comparison.differing_percentage;
+		}
+
+		json_file << " }";
+	}
+
+	json_file << "\n\t]\n}\n";
+
+	if (settings_.update_references)
+	{
+		std::cout << "Wrote " << regression_results_.size() << " reference images to " << settings_.reference_directory << std::endl;
+		return;
+	}
+
+	std::cout << regression_results_.size() - failed_count << " of " << regression_results_.size() << " capture points matched their references, results written to "
+		<< settings_.output_path << "_regression.json" << std::endl;
+}
+
+std::string RegressionApp::GetImageName(uint32_t index)
+{
+	// the model's extension is dropped, underscores stand in for spaces in the render path names
+	std::string model = settings_.model.substr(0, settings_.model.find_last_of('.'));
+	std::string mode = render_mode_;
+	std::replace(mode.begin(), mode.end(), ' ', '_');
+
+	return model + "_" + mode + "_" + std::to_string(window_width_) + "x" + std::to_string(window_height_) + "_msaa" + std::to_string(multisample_level_) + "_capture" + std::to_string(index);
+}
@@ -0,0 +1,39 @@
+#ifndef _REGRESSION_APP_H_
+#define _REGRESSION_APP_H_
+
+#include "benchmark_app.h"
+#include "image_comparison.h"
+
+struct RegressionResult
+{
+	std::string render_mode;
+	uint32_t width, height;
+	int multisample_level;
+	uint32_t capture_point;
+	std::string image_name;			// of the reference, and of the output and diff images written on failure
+	bool reference_found;
+	bool passed;
+	ImageComparisonResult comparison;
+};
+
+// renders every capture point offscreen like a benchmark, then reads back the output image and compares it
+// with a stored reference, so changes to the render paths can be shown not to change what is drawn
+class RegressionApp : public BenchmarkApp
+{
+public:
+	RegressionApp(const BenchmarkSettings& settings);
+
+	// false when any capture point differed from, or had no, reference
+	bool Passed();
+
+protected:
+	virtual void RunCapturePoint(uint32_t index, const PerformanceCapturePoint& capture_point);
+	virtual void WriteResults();
+
+	std::string GetImageName(uint32_t index);
+
+protected:
+	std::vector<RegressionResult> regression_results_;
+};
+
+#endif
\ No newline at end of file
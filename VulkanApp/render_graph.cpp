@@ -0,0 +1,785 @@
+#include "render_graph.h"
+#include "trace_profiler.h"
+#include "device.h"
+#include "render_target.h"
+#include "gpu_profiler.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+VulkanRenderGraph::VulkanRenderGraph()
+{
+	devices_ = nullptr;
+	graphics_queue_ = VK_NULL_HANDLE;
+	compute_queue_ = VK_NULL_HANDLE;
+	graphics_command_pool_ = VK_NULL_HANDLE;
+	compute_command_pool_ = VK_NULL_HANDLE;
+	compiled_ = false;
+	dirty_ = true;
+	statistics_ = {};
+	profiler_ = nullptr;
+}
+
+void VulkanRenderGraph::Init(VulkanDevices* devices)
+{
+	devices_ = devices;
+
+	QueueFamilyIndices indices = devices_->GetQueueFamilyIndices();
+	vkGetDeviceQueue(devices_->GetLogicalDevice(), indices.graphics_family, 0, &graphics_queue_);
+	vkGetDeviceQueue(devices_->GetLogicalDevice(), indices.compute_family, 0, &compute_queue_);
+
+	// the graph records its own barrier command buffers, once per compilation
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.queueFamilyIndex = indices.graphics_family;
+	pool_info.flags = 0;
+
+	if (vkCreateCommandPool(devices_->GetLogicalDevice(), &pool_info, nullptr, &graphics_command_pool_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create render graph command pool!");
+	}
+
+	pool_info.queueFamilyIndex = indices.compute_family;
+
+	if (vkCreateCommandPool(devices_->GetLogicalDevice(), &pool_info, nullptr, &compute_command_pool_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create render graph command pool!");
+	}
+}
+
+void VulkanRenderGraph::Cleanup()
+{
+	DestroyCompiledState();
+
+	vkDestroyCommandPool(devices_->GetLogicalDevice(), graphics_command_pool_, nullptr);
+	vkDestroyCommandPool(devices_->GetLogicalDevice(), compute_command_pool_, nullptr);
+
+	// the transient targets are cleaned up by their owners, only the memory they share belongs to the graph
+	for (MemoryAllocation& heap : transient_heaps_)
+	{
+		devices_->FreeMemory(heap);
+	}
+	transient_heaps_.clear();
+
+	passes_.clear();
+	resource_names_.clear();
+	output_resources_.clear();
+	resource_targets_.clear();
+	transient_targets_.clear();
+	devices_ = nullptr;
+}
+
+void VulkanRenderGraph::Reset()
+{
+	if (compiled_)
+	{
+		vkDeviceWaitIdle(devices_->GetLogicalDevice());
+		devices_->CountIdleWait();
+		DestroyCompiledState();
+	}
+
+	passes_.clear();
+	resource_names_.clear();
+	output_resources_.clear();
+	resource_targets_.clear();
+	transient_targets_.clear();
+	profiler_ = nullptr;
+	dirty_ = true;
+}
+
+RenderGraphHandle VulkanRenderGraph::AddResource(std::string name, VulkanRenderTarget* render_target)
+{
+	resource_names_.push_back(name);
+	output_resources_.push_back(false);
+	resource_targets_.push_back(render_target);
+	dirty_ = true;
+
+	return static_cast<RenderGraphHandle>(resource_names_.size() - 1);
+}
+
+RenderGraphHandle VulkanRenderGraph::AddPass(std::string name, RenderGraphQueue queue_type, VkCommandBuffer command_buffer)
+{
+	Pass pass = {};
+	pass.name = name;
+	pass.queue_type = queue_type;
+	pass.command_buffer = command_buffer;
+	pass.enabled = true;
+	pass.culled = true;
+	pass.barrier_command_buffer = VK_NULL_HANDLE;
+	pass.profiler_scope = 0;
+
+	passes_.push_back(pass);
+	dirty_ = true;
+
+	return static_cast<RenderGraphHandle>(passes_.size() - 1);
+}
+
+void VulkanRenderGraph::AddRead(RenderGraphHandle pass, RenderGraphHandle resource, VkPipelineStageFlags stages, VkAccessFlags access)
+{
+	passes_[pass].accesses.push_back({ resource, stages, access, false });
+	dirty_ = true;
+}
+
+void VulkanRenderGraph::AddWrite(RenderGraphHandle pass, RenderGraphHandle resource, VkPipelineStageFlags stages, VkAccessFlags access)
+{
+	passes_[pass].accesses.push_back({ resource, stages, access, true });
+	dirty_ = true;
+}
+
+void VulkanRenderGraph::SetOutput(RenderGraphHandle resource)
+{
+	output_resources_[resource] = true;
+	dirty_ = true;
+}
+
+void VulkanRenderGraph::SetProfiler(VulkanGpuProfiler* profiler)
+{
+	profiler_ = profiler;
+
+	// every pass is timed by timestamps submitted either side of its command buffer
+	QueueFamilyIndices indices = devices_->GetQueueFamilyIndices();
+	for (Pass& pass : passes_)
+	{
+		bool graphics = pass.queue_type == RenderGraphQueue::GRAPHICS;
+
+		pass.profiler_scope = profiler_->AddScope(pass.name, graphics ? indices.graphics_family : indices.compute_family);
+		profiler_->CreateScopeCommandBuffers(pass.profiler_scope, graphics ? graphics_command_pool_ : compute_command_pool_);
+	}
+}
+
+double VulkanRenderGraph::GetPassTime(RenderGraphHandle pass)
+{
+	if (!profiler_)
+		return 0.0;
+
+	return profiler_->GetScopeTime(passes_[pass].profiler_scope);
+}
+
+double VulkanRenderGraph::GetLastPassTime(RenderGraphHandle pass)
+{
+	if (!profiler_)
+		return 0.0;
+
+	return profiler_->GetLastScopeTime(passes_[pass].profiler_scope);
+}
+
+void VulkanRenderGraph::AllocateTransientTargets()
+{
+	transient_targets_.clear();
+
+	// find the first and last pass using each target, every declared pass counts so that enabling a pass never extends a lifetime
+	for (RenderGraphHandle resource = 0; resource < resource_targets_.size(); resource++)
+	{
+		VulkanRenderTarget* render_target = resource_targets_[resource];
+		if (!render_target || !render_target->IsTransient())
+			continue;
+
+		auto target = std::find_if(transient_targets_.begin(), transient_targets_.end(), [render_target](const TransientTarget& transient_target) { return transient_target.render_target == render_target; });
+		if (target == transient_targets_.end())
+		{
+			TransientTarget transient_target = {};
+			transient_target.render_target = render_target;
+			transient_target.name = resource_names_[resource];
+			transient_target.first_pass = static_cast<RenderGraphHandle>(passes_.size());
+			transient_target.last_pass = 0;
+			transient_target.requirements = render_target->GetMemoryRequirements();
+			transient_target.memory_type = devices_->FindMemoryType(transient_target.requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, transient_target.requirements.size);
+
+			transient_targets_.push_back(transient_target);
+			target = transient_targets_.end() - 1;
+		}
+
+		for (RenderGraphHandle pass = 0; pass < passes_.size(); pass++)
+		{
+			for (const ResourceAccess& access : passes_[pass].accesses)
+			{
+				if (access.resource != resource)
+					continue;
+
+				target->first_pass = std::min(target->first_pass, pass);
+				target->last_pass = std::max(target->last_pass, pass);
+			}
+		}
+	}
+
+	// a target no pass uses is alive for the whole frame so it never shares memory
+	for (TransientTarget& target : transient_targets_)
+	{
+		if (target.first_pass > target.last_pass)
+		{
+			target.first_pass = 0;
+			target.last_pass = static_cast<RenderGraphHandle>(passes_.size());
+		}
+	}
+
+	// place the largest targets first, each heap is as large as the furthest placed target
+	std::sort(transient_targets_.begin(), transient_targets_.end(), [](const TransientTarget& a, const TransientTarget& b) { return a.requirements.size > b.requirements.size; });
+
+	std::vector<VkMemoryRequirements> heap_requirements;
+	std::vector<uint32_t> heap_types;
+
+	statistics_.transient_target_count = static_cast<uint32_t>(transient_targets_.size());
+	statistics_.aliased_target_count = 0;
+	statistics_.transient_bytes = 0;
+	statistics_.aliased_bytes = 0;
+
+	for (uint32_t i = 0; i < transient_targets_.size(); i++)
+	{
+		TransientTarget& target = transient_targets_[i];
+		target.offset = FindTransientOffset(target, i);
+
+		auto heap_type = std::find(heap_types.begin(), heap_types.end(), target.memory_type);
+		target.heap = static_cast<uint32_t>(heap_type - heap_types.begin());
+
+		if (heap_type == heap_types.end())
+		{
+			VkMemoryRequirements requirements = {};
+			requirements.alignment = 1;
+			requirements.memoryTypeBits = 1u << target.memory_type;
+
+			heap_types.push_back(target.memory_type);
+			heap_requirements.push_back(requirements);
+		}
+
+		VkMemoryRequirements& requirements = heap_requirements[target.heap];
+		requirements.size = std::max(requirements.size, target.offset + target.requirements.size);
+		requirements.alignment = std::max(requirements.alignment, target.requirements.alignment);
+
+		statistics_.transient_bytes += target.requirements.size;
+	}
+
+	// allocate the shared memory and bind each target to its place in it
+	size_t first_heap = transient_heaps_.size();
+	for (uint32_t i = 0; i < heap_requirements.size(); i++)
+	{
+		transient_heaps_.push_back(devices_->GetMemoryAllocator()->Allocate(heap_requirements[i], heap_types[i], true, AllocationStrategy::LINEAR));
+		statistics_.aliased_bytes += heap_requirements[i].size;
+	}
+
+	for (TransientTarget& target : transient_targets_)
+	{
+		const MemoryAllocation& heap = transient_heaps_[first_heap + target.heap];
+		target.render_target->BindMemory(heap.memory, heap.offset + target.offset);
+	}
+
+	// passes using targets that overlap in memory are ordered as if they used the same resource
+	for (uint32_t i = 0; i < transient_targets_.size(); i++)
+	{
+		for (uint32_t j = i + 1; j < transient_targets_.size(); j++)
+		{
+			TransientTarget& a = transient_targets_[i];
+			TransientTarget& b = transient_targets_[j];
+
+			if (a.heap != b.heap || a.offset >= b.offset + b.requirements.size || b.offset >= a.offset + a.requirements.size)
+				continue;
+
+			if (a.first_pass < b.first_pass)
+				AddAliasAccesses(a, b);
+			else
+				AddAliasAccesses(b, a);
+
+			a.aliased = true;
+			b.aliased = true;
+		}
+	}
+
+	for (const TransientTarget& target : transient_targets_)
+	{
+		if (target.aliased)
+			statistics_.aliased_target_count++;
+	}
+
+	dirty_ = true;
+}
+
+VkDeviceSize VulkanRenderGraph::FindTransientOffset(const TransientTarget& target, uint32_t placed_count)
+{
+	VkDeviceSize alignment = target.requirements.alignment;
+	VkDeviceSize offset = 0;
+
+	// move past every placed target that is alive at the same time until the range is free
+	bool moved = true;
+	while (moved)
+	{
+		moved = false;
+		for (uint32_t i = 0; i < placed_count; i++)
+		{
+			const TransientTarget& placed = transient_targets_[i];
+			if (placed.memory_type != target.memory_type || placed.last_pass < target.first_pass || target.last_pass < placed.first_pass)
+				continue;
+
+			if (offset < placed.offset + placed.requirements.size && placed.offset < offset + target.requirements.size)
+			{
+				offset = (placed.offset + placed.requirements.size + alignment - 1) / alignment * alignment;
+				moved = true;
+			}
+		}
+	}
+
+	return offset;
+}
+
+void VulkanRenderGraph::AddAliasAccesses(const TransientTarget& earlier, const TransientTarget& later)
+{
+	RenderGraphHandle alias = AddResource(earlier.name + " / " + later.name + " memory");
+
+	// every access to either target also accesses the memory they share
+	for (Pass& pass : passes_)
+	{
+		size_t access_count = pass.accesses.size();
+		for (size_t i = 0; i < access_count; i++)
+		{
+			ResourceAccess access = pass.accesses[i];
+			VulkanRenderTarget* render_target = resource_targets_[access.resource];
+
+			if (render_target == earlier.render_target || render_target == later.render_target)
+			{
+				access.resource = alias;
+				pass.accesses.push_back(access);
+			}
+		}
+	}
+}
+
+void VulkanRenderGraph::SetPassEnabled(RenderGraphHandle pass, bool enabled)
+{
+	// enabling or disabling a pass changes which passes are live
+	if (passes_[pass].enabled != enabled)
+	{
+		passes_[pass].enabled = enabled;
+		dirty_ = true;
+	}
+}
+
+void VulkanRenderGraph::SetCommandBuffer(RenderGraphHandle pass, VkCommandBuffer command_buffer)
+{
+	passes_[pass].command_buffer = command_buffer;
+}
+
+void VulkanRenderGraph::AddExternalWait(RenderGraphHandle pass, VkSemaphore semaphore, VkPipelineStageFlags stages)
+{
+	if (semaphore == VK_NULL_HANDLE)
+		return;
+
+	passes_[pass].external_wait_semaphores.push_back(semaphore);
+	passes_[pass].external_wait_stages.push_back(stages);
+}
+
+void VulkanRenderGraph::Compile()
+{
+	TRACE_FUNCTION();
+
+	// the compiled barriers and semaphores may still be in use by frames in flight
+	if (compiled_)
+	{
+		vkDeviceWaitIdle(devices_->GetLogicalDevice());
+		devices_->CountIdleWait();
+		DestroyCompiledState();
+	}
+
+	CullPasses();
+	SchedulePasses();
+	CreateSynchronisation();
+
+	statistics_.pass_count = static_cast<uint32_t>(passes_.size());
+	statistics_.culled_pass_count = static_cast<uint32_t>(passes_.size() - execution_order_.size());
+	statistics_.semaphore_count = static_cast<uint32_t>(semaphores_.size());
+
+	compiled_ = true;
+	dirty_ = false;
+}
+
+void VulkanRenderGraph::CullPasses()
+{
+	// walk backwards from the outputs, a pass is live when it writes a resource that a later live pass reads
+	std::vector<bool> needed_resources = output_resources_;
+
+	for (int i = static_cast<int>(passes_.size()) - 1; i >= 0; i--)
+	{
+		Pass& pass = passes_[i];
+		pass.culled = true;
+
+		if (!pass.enabled)
+			continue;
+
+		for (const ResourceAccess& access : pass.accesses)
+		{
+			if (access.write && needed_resources[access.resource])
+				pass.culled = false;
+		}
+
+		if (pass.culled)
+			continue;
+
+		// writes replace the earlier contents unless the pass also reads them, e.g. a load op
+		for (const ResourceAccess& access : pass.accesses)
+		{
+			if (access.write)
+				needed_resources[access.resource] = false;
+		}
+
+		for (const ResourceAccess& access : pass.accesses)
+		{
+			if (!access.write)
+				needed_resources[access.resource] = true;
+		}
+	}
+}
+
+void VulkanRenderGraph::SchedulePasses()
+{
+	// a live pass depends on every earlier live pass it shares a resource with, unless both only read it
+	std::vector<std::vector<RenderGraphHandle>> dependents(passes_.size());
+	std::vector<uint32_t> dependency_counts(passes_.size(), 0);
+
+	for (RenderGraphHandle i = 0; i < passes_.size(); i++)
+	{
+		if (passes_[i].culled)
+			continue;
+
+		for (RenderGraphHandle j = i + 1; j < passes_.size(); j++)
+		{
+			if (passes_[j].culled)
+				continue;
+
+			bool dependent = false;
+			for (const ResourceAccess& earlier : passes_[i].accesses)
+			{
+				for (const ResourceAccess& later : passes_[j].accesses)
+				{
+					if (earlier.resource == later.resource && (earlier.write || later.write))
+						dependent = true;
+				}
+			}
+
+			if (dependent)
+			{
+				dependents[i].push_back(j);
+				dependency_counts[j]++;
+			}
+		}
+	}
+
+	// order the live passes, preferring to stay on the current queue so that passes batch into fewer submissions
+	execution_order_.clear();
+	std::vector<bool> scheduled(passes_.size(), false);
+	VkQueue current_queue = VK_NULL_HANDLE;
+
+	uint32_t live_count = 0;
+	for (const Pass& pass : passes_)
+	{
+		if (!pass.culled)
+			live_count++;
+	}
+
+	while (execution_order_.size() < live_count)
+	{
+		RenderGraphHandle next = static_cast<RenderGraphHandle>(passes_.size());
+		for (RenderGraphHandle i = 0; i < passes_.size(); i++)
+		{
+			if (passes_[i].culled || scheduled[i] || dependency_counts[i] > 0)
+				continue;
+
+			if (next == passes_.size())
+				next = i;
+
+			if (GetQueue(passes_[i].queue_type) == current_queue)
+			{
+				next = i;
+				break;
+			}
+		}
+
+		scheduled[next] = true;
+		execution_order_.push_back(next);
+		current_queue = GetQueue(passes_[next].queue_type);
+
+		for (RenderGraphHandle dependent : dependents[next])
+			dependency_counts[dependent]--;
+	}
+
+	// consecutive passes on the same queue share a submission
+	batches_.clear();
+	for (RenderGraphHandle pass : execution_order_)
+	{
+		if (batches_.empty() || GetQueue(batches_.back().queue_type) != GetQueue(passes_[pass].queue_type))
+			batches_.push_back({ passes_[pass].queue_type, {} });
+
+		batches_.back().passes.push_back(pass);
+	}
+}
+
+void VulkanRenderGraph::FindPreviousAccesses(RenderGraphHandle resource, uint32_t position, bool write, std::vector<PreviousAccess>& previous_accesses)
+{
+	previous_accesses.clear();
+
+	// search backwards through this execution, then wrap around to the end of the previous one
+	uint32_t pass_count = static_cast<uint32_t>(execution_order_.size());
+	for (uint32_t offset = 1; offset < pass_count; offset++)
+	{
+		uint32_t previous_position = (position + pass_count - offset) % pass_count;
+		RenderGraphHandle previous_pass = execution_order_[previous_position];
+		bool previous_frame = previous_position > position;
+
+		bool found_write = false;
+		for (const ResourceAccess& access : passes_[previous_pass].accesses)
+		{
+			if (access.resource != resource)
+				continue;
+
+			// reads only need to wait for the last write, writes must also wait for the reads since
+			if (access.write || write)
+				previous_accesses.push_back({ previous_pass, &access, previous_frame });
+
+			found_write |= access.write;
+		}
+
+		if (found_write)
+			break;
+	}
+}
+
+void VulkanRenderGraph::CreateSynchronisation()
+{
+	statistics_.barrier_count = 0;
+
+	// the contents of aliased targets do not survive the other targets' passes
+	std::vector<bool> initialized_targets(transient_targets_.size(), false);
+
+	for (uint32_t position = 0; position < execution_order_.size(); position++)
+	{
+		RenderGraphHandle pass_handle = execution_order_[position];
+		Pass& pass = passes_[pass_handle];
+		VkQueue queue = GetQueue(pass.queue_type);
+
+		// semaphore stages for each earlier pass on another queue
+		std::vector<VkPipelineStageFlags> semaphore_stages(passes_.size(), 0);
+
+		for (const ResourceAccess& access : pass.accesses)
+		{
+			FindPreviousAccesses(access.resource, position, access.write, previous_accesses_);
+
+			for (const PreviousAccess& previous : previous_accesses_)
+			{
+				if (GetQueue(passes_[previous.pass].queue_type) == queue)
+				{
+					// write after read hazards only need an execution dependency
+					if (previous.access->write)
+						barrier_batch_.AddMemoryBarrier(previous.access->stages, previous.access->access, access.stages, access.access);
+					else
+						barrier_batch_.AddMemoryBarrier(previous.access->stages, 0, access.stages, 0);
+				}
+				else if (!previous.previous_frame)
+				{
+					// semaphores carry a full memory dependency, passes on other queues in consecutive frames are ordered by the frame's own waits
+					semaphore_stages[previous.pass] |= access.stages;
+				}
+			}
+		}
+
+		// the first pass using an aliased target discards whatever the memory held
+		for (uint32_t i = 0; i < transient_targets_.size(); i++)
+		{
+			VulkanRenderTarget* render_target = transient_targets_[i].render_target;
+			if (!transient_targets_[i].aliased || initialized_targets[i])
+				continue;
+
+			for (const ResourceAccess& access : pass.accesses)
+			{
+				if (resource_targets_[access.resource] == render_target)
+					initialized_targets[i] = true;
+			}
+
+			if (!initialized_targets[i])
+				continue;
+
+			for (VkImage image : render_target->GetImages())
+			{
+				barrier_batch_.TransitionImage(image, render_target->GetImageAspect(), VK_IMAGE_LAYOUT_UNDEFINED, render_target->GetImageLayout());
+			}
+		}
+
+		// record the barriers for this pass once, they are submitted ahead of its command buffer every frame
+		if (!barrier_batch_.IsEmpty())
+		{
+			VkCommandPool command_pool = (pass.queue_type == RenderGraphQueue::GRAPHICS) ? graphics_command_pool_ : compute_command_pool_;
+			devices_->CreateCommandBuffers(command_pool, &pass.barrier_command_buffer);
+
+			VkCommandBufferBeginInfo begin_info = {};
+			begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+
+			vkBeginCommandBuffer(pass.barrier_command_buffer, &begin_info);
+			barrier_batch_.Record(pass.barrier_command_buffer);
+
+			if (vkEndCommandBuffer(pass.barrier_command_buffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to record render graph barrier command buffer!");
+			}
+
+			statistics_.barrier_count++;
+		}
+
+		// create a semaphore for each cross queue dependency
+		VkSemaphoreCreateInfo semaphore_info = {};
+		semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		for (RenderGraphHandle previous_pass = 0; previous_pass < passes_.size(); previous_pass++)
+		{
+			if (semaphore_stages[previous_pass] == 0)
+				continue;
+
+			VkSemaphore semaphore;
+			if (vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &semaphore) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render graph semaphore!");
+			}
+
+			semaphores_.push_back(semaphore);
+			passes_[previous_pass].signal_semaphores.push_back(semaphore);
+			pass.wait_semaphores.push_back(semaphore);
+			pass.wait_stages.push_back(semaphore_stages[previous_pass]);
+		}
+	}
+}
+
+void VulkanRenderGraph::DestroyCompiledState()
+{
+	for (Pass& pass : passes_)
+	{
+		if (pass.barrier_command_buffer != VK_NULL_HANDLE)
+		{
+			VkCommandPool command_pool = (pass.queue_type == RenderGraphQueue::GRAPHICS) ? graphics_command_pool_ : compute_command_pool_;
+			vkFreeCommandBuffers(devices_->GetLogicalDevice(), command_pool, 1, &pass.barrier_command_buffer);
+			pass.barrier_command_buffer = VK_NULL_HANDLE;
+		}
+
+		pass.wait_semaphores.clear();
+		pass.wait_stages.clear();
+		pass.signal_semaphores.clear();
+	}
+
+	for (VkSemaphore semaphore : semaphores_)
+	{
+		vkDestroySemaphore(devices_->GetLogicalDevice(), semaphore, nullptr);
+	}
+
+	semaphores_.clear();
+	execution_order_.clear();
+	batches_.clear();
+	compiled_ = false;
+}
+
+void VulkanRenderGraph::Execute(VkSemaphore signal_semaphore, VkFence fence)
+{
+	TRACE_FUNCTION();
+
+	if (dirty_)
+		Compile();
+
+	statistics_.submit_count = 0;
+
+	for (size_t i = 0; i < batches_.size(); i++)
+	{
+		bool last_batch = (i == batches_.size() - 1);
+		SubmitBatch(batches_[i], last_batch ? signal_semaphore : VK_NULL_HANDLE, last_batch ? fence : VK_NULL_HANDLE);
+	}
+
+	// external waits only apply to a single execution
+	for (Pass& pass : passes_)
+	{
+		pass.external_wait_semaphores.clear();
+		pass.external_wait_stages.clear();
+	}
+}
+
+void VulkanRenderGraph::SubmitBatch(const Batch& batch, VkSemaphore signal_semaphore, VkFence fence)
+{
+	submit_ranges_.clear();
+	submit_infos_.clear();
+	submit_command_buffers_.clear();
+	submit_wait_semaphores_.clear();
+	submit_wait_stages_.clear();
+	submit_signal_semaphores_.clear();
+
+	// passes share a submit info until one waits on a semaphore or the previous one signals one
+	bool previous_signals = false;
+	for (size_t i = 0; i < batch.passes.size(); i++)
+	{
+		Pass& pass = passes_[batch.passes[i]];
+		bool last_pass = (i == batch.passes.size() - 1);
+		bool waits = !pass.wait_semaphores.empty() || !pass.external_wait_semaphores.empty();
+
+		if (submit_infos_.empty() || waits || previous_signals)
+		{
+			VkSubmitInfo submit_info = {};
+			submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submit_infos_.push_back(submit_info);
+			submit_ranges_.push_back({ static_cast<uint32_t>(submit_command_buffers_.size()), static_cast<uint32_t>(submit_wait_semaphores_.size()), static_cast<uint32_t>(submit_signal_semaphores_.size()) });
+		}
+
+		VkSubmitInfo& submit_info = submit_infos_.back();
+
+		submit_wait_semaphores_.insert(submit_wait_semaphores_.end(), pass.wait_semaphores.begin(), pass.wait_semaphores.end());
+		submit_wait_stages_.insert(submit_wait_stages_.end(), pass.wait_stages.begin(), pass.wait_stages.end());
+		submit_wait_semaphores_.insert(submit_wait_semaphores_.end(), pass.external_wait_semaphores.begin(), pass.external_wait_semaphores.end());
+		submit_wait_stages_.insert(submit_wait_stages_.end(), pass.external_wait_stages.begin(), pass.external_wait_stages.end());
+		submit_info.waitSemaphoreCount += static_cast<uint32_t>(pass.wait_semaphores.size() + pass.external_wait_semaphores.size());
+
+		if (pass.barrier_command_buffer != VK_NULL_HANDLE)
+		{
+			submit_command_buffers_.push_back(pass.barrier_command_buffer);
+			submit_info.commandBufferCount++;
+		}
+
+		// the pass is timed after its barriers have been waited on
+		VkCommandBuffer begin_timestamp = profiler_ ? profiler_->GetBeginCommandBuffer(pass.profiler_scope) : VK_NULL_HANDLE;
+		VkCommandBuffer end_timestamp = profiler_ ? profiler_->GetEndCommandBuffer(pass.profiler_scope) : VK_NULL_HANDLE;
+
+		if (begin_timestamp != VK_NULL_HANDLE)
+		{
+			submit_command_buffers_.push_back(begin_timestamp);
+			submit_info.commandBufferCount++;
+		}
+
+		if (pass.command_buffer != VK_NULL_HANDLE)
+		{
+			submit_command_buffers_.push_back(pass.command_buffer);
+			submit_info.commandBufferCount++;
+		}
+
+		if (end_timestamp != VK_NULL_HANDLE)
+		{
+			submit_command_buffers_.push_back(end_timestamp);
+			submit_info.commandBufferCount++;
+		}
+
+		submit_signal_semaphores_.insert(submit_signal_semaphores_.end(), pass.signal_semaphores.begin(), pass.signal_semaphores.end());
+		submit_info.signalSemaphoreCount += static_cast<uint32_t>(pass.signal_semaphores.size());
+
+		if (last_pass && signal_semaphore != VK_NULL_HANDLE)
+		{
+			submit_signal_semaphores_.push_back(signal_semaphore);
+			submit_info.signalSemaphoreCount++;
+		}
+
+		previous_signals = !pass.signal_semaphores.empty();
+	}
+
+	// the scratch arrays are complete so the pointers into them are now stable
+	for (size_t i = 0; i < submit_infos_.size(); i++)
+	{
+		submit_infos_[i].pCommandBuffers = submit_command_buffers_.data() + submit_ranges_[i].first_command_buffer;
+		submit_infos_[i].pWaitSemaphores = submit_wait_semaphores_.data() + submit_ranges_[i].first_wait;
+		submit_infos_[i].pWaitDstStageMask = submit_wait_stages_.data() + submit_ranges_[i].first_wait;
+		submit_infos_[i].pSignalSemaphores = submit_signal_semaphores_.data() + submit_ranges_[i].first_signal;
+	}
+
+	if (vkQueueSubmit(GetQueue(batch.queue_type), static_cast<uint32_t>(submit_infos_.size()), submit_infos_.data(), fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit render graph batch!");
+	}
+
+	statistics_.submit_count++;
+	devices_->CountQueueSubmit(static_cast<uint32_t>(submit_infos_.size()));
+}
\ No newline at end of file
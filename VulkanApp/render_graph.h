@@ -0,0 +1,201 @@
+#ifndef _RENDER_GRAPH_H_
+#define _RENDER_GRAPH_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+
+#include "barrier_batch.h"
+#include "memory_allocator.h"
+
+class VulkanDevices;
+class VulkanRenderTarget;
+class VulkanGpuProfiler;
+
+// identifies a pass or resource declared in the graph
+typedef uint32_t RenderGraphHandle;
+
+enum class RenderGraphQueue
+{
+	GRAPHICS,
+	COMPUTE
+};
+
+struct RenderGraphStatistics
+{
+	uint32_t pass_count;
+	uint32_t culled_pass_count;
+	uint32_t barrier_count;		// passes preceded by a graph generated pipeline barrier
+	uint32_t semaphore_count;	// cross queue dependencies
+	uint32_t submit_count;		// vkQueueSubmit calls made by the last execution
+
+	// transient render targets
+	uint32_t transient_target_count;
+	uint32_t aliased_target_count;		// targets sharing memory with at least one other target
+	VkDeviceSize transient_bytes;		// memory the targets would need on their own
+	VkDeviceSize aliased_bytes;			// memory allocated for them
+};
+
+// schedules pre-recorded passes from the resources they declare, deriving the barriers and
+// semaphores between them, culling passes whose results are never read and batching the
+// remaining passes into as few queue submissions as possible
+class VulkanRenderGraph
+{
+protected:
+	struct ResourceAccess
+	{
+		RenderGraphHandle resource;
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		bool write;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		RenderGraphQueue queue_type;
+		VkCommandBuffer command_buffer;
+		std::vector<ResourceAccess> accesses;
+		bool enabled;
+
+		// compiled state
+		bool culled;
+		VkCommandBuffer barrier_command_buffer;
+		std::vector<VkSemaphore> wait_semaphores;
+		std::vector<VkPipelineStageFlags> wait_stages;
+		std::vector<VkSemaphore> signal_semaphores;
+
+		// semaphores waited on for this execution only
+		std::vector<VkSemaphore> external_wait_semaphores;
+		std::vector<VkPipelineStageFlags> external_wait_stages;
+
+		// timestamps written either side of the pass
+		uint32_t profiler_scope;
+	};
+
+	struct PreviousAccess
+	{
+		RenderGraphHandle pass;
+		const ResourceAccess* access;
+		bool previous_frame;	// the access belongs to the previous execution of the graph
+	};
+
+	struct SubmitRange
+	{
+		uint32_t first_command_buffer, first_wait, first_signal;
+	};
+
+	struct Batch
+	{
+		RenderGraphQueue queue_type;
+		std::vector<RenderGraphHandle> passes;
+	};
+
+	struct TransientTarget
+	{
+		VulkanRenderTarget* render_target;
+		std::string name;
+		RenderGraphHandle first_pass, last_pass;	// lifetime in declaration order
+		VkMemoryRequirements requirements;
+		uint32_t memory_type;
+		uint32_t heap;
+		VkDeviceSize offset;
+		bool aliased;
+	};
+
+public:
+	VulkanRenderGraph();
+
+	void Init(VulkanDevices* devices);
+	void Cleanup();
+
+	// remove every pass and resource so the graph can be declared again
+	void Reset();
+
+	// declare the graph, passes are declared in the order they would run on a single queue
+	RenderGraphHandle AddResource(std::string name, VulkanRenderTarget* render_target = nullptr);
+	RenderGraphHandle AddPass(std::string name, RenderGraphQueue queue_type, VkCommandBuffer command_buffer = VK_NULL_HANDLE);
+	void AddRead(RenderGraphHandle pass, RenderGraphHandle resource, VkPipelineStageFlags stages, VkAccessFlags access);
+	void AddWrite(RenderGraphHandle pass, RenderGraphHandle resource, VkPipelineStageFlags stages, VkAccessFlags access);
+
+	// resources consumed outside the graph, passes that do not contribute to one are culled
+	void SetOutput(RenderGraphHandle resource);
+
+	// time every declared pass with the profiler's timestamp queries, called once the graph is declared
+	void SetProfiler(VulkanGpuProfiler* profiler);
+
+	// bind the transient render targets behind the declared resources, targets whose lifetimes do not
+	// overlap share memory, called once the graph is declared and before the targets' image views are used
+	void AllocateTransientTargets();
+
+	// per frame state
+	void SetPassEnabled(RenderGraphHandle pass, bool enabled);
+	void SetCommandBuffer(RenderGraphHandle pass, VkCommandBuffer command_buffer);
+	void AddExternalWait(RenderGraphHandle pass, VkSemaphore semaphore, VkPipelineStageFlags stages);
+
+	// derive the execution order and synchronisation, called by Execute when the graph has changed
+	void Compile();
+
+	// submit every live pass, the last submission signals the semaphore and fence
+	void Execute(VkSemaphore signal_semaphore, VkFence fence);
+
+	// gpu milliseconds, averaged over the profiler's recent frames or from its latest result
+	double GetPassTime(RenderGraphHandle pass);
+	double GetLastPassTime(RenderGraphHandle pass);
+
+	inline bool IsPassCulled(RenderGraphHandle pass) { return passes_[pass].culled; }
+	inline const std::string& GetPassName(RenderGraphHandle pass) { return passes_[pass].name; }
+	inline RenderGraphStatistics GetStatistics() { return statistics_; }
+
+protected:
+	void CullPasses();
+	void SchedulePasses();
+	void CreateSynchronisation();
+	void DestroyCompiledState();
+
+	// find the accesses a pass at position in the execution order must wait for, the last write and, for writes, every read since
+	void FindPreviousAccesses(RenderGraphHandle resource, uint32_t position, bool write, std::vector<PreviousAccess>& previous_accesses);
+
+	void SubmitBatch(const Batch& batch, VkSemaphore signal_semaphore, VkFence fence);
+
+	// place a transient target at the lowest offset not used by a target that is alive at the same time
+	VkDeviceSize FindTransientOffset(const TransientTarget& target, uint32_t placed_count);
+	void AddAliasAccesses(const TransientTarget& earlier, const TransientTarget& later);
+
+	inline VkQueue GetQueue(RenderGraphQueue queue_type) { return queue_type == RenderGraphQueue::GRAPHICS ? graphics_queue_ : compute_queue_; }
+
+protected:
+	VulkanDevices* devices_;
+	VkQueue graphics_queue_, compute_queue_;
+	VkCommandPool graphics_command_pool_, compute_command_pool_;
+	VulkanGpuProfiler* profiler_;
+
+	std::vector<Pass> passes_;
+	std::vector<std::string> resource_names_;
+	std::vector<bool> output_resources_;
+	std::vector<VulkanRenderTarget*> resource_targets_;
+
+	// transient render targets and the memory they share
+	std::vector<TransientTarget> transient_targets_;
+	std::vector<MemoryAllocation> transient_heaps_;
+
+	// compiled state, rebuilt when the declaration or the enabled passes change
+	bool compiled_;
+	bool dirty_;
+	std::vector<RenderGraphHandle> execution_order_;
+	std::vector<Batch> batches_;
+	std::vector<VkSemaphore> semaphores_;
+	VulkanBarrierBatch barrier_batch_;
+	RenderGraphStatistics statistics_;
+
+	// scratch storage for building submissions
+	std::vector<PreviousAccess> previous_accesses_;
+	std::vector<SubmitRange> submit_ranges_;
+	std::vector<VkSubmitInfo> submit_infos_;
+	std::vector<VkCommandBuffer> submit_command_buffers_;
+	std::vector<VkSemaphore> submit_wait_semaphores_;
+	std::vector<VkPipelineStageFlags> submit_wait_stages_;
+	std::vector<VkSemaphore> submit_signal_semaphores_;
+};
+
+#endif
\ No newline at end of file
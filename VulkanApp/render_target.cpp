@@ -1,6 +1,8 @@
 #include "render_target.h"
+#include <algorithm>
+#include <stdexcept>
 
-void VulkanRenderTarget::Init(VulkanDevices* devices, VkFormat format, uint32_t width, uint32_t height, uint32_t count, bool depth_enabled, VkSampleCountFlagBits sample_count)
+void VulkanRenderTarget::Init(VulkanDevices* devices, VkFormat format, uint32_t width, uint32_t height, uint32_t count, bool depth_enabled, VkSampleCountFlagBits sample_count, bool transient)
 {
 	devices_ = devices;
 
@@ -9,24 +11,31 @@ void VulkanRenderTarget::Init(VulkanDevices* devices, VkFormat format, uint32_t
 	render_target_image_memories_.resize(count);
 	render_target_format_ = format;
 	render_target_sample_count_ = sample_count;
+	render_target_depth_image_memory_ = {};
+	transient_ = transient;
+
+	if (transient && depth_enabled)
+	{
+		throw std::runtime_error("failed to create render target, transient render targets can not have a depth buffer!");
+	}
 
 	// create render targets
 	for (int i = 0; i < count; i++)
 	{
-		if (format == VK_FORMAT_D32_SFLOAT)
-		{
-			devices->CreateImage(width, height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, sample_count, render_target_images_[i], render_target_image_memories_[i]);
-			render_target_image_views_[i] = devices->CreateImageView(render_target_images_[i], format, VK_IMAGE_ASPECT_DEPTH_BIT);
-			devices->TransitionImageLayout(render_target_images_[i], format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
-		}
+		VkImageUsageFlags usage = (format == VK_FORMAT_D32_SFLOAT) ?
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT :
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+
+		// transient render targets are bound to memory shared with other targets once their lifetimes are known
+		if (transient)
+			devices->CreateUnboundImage(width, height, format, VK_IMAGE_TILING_OPTIMAL, usage, sample_count, render_target_images_[i]);
 		else
-		{
-			devices->CreateImage(width, height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, sample_count, render_target_images_[i], render_target_image_memories_[i]);
-			render_target_image_views_[i] = devices->CreateImageView(render_target_images_[i], format, VK_IMAGE_ASPECT_COLOR_BIT);
-			devices->TransitionImageLayout(render_target_images_[i], format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-		}
+			devices->CreateImage(width, height, format, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, sample_count, render_target_images_[i], render_target_image_memories_[i], AllocationStrategy::LINEAR);
 	}
 
+	if (!transient)
+		InitImageViews();
+
 	// if depth is enabled create depth buffer
 	if (depth_enabled)
 	{
@@ -36,12 +45,62 @@ void VulkanRenderTarget::Init(VulkanDevices* devices, VkFormat format, uint32_t
 			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
 		);
 
-		devices_->CreateImage(width, height, render_target_depth_format_, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, sample_count, render_target_depth_image_, render_target_depth_image_memory_);
+		devices_->CreateImage(width, height, render_target_depth_format_, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, sample_count, render_target_depth_image_, render_target_depth_image_memory_, AllocationStrategy::LINEAR);
 		render_target_depth_image_view_ = devices_->CreateImageView(render_target_depth_image_, render_target_depth_format_, VK_IMAGE_ASPECT_DEPTH_BIT);
 		devices_->TransitionImageLayout(render_target_depth_image_, render_target_depth_format_, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 	}
 }
 
+VkMemoryRequirements VulkanRenderTarget::GetMemoryRequirements()
+{
+	// the images are placed one after another in a single range
+	VkMemoryRequirements requirements = {};
+	requirements.alignment = 1;
+	requirements.memoryTypeBits = ~0u;
+
+	for (VkImage image : render_target_images_)
+	{
+		VkMemoryRequirements image_requirements;
+		vkGetImageMemoryRequirements(devices_->GetLogicalDevice(), image, &image_requirements);
+
+		requirements.size = (requirements.size + image_requirements.alignment - 1) / image_requirements.alignment * image_requirements.alignment;
+		requirements.size += image_requirements.size;
+		requirements.alignment = std::max(requirements.alignment, image_requirements.alignment);
+		requirements.memoryTypeBits &= image_requirements.memoryTypeBits;
+	}
+
+	return requirements;
+}
+
+void VulkanRenderTarget::BindMemory(VkDeviceMemory memory, VkDeviceSize offset)
+{
+	if (!transient_)
+	{
+		throw std::runtime_error("failed to bind render target memory, the render target already has memory!");
+	}
+
+	for (VkImage image : render_target_images_)
+	{
+		VkMemoryRequirements image_requirements;
+		vkGetImageMemoryRequirements(devices_->GetLogicalDevice(), image, &image_requirements);
+
+		offset = (offset + image_requirements.alignment - 1) / image_requirements.alignment * image_requirements.alignment;
+		vkBindImageMemory(devices_->GetLogicalDevice(), image, memory, offset);
+		offset += image_requirements.size;
+	}
+
+	InitImageViews();
+}
+
+void VulkanRenderTarget::InitImageViews()
+{
+	for (int i = 0; i < render_target_images_.size(); i++)
+	{
+		render_target_image_views_[i] = devices_->CreateImageView(render_target_images_[i], render_target_format_, GetImageAspect());
+		devices_->TransitionImageLayout(render_target_images_[i], render_target_format_, VK_IMAGE_LAYOUT_UNDEFINED, GetImageLayout());
+	}
+}
+
 void VulkanRenderTarget::Cleanup()
 {
 	// clean up render targets
@@ -49,13 +108,13 @@ void VulkanRenderTarget::Cleanup()
 	{
 		vkDestroyImage(devices_->GetLogicalDevice(), render_target_images_[i], nullptr);
 		vkDestroyImageView(devices_->GetLogicalDevice(), render_target_image_views_[i], nullptr);
-		vkFreeMemory(devices_->GetLogicalDevice(), render_target_image_memories_[i], nullptr);
+		devices_->FreeMemory(render_target_image_memories_[i]);
 	}
 
 	// clean up depth resources
 	vkDestroyImage(devices_->GetLogicalDevice(), render_target_depth_image_, nullptr);
 	vkDestroyImageView(devices_->GetLogicalDevice(), render_target_depth_image_view_, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), render_target_depth_image_memory_, nullptr);
+	devices_->FreeMemory(render_target_depth_image_memory_);
 }
 
 void VulkanRenderTarget::ClearImage(VkClearColorValue clear_color, int index)
@@ -9,8 +9,14 @@
 class VulkanRenderTarget
 {
 public:
-	void Init(VulkanDevices* devices, VkFormat format, uint32_t width, uint32_t height, uint32_t count, bool depth_enabled, VkSampleCountFlagBits sample_count = VK_SAMPLE_COUNT_1_BIT);
+	void Init(VulkanDevices* devices, VkFormat format, uint32_t width, uint32_t height, uint32_t count, bool depth_enabled, VkSampleCountFlagBits sample_count = VK_SAMPLE_COUNT_1_BIT, bool transient = false);
 	void Cleanup();
+
+	// transient render targets are created without memory, the render graph binds them to memory
+	// shared with the targets whose lifetimes within a frame do not overlap their own
+	VkMemoryRequirements GetMemoryRequirements();
+	void BindMemory(VkDeviceMemory memory, VkDeviceSize offset);
+	inline bool IsTransient() { return transient_; }
 	
 	void ClearImage(VkClearColorValue clear_color = { 0.0f, 0.0f, 0.0f, 0.0f }, int image_index = -1);
 	void ClearDepthImage(VkClearDepthStencilValue clear_value = { 1.0f, 0 }, int image_index = -1);
@@ -18,11 +24,11 @@ public:
 
 	inline std::vector<VkImage>& GetImages() { return render_target_images_; }
 	inline std::vector <VkImageView>& GetImageViews() { return render_target_image_views_; }
-	inline std::vector<VkDeviceMemory>& GetImageMemories() { return render_target_image_memories_; }
+	inline std::vector<MemoryAllocation>& GetImageMemories() { return render_target_image_memories_; }
 
 	inline VkImage GetDepthImage() { return render_target_depth_image_; }
 	inline VkImageView GetDepthImageView() { return render_target_depth_image_view_; }
-	inline VkDeviceMemory GetDepthImageMemory() { return render_target_depth_image_memory_; }
+	inline MemoryAllocation GetDepthImageMemory() { return render_target_depth_image_memory_; }
 
 	inline VkFormat GetRenderTargetFormat() { return render_target_format_; }
 	inline VkFormat GetRenderTargetDepthFormat() { return render_target_depth_format_; }
@@ -30,20 +36,28 @@ public:
 	inline int GetRenderTargetCount() { return render_target_images_.size(); }
 	inline VkSampleCountFlagBits GetSampleCount() { return render_target_sample_count_; }
 
+	// the images are kept in their attachment layout between passes
+	inline VkImageLayout GetImageLayout() { return (render_target_format_ == VK_FORMAT_D32_SFLOAT) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; }
+	inline VkImageAspectFlags GetImageAspect() { return (render_target_format_ == VK_FORMAT_D32_SFLOAT) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT; }
+
+protected:
+	void InitImageViews();
+
 protected:
 	VulkanDevices* devices_;
 
 	VkFormat render_target_format_;
 	std::vector<VkImage> render_target_images_;
-	std::vector<VkDeviceMemory> render_target_image_memories_;
+	std::vector<MemoryAllocation> render_target_image_memories_;
 	std::vector<VkImageView> render_target_image_views_;
 
 
 	VkFormat render_target_depth_format_;
 	VkImage render_target_depth_image_;
-	VkDeviceMemory render_target_depth_image_memory_;
+	MemoryAllocation render_target_depth_image_memory_;
 	VkImageView render_target_depth_image_view_;
 	VkSampleCountFlagBits render_target_sample_count_;
+	bool transient_;
 
 };
 
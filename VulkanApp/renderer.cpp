@@ -1,21 +1,37 @@
 #include "renderer.h"
+#include "trace_profiler.h"
 #include <chrono>
 #include <iostream>
 #include <fstream>
 #include <array>
 #include <map>
+#include <algorithm>
 
-void VulkanRenderer::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, int multisample_level)
+void VulkanRenderer::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, int multisample_level, uint32_t frames_in_flight, VertexFormat vertex_format)
 {
 	devices_ = devices;
 	swap_chain_ = swap_chain;
-	render_mode_ = RenderMode::VISIBILITY_PEELED;
-	performance_captures_remaining_ = 0;
-	visibility_time_ = 0;
-	shading_time_ = 0;
-	transparency_time_ = 0;
-	post_process_time_ = 0;
+	frames_in_flight_ = std::max(1u, std::min((uint32_t)MAX_FRAMES_IN_FLIGHT, frames_in_flight));
+	current_frame_ = 0;
+	frame_statistics_ = {};
+	frame_statistics_.frames_in_flight = frames_in_flight_;
+	current_frame_stats_ = {};
+	last_frame_stats_ = {};
+	frame_begin_activity_ = {};
+	frame_begin_uploaded_bytes_ = 0;
+	frame_begin_constant_bytes_ = 0;
+	render_mode_ = DEFAULT_RENDER_MODE;
+	visualised_render_mode_ = render_mode_;
+	buffer_visualisation_mode_ = BufferVisualisationMode::DEPTH;
+	buffer_visualisation_pipeline_ = nullptr;
+	pipelines_initialized_ = false;
+	performance_statistics_.Stop();
+	performance_warmup_frames_ = PERFORMANCE_WARMUP_FRAMES;
+	performance_sample_frames_ = PERFORMANCE_SAMPLE_FRAMES;
+	current_capture_point_ = 0;
+	last_cpu_frame_time_ = 0.0;
 	multisample_level_ = multisample_level;
+	vertex_format_ = vertex_format;
 	model_filename_ = "";
 
 	// load a default texture
@@ -29,530 +45,398 @@ void VulkanRenderer::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, i
 	CreatePrimitiveBuffer();
 	CreateMaterialBuffer();
 	CreateCommandPool();
-	CreateBuffers();
-	CreateSemaphores();
 
 	vkGetDeviceQueue(devices_->GetLogicalDevice(), devices_->GetQueueFamilyIndices().graphics_family, 0, &graphics_queue_);
 	vkGetDeviceQueue(devices_->GetLogicalDevice(), devices_->GetQueueFamilyIndices().compute_family, 0, &compute_queue_);
+
+	CreateBuffers();
+	CreateFrameResources();
+
+	// the render graph schedules every pass once the pipelines are initialized
+	render_graph_ = new VulkanRenderGraph();
+	render_graph_->Init(devices_);
+
+	// every pass and shadow map face is timed on the gpu
+	gpu_profiler_ = new VulkanGpuProfiler();
+	gpu_profiler_->Init(devices_, frames_in_flight_);
+
+	// the geometry and shading passes and shadow map faces count their primitives and shader invocations when the device supports it
+	pipeline_statistics_ = new VulkanPipelineStatistics();
+	pipeline_statistics_->Init(devices_, frames_in_flight_);
+
+	pipeline_builder_.Init();
 }
 
-void VulkanRenderer::RenderScene()
+void VulkanRenderer::BeginFrame()
 {
-	// set the render semaphore as the signal semaphore
-	current_signal_semaphore_ = render_semaphore_;
+	// the trace's frames begin as the renderer's do
+	TRACE_FRAME();
+	TRACE_FUNCTION();
 
-	// regenerate the shadow map for any moving light
-	for (Light* light : lights_)
+	FrameResources& frame = frames_[current_frame_];
+
+	// wait until the gpu has finished the last frame that used this frame's resources
+	auto wait_start = std::chrono::high_resolution_clock::now();
 	{
-		if (!light->GetLightStationary() && light->GetShadowsEnabled())
-			light->GenerateShadowMap(command_pool_, meshes_);
+		TRACE_SCOPE("wait for frame fence");
+		vkWaitForFences(devices_->GetLogicalDevice(), 1, &frame.fence, VK_TRUE, UINT64_MAX);
 	}
+	frame_begin_time_ = std::chrono::high_resolution_clock::now();
 
-	// get swap chain index
-	uint32_t image_index = swap_chain_->GetCurrentSwapChainImage();
-	VkExtent2D swap_extent = swap_chain_->GetIntermediateImageExtent();
+	frame_statistics_.fence_wait_time += std::chrono::duration<double, std::milli>(frame_begin_time_ - wait_start).count();
+
+	// the timestamps written the last time this frame's resources were used are now complete
+	gpu_profiler_->BeginFrame(current_frame_);
+	pipeline_statistics_->BeginFrame(current_frame_);
 
+	// the counters start from the device's totals, the culling counts carry over until a newer readback completes
+	FrameStats previous_frame_stats = current_frame_stats_;
+	current_frame_stats_ = {};
+	current_frame_stats_.culling_frame_number = previous_frame_stats.culling_frame_number;
+	current_frame_stats_.shape_count = previous_frame_stats.shape_count;
+	current_frame_stats_.visible_shapes = previous_frame_stats.visible_shapes;
+	current_frame_stats_.culled_shapes = previous_frame_stats.culled_shapes;
+	current_frame_stats_.drawn_indices = previous_frame_stats.drawn_indices;
 
-	if (render_mode_ == RenderMode::BUFFER_VIS)
+	frame_begin_activity_ = devices_->GetActivity();
+	frame_begin_uploaded_bytes_ = devices_->GetUploadManager()->GetStatistics().bytes_uploaded;
+	frame_begin_constant_bytes_ = frame_constants_->GetStatistics().bytes_written;
+
+	if (frame.culling_readback_pending)
+		ReadCullingResults(frame);
+
+	// the cpu overlaps the gpu when an earlier frame is still executing
+	for (uint32_t i = 1; i < frames_in_flight_; i++)
 	{
-		RenderVisualisation(image_index);
+		uint32_t earlier_frame = (current_frame_ + frames_in_flight_ - i) % frames_in_flight_;
+		if (vkGetFenceStatus(devices_->GetLogicalDevice(), frames_[earlier_frame].fence) == VK_NOT_READY)
+		{
+			frame_statistics_.overlapped_frames++;
+			break;
+		}
 	}
-	else
-	{
-		// send matrix data to the gpu
-		UniformBufferObject ubo = {};
-		ubo.model = glm::mat4(1.0f);
-		ubo.view = render_camera_->GetViewMatrix();
-		ubo.proj = render_camera_->GetProjectionMatrix();
 
-		devices_->CopyDataToBuffer(matrix_buffer_memory_, &ubo, sizeof(UniformBufferObject));
+	if (frame_statistics_.frame_count == 0)
+		first_frame_time_ = wait_start;
+
+	frame_statistics_.elapsed_time = std::chrono::duration<double, std::milli>(wait_start - first_frame_time_).count();
+	frame_statistics_.frame_count++;
+	current_frame_stats_.frame_number = frame_statistics_.frame_count;
+}
+
+void VulkanRenderer::EndFrame()
+{
+	TRACE_FUNCTION();
+
+	last_cpu_frame_time_ = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frame_begin_time_).count();
+	frame_statistics_.cpu_frame_time += last_cpu_frame_time_;
+
+	// everything submitted or waited on between beginning and ending the frame is counted as the frame's
+	DeviceActivity activity = devices_->GetActivity();
+	current_frame_stats_.queue_submits = activity.queue_submits - frame_begin_activity_.queue_submits;
+	current_frame_stats_.submitted_batches = activity.submitted_batches - frame_begin_activity_.submitted_batches;
+	current_frame_stats_.idle_waits = activity.idle_waits - frame_begin_activity_.idle_waits;
+	current_frame_stats_.uploaded_bytes = devices_->GetUploadManager()->GetStatistics().bytes_uploaded - frame_begin_uploaded_bytes_;
+	current_frame_stats_.constant_bytes = frame_constants_->GetStatistics().bytes_written - frame_begin_constant_bytes_;
+	last_frame_stats_ = current_frame_stats_;
+
+	// move on to the next set of frame resources
+	current_frame_ = (current_frame_ + 1) % frames_in_flight_;
+}
 
-		// send camera data to the gpu
-		SceneLightData scene_data = {};
-		scene_data.scene_data = glm::vec4(glm::vec3(0.1f, 0.1f, 0.1f), lights_.size());
-		//scene_data.scene_data = glm::vec4(glm::vec3(0.85f * 0.5f, 0.68f * 0.5f, 0.92f * 0.5f), lights_.size());
-		scene_data.camera_data = glm::vec4(render_camera_->GetPosition(), 1000.0f);
-		devices_->CopyDataToBuffer(light_buffer_memory_, &scene_data, sizeof(SceneLightData));
+void VulkanRenderer::RenderScene()
+{
+	TRACE_FUNCTION();
 
+	// regenerate the shadow map for any moving light
+	current_frame_stats_.light_count = static_cast<uint32_t>(lights_.size());
+	for (Light* light : lights_)
+	{
+		if (light->GetShadowsEnabled())
+			current_frame_stats_.shadow_casting_lights++;
 
-		for (Light* light : lights_)
+		if (!light->GetLightStationary() && light->GetShadowsEnabled())
 		{
-			// send the light data to the gpu
-			light->SendLightData(devices_, light_buffer_memory_);
+			light->GenerateShadowMap(command_pool_, meshes_);
+			current_frame_stats_.shadow_map_faces_rendered += light->GetShadowMap()->GetRenderTargetCount();
 		}
+	}
+
+	VkExtent2D swap_extent = swap_chain_->GetIntermediateImageExtent();
+
+	frame_constants_->BeginFrame();
 
-		// render the skybox
-		skybox_->Render(render_camera_);
+	// send matrix data to the gpu
+	UniformBufferObject ubo = {};
+	ubo.model = glm::mat4(1.0f);
+	ubo.view = render_camera_->GetViewMatrix();
+	ubo.proj = render_camera_->GetProjectionMatrix();
 
-		// cull the scene geometry
-		CullGeometry();
+	frame_constants_->Write(matrix_buffer_constants_, &ubo, sizeof(UniformBufferObject));
 
-		// render the scene
+	// send camera data to the gpu
+	SceneLightData scene_data = {};
+	scene_data.scene_data = glm::vec4(glm::vec3(0.1f, 0.1f, 0.1f), lights_.size());
+	//scene_data.scene_data = glm::vec4(glm::vec3(0.85f * 0.5f, 0.68f * 0.5f, 0.92f * 0.5f), lights_.size());
+	scene_data.camera_data = glm::vec4(render_camera_->GetPosition(), 1000.0f);
+	frame_constants_->Write(light_buffer_constants_, &scene_data, sizeof(SceneLightData));
 
-#ifdef _VISIBILITY
 
+	for (Light* light : lights_)
+	{
+		// send the light data to the gpu
+		light->SendLightData(frame_constants_, light_buffer_constants_);
+	}
+
+	if (render_mode_ == RenderMode::VISIBILITY)
+	{
 		// send data to the visibility data buffer
 		VisibilityRenderData visibility_data = {};
 		visibility_data.screen_dimensions = glm::vec4(swap_extent.width, swap_extent.height, 0, 0);
 		visibility_data.invView = glm::inverse(render_camera_->GetViewMatrix());
 		visibility_data.invProj = glm::inverse(render_camera_->GetProjectionMatrix());
-		devices_->CopyDataToBuffer(visibility_data_buffer_memory_, &visibility_data, sizeof(VisibilityRenderData));
-
-		if (performance_captures_remaining_ > 0)
-		{
-			// render visibility
-			glfwSetTime(0.0);
-			RenderVisibility();
-			vkQueueWaitIdle(graphics_queue_);
-			visibility_time_ += glfwGetTime() * 1000.0;
-
-			// render shading
-			glfwSetTime(0.0);
-			RenderVisbilityDeferred();
-			vkQueueWaitIdle(graphics_queue_);
-			shading_time_ += glfwGetTime() * 1000.0;
-
-			// render transparency
-			glfwSetTime(0.0);
-			current_signal_semaphore_ = transparency_composite_semaphore_;
-			RenderTransparency();
-			vkQueueWaitIdle(graphics_queue_);
-			transparency_time_ += glfwGetTime() * 1000.0;
-		}
-		else
-		{
-			RenderVisibility();
-			RenderVisbilityDeferred();
-			current_signal_semaphore_ = transparency_composite_semaphore_;
-			RenderTransparency();
-		}
-
-#elif _VISIBILITY_PEELED
-
-		// send data to the visibility data buffer
+		frame_constants_->Write(visibility_data_constants_, &visibility_data, sizeof(VisibilityRenderData));
+	}
+	else if (render_mode_ == RenderMode::VISIBILITY_PEELED)
+	{
+		// send data to the visibility peel data buffer
 		VisibilityPeelRenderData visibility_data = {};
 		visibility_data.screen_dimensions = glm::vec4(swap_extent.width, swap_extent.height, 0, 0);
 		visibility_data.invView = glm::inverse(render_camera_->GetViewMatrix());
 		visibility_data.invProj = glm::inverse(render_camera_->GetProjectionMatrix());
-		devices_->CopyDataToBuffer(visibility_data_buffer_memory_, &visibility_data, sizeof(VisibilityPeelRenderData));
-	
-		if (performance_captures_remaining_)
-		{
-			// render visibility
-			glfwSetTime(0.0);
-			RenderVisibilityPeel();
-			vkQueueWaitIdle(graphics_queue_);
-			visibility_time_ += glfwGetTime() * 1000.0;
-
-			// render deferred stage
-			glfwSetTime(0.0);
-			RenderVisibilityPeelDeferred();
-			vkQueueWaitIdle(graphics_queue_);
-			shading_time_ += glfwGetTime() * 1000.0;
-		}
-		else
-		{
-			RenderVisibilityPeel();
-			RenderVisibilityPeelDeferred();
-		}
+		frame_constants_->Write(visibility_peel_data_constants_, &visibility_data, sizeof(VisibilityPeelRenderData));
+	}
+	else if (render_mode_ == RenderMode::BUFFER_VIS)
+	{
+		// send the selected view to the buffer visualisation data buffer
+		BufferVisualisationData visualisation_data = {};
+		visualisation_data.screen_dimensions = glm::vec4(swap_extent.width, swap_extent.height, 0, 0);
+		visualisation_data.invView = glm::inverse(render_camera_->GetViewMatrix());
+		visualisation_data.invProj = glm::inverse(render_camera_->GetProjectionMatrix());
+		visualisation_data.view_data = glm::uvec4(static_cast<uint32_t>(buffer_visualisation_mode_), primitive_buffer_->GetShapeCount(), 0, 0);
+		frame_constants_->Write(buffer_visualisation_data_constants_, &visualisation_data, sizeof(BufferVisualisationData));
+	}
 
-#elif _DEFERRED
+	// send the skybox matrix data to the gpu
+	skybox_->SendMatrixData(render_camera_);
 
-		if (performance_captures_remaining_ > 0)
-		{
-			// render g buffer
-			glfwSetTime(0.0);
-			RenderGBuffer();
-			vkQueueWaitIdle(graphics_queue_);
-			visibility_time_ += glfwGetTime() * 1000.0;
-			
-			// render deferred stage
-			glfwSetTime(0.0);
-			RenderDeferred();
-			vkQueueWaitIdle(graphics_queue_);
-			shading_time_ += glfwGetTime() * 1000.0;
-
-			// render transparency
-			glfwSetTime(0.0);
-			current_signal_semaphore_ = transparency_composite_semaphore_;
-			RenderTransparency();
-			vkQueueWaitIdle(graphics_queue_);
-			transparency_time_ += glfwGetTime() * 1000.0;
-		}
-		else
-		{
-			RenderGBuffer();
-			RenderDeferred();
-			current_signal_semaphore_ = transparency_composite_semaphore_;
-			RenderTransparency();
-		}
+	// copy this frame's constants to device local memory ahead of every pass
+	VkSemaphore constants_semaphore = frame_constants_->Submit();
 
-#endif
-		
-		if (performance_captures_remaining_ > 0)
-			glfwSetTime(0.0);
+	// record the per frame passes and hand the frame's synchronisation to the render graph
+	FrameResources& frame = frames_[current_frame_];
+	RecordFrameSetup();
+	RecordFrameFinalize();
 
-		if (hdr_->GetHDRMode() > 0)
-		{
-			hdr_->Render(swap_chain_, &current_signal_semaphore_);
-				current_signal_semaphore_ = hdr_->GetHDRSemaphore();
-		}
-		
-		// capture post process time and move to next recording
-		if (performance_captures_remaining_ > 0)
-		{
-			vkQueueWaitIdle(graphics_queue_);
-			post_process_time_ += glfwGetTime() * 1000.0;
+	render_graph_->SetCommandBuffer(setup_pass_, frame.setup_command_buffer);
+	render_graph_->SetCommandBuffer(present_pass_, frame.finalize_command_buffer);
+	render_graph_->AddExternalWait(culling_pass_, constants_semaphore, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+	render_graph_->AddExternalWait(present_pass_, swap_chain_->GetImageAvailableSemaphore(), VK_PIPELINE_STAGE_TRANSFER_BIT);
 
-			performance_captures_remaining_--;
+	// the hdr passes are culled while hdr is disabled, the visualisation's false colours are not tonemapped
+	for (RenderGraphHandle pass : post_process_passes_)
+		render_graph_->SetPassEnabled(pass, hdr_->GetHDRMode() > 0 && render_mode_ != RenderMode::BUFFER_VIS);
 
-			if (performance_captures_remaining_ == 0)
-			{
-				RecordPerformance();
-
-				// advance to the next performance capture point
-				current_capture_point_++;
-				if (current_capture_point_ < capture_points_.size())
-				{
-					performance_captures_remaining_ = PERFORMANCE_CAPTURES;
-
-					// place the camera at the next performance capture position
-					PerformanceCapturePoint capture_point = capture_points_[current_capture_point_];
-					render_camera_->SetPosition(capture_point.capture_position);
-					render_camera_->SetRotation(capture_point.capture_rotation);
-				}
-			}
-		}
+	vkResetFences(devices_->GetLogicalDevice(), 1, &frame.fence);
+	render_graph_->Execute(frame.render_finished_semaphore, frame.fence);
+	current_signal_semaphore_ = frame.render_finished_semaphore;
 
-		swap_chain_->FinalizeIntermediateImage();
+	// the culled draws are read back with this frame's resources, every indirect pass drew the same draws
+	frame.frame_number = frame_statistics_.frame_count;
+	frame.indirect_draw_pass_count = 0;
+	for (RenderGraphHandle pass : visibility_passes_)
+	{
+		if (!render_graph_->IsPassCulled(pass))
+			frame.indirect_draw_pass_count++;
 	}
 
-}
+	// the pass statistics are read back once this frame's fence has signalled
+	for (auto& pass_scope : pass_statistics_scopes_)
+	{
+		if (!render_graph_->IsPassCulled(pass_scope.first))
+			pipeline_statistics_->MarkSubmitted(pass_scope.second);
+	}
 
-void VulkanRenderer::RenderForward(uint32_t image_index)
-{
-	VkSemaphore wait_semaphore = swap_chain_->GetImageAvailableSemaphore();
-	VkSemaphore skybox_semaphore = skybox_->GetRenderSemaphore();
+	// capture the stage times and move to next recording
+	if (performance_statistics_.IsActive())
+	{
+		RenderStageTimes stage_times = GetLastStageTimes();
 
-	// submit the draw command buffer
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		double frame_times[FRAME_TIME_STAGE_COUNT] = {};
+		frame_times[static_cast<int>(FrameTimeStage::CPU_FRAME)] = last_cpu_frame_time_;
+		frame_times[static_cast<int>(FrameTimeStage::VISIBILITY)] = stage_times.visibility;
+		frame_times[static_cast<int>(FrameTimeStage::SHADING)] = stage_times.shading;
+		frame_times[static_cast<int>(FrameTimeStage::TRANSPARENCY)] = stage_times.transparency;
+		frame_times[static_cast<int>(FrameTimeStage::POST_PROCESS)] = stage_times.post_process;
+		frame_times[static_cast<int>(FrameTimeStage::GPU_TOTAL)] = stage_times.visibility + stage_times.shading + stage_times.transparency + stage_times.post_process;
 
-	VkSemaphore wait_semaphores[] = { wait_semaphore, skybox_semaphore };
-	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submit_info.waitSemaphoreCount = 2;
-	submit_info.pWaitSemaphores = wait_semaphores;
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &command_buffers_[image_index];
+		// the pass statistics of the sampled frames are summed for the capture point
+		if (!performance_statistics_.IsWarmingUp())
+			pipeline_statistics_->AddLastResultsToTotals();
 
-	VkSemaphore signal_semaphores[] = { render_semaphore_ };
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
+		if (performance_statistics_.AddFrame(frame_times))
+		{
+			RecordPerformance();
 
-	VkResult result = vkQueueSubmit(graphics_queue_, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to submit draw command buffer!");
+			// advance to the next performance capture point
+			current_capture_point_++;
+			if (current_capture_point_ < capture_points_.size())
+				BeginCapturePoint();
+		}
 	}
 }
 
-void VulkanRenderer::RenderGBuffer()
+void VulkanRenderer::RecordFrameSetup()
 {
-	// submit the draw command buffer
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 0;
-	submit_info.pWaitSemaphores = nullptr;
-	submit_info.pWaitDstStageMask = nullptr;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &g_buffer_command_buffers_[0];
+	TRACE_FUNCTION();
 
-	VkSemaphore signal_semaphores[] = { g_buffer_semaphore_ };
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
+	FrameResources& frame = frames_[current_frame_];
 
-	VkResult result = vkQueueSubmit(graphics_queue_, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
+	// clear the frame's targets, the render graph orders the clears before the passes that use them
+	swap_chain_->AddClearCommands(&frame_barriers_);
+	if (render_mode_ == RenderMode::VISIBILITY_PEELED || render_mode_ == RenderMode::BUFFER_VIS)
 	{
-		throw std::runtime_error("failed to submit draw command buffer!");
+		// the last peel depth layer is read by the first peel before it is written
+		frame_barriers_.ClearDepthImage(peel_depth_buffer_->GetImages()[VISIBILITY_PEEL_COUNT - 1], VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, { 0.0f, 0 });
 	}
-}
 
-void VulkanRenderer::RenderDeferred()
-{
-	VkSemaphore skybox_semaphore = skybox_->GetRenderSemaphore();
-
-	//  transition the intermediate image to color write optimal layout
-	devices_->TransitionImageLayout(swap_chain_->GetIntermediateImage(), swap_chain_->GetIntermediateImageFormat(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-
-	// submit the draw command buffer
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	VkSemaphore wait_semaphores[] = { g_buffer_semaphore_, skybox_semaphore };
-	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submit_info.waitSemaphoreCount = 2;
-	submit_info.pWaitSemaphores = wait_semaphores;
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &deferred_command_buffer_;
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-	VkSemaphore signal_semaphores[] = { render_semaphore_ };
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
+	vkBeginCommandBuffer(frame.setup_command_buffer, &begin_info);
+	frame_barriers_.Record(frame.setup_command_buffer);
 
-	VkResult result = vkQueueSubmit(graphics_queue_, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
+	if (vkEndCommandBuffer(frame.setup_command_buffer) != VK_SUCCESS)
 	{
-		throw std::runtime_error("failed to submit deferred command buffer!");
+		throw std::runtime_error("failed to record frame setup command buffer!");
 	}
 }
 
-void VulkanRenderer::RenderDeferredCompute()
+void VulkanRenderer::RecordFrameFinalize()
 {
-	VkSemaphore skybox_semaphore = skybox_->GetRenderSemaphore();
+	TRACE_FUNCTION();
 
-	// submit the draw command buffer
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	FrameResources& frame = frames_[current_frame_];
 
-	VkSemaphore wait_semaphores[] = { g_buffer_semaphore_, skybox_semaphore, swap_chain_->GetImageAvailableSemaphore() };
-	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submit_info.waitSemaphoreCount = 3;
-	submit_info.pWaitSemaphores = wait_semaphores;
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &deferred_compute_command_buffer_;
+	// record the blit to the acquired swap chain image
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-	VkSemaphore signal_semaphores[] = { render_semaphore_ };
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
+	vkBeginCommandBuffer(frame.finalize_command_buffer, &begin_info);
+	swap_chain_->RecordFinalizeCommands(frame.finalize_command_buffer, &frame_barriers_, GetOutputImage());
 
-	VkResult result = vkQueueSubmit(compute_queue_, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
+	// the render graph orders the copy after the culling pass, only the draws' instance counts are used but they are interleaved
+	frame.culling_readback_pending = frame.culling_readback_buffer != VK_NULL_HANDLE;
+	if (frame.culling_readback_pending)
 	{
-		throw std::runtime_error("failed to submit deferred compute command buffer!");
-	}
-}
-
-void VulkanRenderer::RenderVisibility()
-{
-	// submit the draw command buffer
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 0;
-	submit_info.pWaitSemaphores = nullptr;
-	submit_info.pWaitDstStageMask = nullptr;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &visibility_command_buffer_;
-
-	VkSemaphore signal_semaphores[] = { g_buffer_semaphore_ };
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
+		VkBufferCopy copy_region = {};
+		copy_region.size = primitive_buffer_->GetShapeCount() * sizeof(IndirectDrawCommand);
+		vkCmdCopyBuffer(frame.finalize_command_buffer, primitive_buffer_->GetIndirectDrawBuffer(), frame.culling_readback_buffer, 1, &copy_region);
 
-	VkResult result = vkQueueSubmit(graphics_queue_, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to submit draw command buffer!");
+		frame_barriers_.AddMemoryBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+		frame_barriers_.Record(frame.finalize_command_buffer);
 	}
-}
-
-void VulkanRenderer::RenderVisbilityDeferred()
-{
-	VkSemaphore skybox_semaphore = skybox_->GetRenderSemaphore();
 
-	//  transition the intermediate image to color write optimal layout
-	devices_->TransitionImageLayout(swap_chain_->GetIntermediateImage(), swap_chain_->GetIntermediateImageFormat(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-
-	// submit the draw command buffer
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	VkSemaphore wait_semaphores[] = { g_buffer_semaphore_, skybox_semaphore };
-	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submit_info.waitSemaphoreCount = 2;
-	submit_info.pWaitSemaphores = wait_semaphores;
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &visibility_deferred_command_buffer_;
-
-	VkSemaphore signal_semaphores[] = { render_semaphore_ };
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
-
-	VkResult result = vkQueueSubmit(graphics_queue_, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
+	if (vkEndCommandBuffer(frame.finalize_command_buffer) != VK_SUCCESS)
 	{
-		throw std::runtime_error("failed to submit deferred command buffer!");
+		throw std::runtime_error("failed to record finalize command buffer!");
 	}
 }
 
-void VulkanRenderer::RenderVisibilityPeel()
+void VulkanRenderer::ReadCullingResults(FrameResources& frame)
 {
-	// clear the peel depth buffer manually since it is need out of order
-	peel_depth_buffer_->ClearDepthImage({ 0.0f, 0 }, VISIBILITY_PEEL_COUNT - 1);
-
-	// set up generic draw info
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 0;
-	submit_info.pWaitSemaphores = nullptr;
-	submit_info.pWaitDstStageMask = nullptr;
-	submit_info.commandBufferCount = 1;
+	TRACE_FUNCTION();
 
-	VkSemaphore signal_semaphores[] = { g_buffer_semaphore_ };
+	// the frame's fence has signalled so its copy of the culled draws is complete
+	uint32_t shape_count = primitive_buffer_->GetShapeCount();
+	const IndirectDrawCommand* draws = static_cast<const IndirectDrawCommand*>(frame.culling_readback_buffer_memory.mapped_data);
 
-	// submit the visibility layer peel pipelines
-	for (int i = 0; i < VISIBILITY_PEEL_COUNT; i++)
+	uint32_t visible_shapes = 0;
+	uint64_t visible_indices = 0;
+	for (uint32_t i = 0; i < shape_count; i++)
 	{
-		// cheap wait for the previous pass to complete
-		vkQueueWaitIdle(graphics_queue_);
-
-		// submit the draw command buffer
-		submit_info.pCommandBuffers = &visibility_peel_command_buffers_[i];
-
-		if (i == VISIBILITY_PEEL_COUNT - 1)
+		if (draws[i].instance_count > 0)
 		{
-			submit_info.signalSemaphoreCount = 1;
-			submit_info.pSignalSemaphores = signal_semaphores;
-		}
-		else
-		{
-			submit_info.signalSemaphoreCount = 0;
-			submit_info.pSignalSemaphores = nullptr;
-		}
-
-		VkResult result = vkQueueSubmit(graphics_queue_, 1, &submit_info, VK_NULL_HANDLE);
-		if (result != VK_SUCCESS)
-		{
-			throw std::runtime_error("failed to submit visibility peel command buffer!");
+			visible_shapes++;
+			visible_indices += (uint64_t)draws[i].index_count * draws[i].instance_count;
 		}
 	}
+
+	current_frame_stats_.culling_frame_number = frame.frame_number;
+	current_frame_stats_.shape_count = shape_count;
+	current_frame_stats_.visible_shapes = visible_shapes;
+	current_frame_stats_.culled_shapes = shape_count - visible_shapes;
+	current_frame_stats_.drawn_indices = visible_indices * frame.indirect_draw_pass_count;
+	frame.culling_readback_pending = false;
 }
 
-void VulkanRenderer::RenderVisibilityPeelDeferred()
+VkImage VulkanRenderer::GetOutputImage()
 {
-	VkSemaphore skybox_semaphore = skybox_->GetRenderSemaphore();
-
-	//  transition the intermediate image to color write optimal layout
-	devices_->TransitionImageLayout(swap_chain_->GetIntermediateImage(), swap_chain_->GetIntermediateImageFormat(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-
-	// submit the draw command buffer
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	VkSemaphore wait_semaphores[] = { g_buffer_semaphore_, skybox_semaphore };
-	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submit_info.waitSemaphoreCount = 2;
-	submit_info.pWaitSemaphores = wait_semaphores;
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &visibility_peel_deferred_command_buffer_;
+	// the tonemapped image replaces the intermediate image when hdr is enabled
+	if (hdr_->GetHDRMode() > 0 && render_mode_ != RenderMode::BUFFER_VIS)
+		return hdr_->GetOutputImage();
 
-	VkSemaphore signal_semaphores[] = { render_semaphore_ };
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
-
-	VkResult result = vkQueueSubmit(graphics_queue_, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to submit deferred command buffer!");
-	}
+	return swap_chain_->GetIntermediateImage();
 }
 
-void VulkanRenderer::RenderTransparency()
+void VulkanRenderer::ReadBackOutputImage(std::vector<glm::vec3>& pixels)
 {
-	VkSemaphore wait_semaphores[] = { render_semaphore_ };
-	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	TRACE_FUNCTION();
 
-	// clear the transparency buffers
-	VkClearColorValue revealage_clear = { 1.f, 1.f, 1.f, 1.f };
-	accumulation_buffer_->ClearImage();
-	revealage_buffer_->ClearImage(revealage_clear);
+	vkDeviceWaitIdle(devices_->GetLogicalDevice());
 
-	// submit the transparency render command buffer
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 1;
-	submit_info.pWaitSemaphores = wait_semaphores;
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &transparency_command_buffer_;
+	// both output images share the intermediate image's rgba float format and extent
+	VkExtent2D extent = swap_chain_->GetIntermediateImageExtent();
+	VkDeviceSize image_size = (VkDeviceSize)extent.width * extent.height * sizeof(glm::vec4);
 
-	VkSemaphore signal_semaphores[] = { transparency_semaphore_ };
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
+	VkBuffer readback_buffer;
+	MemoryAllocation readback_buffer_memory;
+	devices_->CreateBuffer(image_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readback_buffer, readback_buffer_memory);
 
-	VkResult result = vkQueueSubmit(graphics_queue_, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to submit transparency command buffer!");
-	}
+	// the finalize pass returns the output image to a colour attachment once it is copied to the swap chain
+	devices_->CopyImageToBuffer(GetOutputImage(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, readback_buffer, extent.width, extent.height);
 
-	// submit the transparency composite command buffer
-	wait_semaphores[0] = transparency_semaphore_;
-	submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 1;
-	submit_info.pWaitSemaphores = wait_semaphores;
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &transparency_composite_command_buffer_;
+	const glm::vec4* data = static_cast<const glm::vec4*>(readback_buffer_memory.mapped_data);
+	pixels.resize(extent.width * extent.height);
+	for (size_t i = 0; i < pixels.size(); i++)
+		pixels[i] = glm::vec3(data[i]);
 
-	signal_semaphores[0] = transparency_composite_semaphore_;
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
+	vkDestroyBuffer(devices_->GetLogicalDevice(), readback_buffer, nullptr);
+	devices_->FreeMemory(readback_buffer_memory);
+}
 
-	result = vkQueueSubmit(graphics_queue_, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
+double VulkanRenderer::GetRenderGraphTime(const std::vector<RenderGraphHandle>& passes)
+{
+	double time = 0.0;
+	for (RenderGraphHandle pass : passes)
 	{
-		throw std::runtime_error("failed to submit transparency composite command buffer!");
+		if (!render_graph_->IsPassCulled(pass))
+			time += render_graph_->GetLastPassTime(pass);
 	}
+
+	return time;
 }
 
-void VulkanRenderer::RenderVisualisation(uint32_t image_index)
+PipelineStatisticsScope VulkanRenderer::GetPassStatisticsScope(RenderGraphHandle pass)
 {
-	VkSemaphore wait_semaphore = swap_chain_->GetImageAvailableSemaphore();
-
-	// submit the draw command buffer
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-	VkSemaphore wait_semaphores[] = { wait_semaphore };
-	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submit_info.waitSemaphoreCount = 1;
-	submit_info.pWaitSemaphores = wait_semaphores;
-	submit_info.pWaitDstStageMask = wait_stages;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &buffer_visualisation_command_buffers_[image_index];
-
-	VkSemaphore signal_semaphores[] = { render_semaphore_ };
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
+	auto scope = pass_statistics_scopes_.find(pass);
+	if (scope == pass_statistics_scopes_.end())
+		return PIPELINE_STATISTICS_NO_SCOPE;
 
-
-	VkResult result = vkQueueSubmit(graphics_queue_, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to submit visualisation command buffer!");
-	}
+	return scope->second;
 }
 
-void VulkanRenderer::CullGeometry()
+RenderStageTimes VulkanRenderer::GetLastStageTimes()
 {
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 0;
-	submit_info.pWaitSemaphores = nullptr;
-	submit_info.pWaitDstStageMask = nullptr;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &shape_culling_command_buffer_;
-
-	VkResult result = vkQueueSubmit(compute_queue_, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to submit shape culling command buffer!");
-	}
+	RenderStageTimes times = {};
+	times.visibility = GetRenderGraphTime(visibility_passes_);
+	times.shading = GetRenderGraphTime(shading_passes_);
+	times.transparency = GetRenderGraphTime(transparency_passes_);
+	times.post_process = GetRenderGraphTime(post_process_passes_);
 
-	vkQueueWaitIdle(compute_queue_);
+	return times;
 }
 
 void VulkanRenderer::Cleanup()
@@ -560,22 +444,11 @@ void VulkanRenderer::Cleanup()
 	// clean up command and descriptor pools
 	vkDestroyCommandPool(devices_->GetLogicalDevice(), command_pool_, nullptr);
 	
-	// clean up the buffer
-	vkDestroyBuffer(devices_->GetLogicalDevice(), matrix_buffer_, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), matrix_buffer_memory_, nullptr);
-
-	vkDestroyBuffer(devices_->GetLogicalDevice(), light_buffer_, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), light_buffer_memory_, nullptr);
-	
 	// clean up shaders
 	material_shader_->Cleanup();
 	delete material_shader_;
 	material_shader_ = nullptr;
 
-	buffer_visualisation_shader_->Cleanup();
-	delete buffer_visualisation_shader_;
-	buffer_visualisation_shader_ = nullptr;
-
 	shape_culling_shader_->Cleanup();
 	delete shape_culling_shader_;
 	shape_culling_shader_ = nullptr;
@@ -599,25 +472,24 @@ void VulkanRenderer::Cleanup()
 	delete texture_cache_;
 	texture_cache_ = nullptr;
 	
-	// clean up the buffer visualisation pipeline
-	buffer_visualisation_pipeline_->CleanUp();
-	delete buffer_visualisation_pipeline_;
-	buffer_visualisation_pipeline_ = nullptr;
-	
 	// clean up the shape culling pipeline
 	shape_culling_pipeline_->CleanUp();
 	delete shape_culling_pipeline_;
 	shape_culling_pipeline_ = nullptr;
 
-#ifdef _DEFERRED
-	CleanupDeferredPipeline();
-	CleanupTransparencyPipeline();
-#elif _VISIBILITY
-	CleanupVisibilityPipeline();
-	CleanupTransparencyPipeline();
-#elif _VISIBILITY_PEELED
-	CleanupVisibilityPeelPipeline();
-#endif
+	// clean up every render path that was selected
+	if (IsRenderPathInitialized(RenderMode::DEFERRED))
+		CleanupDeferredPipeline();
+	if (IsRenderPathInitialized(RenderMode::VISIBILITY))
+		CleanupVisibilityPipeline();
+	if (IsRenderPathInitialized(RenderMode::VISIBILITY_PEELED))
+		CleanupVisibilityPeelPipeline();
+	if (transparency_pipeline_ != nullptr)
+		CleanupTransparencyPipeline();
+	if (IsRenderPathInitialized(RenderMode::BUFFER_VIS))
+		CleanupBufferVisualisationPipeline();
+	CleanupRenderTargets();
+	pipelines_initialized_ = false;
 
 	// clean up the skybox
 	skybox_->Cleanup();
@@ -629,6 +501,11 @@ void VulkanRenderer::Cleanup()
 	delete hdr_;
 	hdr_ = nullptr;
 
+	// clean up the frame constant buffers
+	frame_constants_->Cleanup();
+	delete frame_constants_;
+	frame_constants_ = nullptr;
+
 	// clean up default texture
 	default_texture_->Cleanup();
 	delete default_texture_;
@@ -639,11 +516,34 @@ void VulkanRenderer::Cleanup()
 	vkDestroySampler(devices_->GetLogicalDevice(), buffer_unnormalized_sampler_, nullptr);
 	vkDestroySampler(devices_->GetLogicalDevice(), shadow_map_sampler_, nullptr);
 
-	// clean up semaphores
-	vkDestroySemaphore(devices_->GetLogicalDevice(), render_semaphore_, nullptr);
-	vkDestroySemaphore(devices_->GetLogicalDevice(), transparency_semaphore_, nullptr);
-	vkDestroySemaphore(devices_->GetLogicalDevice(), g_buffer_semaphore_, nullptr);
-	vkDestroySemaphore(devices_->GetLogicalDevice(), transparency_composite_semaphore_, nullptr);
+	// clean up the profiler before the render graph's command pools it records into
+	gpu_profiler_->Cleanup();
+	delete gpu_profiler_;
+	gpu_profiler_ = nullptr;
+
+	pipeline_statistics_->Cleanup();
+	delete pipeline_statistics_;
+	pipeline_statistics_ = nullptr;
+
+	// clean up the render graph
+	render_graph_->Cleanup();
+	delete render_graph_;
+	render_graph_ = nullptr;
+
+	// clean up frame resources
+	for (uint32_t i = 0; i < frames_in_flight_; i++)
+	{
+		vkDestroyFence(devices_->GetLogicalDevice(), frames_[i].fence, nullptr);
+		vkDestroySemaphore(devices_->GetLogicalDevice(), frames_[i].render_finished_semaphore, nullptr);
+
+		if (frames_[i].culling_readback_buffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(devices_->GetLogicalDevice(), frames_[i].culling_readback_buffer, nullptr);
+			devices_->FreeMemory(frames_[i].culling_readback_buffer_memory);
+		}
+	}
+
+	vkDestroyCommandPool(devices_->GetLogicalDevice(), frame_command_pool_, nullptr);
 }
 
 void VulkanRenderer::CleanupForwardPipeline()
@@ -662,11 +562,6 @@ void VulkanRenderer::CleanupDeferredPipeline()
 	delete deferred_shader_;
 	deferred_shader_ = nullptr;
 
-	// clean up g buffer
-	g_buffer_->Cleanup();
-	delete g_buffer_;
-	g_buffer_ = nullptr;
-
 	// clean up deferred rendering pipelines
 	g_buffer_pipeline_->CleanUp();
 	delete g_buffer_pipeline_;
@@ -680,8 +575,7 @@ void VulkanRenderer::CleanupDeferredPipeline()
 void VulkanRenderer::CleanupVisibilityPipeline()
 {
 	// clean up buffers
-	vkDestroyBuffer(devices_->GetLogicalDevice(), visibility_data_buffer_, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), visibility_data_buffer_memory_, nullptr);
+	frame_constants_->RemoveBuffer(visibility_data_constants_);
 
 	// clean up shaders
 	visibility_shader_->Cleanup();
@@ -692,11 +586,6 @@ void VulkanRenderer::CleanupVisibilityPipeline()
 	delete visibility_deferred_shader_;
 	visibility_deferred_shader_ = nullptr;
 
-	// clean up visibility buffer
-	visibility_buffer_->Cleanup();
-	delete visibility_buffer_;
-	visibility_buffer_ = nullptr;
-
 	// clean up the visibility rendering pipelines
 	visibility_pipeline_->CleanUp();
 	delete visibility_pipeline_;
@@ -716,7 +605,7 @@ void VulkanRenderer::CleanupVisibilityPeelPipeline()
 
 	visibility_peel_deferred_shader_->Cleanup();
 	delete visibility_peel_deferred_shader_;
-	visibility_deferred_shader_ = nullptr;
+	visibility_peel_deferred_shader_ = nullptr;
 
 	// clean up visibility peel pipelines
 	for (int i = 0; i < visibility_peel_pipelines_.size(); i++)
@@ -731,17 +620,8 @@ void VulkanRenderer::CleanupVisibilityPeelPipeline()
 	delete visibility_peel_deferred_pipeline_;
 	visibility_peel_deferred_pipeline_ = nullptr;
 
-	// clean up visibility peel resources
-	visibility_peel_buffer_->Cleanup();
-	delete visibility_peel_buffer_;
-	visibility_peel_buffer_ = nullptr;
-
-	peel_depth_buffer_->Cleanup();
-	delete peel_depth_buffer_;
-	peel_depth_buffer_ = nullptr;
-
-	vkDestroyBuffer(devices_->GetLogicalDevice(), visibility_data_buffer_, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), visibility_data_buffer_memory_, nullptr);
+	// clean up buffers
+	frame_constants_->RemoveBuffer(visibility_peel_data_constants_);
 }
 
 void VulkanRenderer::CleanupTransparencyPipeline()
@@ -763,6 +643,56 @@ void VulkanRenderer::CleanupTransparencyPipeline()
 	transparency_composite_pipeline_->CleanUp();
 	delete transparency_composite_pipeline_;
 	transparency_composite_pipeline_ = nullptr;
+}
+
+void VulkanRenderer::CleanupBufferVisualisationPipeline()
+{
+	// clean up buffers
+	frame_constants_->RemoveBuffer(buffer_visualisation_data_constants_);
+
+	// clean up shaders
+	overdraw_shader_->Cleanup();
+	delete overdraw_shader_;
+	overdraw_shader_ = nullptr;
+
+	buffer_visualisation_shader_->Cleanup();
+	delete buffer_visualisation_shader_;
+	buffer_visualisation_shader_ = nullptr;
+
+	// clean up the buffer visualisation pipelines
+	overdraw_pipeline_->CleanUp();
+	delete overdraw_pipeline_;
+	overdraw_pipeline_ = nullptr;
+
+	buffer_visualisation_pipeline_->CleanUp();
+	delete buffer_visualisation_pipeline_;
+	buffer_visualisation_pipeline_ = nullptr;
+}
+
+void VulkanRenderer::CleanupRenderTargets()
+{
+	// clean up the deferred and visibility buffers
+	g_buffer_->Cleanup();
+	delete g_buffer_;
+	g_buffer_ = nullptr;
+
+	visibility_buffer_->Cleanup();
+	delete visibility_buffer_;
+	visibility_buffer_ = nullptr;
+
+	// clean up visibility peel resources
+	visibility_peel_buffer_->Cleanup();
+	delete visibility_peel_buffer_;
+	visibility_peel_buffer_ = nullptr;
+
+	peel_depth_buffer_->Cleanup();
+	delete peel_depth_buffer_;
+	peel_depth_buffer_ = nullptr;
+
+	// clean up the overdraw buffer
+	overdraw_buffer_->Cleanup();
+	delete overdraw_buffer_;
+	overdraw_buffer_ = nullptr;
 
 	// clean up transparency buffers
 	accumulation_buffer_->Cleanup();
@@ -776,6 +706,8 @@ void VulkanRenderer::CleanupTransparencyPipeline()
 
 void VulkanRenderer::InitPipelines()
 {
+	TRACE_FUNCTION();
+
 	CreateLightBuffer();
 
 	// fill out any empty texture arrays using the default texture
@@ -834,31 +766,30 @@ void VulkanRenderer::InitPipelines()
 	// initialize the shape buffer now that we know how many there are
 	primitive_buffer_->InitShapeBuffer(devices_);
 
-	// init rendering pipelines
-#ifdef _DEFERRED
-	InitDeferredPipeline();
-	InitTransparencyPipeline();
-#elif _VISIBILITY
-	InitVisibilityPipeline();
-	InitTransparencyPipeline();
-#elif _VISIBILITY_PEELED
-	InitVisibilityPeelPipeline();
-#endif
+	// create the transient render targets, the render graph binds their memory from their lifetimes
+	hdr_ = new HDR();
+	hdr_->InitRenderTargets(devices_, swap_chain_);
+	CreateRenderTargets();
+
+	BuildRenderGraph();
+	render_graph_->AllocateTransientTargets();
+	render_graph_->SetProfiler(gpu_profiler_);
+
+	RenderGraphStatistics graph_statistics = render_graph_->GetStatistics();
+	std::cout << "transient render targets (every render path, " << multisample_data[multisample_level_].sample_count << "x msaa): "
+		<< graph_statistics.transient_target_count << " targets, " << graph_statistics.aliased_target_count << " aliased, "
+		<< graph_statistics.transient_bytes / (1024.0 * 1024.0) << " MB -> " << graph_statistics.aliased_bytes / (1024.0 * 1024.0) << " MB ("
+		<< (graph_statistics.transient_bytes - graph_statistics.aliased_bytes) / (1024.0 * 1024.0) << " MB saved)" << std::endl;
+
+	// init the selected render path's pipelines, the others are created the first time they are selected
+	InitRenderPath(render_mode_);
 
 	// initialize the skybox
 	skybox_ = new Skybox();
-	skybox_->Init(devices_, swap_chain_, command_pool_);
+	skybox_->Init(devices_, swap_chain_, frame_constants_, &pipeline_builder_);
 
 	// initialize the hdr renderer
-	hdr_ = new HDR();
-	hdr_->Init(devices_, swap_chain_, command_pool_);
-
-	// initialize a buffer visualisation pipeline
-	buffer_visualisation_pipeline_ = new BufferVisualisationPipeline();
-	buffer_visualisation_pipeline_->SetShader(buffer_visualisation_shader_);
-	buffer_visualisation_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 0, buffer_normalized_sampler_);
-	buffer_visualisation_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 1, swap_chain_->GetDepthImageView());
-	buffer_visualisation_pipeline_->Init(devices_, swap_chain_, primitive_buffer_);
+	hdr_->Init(devices_, swap_chain_, frame_constants_, &pipeline_builder_);
 
 	// initialize the shape culling pipeline
 	shape_culling_pipeline_ = new ShapeCullingPipeline();
@@ -867,9 +798,281 @@ void VulkanRenderer::InitPipelines()
 	shape_culling_pipeline_->AddStorageBuffer(1, primitive_buffer_->GetShapeBuffer(), primitive_buffer_->GetShapeCount() * sizeof(ShapeData));
 	shape_culling_pipeline_->AddUniformBuffer(2, matrix_buffer_, sizeof(UniformBufferObject));
 	shape_culling_pipeline_->SetShapeCount(primitive_buffer_->GetShapeCount());
-	shape_culling_pipeline_->Init(devices_);
+	pipeline_builder_.Add("shape culling", [=]() { shape_culling_pipeline_->Init(devices_); });
+	CreateCullingReadbackBuffers();
+
+	// build every queued pipeline before any command buffer is recorded
+	pipeline_builder_.Build();
+	pipeline_builder_.PrintStatistics();
+
+	skybox_->InitCommandBuffer(command_pool_);
+	hdr_->InitCommandBuffers(command_pool_);
 
 	CreateCommandBuffers();
+	CreateRenderPathCommandBuffers(render_mode_);
+	SetRenderGraphCommandBuffers();
+
+	pipelines_initialized_ = true;
+	EnableRenderPathPasses();
+}
+
+void VulkanRenderer::SetRenderMode(RenderMode mode)
+{
+	// forward and deferred compute rendering are not scheduled by the render graph
+	if (mode == RenderMode::FORWARD || mode == RenderMode::DEFERRED_COMPUTE)
+	{
+		throw std::runtime_error("render mode " + GetRenderModeName(mode) + " is not supported!");
+	}
+
+	// the buffer visualisation reads the single sampled peel buffers
+	if (mode == RenderMode::BUFFER_VIS && multisample_level_ > 1)
+	{
+		throw std::runtime_error("render mode " + GetRenderModeName(mode) + " is not supported with msaa!");
+	}
+
+	render_mode_ = mode;
+
+	// before the pipelines are initialized the selected path is created along with them
+	if (!pipelines_initialized_)
+		return;
+
+	if (!IsRenderPathInitialized(mode))
+	{
+		// the scene buffers and textures are shared, only the path's pipelines and command buffers are new
+		InitRenderPath(mode);
+		pipeline_builder_.Build();
+		pipeline_builder_.PrintStatistics();
+
+		CreateRenderPathCommandBuffers(mode);
+		SetRenderGraphCommandBuffers();
+	}
+
+	EnableRenderPathPasses();
+
+	// the stage times of the frames in flight belong to the previous path, restart the capture point's window
+	if (performance_statistics_.IsActive())
+		BeginCapturePoint();
+}
+
+void VulkanRenderer::CycleRenderMode()
+{
+	switch (render_mode_)
+	{
+	case RenderMode::DEFERRED:
+		SetRenderMode(RenderMode::VISIBILITY);
+		break;
+	case RenderMode::VISIBILITY:
+		SetRenderMode(RenderMode::VISIBILITY_PEELED);
+		break;
+	default:
+		SetRenderMode(RenderMode::DEFERRED);
+		break;
+	}
+
+	std::cout << "render path: " << GetRenderModeName(render_mode_) << std::endl;
+}
+
+std::string VulkanRenderer::GetRenderModeName(RenderMode mode)
+{
+	switch (mode)
+	{
+	case RenderMode::FORWARD:
+		return "forward";
+	case RenderMode::DEFERRED:
+		return "deferred";
+	case RenderMode::DEFERRED_COMPUTE:
+		return "deferred compute";
+	case RenderMode::VISIBILITY:
+		return "visibility";
+	case RenderMode::VISIBILITY_PEELED:
+		return "visibility peeled";
+	case RenderMode::BUFFER_VIS:
+		return "buffer visualisation";
+	}
+
+	return "";
+}
+
+bool VulkanRenderer::FindRenderMode(const std::string& name, RenderMode& mode)
+{
+	// only the render paths scheduled by the render graph can be selected by name
+	const RenderMode render_paths[] = { RenderMode::DEFERRED, RenderMode::VISIBILITY, RenderMode::VISIBILITY_PEELED };
+	for (RenderMode render_path : render_paths)
+	{
+		if (GetRenderModeName(render_path) == name)
+		{
+			mode = render_path;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void VulkanRenderer::SetBufferVisualisationMode(BufferVisualisationMode mode)
+{
+	// the view is written to the visualisation data every frame, only the render path changes
+	if (render_mode_ != RenderMode::BUFFER_VIS)
+	{
+		RenderMode render_path = render_mode_;
+		SetRenderMode(RenderMode::BUFFER_VIS);
+		visualised_render_mode_ = render_path;
+	}
+
+	buffer_visualisation_mode_ = mode;
+}
+
+void VulkanRenderer::CycleBufferVisualisationMode()
+{
+	if (multisample_level_ > 1)
+	{
+		std::cout << "buffer visualisation is not supported with msaa" << std::endl;
+		return;
+	}
+
+	if (render_mode_ != RenderMode::BUFFER_VIS)
+	{
+		SetBufferVisualisationMode(BufferVisualisationMode::DEPTH);
+	}
+	else
+	{
+		// past the last view the render path selected before the visualisation is restored
+		int next_mode = static_cast<int>(buffer_visualisation_mode_) + 1;
+		if (next_mode == BUFFER_VISUALISATION_MODE_COUNT)
+		{
+			SetRenderMode(visualised_render_mode_);
+			std::cout << "render path: " << GetRenderModeName(render_mode_) << std::endl;
+			return;
+		}
+
+		SetBufferVisualisationMode(static_cast<BufferVisualisationMode>(next_mode));
+	}
+
+	std::cout << "buffer visualisation: " << GetBufferVisualisationModeName(buffer_visualisation_mode_) << std::endl;
+}
+
+std::string VulkanRenderer::GetBufferVisualisationModeName(BufferVisualisationMode mode)
+{
+	switch (mode)
+	{
+	case BufferVisualisationMode::DEPTH:
+		return "depth";
+	case BufferVisualisationMode::OVERDRAW:
+		return "overdraw";
+	case BufferVisualisationMode::LIGHT_COUNT:
+		return "light count";
+	case BufferVisualisationMode::PEEL_OCCUPANCY:
+		return "peel occupancy";
+	case BufferVisualisationMode::SHAPE_ID:
+		return "shape id";
+	case BufferVisualisationMode::TRIANGLE_ID:
+		return "triangle id";
+	case BufferVisualisationMode::CULLING:
+		return "culling";
+	case BufferVisualisationMode::SHADOW_TEXEL_DENSITY:
+		return "shadow texel density";
+	}
+
+	return "";
+}
+
+void VulkanRenderer::InitRenderPath(RenderMode mode)
+{
+	TRACE_FUNCTION();
+
+	// queue the path's pipelines, the caller builds them
+	switch (mode)
+	{
+	case RenderMode::DEFERRED:
+		InitDeferredPipeline();
+		break;
+	case RenderMode::VISIBILITY:
+		InitVisibilityPipeline();
+		break;
+	case RenderMode::VISIBILITY_PEELED:
+		InitVisibilityPeelPipeline();
+		break;
+	case RenderMode::BUFFER_VIS:
+		// the views read the buffers of the visibility peeled path
+		if (!IsRenderPathInitialized(RenderMode::VISIBILITY_PEELED))
+			InitVisibilityPeelPipeline();
+		InitBufferVisualisationPipeline();
+		break;
+	default:
+		throw std::runtime_error("failed to initialize render path " + GetRenderModeName(mode) + "!");
+	}
+
+	// the deferred and visibility paths share the transparency pipelines
+	if ((mode == RenderMode::DEFERRED || mode == RenderMode::VISIBILITY) && !transparency_pipeline_)
+		InitTransparencyPipeline();
+}
+
+void VulkanRenderer::CreateRenderPathCommandBuffers(RenderMode mode)
+{
+	TRACE_FUNCTION();
+
+	switch (mode)
+	{
+	case RenderMode::DEFERRED:
+		CreateGBufferCommandBuffers();
+		CreateDeferredCommandBuffers();
+		break;
+	case RenderMode::VISIBILITY:
+		CreateVisibilityCommandBuffer();
+		CreateVisibilityDeferredCommandBuffer();
+		break;
+	case RenderMode::VISIBILITY_PEELED:
+		CreateVisibilityPeelCommandBuffers();
+		CreateVisibilityPeelDeferredCommandBuffers();
+		break;
+	case RenderMode::BUFFER_VIS:
+		if (visibility_peel_command_buffers_.empty())
+		{
+			CreateVisibilityPeelCommandBuffers();
+			CreateVisibilityPeelDeferredCommandBuffers();
+		}
+		CreateOverdrawCommandBuffer();
+		CreateBufferVisualisationCommandBuffer();
+		break;
+	default:
+		break;
+	}
+
+	if ((mode == RenderMode::DEFERRED || mode == RenderMode::VISIBILITY) && transparency_command_buffer_ == VK_NULL_HANDLE)
+	{
+		CreateTransparencyCommandBuffer();
+		CreateTransparencyCompositeCommandBuffer();
+	}
+}
+
+bool VulkanRenderer::IsRenderPathInitialized(RenderMode mode)
+{
+	switch (mode)
+	{
+	case RenderMode::DEFERRED:
+		return deferred_pipeline_ != nullptr;
+	case RenderMode::VISIBILITY:
+		return visibility_deferred_pipeline_ != nullptr;
+	case RenderMode::VISIBILITY_PEELED:
+		return visibility_peel_deferred_pipeline_ != nullptr;
+	case RenderMode::BUFFER_VIS:
+		return buffer_visualisation_pipeline_ != nullptr;
+	default:
+		return false;
+	}
+}
+
+void VulkanRenderer::EnableRenderPathPasses()
+{
+	// every path is declared in the render graph, the passes of the unselected paths are culled
+	for (auto& render_path : render_path_passes_)
+	{
+		for (RenderGraphHandle pass : render_path.second)
+			render_graph_->SetPassEnabled(pass, false);
+	}
+
+	for (RenderGraphHandle pass : render_path_passes_[render_mode_])
+		render_graph_->SetPassEnabled(pass, true);
 }
 
 void VulkanRenderer::InitForwardPipeline()
@@ -907,14 +1110,11 @@ void VulkanRenderer::InitDeferredPipeline()
 {
 	// create the deferred rendering shaders
 	g_buffer_shader_ = new VulkanShader();
-	g_buffer_shader_->Init(devices_, swap_chain_, "../res/shaders/g_buffer.vert.spv", "", "", "../res/shaders/g_buffer.frag.spv");
+	g_buffer_shader_->Init(devices_, swap_chain_, VertexPacker::GetShaderFilename("../res/shaders/g_buffer.vert.spv", vertex_format_), "", "", "../res/shaders/g_buffer.frag.spv", vertex_format_);
 
 	deferred_shader_ = new VulkanShader();
 	deferred_shader_->Init(devices_, swap_chain_, "../res/shaders/deferred.vert.spv", "", "", "../res/shaders/" + multisample_data[multisample_level_].deferred_shader);
-	
-	// initialize the g buffer
-	g_buffer_ = new VulkanRenderTarget();
-	g_buffer_->Init(devices_, VK_FORMAT_R32G32B32A32_SFLOAT, swap_chain_->GetIntermediateImageExtent().width, swap_chain_->GetIntermediateImageExtent().height, 2, false, multisample_data[multisample_level_].sample_count);
+
 
 	// initialize the g buffer pipeline
 	g_buffer_pipeline_ = new GBufferPipeline();
@@ -926,7 +1126,7 @@ void VulkanRenderer::InitDeferredPipeline()
 	g_buffer_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 1, material_buffer_->GetBuffer(), MAX_MATERIAL_COUNT * sizeof(MaterialData));
 	g_buffer_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 2, buffer_normalized_sampler_);
 	g_buffer_pipeline_->AddTextureArray(VK_SHADER_STAGE_FRAGMENT_BIT, 3, alpha_textures_);
-	g_buffer_pipeline_->Init(devices_, swap_chain_, primitive_buffer_);
+	pipeline_builder_.Add("g buffer", [=]() { g_buffer_pipeline_->Init(devices_, swap_chain_, primitive_buffer_); });
 
 	// calculate size of the light buffer
 	VkDeviceSize buffer_size = sizeof(SceneLightData) + (lights_.size() * sizeof(LightData));
@@ -955,10 +1155,7 @@ void VulkanRenderer::InitDeferredPipeline()
 
 	// set the deferred shader
 	deferred_pipeline_->SetShader(deferred_shader_);
-	deferred_pipeline_->Init(devices_, swap_chain_, primitive_buffer_);
-
-	// create the deferred command buffers
-	CreateDeferredCommandBuffers();
+	pipeline_builder_.Add("deferred shading", [=]() { deferred_pipeline_->Init(devices_, swap_chain_, primitive_buffer_); });
 }
 
 void VulkanRenderer::InitDeferredComputePipeline()
@@ -1001,22 +1198,18 @@ void VulkanRenderer::InitVisibilityPipeline()
 {
 	// create the visibility rendering shaders
 	visibility_shader_ = new VulkanShader();
-	visibility_shader_->Init(devices_, swap_chain_, "../res/shaders/visibility.vert.spv", "", "", "../res/shaders/visibility.frag.spv");
+	visibility_shader_->Init(devices_, swap_chain_, VertexPacker::GetShaderFilename("../res/shaders/visibility.vert.spv", vertex_format_), "", "", "../res/shaders/visibility.frag.spv", vertex_format_);
 
 	visibility_deferred_shader_ = new VulkanShader();
-	visibility_deferred_shader_->Init(devices_, swap_chain_, "../res/shaders/screen_space.vert.spv", "", "", "../res/shaders/" + multisample_data[multisample_level_].visibility_deferred_shader);
+	visibility_deferred_shader_->Init(devices_, swap_chain_, "../res/shaders/screen_space.vert.spv", "", "", VertexPacker::GetShaderFilename("../res/shaders/" + multisample_data[multisample_level_].visibility_deferred_shader, vertex_format_));
 
 	// create the visibility data buffer
-	devices_->CreateBuffer(sizeof(VisibilityRenderData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, visibility_data_buffer_, visibility_data_buffer_memory_);
+	visibility_data_constants_ = frame_constants_->AddBuffer(sizeof(VisibilityRenderData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	visibility_data_buffer_ = frame_constants_->GetBuffer(visibility_data_constants_);
 
 	// calculate size of the light buffer
 	VkDeviceSize buffer_size = sizeof(SceneLightData) + (lights_.size() * sizeof(LightData));
 
-	// initialize the visibility buffer
-	VkExtent2D swap_size = swap_chain_->GetIntermediateImageExtent();
-	visibility_buffer_ = new VulkanRenderTarget();
-	visibility_buffer_->Init(devices_, VK_FORMAT_R32_UINT, swap_size.width, swap_size.height, 1, false, multisample_data[multisample_level_].sample_count);
-
 	// initialize the visibility buffer generation pipeline
 	visibility_pipeline_ = new VisibilityPipeline();
 	visibility_pipeline_->SetShader(visibility_shader_);
@@ -1025,7 +1218,7 @@ void VulkanRenderer::InitVisibilityPipeline()
 	visibility_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 1, material_buffer_->GetBuffer(), MAX_MATERIAL_COUNT * sizeof(MaterialData));
 	visibility_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 2, buffer_normalized_sampler_);
 	visibility_pipeline_->AddTextureArray(VK_SHADER_STAGE_FRAGMENT_BIT, 3, alpha_textures_);
-	visibility_pipeline_->Init(devices_, swap_chain_, primitive_buffer_);
+	pipeline_builder_.Add("visibility", [=]() { visibility_pipeline_->Init(devices_, swap_chain_, primitive_buffer_); });
 
 	// initialize the deferred pipeline
 	visibility_deferred_pipeline_ = new VisibilityDeferredPipeline();
@@ -1047,7 +1240,7 @@ void VulkanRenderer::InitVisibilityPipeline()
 
 	// add the visibility buffer to the pipeline
 	visibility_deferred_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 12, visibility_buffer_->GetImageViews()[0]);
-	visibility_deferred_pipeline_->AddStorageBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 13, primitive_buffer_->GetVertexBuffer(), primitive_buffer_->GetVertexCount() * sizeof(Vertex));
+	visibility_deferred_pipeline_->AddStorageBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 13, primitive_buffer_->GetVertexBuffer(), primitive_buffer_->GetVertexBufferSize());
 	visibility_deferred_pipeline_->AddStorageBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 14, primitive_buffer_->GetIndexBuffer(), primitive_buffer_->GetIndexCount() * sizeof(uint32_t));
 	visibility_deferred_pipeline_->AddStorageBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 15, primitive_buffer_->GetShapeBuffer(), primitive_buffer_->GetShapeCount() * sizeof(ShapeData));
 	visibility_deferred_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 16, visibility_data_buffer_, sizeof(VisibilityRenderData));
@@ -1055,10 +1248,7 @@ void VulkanRenderer::InitVisibilityPipeline()
 	visibility_deferred_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 18, buffer_unnormalized_sampler_);
 	visibility_deferred_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 19, buffer_normalized_sampler_);
 
-	visibility_deferred_pipeline_->Init(devices_, swap_chain_, primitive_buffer_);
-
-	CreateVisibilityCommandBuffer();
-	CreateVisibilityDeferredCommandBuffer();
+	pipeline_builder_.Add("visibility shading", [=]() { visibility_deferred_pipeline_->Init(devices_, swap_chain_, primitive_buffer_); });
 }
 
 void VulkanRenderer::InitVisibilityPeelPipeline()
@@ -1070,22 +1260,14 @@ void VulkanRenderer::InitVisibilityPeelPipeline()
 	visibility_peel_shader_ = new VulkanShader();
 
 	if(multisample_level_ > 1)
-		visibility_peel_shader_->Init(devices_, swap_chain_, "../res/shaders/visibility_front_peel.vert.spv", "", "", "../res/shaders/visibility_front_peel_msaa.frag.spv");
+		visibility_peel_shader_->Init(devices_, swap_chain_, VertexPacker::GetShaderFilename("../res/shaders/visibility_front_peel.vert.spv", vertex_format_), "", "", "../res/shaders/visibility_front_peel_msaa.frag.spv", vertex_format_);
 	else
-		visibility_peel_shader_->Init(devices_, swap_chain_, "../res/shaders/visibility_front_peel.vert.spv", "", "", "../res/shaders/visibility_front_peel.frag.spv");
+		visibility_peel_shader_->Init(devices_, swap_chain_, VertexPacker::GetShaderFilename("../res/shaders/visibility_front_peel.vert.spv", vertex_format_), "", "", "../res/shaders/visibility_front_peel.frag.spv", vertex_format_);
 
 	visibility_peel_deferred_shader_ = new VulkanShader();
-	visibility_peel_deferred_shader_->Init(devices_, swap_chain_, "../res/shaders/screen_space.vert.spv", "", "", "../res/shaders/" + multisample_data[multisample_level_].visibility_peel_deferred_shader);
-	
-	// initalize the peeled visibility buffer
-	VkExtent2D swap_size = swap_chain_->GetIntermediateImageExtent();
-	visibility_peel_buffer_ = new VulkanRenderTarget();
-	visibility_peel_buffer_->Init(devices_, VK_FORMAT_R32_UINT, swap_size.width, swap_size.height, VISIBILITY_PEEL_COUNT, false, multisample_data[multisample_level_].sample_count);
+	visibility_peel_deferred_shader_->Init(devices_, swap_chain_, "../res/shaders/screen_space.vert.spv", "", "", VertexPacker::GetShaderFilename("../res/shaders/" + multisample_data[multisample_level_].visibility_peel_deferred_shader, vertex_format_));
+
 
-	// initialize the min max depth buffer
-	peel_depth_buffer_ = new VulkanRenderTarget();
-	peel_depth_buffer_->Init(devices_, VK_FORMAT_D32_SFLOAT, swap_size.width, swap_size.height, VISIBILITY_PEEL_COUNT, false, multisample_data[multisample_level_].sample_count);
-	
 	std::vector<VkImageView> visibility_peels = visibility_peel_buffer_->GetImageViews();
 	std::vector<VkImageView> depth_peels = peel_depth_buffer_->GetImageViews();
 
@@ -1109,11 +1291,13 @@ void VulkanRenderer::InitVisibilityPeelPipeline()
 		visibility_peel_pipelines_[i]->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 5, buffer_unnormalized_sampler_);
 
 		// initialize the visibility peel pipelines
-		visibility_peel_pipelines_[i]->Init(devices_, swap_chain_, primitive_buffer_);
+		VisibilityFrontPeelPipeline* peel_pipeline = visibility_peel_pipelines_[i];
+		pipeline_builder_.Add("visibility peel " + std::to_string(i), [=]() { peel_pipeline->Init(devices_, swap_chain_, primitive_buffer_); });
 	}
 
 	// create the visibility data buffer
-	devices_->CreateBuffer(sizeof(VisibilityPeelRenderData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, visibility_data_buffer_, visibility_data_buffer_memory_);
+	visibility_peel_data_constants_ = frame_constants_->AddBuffer(sizeof(VisibilityPeelRenderData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	visibility_peel_data_buffer_ = frame_constants_->GetBuffer(visibility_peel_data_constants_);
 
 	// create the visibility peel deferred pipelines
 	visibility_peel_deferred_pipeline_ = new VisibilityPeelDeferredPipeline();
@@ -1139,37 +1323,26 @@ void VulkanRenderer::InitVisibilityPeelPipeline()
 	visibility_peel_deferred_pipeline_->AddTextureArray(VK_SHADER_STAGE_FRAGMENT_BIT, 12, visibility_peel_buffer_->GetImageViews());
 	visibility_peel_deferred_pipeline_->AddTextureArray(VK_SHADER_STAGE_FRAGMENT_BIT, 13, peel_depth_buffer_->GetImageViews());
 	visibility_peel_deferred_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 14, buffer_unnormalized_sampler_);
-	visibility_peel_deferred_pipeline_->AddStorageBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 15, primitive_buffer_->GetVertexBuffer(), primitive_buffer_->GetVertexCount() * sizeof(Vertex));
+	visibility_peel_deferred_pipeline_->AddStorageBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 15, primitive_buffer_->GetVertexBuffer(), primitive_buffer_->GetVertexBufferSize());
 	visibility_peel_deferred_pipeline_->AddStorageBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 16, primitive_buffer_->GetIndexBuffer(), primitive_buffer_->GetIndexCount() * sizeof(uint32_t));
 	visibility_peel_deferred_pipeline_->AddStorageBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 17, primitive_buffer_->GetShapeBuffer(), primitive_buffer_->GetShapeCount() * sizeof(ShapeData));
-	visibility_peel_deferred_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 18, visibility_data_buffer_, sizeof(VisibilityRenderData));
+	visibility_peel_deferred_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 18, visibility_peel_data_buffer_, sizeof(VisibilityRenderData));
 	visibility_peel_deferred_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 19, buffer_normalized_sampler_);
-	visibility_peel_deferred_pipeline_->Init(devices_, swap_chain_, primitive_buffer_);
-
-	CreateVisibilityPeelCommandBuffers();
-	CreateVisibilityPeelDeferredCommandBuffers();
+	pipeline_builder_.Add("visibility peel shading", [=]() { visibility_peel_deferred_pipeline_->Init(devices_, swap_chain_, primitive_buffer_); });
 }
 
 void VulkanRenderer::InitTransparencyPipeline()
 {
 	// create the tranparency rendering shaders
 	transparency_shader_ = new VulkanShader();
-	transparency_shader_->Init(devices_, swap_chain_, "../res/shaders/default_material.vert.spv", "", "", "../res/shaders/weighted_blended_transparency.frag.spv");
+	transparency_shader_->Init(devices_, swap_chain_, VertexPacker::GetShaderFilename("../res/shaders/default_material.vert.spv", vertex_format_), "", "", "../res/shaders/weighted_blended_transparency.frag.spv", vertex_format_);
 
 	transparency_composite_shader_ = new VulkanShader();
 	transparency_composite_shader_->Init(devices_, swap_chain_, "../res/shaders/screen_space.vert.spv", "", "", "../res/shaders/" + multisample_data[multisample_level_].transparency_composite_shader);
 
-	VkExtent2D image_extent = swap_chain_->GetIntermediateImageExtent();
-
 	// calculate size of the light buffer
 	VkDeviceSize buffer_size = sizeof(SceneLightData) + (lights_.size() * sizeof(LightData));
 
-	// create the transparency buffers
-	accumulation_buffer_ = new VulkanRenderTarget();
-	accumulation_buffer_->Init(devices_, VK_FORMAT_R16G16B16A16_SFLOAT, image_extent.width, image_extent.height, 1, false, multisample_data[multisample_level_].sample_count);
-	revealage_buffer_ = new VulkanRenderTarget();
-	revealage_buffer_->Init(devices_, VK_FORMAT_R16_SFLOAT, image_extent.width, image_extent.height, 1, false, multisample_data[multisample_level_].sample_count);
-
 	// create the transparency pipeline
 	transparency_pipeline_ = new WeightedBlendedTransparencyPipeline();
 	transparency_pipeline_->SetShader(transparency_shader_);
@@ -1192,7 +1365,7 @@ void VulkanRenderer::InitTransparencyPipeline()
 	transparency_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 14, buffer_normalized_sampler_);
 
 	// initialize the transparency pipeline
-	transparency_pipeline_->Init(devices_, swap_chain_, primitive_buffer_);
+	pipeline_builder_.Add("transparency", [=]() { transparency_pipeline_->Init(devices_, swap_chain_, primitive_buffer_); });
 
 	// create the composite pipeline
 	transparency_composite_pipeline_ = new TransparencyCompositePipeline();
@@ -1204,9 +1377,50 @@ void VulkanRenderer::InitTransparencyPipeline()
 	transparency_composite_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 2, revealage_buffer_->GetImageViews()[0]);
 
 	// initialize the transparency composite pipeline
-	transparency_composite_pipeline_->Init(devices_, swap_chain_, nullptr);
+	pipeline_builder_.Add("transparency composite", [=]() { transparency_composite_pipeline_->Init(devices_, swap_chain_, nullptr); });
+}
+
+void VulkanRenderer::InitBufferVisualisationPipeline()
+{
+	// create the buffer visualisation shaders, the overdraw pass redraws the visibility pass's geometry
+	overdraw_shader_ = new VulkanShader();
+	overdraw_shader_->Init(devices_, swap_chain_, VertexPacker::GetShaderFilename("../res/shaders/visibility.vert.spv", vertex_format_), "", "", "../res/shaders/overdraw.frag.spv", vertex_format_);
+
+	buffer_visualisation_shader_ = new VulkanShader();
+	buffer_visualisation_shader_->Init(devices_, swap_chain_, "../res/shaders/buffer_visualisation.vert.spv", "", "", VertexPacker::GetShaderFilename("../res/shaders/buffer_visualisation.frag.spv", vertex_format_));
+
+	// create the buffer visualisation data buffer
+	buffer_visualisation_data_constants_ = frame_constants_->AddBuffer(sizeof(BufferVisualisationData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	buffer_visualisation_data_buffer_ = frame_constants_->GetBuffer(buffer_visualisation_data_constants_);
+
+	// calculate size of the light buffer
+	VkDeviceSize buffer_size = sizeof(SceneLightData) + (lights_.size() * sizeof(LightData));
 
-	CreateTransparencyCompositeCommandBuffer();
+	// initialize the overdraw pipeline
+	overdraw_pipeline_ = new OverdrawPipeline();
+	overdraw_pipeline_->SetShader(overdraw_shader_);
+	overdraw_pipeline_->SetOverdrawBuffer(overdraw_buffer_);
+	overdraw_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 0, matrix_buffer_, sizeof(UniformBufferObject));
+	overdraw_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 1, material_buffer_->GetBuffer(), MAX_MATERIAL_COUNT * sizeof(MaterialData));
+	overdraw_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 2, buffer_normalized_sampler_);
+	overdraw_pipeline_->AddTextureArray(VK_SHADER_STAGE_FRAGMENT_BIT, 3, alpha_textures_);
+	pipeline_builder_.Add("overdraw", [=]() { overdraw_pipeline_->Init(devices_, swap_chain_, primitive_buffer_); });
+
+	// initialize the buffer visualisation pipeline
+	buffer_visualisation_pipeline_ = new BufferVisualisationPipeline();
+	buffer_visualisation_pipeline_->SetShader(buffer_visualisation_shader_);
+	buffer_visualisation_pipeline_->AddStorageBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 0, light_buffer_, buffer_size);
+	buffer_visualisation_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 1, buffer_visualisation_data_buffer_, sizeof(BufferVisualisationData));
+	buffer_visualisation_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 2, buffer_unnormalized_sampler_);
+	buffer_visualisation_pipeline_->AddTextureArray(VK_SHADER_STAGE_FRAGMENT_BIT, 3, visibility_peel_buffer_->GetImageViews());
+	buffer_visualisation_pipeline_->AddTextureArray(VK_SHADER_STAGE_FRAGMENT_BIT, 4, peel_depth_buffer_->GetImageViews());
+	buffer_visualisation_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 5, overdraw_buffer_->GetImageViews()[0]);
+	buffer_visualisation_pipeline_->AddTextureArray(VK_SHADER_STAGE_FRAGMENT_BIT, 6, shadow_maps_);
+	buffer_visualisation_pipeline_->AddStorageBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 7, primitive_buffer_->GetVertexBuffer(), primitive_buffer_->GetVertexBufferSize());
+	buffer_visualisation_pipeline_->AddStorageBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 8, primitive_buffer_->GetIndexBuffer(), primitive_buffer_->GetIndexCount() * sizeof(uint32_t));
+	buffer_visualisation_pipeline_->AddStorageBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 9, primitive_buffer_->GetShapeBuffer(), primitive_buffer_->GetShapeCount() * sizeof(ShapeData));
+	buffer_visualisation_pipeline_->AddStorageBuffer(VK_SHADER_STAGE_FRAGMENT_BIT, 10, primitive_buffer_->GetIndirectDrawBuffer(), primitive_buffer_->GetShapeCount() * sizeof(IndirectDrawCommand));
+	pipeline_builder_.Add("buffer visualisation", [=]() { buffer_visualisation_pipeline_->Init(devices_, swap_chain_, primitive_buffer_); });
 }
 
 void VulkanRenderer::RecreateSwapChainFeatures()
@@ -1230,10 +1444,7 @@ void VulkanRenderer::CreateCommandPool()
 
 void VulkanRenderer::CreateCommandBuffers()
 {
-	CreateGBufferCommandBuffers();
-	CreateVisibilityCommandBuffer();
-	CreateTransparencyCommandBuffer();
-	CreateBufferVisualisationCommandBuffers();
+	// the render paths' command buffers are created with their pipelines
 	CreateCullingCommandBuffer();
 }
 
@@ -1293,6 +1504,9 @@ void VulkanRenderer::CreateGBufferCommandBuffers()
 
 		if (g_buffer_pipeline_)
 		{
+			// count the pass's primitives, invocations and samples around its render pass
+			pipeline_statistics_->RecordBegin(g_buffer_command_buffers_[i], GetPassStatisticsScope(g_buffer_pass_));
+
 			// bind pipeline
 			g_buffer_pipeline_->RecordCommands(g_buffer_command_buffers_[i], i);
 
@@ -1300,6 +1514,7 @@ void VulkanRenderer::CreateGBufferCommandBuffers()
 			primitive_buffer_->RecordIndirectDrawCommands(g_buffer_command_buffers_[i]);
 
 			vkCmdEndRenderPass(g_buffer_command_buffers_[i]);
+			pipeline_statistics_->RecordEnd(g_buffer_command_buffers_[i], GetPassStatisticsScope(g_buffer_pass_));
 		}
 
 		if (vkEndCommandBuffer(g_buffer_command_buffers_[i]) != VK_SUCCESS)
@@ -1349,10 +1564,13 @@ void VulkanRenderer::CreateDeferredCommandBuffers()
 
 	if (deferred_pipeline_)
 	{
+		pipeline_statistics_->RecordBegin(deferred_command_buffer_, GetPassStatisticsScope(deferred_shading_pass_));
+
 		// bind pipeline
 		deferred_pipeline_->RecordCommands(deferred_command_buffer_, 0);
 
 		vkCmdEndRenderPass(deferred_command_buffer_);
+		pipeline_statistics_->RecordEnd(deferred_command_buffer_, GetPassStatisticsScope(deferred_shading_pass_));
 	}
 
 	if (vkEndCommandBuffer(deferred_command_buffer_) != VK_SUCCESS)
@@ -1375,12 +1593,15 @@ void VulkanRenderer::CreateVisibilityCommandBuffer()
 
 	if (visibility_pipeline_)
 	{
+		pipeline_statistics_->RecordBegin(visibility_command_buffer_, GetPassStatisticsScope(visibility_pass_));
+
 		// bind pipeline
 		visibility_pipeline_->RecordCommands(visibility_command_buffer_, 0);
 
 		primitive_buffer_->RecordIndirectDrawCommands(visibility_command_buffer_);
 
 		vkCmdEndRenderPass(visibility_command_buffer_);
+		pipeline_statistics_->RecordEnd(visibility_command_buffer_, GetPassStatisticsScope(visibility_pass_));
 	}
 
 	if (vkEndCommandBuffer(visibility_command_buffer_) != VK_SUCCESS)
@@ -1404,10 +1625,13 @@ void VulkanRenderer::CreateVisibilityDeferredCommandBuffer()
 
 	if (visibility_deferred_pipeline_)
 	{
+		pipeline_statistics_->RecordBegin(visibility_deferred_command_buffer_, GetPassStatisticsScope(visibility_shading_pass_));
+
 		// bind pipeline
 		visibility_deferred_pipeline_->RecordCommands(visibility_deferred_command_buffer_, 0);
 
 		vkCmdEndRenderPass(visibility_deferred_command_buffer_);
+		pipeline_statistics_->RecordEnd(visibility_deferred_command_buffer_, GetPassStatisticsScope(visibility_shading_pass_));
 	}
 
 	if (vkEndCommandBuffer(visibility_deferred_command_buffer_) != VK_SUCCESS)
@@ -1435,12 +1659,15 @@ void VulkanRenderer::CreateVisibilityPeelCommandBuffers()
 
 		if (visibility_peel_pipelines_[i])
 		{
+			pipeline_statistics_->RecordBegin(visibility_peel_command_buffers_[i], GetPassStatisticsScope(visibility_peel_passes_[i]));
+
 			// bind pipeline
 			visibility_peel_pipelines_[i]->RecordCommands(visibility_peel_command_buffers_[i], 0);
 
 			primitive_buffer_->RecordIndirectDrawCommands(visibility_peel_command_buffers_[i]);
 
 			vkCmdEndRenderPass(visibility_peel_command_buffers_[i]);
+			pipeline_statistics_->RecordEnd(visibility_peel_command_buffers_[i], GetPassStatisticsScope(visibility_peel_passes_[i]));
 		}
 
 		if (vkEndCommandBuffer(visibility_peel_command_buffers_[i]) != VK_SUCCESS)
@@ -1465,10 +1692,13 @@ void VulkanRenderer::CreateVisibilityPeelDeferredCommandBuffers()
 
 	if (visibility_peel_deferred_pipeline_)
 	{
+		pipeline_statistics_->RecordBegin(visibility_peel_deferred_command_buffer_, GetPassStatisticsScope(visibility_peel_shading_pass_));
+
 		// bind pipeline
 		visibility_peel_deferred_pipeline_->RecordCommands(visibility_peel_deferred_command_buffer_, 0);
 
 		vkCmdEndRenderPass(visibility_peel_deferred_command_buffer_);
+		pipeline_statistics_->RecordEnd(visibility_peel_deferred_command_buffer_, GetPassStatisticsScope(visibility_peel_shading_pass_));
 	}
 
 	if (vkEndCommandBuffer(visibility_peel_deferred_command_buffer_) != VK_SUCCESS)
@@ -1492,6 +1722,8 @@ void VulkanRenderer::CreateTransparencyCommandBuffer()
 
 	if (transparency_pipeline_)
 	{
+		pipeline_statistics_->RecordBegin(transparency_command_buffer_, GetPassStatisticsScope(transparency_pass_));
+
 		// bind pipeline
 		transparency_pipeline_->RecordCommands(transparency_command_buffer_, 0);
 
@@ -1501,6 +1733,7 @@ void VulkanRenderer::CreateTransparencyCommandBuffer()
 		}
 
 		vkCmdEndRenderPass(transparency_command_buffer_);
+		pipeline_statistics_->RecordEnd(transparency_command_buffer_, GetPassStatisticsScope(transparency_pass_));
 	}
 
 	if (vkEndCommandBuffer(transparency_command_buffer_) != VK_SUCCESS)
@@ -1523,10 +1756,13 @@ void VulkanRenderer::CreateTransparencyCompositeCommandBuffer()
 
 	if (transparency_composite_pipeline_)
 	{
+		pipeline_statistics_->RecordBegin(transparency_composite_command_buffer_, GetPassStatisticsScope(transparency_composite_pass_));
+
 		// bind pipeline
 		transparency_composite_pipeline_->RecordCommands(transparency_composite_command_buffer_, 0);
 
 		vkCmdEndRenderPass(transparency_composite_command_buffer_);
+		pipeline_statistics_->RecordEnd(transparency_composite_command_buffer_, GetPassStatisticsScope(transparency_composite_pass_));
 	}
 
 	if (vkEndCommandBuffer(transparency_composite_command_buffer_) != VK_SUCCESS)
@@ -1535,38 +1771,58 @@ void VulkanRenderer::CreateTransparencyCompositeCommandBuffer()
 	}
 }
 
-void VulkanRenderer::CreateBufferVisualisationCommandBuffers()
+void VulkanRenderer::CreateOverdrawCommandBuffer()
 {
-	int buffer_count = swap_chain_->GetSwapChainImages().size();
+	// create the overdraw command buffer
+	devices_->CreateCommandBuffers(command_pool_, &overdraw_command_buffer_);
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+	begin_info.pInheritanceInfo = nullptr;
 
-	// create buffer visualisation command buffers
-	buffer_visualisation_command_buffers_.resize(buffer_count);
-	devices_->CreateCommandBuffers(command_pool_, buffer_visualisation_command_buffers_.data(), buffer_count);
+	vkBeginCommandBuffer(overdraw_command_buffer_, &begin_info);
 
-	// record the command buffers
-	for (size_t i = 0; i < buffer_visualisation_command_buffers_.size(); i++)
+	if (overdraw_pipeline_)
 	{
-		VkCommandBufferBeginInfo begin_info = {};
-		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-		begin_info.pInheritanceInfo = nullptr;
+		// bind pipeline
+		overdraw_pipeline_->RecordCommands(overdraw_command_buffer_, 0);
 
-		vkBeginCommandBuffer(buffer_visualisation_command_buffers_[i], &begin_info);
+		primitive_buffer_->RecordIndirectDrawCommands(overdraw_command_buffer_);
 
-		if (buffer_visualisation_pipeline_)
-		{
-			// bind pipeline
-			buffer_visualisation_pipeline_->RecordCommands(buffer_visualisation_command_buffers_[i], i);
+		vkCmdEndRenderPass(overdraw_command_buffer_);
+	}
 
-			vkCmdEndRenderPass(buffer_visualisation_command_buffers_[i]);
-		}
+	if (vkEndCommandBuffer(overdraw_command_buffer_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record overdraw command buffer!");
+	}
+}
 
-		if (vkEndCommandBuffer(buffer_visualisation_command_buffers_[i]) != VK_SUCCESS)
-		{
-			throw std::runtime_error("failed to record render command buffer!");
-		}
+void VulkanRenderer::CreateBufferVisualisationCommandBuffer()
+{
+	// create the buffer visualisation command buffer
+	devices_->CreateCommandBuffers(command_pool_, &buffer_visualisation_command_buffer_);
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+	begin_info.pInheritanceInfo = nullptr;
+
+	vkBeginCommandBuffer(buffer_visualisation_command_buffer_, &begin_info);
+
+	if (buffer_visualisation_pipeline_)
+	{
+		// bind pipeline, the view is read from the visualisation data so the commands are recorded once
+		buffer_visualisation_pipeline_->RecordCommands(buffer_visualisation_command_buffer_, 0);
+
+		vkCmdEndRenderPass(buffer_visualisation_command_buffer_);
 	}
 
+	if (vkEndCommandBuffer(buffer_visualisation_command_buffer_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record buffer visualisation command buffer!");
+	}
 }
 
 void VulkanRenderer::CreateCullingCommandBuffer()
@@ -1590,17 +1846,243 @@ void VulkanRenderer::CreateCullingCommandBuffer()
 	vkEndCommandBuffer(shape_culling_command_buffer_);
 }
 
+void VulkanRenderer::BuildRenderGraph()
+{
+	TRACE_FUNCTION();
+
+	render_graph_->Reset();
+	visibility_passes_.clear();
+	shading_passes_.clear();
+	transparency_passes_.clear();
+	post_process_passes_.clear();
+
+	const VkPipelineStageFlags depth_stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	const VkAccessFlags depth_access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	const VkAccessFlags color_access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	// resources shared between passes
+	RenderGraphHandle indirect_draws = render_graph_->AddResource("indirect draws");
+	RenderGraphHandle scene_color = render_graph_->AddResource("scene color");
+	RenderGraphHandle scene_depth = render_graph_->AddResource("scene depth");
+	RenderGraphHandle hdr_output = render_graph_->AddResource("hdr output", hdr_->GetTonemapTarget());
+	RenderGraphHandle swap_chain_image = render_graph_->AddResource("swap chain image");
+	render_graph_->SetOutput(swap_chain_image);
+
+	// clear the frame's targets, the command buffer is recorded per frame
+	setup_pass_ = render_graph_->AddPass("frame setup", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddWrite(setup_pass_, scene_color, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+	render_graph_->AddWrite(setup_pass_, scene_depth, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+	// render the skybox
+	skybox_pass_ = render_graph_->AddPass("skybox", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(skybox_pass_, scene_color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
+	render_graph_->AddWrite(skybox_pass_, scene_color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+
+	// cull the scene geometry
+	culling_pass_ = render_graph_->AddPass("shape culling", RenderGraphQueue::COMPUTE);
+	render_graph_->AddWrite(culling_pass_, indirect_draws, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+	// render the scene, every render path is declared and the passes of the unselected paths are disabled,
+	// the paths run in turn so their transient targets share memory
+	render_path_passes_.clear();
+
+	// visibility peeling
+	RenderGraphHandle visibility_peel = render_graph_->AddResource("visibility peel", visibility_peel_buffer_);
+	RenderGraphHandle peel_depth = render_graph_->AddResource("peel depth", peel_depth_buffer_);
+	std::vector<RenderGraphHandle>& peel_path = render_path_passes_[RenderMode::VISIBILITY_PEELED];
+
+	// the setup pass also clears the last peel depth layer, the first peel reads it before it is written
+	render_graph_->AddWrite(setup_pass_, peel_depth, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+	// each layer peels against the depth of the previous one
+	for (int i = 0; i < VISIBILITY_PEEL_COUNT; i++)
+	{
+		RenderGraphHandle peel_pass = render_graph_->AddPass("visibility peel " + std::to_string(i), RenderGraphQueue::GRAPHICS);
+		render_graph_->AddRead(peel_pass, indirect_draws, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+		render_graph_->AddRead(peel_pass, peel_depth, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+		render_graph_->AddWrite(peel_pass, peel_depth, depth_stages, depth_access);
+		render_graph_->AddRead(peel_pass, visibility_peel, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
+		render_graph_->AddWrite(peel_pass, visibility_peel, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+		visibility_passes_.push_back(peel_pass);
+		peel_path.push_back(peel_pass);
+		visibility_peel_passes_[i] = peel_pass;
+	}
+
+	visibility_peel_shading_pass_ = render_graph_->AddPass("visibility peel shading", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(visibility_peel_shading_pass_, visibility_peel, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddRead(visibility_peel_shading_pass_, peel_depth, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddRead(visibility_peel_shading_pass_, scene_color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
+	render_graph_->AddWrite(visibility_peel_shading_pass_, scene_color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+	shading_passes_.push_back(visibility_peel_shading_pass_);
+	peel_path.push_back(visibility_peel_shading_pass_);
+
+	// deferred
+	RenderGraphHandle g_buffer = render_graph_->AddResource("g buffer", g_buffer_);
+
+	g_buffer_pass_ = render_graph_->AddPass("g buffer", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(g_buffer_pass_, indirect_draws, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+	render_graph_->AddRead(g_buffer_pass_, scene_depth, depth_stages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT);
+	render_graph_->AddWrite(g_buffer_pass_, scene_depth, depth_stages, depth_access);
+	render_graph_->AddWrite(g_buffer_pass_, g_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, color_access);
+	visibility_passes_.push_back(g_buffer_pass_);
+
+	deferred_shading_pass_ = render_graph_->AddPass("deferred shading", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(deferred_shading_pass_, g_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddRead(deferred_shading_pass_, scene_depth, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddRead(deferred_shading_pass_, scene_color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
+	render_graph_->AddWrite(deferred_shading_pass_, scene_color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+	shading_passes_.push_back(deferred_shading_pass_);
+
+	// visibility buffer
+	RenderGraphHandle visibility = render_graph_->AddResource("visibility buffer", visibility_buffer_);
+
+	visibility_pass_ = render_graph_->AddPass("visibility", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(visibility_pass_, indirect_draws, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+	render_graph_->AddRead(visibility_pass_, scene_depth, depth_stages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT);
+	render_graph_->AddWrite(visibility_pass_, scene_depth, depth_stages, depth_access);
+	render_graph_->AddWrite(visibility_pass_, visibility, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, color_access);
+	visibility_passes_.push_back(visibility_pass_);
+
+	visibility_shading_pass_ = render_graph_->AddPass("visibility shading", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(visibility_shading_pass_, visibility, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddRead(visibility_shading_pass_, scene_depth, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddRead(visibility_shading_pass_, scene_color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
+	render_graph_->AddWrite(visibility_shading_pass_, scene_color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+	shading_passes_.push_back(visibility_shading_pass_);
+
+	// accumulate the transparent geometry and composite it over the shaded scene
+	RenderGraphHandle accumulation = render_graph_->AddResource("accumulation buffer", accumulation_buffer_);
+	RenderGraphHandle revealage = render_graph_->AddResource("revealage buffer", revealage_buffer_);
+
+	transparency_pass_ = render_graph_->AddPass("transparency", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(transparency_pass_, scene_depth, depth_stages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT);
+	render_graph_->AddWrite(transparency_pass_, accumulation, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, color_access);
+	render_graph_->AddWrite(transparency_pass_, revealage, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, color_access);
+	transparency_passes_.push_back(transparency_pass_);
+
+	transparency_composite_pass_ = render_graph_->AddPass("transparency composite", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(transparency_composite_pass_, accumulation, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddRead(transparency_composite_pass_, revealage, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddRead(transparency_composite_pass_, scene_color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
+	render_graph_->AddWrite(transparency_composite_pass_, scene_color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+	transparency_passes_.push_back(transparency_composite_pass_);
+
+	// the deferred and visibility paths share the transparency passes, the peeled path shades every layer
+	render_path_passes_[RenderMode::DEFERRED] = { g_buffer_pass_, deferred_shading_pass_, transparency_pass_, transparency_composite_pass_ };
+	render_path_passes_[RenderMode::VISIBILITY] = { visibility_pass_, visibility_shading_pass_, transparency_pass_, transparency_composite_pass_ };
+
+	// buffer visualisation, the peel layers are drawn as the peeled path draws them and replace its shading with the selected view
+	RenderGraphHandle overdraw = render_graph_->AddResource("overdraw buffer", overdraw_buffer_);
+
+	overdraw_pass_ = render_graph_->AddPass("overdraw", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(overdraw_pass_, indirect_draws, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+	render_graph_->AddRead(overdraw_pass_, scene_depth, depth_stages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT);
+	render_graph_->AddWrite(overdraw_pass_, scene_depth, depth_stages, depth_access);
+	render_graph_->AddWrite(overdraw_pass_, overdraw, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, color_access);
+	visibility_passes_.push_back(overdraw_pass_);
+
+	buffer_visualisation_pass_ = render_graph_->AddPass("buffer visualisation", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(buffer_visualisation_pass_, visibility_peel, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddRead(buffer_visualisation_pass_, peel_depth, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddRead(buffer_visualisation_pass_, overdraw, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddRead(buffer_visualisation_pass_, indirect_draws, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddRead(buffer_visualisation_pass_, scene_color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
+	render_graph_->AddWrite(buffer_visualisation_pass_, scene_color, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+	shading_passes_.push_back(buffer_visualisation_pass_);
+
+	render_path_passes_[RenderMode::BUFFER_VIS] = std::vector<RenderGraphHandle>(visibility_peel_passes_, visibility_peel_passes_ + VISIBILITY_PEEL_COUNT);
+	render_path_passes_[RenderMode::BUFFER_VIS].insert(render_path_passes_[RenderMode::BUFFER_VIS].end(), { overdraw_pass_, buffer_visualisation_pass_ });
+
+	// hdr post processing, every pass samples the output of the previous one
+	RenderGraphHandle hdr_bright = render_graph_->AddResource("hdr bright", hdr_->GetLDRSuppressTarget());
+	RenderGraphHandle hdr_horizontal_blur = render_graph_->AddResource("hdr horizontal blur", hdr_->GetBlurTarget());
+	RenderGraphHandle hdr_vertical_blur = render_graph_->AddResource("hdr vertical blur", hdr_->GetBlurTarget());
+
+	hdr_passes_[0] = render_graph_->AddPass("ldr suppress", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(hdr_passes_[0], scene_color, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddWrite(hdr_passes_[0], hdr_bright, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, color_access);
+
+	hdr_passes_[1] = render_graph_->AddPass("horizontal blur", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(hdr_passes_[1], hdr_bright, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddWrite(hdr_passes_[1], hdr_horizontal_blur, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, color_access);
+
+	hdr_passes_[2] = render_graph_->AddPass("vertical blur", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(hdr_passes_[2], hdr_horizontal_blur, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddWrite(hdr_passes_[2], hdr_vertical_blur, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, color_access);
+
+	hdr_passes_[3] = render_graph_->AddPass("tonemap", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(hdr_passes_[3], scene_color, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddRead(hdr_passes_[3], hdr_vertical_blur, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	render_graph_->AddWrite(hdr_passes_[3], hdr_output, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, color_access);
+
+	for (RenderGraphHandle pass : hdr_passes_)
+		post_process_passes_.push_back(pass);
+
+	// count the primitives and shader invocations of the geometry and shading passes
+	pass_statistics_scopes_.clear();
+	std::vector<RenderGraphHandle> counted_passes = { g_buffer_pass_, deferred_shading_pass_, visibility_pass_, visibility_shading_pass_ };
+	counted_passes.insert(counted_passes.end(), visibility_peel_passes_, visibility_peel_passes_ + VISIBILITY_PEEL_COUNT);
+	counted_passes.insert(counted_passes.end(), { visibility_peel_shading_pass_, transparency_pass_, transparency_composite_pass_ });
+	for (RenderGraphHandle pass : counted_passes)
+		pass_statistics_scopes_[pass] = pipeline_statistics_->AddScope(render_graph_->GetPassName(pass));
+
+	// copy the scene or the tonemapped image to the swap chain, the command buffer is recorded per frame
+	present_pass_ = render_graph_->AddPass("present", RenderGraphQueue::GRAPHICS);
+	render_graph_->AddRead(present_pass_, scene_color, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+	render_graph_->AddRead(present_pass_, hdr_output, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+	render_graph_->AddRead(present_pass_, indirect_draws, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+	render_graph_->AddWrite(present_pass_, swap_chain_image, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+}
+
+void VulkanRenderer::SetRenderGraphCommandBuffers()
+{
+	// the passes are declared before their pipelines exist, the pre-recorded command buffers are attached once they are created
+	render_graph_->SetCommandBuffer(skybox_pass_, skybox_->GetCommandBuffer());
+	render_graph_->SetCommandBuffer(culling_pass_, shape_culling_command_buffer_);
+
+	// a render path's command buffers exist once it has been selected
+	if (IsRenderPathInitialized(RenderMode::DEFERRED))
+	{
+		render_graph_->SetCommandBuffer(g_buffer_pass_, g_buffer_command_buffers_[0]);
+		render_graph_->SetCommandBuffer(deferred_shading_pass_, deferred_command_buffer_);
+	}
+
+	if (IsRenderPathInitialized(RenderMode::VISIBILITY))
+	{
+		render_graph_->SetCommandBuffer(visibility_pass_, visibility_command_buffer_);
+		render_graph_->SetCommandBuffer(visibility_shading_pass_, visibility_deferred_command_buffer_);
+	}
+
+	if (IsRenderPathInitialized(RenderMode::VISIBILITY_PEELED))
+	{
+		for (int i = 0; i < VISIBILITY_PEEL_COUNT; i++)
+			render_graph_->SetCommandBuffer(visibility_peel_passes_[i], visibility_peel_command_buffers_[i]);
+		render_graph_->SetCommandBuffer(visibility_peel_shading_pass_, visibility_peel_deferred_command_buffer_);
+	}
+
+	if (IsRenderPathInitialized(RenderMode::BUFFER_VIS))
+	{
+		render_graph_->SetCommandBuffer(overdraw_pass_, overdraw_command_buffer_);
+		render_graph_->SetCommandBuffer(buffer_visualisation_pass_, buffer_visualisation_command_buffer_);
+	}
+
+	render_graph_->SetCommandBuffer(transparency_pass_, transparency_command_buffer_);
+	render_graph_->SetCommandBuffer(transparency_composite_pass_, transparency_composite_command_buffer_);
+
+	render_graph_->SetCommandBuffer(hdr_passes_[0], hdr_->GetLDRSuppressCommandBuffer());
+	render_graph_->SetCommandBuffer(hdr_passes_[1], hdr_->GetGaussianBlurCommandBuffer(0));
+	render_graph_->SetCommandBuffer(hdr_passes_[2], hdr_->GetGaussianBlurCommandBuffer(1));
+	render_graph_->SetCommandBuffer(hdr_passes_[3], hdr_->GetTonemapCommandBuffer());
+}
+
 void VulkanRenderer::CreateShaders()
 {
 	material_shader_ = new VulkanShader();
-	material_shader_->Init(devices_, swap_chain_, "../res/shaders/default_material.vert.spv", "", "", "../res/shaders/default_material.frag.spv");
+	material_shader_->Init(devices_, swap_chain_, VertexPacker::GetShaderFilename("../res/shaders/default_material.vert.spv", vertex_format_), "", "", "../res/shaders/default_material.frag.spv", vertex_format_);
 
 	shadow_map_shader_ = new VulkanShader();
-	shadow_map_shader_->Init(devices_, swap_chain_, "../res/shaders/shadow_map.vert.spv", "", "", "../res/shaders/shadow_map.frag.spv");
+	shadow_map_shader_->Init(devices_, swap_chain_, VertexPacker::GetShaderFilename("../res/shaders/shadow_map.vert.spv", vertex_format_), "", "", "../res/shaders/shadow_map.frag.spv", vertex_format_);
 
-	buffer_visualisation_shader_ = new VulkanShader();
-	buffer_visualisation_shader_->Init(devices_, swap_chain_, "../res/shaders/buffer_visualisation.vert.spv", "", "", "../res/shaders/buffer_visualisation.frag.spv");
-	
 	shape_culling_shader_ = new VulkanComputeShader();
 	shape_culling_shader_->Init(devices_, swap_chain_, "../res/shaders/shape_culling.comp.spv");
 }
@@ -1608,8 +2090,7 @@ void VulkanRenderer::CreateShaders()
 void VulkanRenderer::CreatePrimitiveBuffer()
 {
 	primitive_buffer_ = new VulkanPrimitiveBuffer();
-	std::vector<VkVertexInputAttributeDescription> attribute_descriptions;
-	primitive_buffer_->Init(devices_, Vertex::GetBindingDescription(), attribute_descriptions);
+	primitive_buffer_->Init(devices_, vertex_format_);
 }
 
 void VulkanRenderer::CreateMaterialBuffer()
@@ -1699,23 +2180,68 @@ void VulkanRenderer::RemoveLight(Light* remove_light)
 	}
 }
 
-void VulkanRenderer::CreateSemaphores()
+void VulkanRenderer::CreateFrameResources()
 {
+	// the finalize command buffers are re-recorded every frame for the acquired swap chain image
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.queueFamilyIndex = devices_->GetQueueFamilyIndices().graphics_family;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	if (vkCreateCommandPool(devices_->GetLogicalDevice(), &pool_info, nullptr, &frame_command_pool_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create frame command pool!");
+	}
+
+	// fences start signalled so the first wait on each frame returns immediately
+	VkFenceCreateInfo fence_info = {};
+	fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
 	VkSemaphoreCreateInfo semaphore_info = {};
 	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	if (vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &render_semaphore_) != VK_SUCCESS ||
-		vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &g_buffer_semaphore_) != VK_SUCCESS ||
-		vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &transparency_semaphore_) != VK_SUCCESS ||
-		vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &transparency_composite_semaphore_) != VK_SUCCESS) {
+	for (uint32_t i = 0; i < frames_in_flight_; i++)
+	{
+		devices_->CreateCommandBuffers(frame_command_pool_, &frames_[i].setup_command_buffer);
+		devices_->CreateCommandBuffers(frame_command_pool_, &frames_[i].finalize_command_buffer);
+
+		// the readback buffers are sized once the scene's shapes are known
+		frames_[i].culling_readback_buffer = VK_NULL_HANDLE;
+		frames_[i].culling_readback_buffer_memory = {};
+		frames_[i].culling_readback_pending = false;
+		frames_[i].frame_number = 0;
+		frames_[i].indirect_draw_pass_count = 0;
+
+		if (vkCreateFence(devices_->GetLogicalDevice(), &fence_info, nullptr, &frames_[i].fence) != VK_SUCCESS ||
+			vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &frames_[i].render_finished_semaphore) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create frame synchronisation objects!");
+		}
+	}
+}
 
-		throw std::runtime_error("failed to create semaphores!");
+void VulkanRenderer::CreateCullingReadbackBuffers()
+{
+	VkDeviceSize readback_size = primitive_buffer_->GetShapeCount() * sizeof(IndirectDrawCommand);
+	if (readback_size == 0)
+		return;
+
+	for (uint32_t i = 0; i < frames_in_flight_; i++)
+	{
+		devices_->CreateBuffer(readback_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frames_[i].culling_readback_buffer, frames_[i].culling_readback_buffer_memory);
 	}
 }
 
 void VulkanRenderer::CreateBuffers()
 {
-	devices_->CreateBuffer(sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, matrix_buffer_, matrix_buffer_memory_);
+	// per frame constants are refreshed on the graphics queue ahead of the passes that read them
+	// direct writes would overwrite constants an earlier frame in flight is still reading
+	frame_constants_ = new VulkanFrameConstants();
+	frame_constants_->Init(devices_, graphics_queue_, devices_->GetQueueFamilyIndices().graphics_family, frames_in_flight_ == 1);
+
+	matrix_buffer_constants_ = frame_constants_->AddBuffer(sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	matrix_buffer_ = frame_constants_->GetBuffer(matrix_buffer_constants_);
 }
 
 void VulkanRenderer::CreateLightBuffer()
@@ -1723,13 +2249,48 @@ void VulkanRenderer::CreateLightBuffer()
 	// create the lighting data buffer
 	VkDeviceSize buffer_size = sizeof(SceneLightData) + (lights_.size() * sizeof(LightData));
 
-	devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, light_buffer_, light_buffer_memory_);
+	light_buffer_constants_ = frame_constants_->AddBuffer(buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	light_buffer_ = frame_constants_->GetBuffer(light_buffer_constants_);
 
 	SceneLightData light_data = {};
 	light_data.scene_data = glm::vec4(glm::vec3(0.1f, 0.1f, 0.1f), lights_.size());
 	light_data.camera_data = glm::vec4(0.0f, 0.0f, 0.0f, 1000.0f);
 
-	devices_->CopyDataToBuffer(light_buffer_memory_, &light_data, sizeof(SceneLightData));
+	frame_constants_->Write(light_buffer_constants_, &light_data, sizeof(SceneLightData));
+}
+
+void VulkanRenderer::CreateRenderTargets()
+{
+	// the targets are transient, their memory is bound by the render graph once their lifetimes are known
+	VkExtent2D swap_size = swap_chain_->GetIntermediateImageExtent();
+	VkSampleCountFlagBits sample_count = multisample_data[multisample_level_].sample_count;
+
+	// every render path's targets are created up front, the paths never run in the same frame so the render graph aliases them
+	// initialize the g buffer
+	g_buffer_ = new VulkanRenderTarget();
+	g_buffer_->Init(devices_, VK_FORMAT_R32G32B32A32_SFLOAT, swap_size.width, swap_size.height, 2, false, sample_count, true);
+
+	// initialize the visibility buffer
+	visibility_buffer_ = new VulkanRenderTarget();
+	visibility_buffer_->Init(devices_, VK_FORMAT_R32_UINT, swap_size.width, swap_size.height, 1, false, sample_count, true);
+
+	// initalize the peeled visibility buffer
+	visibility_peel_buffer_ = new VulkanRenderTarget();
+	visibility_peel_buffer_->Init(devices_, VK_FORMAT_R32_UINT, swap_size.width, swap_size.height, VISIBILITY_PEEL_COUNT, false, sample_count, true);
+
+	// initialize the min max depth buffer
+	peel_depth_buffer_ = new VulkanRenderTarget();
+	peel_depth_buffer_->Init(devices_, VK_FORMAT_D32_SFLOAT, swap_size.width, swap_size.height, VISIBILITY_PEEL_COUNT, false, sample_count, true);
+
+	// initialize the buffer visualisation's overdraw counts, half floats are blendable on every device
+	overdraw_buffer_ = new VulkanRenderTarget();
+	overdraw_buffer_->Init(devices_, VK_FORMAT_R16_SFLOAT, swap_size.width, swap_size.height, 1, false, sample_count, true);
+
+	// create the transparency buffers
+	accumulation_buffer_ = new VulkanRenderTarget();
+	accumulation_buffer_->Init(devices_, VK_FORMAT_R16G16B16A16_SFLOAT, swap_size.width, swap_size.height, 1, false, sample_count, true);
+	revealage_buffer_ = new VulkanRenderTarget();
+	revealage_buffer_->Init(devices_, VK_FORMAT_R16_SFLOAT, swap_size.width, swap_size.height, 1, false, sample_count, true);
 }
 
 uint32_t VulkanRenderer::AddTextureMap(Texture* texture, Texture::MapType map_type)
@@ -1799,71 +2360,75 @@ uint32_t VulkanRenderer::AddTextureMap(Texture* texture, Texture::MapType map_ty
 
 void VulkanRenderer::RecordPerformance()
 {
-	double out_visibility = visibility_time_ / (float)PERFORMANCE_CAPTURES;
-	double out_shading = shading_time_ / (float)PERFORMANCE_CAPTURES;
-	double out_transparency = transparency_time_ / (float)PERFORMANCE_CAPTURES;
-	double out_post_process = post_process_time_ / (float)PERFORMANCE_CAPTURES;
-	double out_total = out_visibility + out_shading + out_transparency + out_post_process;
-
-	// extract the name of the model
-	std::string model = "";
-	for (int i = 0; i < model_filename_.find_last_of('.'); i++)
-		model += model_filename_[i];
-
-#ifdef _DEFERRED
-	std::string out_filename = "../res/data/performance_data/" + model + "_deferred_results.txt";
-#elif _VISIBILITY
-	std::string out_filename = "../res/data/performance_data/" + model + "_visibility_results.txt";
-#elif _VISIBILITY_PEELED
-	std::string out_filename = "../res/data/performance_data/" + model + "_visibility_peel_results.txt";
-#endif
+	// extract the name of the model, procedural scene descriptions have no extension
+	std::string model = model_filename_.substr(0, model_filename_.find_last_of('.'));
+
+	// one row per stage, appended to the model's results so every render mode and msaa level can be compared
+	std::string out_filename = "../res/data/performance_data/" + model + "_results.csv";
+
+	std::string results_string = "";
+	if (!std::ifstream(out_filename).good())
+		results_string += "render_mode,width,height,msaa,capture_point,stage,samples,min,max,mean,median,p95,p99,std_dev,outliers,upper_fence,trimmed_mean\n";
 
 	VkExtent2D resolution = swap_chain_->GetIntermediateImageExtent();
 
-	// build the results string
-	std::string results_string = "Resolution: " + std::to_string(resolution.width) + " " + std::to_string(resolution.height) + "\n";
-	results_string += "Sample Count: " + std::to_string(multisample_level_) + "\n\n";
-	results_string += "Visibility: " + std::to_string(out_visibility) + "\n";
-	results_string += "Shading: " + std::to_string(out_shading) + "\n";
-	results_string += "Transparency: " + std::to_string(out_transparency) + "\n";
-	results_string += "Post-Process: " + std::to_string(out_post_process) + "\n";
-	results_string += "Total Time: " + std::to_string(out_total) + "\n\n";
-	results_string += "//////////////////////////////\n\n";
+	for (int i = 0; i < FRAME_TIME_STAGE_COUNT; i++)
+	{
+		FrameTimeStage stage = static_cast<FrameTimeStage>(i);
+		FrameTimeSummary summary = performance_statistics_.Summarize(stage);
+
+		results_string += GetRenderModeName(render_mode_) + "," + std::to_string(resolution.width) + "," + std::to_string(resolution.height) + ",";
+		results_string += std::to_string(multisample_level_) + "," + std::to_string(current_capture_point_) + "," + FrameTimeStatistics::GetStageName(stage) + ",";
+		results_string += std::to_string(summary.sample_count) + "," + std::to_string(summary.min) + "," + std::to_string(summary.max) + ",";
+		results_string += std::to_string(summary.mean) + "," + std::to_string(summary.median) + "," + std::to_string(summary.p95) + ",";
+		results_string += std::to_string(summary.p99) + "," + std::to_string(summary.std_dev) + "," + std::to_string(summary.outlier_count) + ",";
+		results_string += std::to_string(summary.upper_fence) + "," + std::to_string(summary.trimmed_mean) + "\n";
+	}
 
 	VulkanDevices::AppendFile(out_filename, results_string);
 
-	visibility_time_ = 0;
-	shading_time_ = 0;
-	transparency_time_ = 0;
-	post_process_time_ = 0;
+	RecordPipelineStatistics(model);
+
+	FrameTimeSummary gpu_summary = performance_statistics_.Summarize(FrameTimeStage::GPU_TOTAL);
+	std::cout << "capture point " << current_capture_point_ << " (" << GetRenderModeName(render_mode_) << ", " << multisample_level_ << "x msaa): "
+		<< gpu_summary.median << " ms gpu median, " << gpu_summary.p99 << " ms p99, " << gpu_summary.outlier_count << " outliers" << std::endl;
 }
 
 void VulkanRenderer::LoadCapturePoints(std::string filename)
 {
 	model_filename_ = filename;
+	capture_points_.clear();
+
+	std::string capture_points_filename = "../res/data/capture_points/" + filename + "_capture_points.txt";
 
 	std::ifstream file;
 
-	file.open("../res/data/capture_points/" + filename + "_capture_points.txt", std::ios::in);
+	file.open(capture_points_filename, std::ios::in);
 
 	if (!file.is_open())
 	{
-		return;
+		throw std::runtime_error("failed to open capture points file " + capture_points_filename + "!");
 	}
 
-	while (!file.eof())
+	// only whole points are kept, a point cut short by the end of the file is dropped
+	PerformanceCapturePoint capture_point = {};
+	while (file >> capture_point.capture_position.x >> capture_point.capture_position.y >> capture_point.capture_position.z
+		>> capture_point.capture_rotation.x >> capture_point.capture_rotation.y >> capture_point.capture_rotation.z)
 	{
-		PerformanceCapturePoint capture_point = {};
-		file >> capture_point.capture_position.x;
-		file >> capture_point.capture_position.y;
-		file >> capture_point.capture_position.z;
-		file >> capture_point.capture_rotation.x;
-		file >> capture_point.capture_rotation.y;
-		file >> capture_point.capture_rotation.z;
-
 		capture_points_.push_back(capture_point);
 	}
 
+	// the read stops short of the end of the file at a value that is not a number
+	if (!file.eof())
+	{
+		throw std::runtime_error("failed to read capture point " + std::to_string(capture_points_.size()) + " from " + capture_points_filename + "!");
+	}
+
+	if (capture_points_.empty())
+	{
+		throw std::runtime_error("capture points file " + capture_points_filename + " holds no capture points!");
+	}
+
 	file.close();
 }
 
@@ -1871,13 +2436,58 @@ void VulkanRenderer::StartPerformanceCapture()
 {
 	if (capture_points_.size() > 0)
 	{
-
-		performance_captures_remaining_ = PERFORMANCE_CAPTURES;
 		current_capture_point_ = 0;
+		BeginCapturePoint();
+	}
+}
 
-		PerformanceCapturePoint capture_point = capture_points_[current_capture_point_];
+void VulkanRenderer::SetPerformanceCaptureWindow(uint32_t warmup_frames, uint32_t sample_frames)
+{
+	performance_warmup_frames_ = warmup_frames;
+	performance_sample_frames_ = std::max(1u, sample_frames);
+}
+
+void VulkanRenderer::RecordPipelineStatistics(std::string model)
+{
+	uint32_t frame_count = pipeline_statistics_->GetTotalFrameCount();
+	if (!pipeline_statistics_->IsEnabled() || frame_count == 0)
+		return;
+
+	// one row per counted pass, averaged over the sampled frames
+	std::string out_filename = "../res/data/performance_data/" + model + "_pipeline_statistics.csv";
 
-		render_camera_->SetPosition(capture_point.capture_position);
-		render_camera_->SetRotation(capture_point.capture_rotation);
+	std::string results_string = "";
+	if (!std::ifstream(out_filename).good())
+		results_string += "render_mode,width,height,msaa,capture_point,scope,frames,input_primitives,clipping_invocations,clipping_primitives,vertex_invocations,fragment_invocations,compute_invocations,samples_passed\n";
+
+	VkExtent2D resolution = swap_chain_->GetIntermediateImageExtent();
+
+	for (PipelineStatisticsScope scope = 0; scope < pipeline_statistics_->GetScopeCount(); scope++)
+	{
+		// passes of the other render paths did no work
+		PipelineStatisticsResult total = pipeline_statistics_->GetTotal(scope);
+		if (total.input_primitives == 0 && total.fragment_invocations == 0 && total.compute_invocations == 0)
+			continue;
+
+		results_string += GetRenderModeName(render_mode_) + "," + std::to_string(resolution.width) + "," + std::to_string(resolution.height) + ",";
+		results_string += std::to_string(multisample_level_) + "," + std::to_string(current_capture_point_) + "," + pipeline_statistics_->GetScopeName(scope) + ",";
+		results_string += std::to_string(frame_count) + "," + std::to_string(total.input_primitives / frame_count) + ",";
+		results_string += std::to_string(total.clipping_invocations / frame_count) + "," + std::to_string(total.clipping_primitives / frame_count) + ",";
+		results_string += std::to_string(total.vertex_invocations / frame_count) + "," + std::to_string(total.fragment_invocations / frame_count) + ",";
+		results_string += std::to_string(total.compute_invocations / frame_count) + "," + std::to_string(total.samples_passed / frame_count) + "\n";
 	}
+
+	VulkanDevices::AppendFile(out_filename, results_string);
+}
+
+void VulkanRenderer::BeginCapturePoint()
+{
+	// place the camera at the performance capture position
+	PerformanceCapturePoint capture_point = capture_points_[current_capture_point_];
+	render_camera_->SetPosition(capture_point.capture_position);
+	render_camera_->SetRotation(capture_point.capture_rotation);
+
+	// the stage times arrive a frame in flight late, the warm up must at least skip the frames rendered before the camera moved
+	performance_statistics_.Begin(std::max(performance_warmup_frames_, frames_in_flight_), performance_sample_frames_);
+	pipeline_statistics_->ResetTotals();
 }
\ No newline at end of file
@@ -1,11 +1,23 @@
 #ifndef _RENDERER_H_
 #define _RENDERER_H_
 
-#define PERFORMANCE_CAPTURES 10
+#define PERFORMANCE_WARMUP_FRAMES 16
+#define PERFORMANCE_SAMPLE_FRAMES 64
+
+// every render path is built into the renderer, the build configuration only selects the one used at startup
+#ifdef _DEFERRED
+#define DEFAULT_RENDER_MODE VulkanRenderer::RenderMode::DEFERRED
+#elif _VISIBILITY
+#define DEFAULT_RENDER_MODE VulkanRenderer::RenderMode::VISIBILITY
+#else
+#define DEFAULT_RENDER_MODE VulkanRenderer::RenderMode::VISIBILITY_PEELED
+#endif
 
 #include <vulkan/vulkan.h>
 #include <vector>
 #include <string>
+#include <chrono>
+#include <map>
 
 #include "device.h"
 #include "swap_chain.h"
@@ -18,6 +30,7 @@
 #include "camera.h"
 #include "compute_shader.h"
 #include "buffer_visualisation_pipeline.h"
+#include "overdraw_pipeline.h"
 #include "g_buffer_pipeline.h"
 #include "deferred_compute_pipeline.h"
 #include "deferred_pipeline.h"
@@ -30,6 +43,12 @@
 #include "shape_culling_pipeline.h"
 #include "HDR.h"
 #include "skybox.h"
+#include "frame_constants.h"
+#include "render_graph.h"
+#include "pipeline_builder.h"
+#include "gpu_profiler.h"
+#include "pipeline_statistics.h"
+#include "frame_time_statistics.h"
 
 struct UniformBufferObject
 {
@@ -53,6 +72,60 @@ struct PerformanceCapturePoint
 	glm::vec3 capture_rotation;
 };
 
+struct FrameResources
+{
+	VkFence fence;
+	VkSemaphore render_finished_semaphore;
+	VkCommandBuffer setup_command_buffer;
+	VkCommandBuffer finalize_command_buffer;
+
+	// the culled indirect draws are copied here after the frame's passes and read once its fence has signalled
+	VkBuffer culling_readback_buffer;
+	MemoryAllocation culling_readback_buffer_memory;
+	bool culling_readback_pending;
+	uint64_t frame_number;				// of the frame last recorded with these resources
+	uint32_t indirect_draw_pass_count;	// passes that drew the culled indirect draws in that frame
+};
+
+struct FrameThroughputStatistics
+{
+	uint32_t frames_in_flight;
+	uint64_t frame_count;
+	uint64_t overlapped_frames;	// frames begun while an earlier frame was still executing on the gpu
+	double cpu_frame_time;		// total milliseconds between beginning and presenting frames
+	double fence_wait_time;		// total milliseconds blocked on frame fences
+	double elapsed_time;		// milliseconds between the first and latest frame
+};
+
+// what the renderer did in a frame, the cpu side counters describe the latest frame ended and the
+// culling counts the latest frame whose readback has completed, up to frames in flight earlier
+struct FrameStats
+{
+	uint64_t frame_number;
+	uint64_t culling_frame_number;		// zero until the first readback completes
+	uint32_t shape_count;
+	uint32_t visible_shapes;			// survived shape culling
+	uint32_t culled_shapes;
+	uint64_t drawn_indices;				// summed over every pass that drew the culled indirect draws
+	uint32_t light_count;
+	uint32_t shadow_casting_lights;
+	uint32_t shadow_map_faces_rendered;	// shadow maps of moving lights are regenerated every frame
+	uint64_t queue_submits;
+	uint64_t submitted_batches;
+	uint64_t idle_waits;
+	uint64_t uploaded_bytes;			// through the upload manager
+	uint64_t constant_bytes;			// written to the frame constants
+};
+
+struct RenderStageTimes
+{
+	// gpu milliseconds from the latest timestamps, a frame in flight behind the frame being recorded
+	double visibility;
+	double shading;
+	double transparency;
+	double post_process;
+};
+
 static std::map<int, SampleCountData> multisample_data =
 {
 	{ 1, { VK_SAMPLE_COUNT_1_BIT, "deferred.frag.spv", "visibility_deferred.frag.spv", "visibility_peel_deferred.frag.spv", "transparency_composite.frag.spv" }},
@@ -76,9 +149,11 @@ public:
 	};
 
 public:
-	void Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, int multisample_level = 1);
+	void Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, int multisample_level = 1, uint32_t frames_in_flight = DEFAULT_FRAMES_IN_FLIGHT, VertexFormat vertex_format = DEFAULT_VERTEX_FORMAT);
 	void InitPipelines();
+	void BeginFrame();
 	void RenderScene();
+	void EndFrame();
 	void Cleanup();
 	
 	void RecreateSwapChainFeatures();
@@ -98,25 +173,53 @@ public:
 	inline VkCommandPool GetCommandPool() { return command_pool_; }
 	inline std::vector<Mesh*> GetMeshes() { return meshes_; }
 
-	void GetMatrixBuffer(VkBuffer& buffer, VkDeviceMemory& buffer_memory) { buffer = matrix_buffer_; buffer_memory = matrix_buffer_memory_; }
-	void GetLightBuffer(VkBuffer& buffer, VkDeviceMemory& buffer_memory) { buffer = light_buffer_; buffer_memory = light_buffer_memory_; }
+	inline VkBuffer GetMatrixBuffer() { return matrix_buffer_; }
+	inline VkBuffer GetLightBuffer() { return light_buffer_; }
+	inline VulkanFrameConstants* GetFrameConstants() { return frame_constants_; }
 	void GetSceneMinMax(glm::vec3& scene_min, glm::vec3& scene_max);
 
 	inline VkSemaphore GetSignalSemaphore() { return current_signal_semaphore_; }
+	inline uint32_t GetCurrentFrame() { return current_frame_; }
+	inline FrameThroughputStatistics GetFrameStatistics() { return frame_statistics_; }
+	inline FrameStats GetFrameStats() { return last_frame_stats_; }
 	inline Texture* GetDefaultTexture() { return default_texture_; }
 
 	uint32_t AddTextureMap(Texture* texture, Texture::MapType map_type);
 
-	inline void SetRenderMode(RenderMode mode) { render_mode_ = mode; }
+	// a render path's pipelines and command buffers are created the first time it is selected, the scene data is shared
+	void SetRenderMode(RenderMode mode);
+	void CycleRenderMode();
+	inline RenderMode GetRenderMode() { return render_mode_; }
+	static std::string GetRenderModeName(RenderMode mode);
+	static bool FindRenderMode(const std::string& name, RenderMode& mode);
+
+	// the buffer visualisation renders the peeled path's buffers as one of its views, cycling past the last
+	// view returns to the render path selected before it
+	void SetBufferVisualisationMode(BufferVisualisationMode mode);
+	void CycleBufferVisualisationMode();
+	inline BufferVisualisationMode GetBufferVisualisationMode() { return buffer_visualisation_mode_; }
+	static std::string GetBufferVisualisationModeName(BufferVisualisationMode mode);
 
 	inline void SetTextureDirectory(std::string dir) { texture_directory_ = dir; }
 	inline std::string GetTextureDirectory() { return texture_directory_; }
 
 	inline VulkanTextureCache*	GetTextureCache() { return texture_cache_; }
 	inline HDR* GetHDR() { return hdr_; }
+	inline VulkanRenderGraph* GetRenderGraph() { return render_graph_; }
+	inline VulkanPipelineBuilder* GetPipelineBuilder() { return &pipeline_builder_; }
+	inline VulkanGpuProfiler* GetGpuProfiler() { return gpu_profiler_; }
+	inline VulkanPipelineStatistics* GetPipelineStatistics() { return pipeline_statistics_; }
 
 	void StartPerformanceCapture();
+	void SetPerformanceCaptureWindow(uint32_t warmup_frames, uint32_t sample_frames);
 	void LoadCapturePoints(std::string filename);
+	inline const std::vector<PerformanceCapturePoint>& GetCapturePoints() { return capture_points_; }
+	RenderStageTimes GetLastStageTimes();
+
+	// the intermediate image, or the tonemapped image when hdr is enabled, as copied to the swap chain
+	VkImage GetOutputImage();
+	// waits for the device, then copies the rgb of the last frame's output image, rows top to bottom
+	void ReadBackOutputImage(std::vector<glm::vec3>& pixels);
 
 protected:
 	// pipeline creation functions
@@ -126,6 +229,7 @@ protected:
 	void InitVisibilityPipeline();
 	void InitVisibilityPeelPipeline();
 	void InitTransparencyPipeline();
+	void InitBufferVisualisationPipeline();
 
 	// cleanup functions
 	void CleanupForwardPipeline();
@@ -133,6 +237,14 @@ protected:
 	void CleanupVisibilityPipeline();
 	void CleanupVisibilityPeelPipeline();
 	void CleanupTransparencyPipeline();
+	void CleanupBufferVisualisationPipeline();
+	void CleanupRenderTargets();
+
+	// render path selection
+	void InitRenderPath(RenderMode mode);
+	void CreateRenderPathCommandBuffers(RenderMode mode);
+	bool IsRenderPathInitialized(RenderMode mode);
+	void EnableRenderPathPasses();
 
 	// command buffer creation functions
 	void CreateCommandPool();
@@ -147,32 +259,33 @@ protected:
 	void CreateVisibilityDeferredCommandBuffer();
 	void CreateVisibilityPeelCommandBuffers();
 	void CreateVisibilityPeelDeferredCommandBuffers();
-	void CreateBufferVisualisationCommandBuffers();
+	void CreateOverdrawCommandBuffer();
+	void CreateBufferVisualisationCommandBuffer();
 	void CreateCullingCommandBuffer();
 
 	// resource creation functions
 	void CreateBuffers();
-	void CreateSemaphores();
+	void CreateFrameResources();
+	void CreateCullingReadbackBuffers();
 	void CreateShaders();
 	void CreatePrimitiveBuffer();
 	void CreateMaterialBuffer();
 	void CreateLightBuffer();
+	void CreateRenderTargets();
 
 	// rendering functions
-	void RenderForward(uint32_t frame_index);
-	void RenderVisualisation(uint32_t frame_index);
-	void RenderGBuffer();
-	void RenderDeferred();
-	void RenderDeferredCompute();
-	void RenderVisibility();
-	void RenderVisbilityDeferred();
-	void RenderVisibilityPeel();
-	void RenderVisibilityPeelDeferred();
-	void RenderTransparency();
-	void CullGeometry();
+	void BuildRenderGraph();
+	void SetRenderGraphCommandBuffers();
+	void RecordFrameSetup();
+	void RecordFrameFinalize();
+	void ReadCullingResults(FrameResources& frame);
 
 	// performance recording functions
 	void RecordPerformance();
+	void RecordPipelineStatistics(std::string model);
+	void BeginCapturePoint();
+	double GetRenderGraphTime(const std::vector<RenderGraphHandle>& passes);
+	PipelineStatisticsScope GetPassStatisticsScope(RenderGraphHandle pass);
 
 protected:
 	VulkanDevices* devices_;
@@ -181,14 +294,13 @@ protected:
 	VulkanMaterialBuffer* material_buffer_;
 	VulkanTextureCache* texture_cache_;
 	int multisample_level_;
+	VertexFormat vertex_format_;		// of the primitive buffer, the shaders that read it are compiled for it
 
 	VulkanShader* material_shader_;
 	VulkanShader* shadow_map_shader_;
-	VulkanShader* buffer_visualisation_shader_;
 	VulkanComputeShader* shape_culling_shader_;
 	VulkanPipeline* rendering_pipeline_;
 	ShapeCullingPipeline* shape_culling_pipeline_;
-	BufferVisualisationPipeline* buffer_visualisation_pipeline_;
 	VkSampler buffer_unnormalized_sampler_, buffer_normalized_sampler_, shadow_map_sampler_;
 	
 	// deferred shading components
@@ -219,17 +331,26 @@ protected:
 	std::vector<VisibilityFrontPeelPipeline*> visibility_peel_pipelines_;
 	std::vector<VkCommandBuffer> visibility_peel_command_buffers_;
 
+	// buffer visualisation components, the views read the visibility peeled path's buffers
+	VulkanShader *overdraw_shader_, *buffer_visualisation_shader_;
+	VulkanRenderTarget* overdraw_buffer_;
+	OverdrawPipeline* overdraw_pipeline_;
+	BufferVisualisationPipeline* buffer_visualisation_pipeline_;
+	VkCommandBuffer overdraw_command_buffer_, buffer_visualisation_command_buffer_;
+	BufferVisualisationMode buffer_visualisation_mode_;
+	RenderMode visualised_render_mode_;		// selected before the visualisation
+
 	// transparency shading components
 	VulkanShader *transparency_shader_, *transparency_composite_shader_;
 	WeightedBlendedTransparencyPipeline* transparency_pipeline_;
 	TransparencyCompositePipeline* transparency_composite_pipeline_;
 	VulkanRenderTarget *accumulation_buffer_, *revealage_buffer_;
 	VkCommandBuffer transparency_command_buffer_, transparency_composite_command_buffer_;
-	VkSemaphore transparency_semaphore_, transparency_composite_semaphore_;
 
-	// buffers
-	VkBuffer matrix_buffer_, light_buffer_, visibility_data_buffer_;
-	VkDeviceMemory matrix_buffer_memory_, light_buffer_memory_, visibility_data_buffer_memory_;
+	// per frame constant buffers, written through the frame constants and read from device local memory
+	VulkanFrameConstants* frame_constants_;
+	FrameConstantHandle matrix_buffer_constants_, light_buffer_constants_, visibility_data_constants_, visibility_peel_data_constants_, buffer_visualisation_data_constants_;
+	VkBuffer matrix_buffer_, light_buffer_, visibility_data_buffer_, visibility_peel_data_buffer_, buffer_visualisation_data_buffer_;
 	HDR* hdr_;
 	Skybox* skybox_;
 
@@ -240,13 +361,42 @@ protected:
 	VkQueue compute_queue_;
 	VkCommandPool command_pool_;
 	std::vector<VkCommandBuffer> command_buffers_;
-	std::vector<VkCommandBuffer> buffer_visualisation_command_buffers_;
 	VkCommandBuffer shape_culling_command_buffer_;
 
-	VkSemaphore g_buffer_semaphore_;
-	VkSemaphore render_semaphore_;
 	VkSemaphore current_signal_semaphore_;
 
+	// every pass of a frame is scheduled and synchronised by the render graph
+	VulkanRenderGraph* render_graph_;
+	RenderGraphHandle setup_pass_, skybox_pass_, culling_pass_, present_pass_;
+	RenderGraphHandle hdr_passes_[4];
+	RenderGraphHandle g_buffer_pass_, deferred_shading_pass_, visibility_pass_, visibility_shading_pass_, visibility_peel_shading_pass_;
+	RenderGraphHandle visibility_peel_passes_[VISIBILITY_PEEL_COUNT];
+	RenderGraphHandle transparency_pass_, transparency_composite_pass_;
+	RenderGraphHandle overdraw_pass_, buffer_visualisation_pass_;
+	std::vector<RenderGraphHandle> visibility_passes_, shading_passes_, transparency_passes_, post_process_passes_;
+	std::map<RenderMode, std::vector<RenderGraphHandle>> render_path_passes_;	// passes enabled while each path is selected
+	bool pipelines_initialized_;
+	VulkanGpuProfiler* gpu_profiler_;
+	VulkanPipelineStatistics* pipeline_statistics_;
+	std::map<RenderGraphHandle, PipelineStatisticsScope> pass_statistics_scopes_;	// geometry and shading passes
+
+	// frames in flight, the cpu records frame n + 1 while the gpu executes frame n
+	uint32_t frames_in_flight_;
+	uint32_t current_frame_;
+	FrameResources frames_[MAX_FRAMES_IN_FLIGHT];
+	VkCommandPool frame_command_pool_;
+	VulkanBarrierBatch frame_barriers_;
+	FrameThroughputStatistics frame_statistics_;
+
+	// the counters of the frame being recorded, with the totals they are measured from, and of the last frame ended
+	FrameStats current_frame_stats_, last_frame_stats_;
+	DeviceActivity frame_begin_activity_;
+	uint64_t frame_begin_uploaded_bytes_, frame_begin_constant_bytes_;
+
+	// independent pipelines are built in parallel during InitPipelines
+	VulkanPipelineBuilder pipeline_builder_;
+	std::chrono::high_resolution_clock::time_point first_frame_time_, frame_begin_time_;
+
 	std::vector<Mesh*> meshes_;
 	std::vector<Light*> lights_;
 	std::vector<VkImageView> shadow_maps_;
@@ -265,12 +415,10 @@ protected:
 	std::vector<Texture*> reflection_textures_;
 
 	//  rendering stage timing
-	int performance_captures_remaining_;
+	FrameTimeStatistics performance_statistics_;
+	uint32_t performance_warmup_frames_, performance_sample_frames_;
 	int current_capture_point_;
-	double visibility_time_;
-	double shading_time_;
-	double transparency_time_;
-	double post_process_time_;
+	double last_cpu_frame_time_;
 	std::string model_filename_;
 	std::vector<PerformanceCapturePoint> capture_points_;
 };
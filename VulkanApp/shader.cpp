@@ -1,10 +1,11 @@
 #include "shader.h"
 #include "mesh.h"
 
-void VulkanShader::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, std::string vs_filename, std::string ts_filename, std::string gs_filename, std::string fs_filename)
+void VulkanShader::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, std::string vs_filename, std::string ts_filename, std::string gs_filename, std::string fs_filename, VertexFormat vertex_format)
 {
 	devices_ = devices;
 	swap_chain_ = swap_chain;
+	vertex_format_ = vertex_format;
 
 	LoadShaders(vs_filename, ts_filename, gs_filename, fs_filename);
 
@@ -95,22 +96,22 @@ void VulkanShader::CreateVertexInput()
 
 	vertex_input_ = {};
 	vertex_input_.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertex_input_.vertexBindingDescriptionCount = 1;
-	vertex_input_.pVertexBindingDescriptions = &vertex_binding_;
+	vertex_input_.vertexBindingDescriptionCount = static_cast<uint32_t>(vertex_bindings_.size());
+	vertex_input_.pVertexBindingDescriptions = vertex_bindings_.data();
 	vertex_input_.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_attributes_.size());
 	vertex_input_.pVertexAttributeDescriptions = vertex_attributes_.data();
 }
 
 void VulkanShader::CreateVertexBinding()
 {
-	// get the binding description from Vertex since this is what is used in a base render shader
-	vertex_binding_ = Vertex::GetBindingDescription();
+	// get the binding descriptions of the vertex format since this is what is used in a base render shader
+	vertex_bindings_ = VertexPacker::GetBindingDescriptions(vertex_format_);
 }
 
 void VulkanShader::CreateVertexAttributes()
 {
-	// get the binding attributes from Vertex since this is what is used in a base render shader
-	auto attribute_descriptions = Vertex::GetAttributeDescriptions();
+	// get the binding attributes of the vertex format since this is what is used in a base render shader
+	auto attribute_descriptions = VertexPacker::GetAttributeDescriptions(vertex_format_);
 
 	for (VkVertexInputAttributeDescription& description : attribute_descriptions)
 	{
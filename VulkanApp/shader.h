@@ -9,11 +9,13 @@
 #include "device.h"
 #include "swap_chain.h"
 #include "texture.h"
+#include "vertex_format.h"
 
 class VulkanShader
 {
 public:
-	void Init(VulkanDevices* devices,  VulkanSwapChain* swap_chain, std::string vs_filename, std::string ts_filename, std::string gs_filename, std::string fs_filename);
+	// the vertex format sets the vertex input of shaders that read the primitive buffer
+	void Init(VulkanDevices* devices,  VulkanSwapChain* swap_chain, std::string vs_filename, std::string ts_filename, std::string gs_filename, std::string fs_filename, VertexFormat vertex_format = VertexFormat::FLOAT);
 	virtual void Cleanup();
 
 	// getters
@@ -23,7 +25,7 @@ public:
 	VkShaderModule GetFragmentShader() { return fragment_shader_module_; }
 
 	const std::vector<VkPipelineShaderStageCreateInfo>& GetShaderStageInfo() const { return shader_stage_info_; }
-	const VkVertexInputBindingDescription& GetBindingDescription() const { return vertex_binding_; }
+	const std::vector<VkVertexInputBindingDescription>& GetBindingDescriptions() const { return vertex_bindings_; }
 	const std::vector<VkVertexInputAttributeDescription>& GetAttributeDescriptions() const { return vertex_attributes_; }
 	const VkPipelineVertexInputStateCreateInfo& GetVertexInputDescription() const { return vertex_input_; }
 	const VkPipelineInputAssemblyStateCreateInfo& GetInputAssemblyDescription() const { return input_assembly_; }
@@ -59,7 +61,8 @@ protected:
 
 	// pipeline creation data
 	std::vector<VkPipelineShaderStageCreateInfo> shader_stage_info_;
-	VkVertexInputBindingDescription vertex_binding_;
+	VertexFormat vertex_format_;
+	std::vector<VkVertexInputBindingDescription> vertex_bindings_;
 	std::vector<VkVertexInputAttributeDescription> vertex_attributes_;
 	VkPipelineVertexInputStateCreateInfo vertex_input_;
 	VkPipelineInputAssemblyStateCreateInfo input_assembly_;
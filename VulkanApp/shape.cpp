@@ -8,15 +8,20 @@ Shape::Shape()
 	mesh_material_ = nullptr;
 
 	vertex_buffer_ = VK_NULL_HANDLE;
-	vertex_buffer_memory_ = VK_NULL_HANDLE;
+	vertex_buffer_memory_ = {};
 
 	index_buffer_ = VK_NULL_HANDLE;
-	index_buffer_memory_ = VK_NULL_HANDLE;
+	index_buffer_memory_ = {};
 
 	standalone_shape_ = true;
 }
 
 void Shape::InitShape(VulkanDevices* devices, VulkanRenderer* renderer, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, BoundingBox bounding_box, bool transparency_enabled)
+{
+	InitShape(devices, renderer, vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(), static_cast<uint32_t>(indices.size()), bounding_box, transparency_enabled);
+}
+
+void Shape::InitShape(VulkanDevices* devices, VulkanRenderer* renderer, const Vertex* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count, BoundingBox bounding_box, bool transparency_enabled)
 {
 	devices_ = devices;
 	transparency_enabled_ = transparency_enabled;
@@ -25,20 +30,19 @@ void Shape::InitShape(VulkanDevices* devices, VulkanRenderer* renderer, std::vec
 	if (renderer)
 		standalone_shape_ = false;
 
-	CreateVertexBuffer(vertices);
-	CreateIndexBuffer(indices);
+	vertex_count_ = vertex_count;
+	index_count_ = index_count;
 
 	// add mesh to renderer primitve buffer - standalone meshes do not need to be added
 	if (renderer)
 	{
-		renderer->GetPrimitiveBuffer()->AddPrimitiveData(devices, this);
-
-		// free the vertex and index buffers now that they have been added to the primitive buffer
-		vkDestroyBuffer(devices_->GetLogicalDevice(), vertex_buffer_, nullptr);
-		vkFreeMemory(devices_->GetLogicalDevice(), vertex_buffer_memory_, nullptr);
-
-		vkDestroyBuffer(devices_->GetLogicalDevice(), index_buffer_, nullptr);
-		vkFreeMemory(devices_->GetLogicalDevice(), index_buffer_memory_, nullptr);
+		// the primitive buffer stages the data directly so no per shape buffers are needed
+		renderer->GetPrimitiveBuffer()->AddPrimitiveData(devices, this, vertices, indices);
+	}
+	else
+	{
+		CreateVertexBuffer(vertices);
+		CreateIndexBuffer(indices);
 	}
 }
 
@@ -48,95 +52,33 @@ void Shape::CleanUp()
 	{
 		// free the vertex and index buffers
 		vkDestroyBuffer(devices_->GetLogicalDevice(), vertex_buffer_, nullptr);
-		vkFreeMemory(devices_->GetLogicalDevice(), vertex_buffer_memory_, nullptr);
+		devices_->FreeMemory(vertex_buffer_memory_);
 
 		vkDestroyBuffer(devices_->GetLogicalDevice(), index_buffer_, nullptr);
-		vkFreeMemory(devices_->GetLogicalDevice(), index_buffer_memory_, nullptr);
+		devices_->FreeMemory(index_buffer_memory_);
 	}
 }
 
-void Shape::CreateVertexBuffer(std::vector<Vertex>& vertices)
+void Shape::CreateVertexBuffer(const Vertex* vertices)
 {
-	vertex_count_ = static_cast<uint32_t>(vertices.size());
-	VkDeviceSize buffer_size = sizeof(vertices[0]) * vertices.size();
+	VkDeviceSize buffer_size = sizeof(Vertex) * vertex_count_;
 
-	if (standalone_shape_)
-	{
-		// create the vertex buffer
-		devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertex_buffer_, vertex_buffer_memory_);
-
-		// create a staging buffer to copy the data from
-		VkBuffer staging_buffer;
-		VkDeviceMemory staging_buffer_memory;
+	// create the vertex buffer
+	devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertex_buffer_, vertex_buffer_memory_);
 
-		devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, staging_buffer, staging_buffer_memory);
-		
-		// copy the data to the staging buffer
-		void* data;
-		vkMapMemory(devices_->GetLogicalDevice(), staging_buffer_memory, 0, buffer_size, 0, &data);
-		memcpy(data, vertices.data(), (size_t)buffer_size);
-		vkUnmapMemory(devices_->GetLogicalDevice(), staging_buffer_memory);
-
-		// copy the data from the staging buffer to the vertex buffer
-		devices_->CopyBuffer(staging_buffer, vertex_buffer_, buffer_size);
-
-		// clean up the staging buffer now that it is no longer needed
-		vkDestroyBuffer(devices_->GetLogicalDevice(), staging_buffer, nullptr);
-		vkFreeMemory(devices_->GetLogicalDevice(), staging_buffer_memory, nullptr);
-	}
-	else
-	{
-		// create the vertex buffer as a staging buffer
-		devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vertex_buffer_, vertex_buffer_memory_);
-
-		// copy the data to the staging buffer
-		void* data;
-		vkMapMemory(devices_->GetLogicalDevice(), vertex_buffer_memory_, 0, buffer_size, 0, &data);
-		memcpy(data, vertices.data(), (size_t)buffer_size);
-		vkUnmapMemory(devices_->GetLogicalDevice(), vertex_buffer_memory_);
-	}
+	// stage the data through the upload manager
+	devices_->GetUploadManager()->UploadToBuffer(vertex_buffer_, vertices, buffer_size);
 }
 
-void Shape::CreateIndexBuffer(std::vector<uint32_t>& indices)
+void Shape::CreateIndexBuffer(const uint32_t* indices)
 {
-	index_count_ = static_cast<uint32_t>(indices.size());
-	VkDeviceSize buffer_size = sizeof(indices[0]) * indices.size();
-
-	if (standalone_shape_)
-	{
-		// create the index buffer
-		devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, index_buffer_, index_buffer_memory_);
+	VkDeviceSize buffer_size = sizeof(uint32_t) * index_count_;
 
-		// create a staging buffer to copy the data from
-		VkBuffer staging_buffer;
-		VkDeviceMemory staging_buffer_memory;
+	// create the index buffer
+	devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, index_buffer_, index_buffer_memory_);
 
-		devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, staging_buffer, staging_buffer_memory);
-
-		// copy the data to the staging buffer
-		void* data;
-		vkMapMemory(devices_->GetLogicalDevice(), staging_buffer_memory, 0, buffer_size, 0, &data);
-		memcpy(data, indices.data(), (size_t)buffer_size);
-		vkUnmapMemory(devices_->GetLogicalDevice(), staging_buffer_memory);
-
-		// copy the data from the staging buffer to the vertex buffer
-		devices_->CopyBuffer(staging_buffer, index_buffer_, buffer_size);
-
-		// clean up the staging buffer now that it is no longer needed
-		vkDestroyBuffer(devices_->GetLogicalDevice(), staging_buffer, nullptr);
-		vkFreeMemory(devices_->GetLogicalDevice(), staging_buffer_memory, nullptr);
-	}
-	else
-	{
-		// create index buffer as a staging buffer
-		devices_->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, index_buffer_, index_buffer_memory_);
-
-		// copy the data to the staging buffer
-		void* data;
-		vkMapMemory(devices_->GetLogicalDevice(), index_buffer_memory_, 0, buffer_size, 0, &data);
-		memcpy(data, indices.data(), (size_t)buffer_size);
-		vkUnmapMemory(devices_->GetLogicalDevice(), index_buffer_memory_);
-	}
+	// stage the data through the upload manager
+	devices_->GetUploadManager()->UploadToBuffer(index_buffer_, indices, buffer_size);
 }
 
 void Shape::RecordRenderCommands(VkCommandBuffer& command_buffer)
@@ -154,7 +96,8 @@ void Shape::RecordRenderCommands(VkCommandBuffer& command_buffer)
 	}
 	else
 	{
-		// shapes that are added to a primitive buffer simply need to execute their draw command
-		vkCmdDrawIndexed(command_buffer, index_count_, 1, index_buffer_offset_, vertex_buffer_offset_, 0);
+		// shapes that are added to a primitive buffer simply need to execute their draw command,
+		// the first instance is the shape index as in the indirect draws
+		vkCmdDrawIndexed(command_buffer, index_count_, 1, index_buffer_offset_, vertex_buffer_offset_, shape_index_);
 	}
 }
\ No newline at end of file
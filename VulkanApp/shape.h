@@ -25,6 +25,8 @@ public:
 	Shape();
 
 	void InitShape(VulkanDevices* devices, VulkanRenderer* renderer, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, BoundingBox bounding_box, bool transparency_enabled);
+	// the data is only read while it is staged, so it may point into a mapped file
+	void InitShape(VulkanDevices* devices, VulkanRenderer* renderer, const Vertex* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count, BoundingBox bounding_box, bool transparency_enabled);
 	void RecordRenderCommands(VkCommandBuffer& command_buffer);
 	void CleanUp();
 
@@ -42,18 +44,18 @@ public:
 
 protected:
 	
-	void CreateVertexBuffer(std::vector<Vertex>& vertices);
-	void CreateIndexBuffer(std::vector<uint32_t>& indices);
+	void CreateVertexBuffer(const Vertex* vertices);
+	void CreateIndexBuffer(const uint32_t* indices);
 
 protected:
 	VulkanDevices* devices_;
 	Material* mesh_material_;
 
 	VkBuffer vertex_buffer_;
-	VkDeviceMemory vertex_buffer_memory_;
+	MemoryAllocation vertex_buffer_memory_;
 
 	VkBuffer index_buffer_;
-	VkDeviceMemory index_buffer_memory_;
+	MemoryAllocation index_buffer_memory_;
 
 	uint32_t vertex_count_;
 	uint32_t index_count_;
@@ -87,7 +87,7 @@ void SkyboxPipeline::CreatePipeline()
 	pipeline_info.basePipelineIndex = -1;
 	pipeline_info.flags = 0;
 
-	if (vkCreateGraphicsPipelines(devices_->GetLogicalDevice(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &pipeline_) != VK_SUCCESS)
+	if (devices_->CreateGraphicsPipelines(1, &pipeline_info, &pipeline_) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create graphics pipeline!");
 	}
@@ -104,7 +104,7 @@ void SkyboxPipeline::CreateRenderPass()
 	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	color_attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	color_attachment.finalLayout = VK_IMAGE_LAYOUT_GENERAL;
+	color_attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 	// setup the subpass attachment description
 	VkAttachmentReference color_attachment_ref = {};
@@ -167,20 +167,19 @@ void SkyboxPipeline::CreateFramebuffers()
 	}
 }
 
-void Skybox::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, VkCommandPool command_pool)
+void Skybox::Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, VulkanFrameConstants* frame_constants, VulkanPipelineBuilder* pipeline_builder)
 {
 	devices_ = devices;
+	frame_constants_ = frame_constants;
 
 	InitResources();
-	InitPipeline(devices, swap_chain);
-	InitCommandBuffer(command_pool);
+	InitPipeline(devices, swap_chain, pipeline_builder);
 }
 
 void Skybox::Cleanup()
 {
 	// clean up buffers
-	vkDestroyBuffer(devices_->GetLogicalDevice(), matrix_buffer_, nullptr);
-	vkFreeMemory(devices_->GetLogicalDevice(), matrix_buffer_memory_, nullptr);
+	frame_constants_->RemoveBuffer(matrix_buffer_constants_);
 	
 	// clean up mesh
 	delete skybox_mesh_;
@@ -200,57 +199,23 @@ void Skybox::Cleanup()
 	skybox_shader_->Cleanup();
 	delete skybox_shader_;
 	skybox_shader_ = nullptr;
-
-	// clean up semaphore
-	vkDestroySemaphore(devices_->GetLogicalDevice(), render_semaphore_, nullptr);
 }
 
-void Skybox::Render(Camera* camera)
+void Skybox::SendMatrixData(Camera* camera)
 {
-	// copy the matrix data to the buffer
+	// copy the matrix data to this frame's constants
 	UniformBufferObject ubo = {};
 	ubo.model = glm::translate(camera->GetPosition());
 	ubo.view = camera->GetViewMatrix();
 	ubo.proj = camera->GetProjectionMatrix();
 
-	devices_->CopyDataToBuffer(matrix_buffer_memory_, &ubo, sizeof(UniformBufferObject));
-
-	// submit the draw command buffer
-	VkSubmitInfo submit_info = {};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.waitSemaphoreCount = 0;
-	submit_info.pWaitSemaphores = nullptr;
-	submit_info.pWaitDstStageMask = nullptr;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &skybox_command_buffer_;
-
-	VkSemaphore signal_semaphores[] = { render_semaphore_ };
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
-
-	VkQueue graphics_queue;
-	vkGetDeviceQueue(devices_->GetLogicalDevice(), devices_->GetQueueFamilyIndices().graphics_family, 0, &graphics_queue);
-
-	VkResult result = vkQueueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to submit deferred command buffer!");
-	}
+	frame_constants_->Write(matrix_buffer_constants_, &ubo, sizeof(UniformBufferObject));
 }
 
-void Skybox::InitPipeline(VulkanDevices* devices, VulkanSwapChain* swap_chain)
+void Skybox::InitPipeline(VulkanDevices* devices, VulkanSwapChain* swap_chain, VulkanPipelineBuilder* pipeline_builder)
 {
-	// create the render semaphore
-	VkSemaphoreCreateInfo semaphore_info = {};
-	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-	if (vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &render_semaphore_) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to create semaphores!");
-	}
-
 	// create the matrix buffer
-	devices_->CreateBuffer(sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, matrix_buffer_, matrix_buffer_memory_);
+	matrix_buffer_constants_ = frame_constants_->AddBuffer(sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
 	
 	// create the skybox shader
 	skybox_shader_ = new VulkanShader();
@@ -259,10 +224,10 @@ void Skybox::InitPipeline(VulkanDevices* devices, VulkanSwapChain* swap_chain)
 	// initialize the skybox pipeline
 	skybox_pipeline_ = new SkyboxPipeline();
 	skybox_pipeline_->SetShader(skybox_shader_);
-	skybox_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 0, matrix_buffer_, sizeof(UniformBufferObject));
+	skybox_pipeline_->AddUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT, 0, frame_constants_->GetBuffer(matrix_buffer_constants_), sizeof(UniformBufferObject));
 	skybox_pipeline_->AddSampler(VK_SHADER_STAGE_FRAGMENT_BIT, 1, skybox_texture_->GetSampler());
 	skybox_pipeline_->AddTexture(VK_SHADER_STAGE_FRAGMENT_BIT, 2, skybox_texture_->GetImageView());
-	skybox_pipeline_->Init(devices, swap_chain, nullptr);
+	pipeline_builder->Add("skybox", [=]() { skybox_pipeline_->Init(devices, swap_chain, nullptr); });
 }
 
 void Skybox::InitCommandBuffer(VkCommandPool command_pool)
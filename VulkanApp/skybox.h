@@ -4,6 +4,8 @@
 #include "pipeline.h"
 #include "mesh.h"
 #include "camera.h"
+#include "frame_constants.h"
+#include "pipeline_builder.h"
 
 class SkyboxPipeline : public VulkanPipeline
 {
@@ -19,15 +21,16 @@ protected:
 class Skybox
 {
 public:
-	void Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, VkCommandPool command_pool);
+	// the pipeline is queued on the builder, the command buffer is recorded once it has been built
+	void Init(VulkanDevices* devices, VulkanSwapChain* swap_chain, VulkanFrameConstants* frame_constants, VulkanPipelineBuilder* pipeline_builder);
+	void InitCommandBuffer(VkCommandPool command_pool);
 	void Cleanup();
-	void Render(Camera* camera);
+	void SendMatrixData(Camera* camera);
 
-	inline VkSemaphore GetRenderSemaphore() { return render_semaphore_; }
+	inline VkCommandBuffer GetCommandBuffer() { return skybox_command_buffer_; }
 
 protected:
-	void InitPipeline(VulkanDevices* devices, VulkanSwapChain* swap_chain);
-	void InitCommandBuffer(VkCommandPool command_pool);
+	void InitPipeline(VulkanDevices* devices, VulkanSwapChain* swap_chain, VulkanPipelineBuilder* pipeline_builder);
 	void InitResources();
 
 protected:
@@ -38,9 +41,8 @@ protected:
 	Mesh* skybox_mesh_;
 	Texture* skybox_texture_;
 	VkCommandBuffer skybox_command_buffer_;
-	VkSemaphore render_semaphore_;
-	VkBuffer matrix_buffer_;
-	VkDeviceMemory matrix_buffer_memory_;
+	VulkanFrameConstants* frame_constants_;
+	FrameConstantHandle matrix_buffer_constants_;
 
 };
 
@@ -1,4 +1,5 @@
 #include "swap_chain.h"
+#include "trace_profiler.h"
 #include "renderer.h"
 #include <stdexcept>
 #include <algorithm>
@@ -10,9 +11,21 @@ void VulkanSwapChain::Init(GLFWwindow* window, VkInstance instance)
 	instance_ = instance;
 	window_ = window;
 	swap_chain_ = VK_NULL_HANDLE;
+	current_image_index_ = 0;
+	current_frame_index_ = 0;
 	CreateSurface();
 }
 
+void VulkanSwapChain::InitHeadless(VkInstance instance)
+{
+	instance_ = instance;
+	window_ = nullptr;
+	surface_ = VK_NULL_HANDLE;
+	swap_chain_ = VK_NULL_HANDLE;
+	current_image_index_ = 0;
+	current_frame_index_ = 0;
+}
+
 void VulkanSwapChain::Cleanup()
 {
 	CleanupSwapChain();
@@ -29,27 +42,62 @@ void VulkanSwapChain::CleanupSwapChain()
 {
 	VkDevice device = devices_->GetLogicalDevice();
 
-	vkDestroySemaphore(device, image_available_semaphore_, nullptr);
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		vkDestroySemaphore(device, image_available_semaphores_[i], nullptr);
+	}
 
 	for (size_t i = 0; i < swap_chain_images_.size(); i++)
 	{
 		vkDestroyImageView(device, swap_chain_image_views_[i], nullptr);
 	}
+
+	for (size_t i = 0; i < offscreen_image_memory_.size(); i++)
+	{
+		vkDestroyImage(device, swap_chain_images_[i], nullptr);
+		devices_->FreeMemory(offscreen_image_memory_[i]);
+	}
+	offscreen_image_memory_.clear();
 	
 	vkDestroyImage(device, intermediate_image_, nullptr);
 	vkDestroyImageView(device, intermediate_image_view_, nullptr);
-	vkFreeMemory(device, intermediate_image_memory_, nullptr);
+	devices_->FreeMemory(intermediate_image_memory_);
 
 	vkDestroyImageView(device, depth_image_view_, nullptr);
 	vkDestroyImage(device, depth_image_, nullptr);
-	vkFreeMemory(device, depth_image_memory_, nullptr);
+	devices_->FreeMemory(depth_image_memory_);
 	
 }
 
-VkResult VulkanSwapChain::PreRender()
+VkResult VulkanSwapChain::PreRender(uint32_t frame_index)
 {
+	TRACE_FUNCTION();
+
+	// each frame in flight signals its own semaphore as the previous frame's may not have been waited on yet
+	current_frame_index_ = frame_index;
+
+	if (IsHeadless())
+	{
+		// each frame in flight renders into its own offscreen image, so the semaphore the frame waits on is signalled straight away
+		current_image_index_ = frame_index % swap_chain_images_.size();
+
+		VkSubmitInfo submit_info = {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.signalSemaphoreCount = 1;
+		submit_info.pSignalSemaphores = &image_available_semaphores_[current_frame_index_];
+
+		if (vkQueueSubmit(present_queue_, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to signal offscreen image semaphore!");
+		}
+		devices_->CountQueueSubmit();
+
+		return VK_SUCCESS;
+	}
+
 	// acquire the next image in the swap chain
-	VkResult result = vkAcquireNextImageKHR(devices_->GetLogicalDevice(), swap_chain_, std::numeric_limits<uint64_t>::max(), image_available_semaphore_, VK_NULL_HANDLE, &current_image_index_);
+	TRACE_SCOPE("acquire swap chain image");
+	VkResult result = vkAcquireNextImageKHR(devices_->GetLogicalDevice(), swap_chain_, std::numeric_limits<uint64_t>::max(), image_available_semaphores_[current_frame_index_], VK_NULL_HANDLE, &current_image_index_);
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR)
 	{
@@ -60,41 +108,33 @@ VkResult VulkanSwapChain::PreRender()
 		throw std::runtime_error("failed to acquire swap chain image!");
 	}
 
-	// clear the swap chain image and depth stencil view before rendering
-	// transition the buffers to the correct format for clearing
-	devices_->TransitionImageLayout(swap_chain_images_[current_image_index_], swap_chain_image_format_, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	devices_->TransitionImageLayout(intermediate_image_, intermediate_image_format_, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	devices_->TransitionImageLayout(depth_image_, depth_format_, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-	// clear the buffers
-	VkCommandBuffer clear_buffer = devices_->BeginSingleTimeCommands();
-
-	VkClearColorValue clear_color = { 0.0f, 0.0f, 0.0f, 0.0f };
-	VkImageSubresourceRange image_range = {};
-	image_range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	image_range.levelCount = 1;
-	image_range.layerCount = 1;
+	return VK_SUCCESS;
+}
 
-	vkCmdClearColorImage(clear_buffer, swap_chain_images_[current_image_index_], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear_color, 1, &image_range);
-	vkCmdClearColorImage(clear_buffer, intermediate_image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear_color, 1, &image_range);
+VkResult VulkanSwapChain::PostRender(VkSemaphore signal_semaphore)
+{
+	TRACE_FUNCTION();
 
-	VkClearDepthStencilValue clear_depth = { 1.0f, 0 };
-	image_range.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	if (IsHeadless())
+	{
+		// nothing is presented, the frame's semaphore is still waited on so it can be signalled again
+		VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 
-	vkCmdClearDepthStencilImage(clear_buffer, depth_image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear_depth, 1, &image_range);
-	
-	devices_->EndSingleTimeCommands(clear_buffer);
+		VkSubmitInfo submit_info = {};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.waitSemaphoreCount = 1;
+		submit_info.pWaitSemaphores = &signal_semaphore;
+		submit_info.pWaitDstStageMask = &wait_stage;
 
-	// transition buffers back to the correct format
-	devices_->TransitionImageLayout(swap_chain_images_[current_image_index_], swap_chain_image_format_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
-	devices_->TransitionImageLayout(intermediate_image_, intermediate_image_format_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-	devices_->TransitionImageLayout(depth_image_, depth_format_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+		if (vkQueueSubmit(present_queue_, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to consume offscreen frame semaphore!");
+		}
+		devices_->CountQueueSubmit();
 
-	return VK_SUCCESS;
-}
+		return VK_SUCCESS;
+	}
 
-VkResult VulkanSwapChain::PostRender(VkSemaphore signal_semaphore)
-{
 	// present the swap chain
 	VkPresentInfoKHR present_info = {};
 	present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -121,53 +161,31 @@ VkResult VulkanSwapChain::PostRender(VkSemaphore signal_semaphore)
 		throw std::runtime_error("failed to present swap chain image!");
 	}
 
-	vkQueueWaitIdle(present_queue_);
-
 	return result;
 }
 
-void VulkanSwapChain::FinalizeIntermediateImage()
+void VulkanSwapChain::AddClearCommands(VulkanBarrierBatch* barrier_batch)
 {
-	// transition the intermediate image to transfersrc layout
-	devices_->TransitionImageLayout(swap_chain_images_[current_image_index_], swap_chain_image_format_, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	devices_->TransitionImageLayout(intermediate_image_, intermediate_image_format_, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-
-	// start the copy command buffer
-	VkCommandBuffer blit_buffer = devices_->BeginSingleTimeCommands();
-
-	VkImageBlit image_blit = {};
-	image_blit.srcOffsets[0] = { 0, 0, 0 };
-	image_blit.srcOffsets[1] = { (int)intermediate_image_extent_.width, (int)intermediate_image_extent_.height, 1 };
-	image_blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	image_blit.srcSubresource.baseArrayLayer = 0;
-	image_blit.srcSubresource.layerCount = 1;
-	image_blit.srcSubresource.mipLevel = 0;
-
-	image_blit.dstOffsets[0] = { 0, 0, 0 };
-	image_blit.dstOffsets[1] = { (int)swap_chain_extent_.width, (int)swap_chain_extent_.height, 1 };
-	image_blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	image_blit.dstSubresource.baseArrayLayer = 0;
-	image_blit.dstSubresource.layerCount = 1;
-	image_blit.dstSubresource.mipLevel = 0;
-
-	vkCmdBlitImage(blit_buffer, intermediate_image_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swap_chain_images_[current_image_index_], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_blit, VK_FILTER_LINEAR);
-
-	// submit the blit command buffer
-	devices_->EndSingleTimeCommands(blit_buffer, image_available_semaphore_);
+	// clear the intermediate image and depth stencil view before rendering, the swap chain image is overwritten by the final blit
+	VkImageAspectFlags depth_aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	if (depth_format_ == VK_FORMAT_D32_SFLOAT_S8_UINT || depth_format_ == VK_FORMAT_D24_UNORM_S8_UINT)
+	{
+		depth_aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+	}
 
-	// transition images back to correct layouts
-	devices_->TransitionImageLayout(swap_chain_images_[current_image_index_], swap_chain_image_format_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
-	devices_->TransitionImageLayout(intermediate_image_, intermediate_image_format_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	barrier_batch->ClearColorImage(intermediate_image_, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	barrier_batch->ClearDepthImage(depth_image_, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, { 1.0f, 0 }, depth_aspect);
 }
 
-void VulkanSwapChain::CopyToIntermediateImage(VkImage image, VkImageLayout image_layout)
+void VulkanSwapChain::RecordFinalizeCommands(VkCommandBuffer command_buffer, VulkanBarrierBatch* barrier_batch, VkImage source_image)
 {
-	// transition the images to the correct layouts
-	devices_->TransitionImageLayout(image, intermediate_image_format_, image_layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-	devices_->TransitionImageLayout(intermediate_image_, intermediate_image_format_, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	VkImage swap_chain_image = swap_chain_images_[current_image_index_];
 
-	// start the copy command buffer
-	VkCommandBuffer blit_buffer = devices_->BeginSingleTimeCommands();
+	// transition the swap chain image to transferdst and the source image to transfersrc layout
+	// the image available semaphore is waited on at the transfer stage so the transition must come after it
+	barrier_batch->TransitionImage(swap_chain_image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT);
+	barrier_batch->TransitionImage(source_image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	barrier_batch->Record(command_buffer);
 
 	VkImageBlit image_blit = {};
 	image_blit.srcOffsets[0] = { 0, 0, 0 };
@@ -178,19 +196,18 @@ void VulkanSwapChain::CopyToIntermediateImage(VkImage image, VkImageLayout image
 	image_blit.srcSubresource.mipLevel = 0;
 
 	image_blit.dstOffsets[0] = { 0, 0, 0 };
-	image_blit.dstOffsets[1] = { (int)intermediate_image_extent_.width, (int)intermediate_image_extent_.height, 1 };
+	image_blit.dstOffsets[1] = { (int)swap_chain_extent_.width, (int)swap_chain_extent_.height, 1 };
 	image_blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	image_blit.dstSubresource.baseArrayLayer = 0;
 	image_blit.dstSubresource.layerCount = 1;
 	image_blit.dstSubresource.mipLevel = 0;
 
-	vkCmdBlitImage(blit_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, intermediate_image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_blit, VK_FILTER_LINEAR);
-
-	devices_->EndSingleTimeCommands(blit_buffer);
+	vkCmdBlitImage(command_buffer, source_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swap_chain_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_blit, VK_FILTER_LINEAR);
 
 	// transition images back to correct layouts
-	devices_->TransitionImageLayout(image, intermediate_image_format_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image_layout);
-	devices_->TransitionImageLayout(intermediate_image_, intermediate_image_format_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	barrier_batch->TransitionImage(swap_chain_image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	barrier_batch->TransitionImage(source_image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	barrier_batch->Record(command_buffer);
 }
 
 void VulkanSwapChain::CreateSurface()
@@ -203,6 +220,8 @@ void VulkanSwapChain::CreateSurface()
 
 void VulkanSwapChain::CreateSwapChain(VulkanDevices* devices, int rendering_width, int rendering_height, int multisample_count)
 {
+	TRACE_FUNCTION();
+
 	devices_ = devices;
 
 	VkDevice vk_device = devices->GetLogicalDevice();
@@ -210,6 +229,21 @@ void VulkanSwapChain::CreateSwapChain(VulkanDevices* devices, int rendering_widt
 	intermediate_image_format_ = VK_FORMAT_R32G32B32A32_SFLOAT;
 	multisample_level_ = multisample_data[multisample_count].sample_count;
 
+	if (IsHeadless())
+	{
+		// without a surface the frames are finalized into offscreen images at the rendering resolution
+		intermediate_image_extent_ = { (uint32_t)rendering_width, (uint32_t)rendering_height };
+
+		CreateOffscreenImages(rendering_width, rendering_height);
+		CreateImageViews();
+		CreateIntermediateImage();
+		CreateDepthResources();
+		CreateSemaphores();
+
+		vkGetDeviceQueue(devices_->GetLogicalDevice(), devices_->GetQueueFamilyIndices().present_family, 0, &present_queue_);
+		return;
+	}
+
 	// store the handle of any previous swap chain
 	VkSwapchainKHR old_swap_chain = swap_chain_;
 
@@ -307,6 +341,30 @@ void VulkanSwapChain::CreateSwapChain(VulkanDevices* devices, int rendering_widt
 	vkGetDeviceQueue(devices_->GetLogicalDevice(), devices_->GetQueueFamilyIndices().present_family, 0, &present_queue_);
 }
 
+void VulkanSwapChain::CreateOffscreenImages(int width, int height)
+{
+	// release the images of a previous resolution
+	if (!swap_chain_images_.empty())
+	{
+		vkDeviceWaitIdle(devices_->GetLogicalDevice());
+		CleanupSwapChain();
+	}
+
+	swap_chain_image_format_ = VK_FORMAT_B8G8R8A8_UNORM;
+	swap_chain_extent_ = { (uint32_t)width, (uint32_t)height };
+
+	// one image per frame in flight so a frame never overwrites an image an earlier frame is still writing
+	swap_chain_images_.resize(MAX_FRAMES_IN_FLIGHT);
+	offscreen_image_memory_.resize(MAX_FRAMES_IN_FLIGHT);
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		devices_->CreateImage(width, height, swap_chain_image_format_, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_SAMPLE_COUNT_1_BIT, swap_chain_images_[i], offscreen_image_memory_[i], AllocationStrategy::LINEAR);
+
+		// the finalize commands expect the layout a presented image is left in
+		devices_->TransitionImageLayout(swap_chain_images_[i], swap_chain_image_format_, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	}
+}
+
 void VulkanSwapChain::CreateImageViews()
 {
 	swap_chain_image_views_.resize(swap_chain_images_.size());
@@ -321,7 +379,7 @@ void VulkanSwapChain::CreateImageViews()
 void VulkanSwapChain::CreateIntermediateImage()
 {
 	// create the intermediate storage image
-	devices_->CreateImage(intermediate_image_extent_.width, intermediate_image_extent_.height, intermediate_image_format_, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_SAMPLE_COUNT_1_BIT, intermediate_image_, intermediate_image_memory_);
+	devices_->CreateImage(intermediate_image_extent_.width, intermediate_image_extent_.height, intermediate_image_format_, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_SAMPLE_COUNT_1_BIT, intermediate_image_, intermediate_image_memory_, AllocationStrategy::LINEAR);
 	intermediate_image_view_ = devices_->CreateImageView(intermediate_image_, intermediate_image_format_, VK_IMAGE_ASPECT_COLOR_BIT);
 
 	// transition to the general image layout
@@ -332,7 +390,7 @@ void VulkanSwapChain::CreateDepthResources()
 {
 	depth_format_ = FindDepthFormat();
 
-	devices_->CreateImage(intermediate_image_extent_.width,intermediate_image_extent_.height, depth_format_, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, multisample_level_, depth_image_, depth_image_memory_);
+	devices_->CreateImage(intermediate_image_extent_.width,intermediate_image_extent_.height, depth_format_, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, multisample_level_, depth_image_, depth_image_memory_, AllocationStrategy::LINEAR);
 	depth_image_view_ = devices_->CreateImageView(depth_image_, depth_format_, VK_IMAGE_ASPECT_DEPTH_BIT);
 
 	devices_->TransitionImageLayout(depth_image_, depth_format_, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
@@ -343,9 +401,12 @@ void VulkanSwapChain::CreateSemaphores()
 	VkSemaphoreCreateInfo semaphore_info = {};
 	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	if (vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &image_available_semaphore_) != VK_SUCCESS)
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		throw std::runtime_error("failed to create semaphores!");
+		if (vkCreateSemaphore(devices_->GetLogicalDevice(), &semaphore_info, nullptr, &image_available_semaphores_[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create semaphores!");
+		}
 	}
 }
 
@@ -7,22 +7,28 @@
 #include <vector>
 
 #include "device.h"
+#include "barrier_batch.h"
+
+#define DEFAULT_FRAMES_IN_FLIGHT 2
+#define MAX_FRAMES_IN_FLIGHT 3
 
 class VulkanSwapChain
 {
 public:	
 	void Init(GLFWwindow* window, VkInstance instance);
+	// render into offscreen images without a window or surface, the frames are never presented
+	void InitHeadless(VkInstance instance);
 	void Cleanup();
 	void CreateSwapChain(VulkanDevices* devices, int rendering_width, int rendering_height, int multisample_count = 1);
 
-	VkResult PreRender();
+	VkResult PreRender(uint32_t frame_index);
 	VkResult PostRender(VkSemaphore signal_semaphore);
-	void CopyToIntermediateImage(VkImage image, VkImageLayout image_layout);
-	void FinalizeIntermediateImage();
+	void AddClearCommands(VulkanBarrierBatch* barrier_batch);
+	void RecordFinalizeCommands(VkCommandBuffer command_buffer, VulkanBarrierBatch* barrier_batch, VkImage source_image);
 
 	VkFormat FindDepthFormat();
 
-	inline VkSemaphore GetImageAvailableSemaphore() { return image_available_semaphore_; }
+	inline VkSemaphore GetImageAvailableSemaphore() { return image_available_semaphores_[current_frame_index_]; }
 	inline uint32_t GetCurrentSwapChainImage() { return current_image_index_; }
 	inline VkSurfaceKHR GetSurface() { return surface_; }
 	inline VkSwapchainKHR GetSwapChain() { return swap_chain_; }
@@ -37,9 +43,11 @@ public:
 	inline VkImage GetDepthImage() { return depth_image_; }
 	inline VkImageView GetDepthImageView() { return depth_image_view_; }
 	inline VkSampleCountFlagBits GetSampleCount() { return multisample_level_; }
+	inline bool IsHeadless() { return surface_ == VK_NULL_HANDLE; }
 
 protected:
 	void CreateSurface();
+	void CreateOffscreenImages(int width, int height);
 	void CreateImageViews();
 	void CreateIntermediateImage();
 	void CreateDepthResources();
@@ -61,8 +69,9 @@ protected:
 	VkSwapchainKHR swap_chain_;
 	std::vector<VkImage> swap_chain_images_;
 	std::vector<VkImageView> swap_chain_image_views_;
+	std::vector<MemoryAllocation> offscreen_image_memory_;	// headless images are owned by the swap chain
 	VkImage intermediate_image_;
-	VkDeviceMemory intermediate_image_memory_;
+	MemoryAllocation intermediate_image_memory_;
 	VkImageView intermediate_image_view_;
 	VkFormat swap_chain_image_format_;
 	VkFormat intermediate_image_format_;
@@ -72,13 +81,14 @@ protected:
 
 	// depth buffer components
 	VkImage depth_image_;
-	VkDeviceMemory depth_image_memory_;
+	MemoryAllocation depth_image_memory_;
 	VkImageView depth_image_view_;
 	VkFormat depth_format_;
 
 	// swap chain presentation components
 	uint32_t current_image_index_;
-	VkSemaphore image_available_semaphore_;
+	uint32_t current_frame_index_;
+	VkSemaphore image_available_semaphores_[MAX_FRAMES_IN_FLIGHT];
 	VkQueue present_queue_;
 };
 
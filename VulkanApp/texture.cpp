@@ -1,4 +1,6 @@
 #include "texture.h"
+#include "trace_profiler.h"
+#include "load_statistics.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #include <iostream>
@@ -15,11 +17,25 @@ Texture::~Texture()
 
 void Texture::Init(VulkanDevices* devices, std::string filename, bool sampler)
 {
+	TRACE_FUNCTION();
+
+	devices_ = devices;
 	vk_device_handle_ = devices->GetLogicalDevice();
 	texture_name_ = filename;
 
 	int tex_width, tex_height, tex_channels;
-	stbi_uc* pixels = stbi_load(filename.c_str(), &tex_width, &tex_height, &tex_channels, STBI_rgb_alpha);
+	stbi_uc* pixels;
+	{
+		TRACE_SCOPE("decode texture");
+		LoadPhaseTimer decode_timer(LoadPhase::TEXTURE_DECODE);
+		pixels = stbi_load(filename.c_str(), &tex_width, &tex_height, &tex_channels, STBI_rgb_alpha);
+
+		if (pixels)
+		{
+			decode_timer.AddBytes(static_cast<uint64_t>(tex_width) * tex_height * 4);
+			decode_timer.AddItems(1);
+		}
+	}
 
 	image_size_ = tex_width * tex_height * 4;
 
@@ -28,17 +44,12 @@ void Texture::Init(VulkanDevices* devices, std::string filename, bool sampler)
 		throw std::runtime_error("failed to load texture image!");
 	}
 
-	VkBuffer staging_buffer;
-	VkDeviceMemory staging_buffer_memory;
+	// staging the pixels, resizing oversized textures and creating the view
+	LoadPhaseTimer upload_timer(LoadPhase::TEXTURE_UPLOAD);
+	upload_timer.AddBytes(image_size_);
+	upload_timer.AddItems(1);
 
-	devices->CreateBuffer(image_size_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory);
-
-	void* data;
-	vkMapMemory(vk_device_handle_, staging_buffer_memory, 0, image_size_, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(image_size_));
-	vkUnmapMemory(vk_device_handle_, staging_buffer_memory);
-
-	stbi_image_free(pixels);
+	VulkanUploadManager* upload_manager = devices->GetUploadManager();
 
 	// reduce sizes of textures that are larger than max texture resolution
 	if (tex_width * tex_height > MAX_TEXTURE_RESOLUTION * MAX_TEXTURE_RESOLUTION)
@@ -56,57 +67,33 @@ void Texture::Init(VulkanDevices* devices, std::string filename, bool sampler)
 			new_height = tex_height * ((float)new_width / (float)tex_width);
 		}
 
-		// create the initial texture and copy in data from the staging buffer
+		// create the initial texture and stage the pixel data into it
 		VkImage initial_image;
-		VkDeviceMemory initial_image_memory;
+		MemoryAllocation initial_image_memory;
 
 		devices->CreateImage(tex_width, tex_height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_SAMPLE_COUNT_1_BIT, initial_image, initial_image_memory);
-		devices->TransitionImageLayout(initial_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		devices->CopyBufferToImage(staging_buffer, initial_image, static_cast<uint32_t>(tex_width), static_cast<uint32_t>(tex_height));
-		devices->TransitionImageLayout(initial_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		upload_manager->UploadToImage(initial_image, pixels, image_size_, static_cast<uint32_t>(tex_width), static_cast<uint32_t>(tex_height), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
 
-		// create the final texture
+		// create the final texture and blit the image from the initial texture
 		devices->CreateImage(new_width, new_height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_SAMPLE_COUNT_1_BIT, texture_image_, texture_image_memory_);
-		devices->TransitionImageLayout(texture_image_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-		// blit the image from the initial texture
-		VkCommandBuffer blit_buffer = devices->BeginSingleTimeCommands();
-
-		VkImageBlit image_blit = {};
-		image_blit.srcOffsets[0] = { 0, 0, 0 };
-		image_blit.srcOffsets[1] = { tex_width, tex_height, 1 };
-		image_blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		image_blit.srcSubresource.baseArrayLayer = 0;
-		image_blit.srcSubresource.layerCount = 1;
-		image_blit.srcSubresource.mipLevel = 0;
-
-		image_blit.dstOffsets[0] = { 0, 0, 0 };
-		image_blit.dstOffsets[1] = { new_width, new_height, 1 };
-		image_blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		image_blit.dstSubresource.baseArrayLayer = 0;
-		image_blit.dstSubresource.layerCount = 1;
-		image_blit.dstSubresource.mipLevel = 0;
-
-		vkCmdBlitImage(blit_buffer, initial_image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, texture_image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_blit, VK_FILTER_LINEAR);
-
-		// submit the blit command buffer
-		devices->EndSingleTimeCommands(blit_buffer);
-
-		// clean up the initial texture now it is no longer needed
-		vkDestroyImage(vk_device_handle_, initial_image, nullptr);
-		vkFreeMemory(vk_device_handle_, initial_image_memory, nullptr);
+		upload_manager->BlitImage(initial_image, { tex_width, tex_height, 1 }, texture_image_, { new_width, new_height, 1 });
+
+		// clean up the initial texture once the blit has completed
+		upload_manager->ReleaseAfterUpload([devices, initial_image, initial_image_memory]() mutable
+		{
+			vkDestroyImage(devices->GetLogicalDevice(), initial_image, nullptr);
+			devices->FreeMemory(initial_image_memory);
+		});
 	}
 	else
 	{
-		// create the texture and copy in data from the buffer
+		// create the texture and stage the pixel data into it
 		devices->CreateImage(tex_width, tex_height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_SAMPLE_COUNT_1_BIT, texture_image_, texture_image_memory_);
-		devices->TransitionImageLayout(texture_image_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		devices->CopyBufferToImage(staging_buffer, texture_image_, static_cast<uint32_t>(tex_width), static_cast<uint32_t>(tex_height));
-		devices->TransitionImageLayout(texture_image_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		upload_manager->UploadToImage(texture_image_, pixels, image_size_, static_cast<uint32_t>(tex_width), static_cast<uint32_t>(tex_height));
 	}
 
-	vkDestroyBuffer(vk_device_handle_, staging_buffer, nullptr);
-	vkFreeMemory(vk_device_handle_, staging_buffer_memory, nullptr);
+	// the pixels have been copied into staging memory so can be freed straight away
+	stbi_image_free(pixels);
 
 	texture_image_view_ = devices->CreateImageView(texture_image_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
 	
@@ -118,7 +105,7 @@ void Texture::Cleanup()
 {
 	vkDestroyImageView(vk_device_handle_, texture_image_view_, nullptr);
 	vkDestroyImage(vk_device_handle_, texture_image_, nullptr);
-	vkFreeMemory(vk_device_handle_, texture_image_memory_, nullptr);
+	devices_->FreeMemory(texture_image_memory_);
 	vkDestroySampler(vk_device_handle_, texture_sampler_, nullptr);
 }
 
@@ -49,7 +49,7 @@ protected:
 
 protected:
 	VkImage texture_image_;
-	VkDeviceMemory texture_image_memory_;
+	MemoryAllocation texture_image_memory_;
 	VkImageView texture_image_view_;
 	VkSampler texture_sampler_;
 
@@ -58,6 +58,7 @@ protected:
 	std::vector<MapType> map_types_;
 	uint16_t usage_count_;
 
+	VulkanDevices* devices_;
 	VkDevice vk_device_handle_;
 };
 
@@ -1,4 +1,5 @@
 #include "texture_cache.h"
+#include "trace_profiler.h"
 
 VulkanTextureCache::VulkanTextureCache(VulkanDevices* devices)
 {
@@ -19,6 +20,8 @@ void VulkanTextureCache::Cleanup()
 
 Texture* VulkanTextureCache::LoadTexture(std::string texture_filename)
 {
+	TRACE_FUNCTION();
+
 	for (Texture* texture : textures_)
 	{
 		if (texture->GetTextureName() == texture_filename)
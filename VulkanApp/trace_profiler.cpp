@@ -0,0 +1,230 @@
+#include "trace_profiler.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+std::mutex TraceProfiler::buffers_mutex_;
+std::vector<TraceProfiler::ThreadBuffer*> TraceProfiler::buffers_;
+std::vector<TraceProfiler::ThreadBuffer*> TraceProfiler::gpu_buffers_;
+std::set<std::string> TraceProfiler::interned_names_;
+
+uint64_t TraceProfiler::frame_ = 0;
+int64_t TraceProfiler::frame_begin_ = -1;
+
+uint32_t TraceProfiler::capture_frame_count_ = 0;
+uint32_t TraceProfiler::capture_boundaries_ = 0;
+int64_t TraceProfiler::capture_begin_ = -1;
+int64_t TraceProfiler::capture_end_ = -1;
+std::string TraceProfiler::capture_filename_;
+
+int64_t TraceProfiler::GetTime()
+{
+	static const auto epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void TraceProfiler::AddEvent(const char* name, int64_t begin, int64_t end)
+{
+	AppendEvent(GetThreadBuffer(), name, begin, end);
+}
+
+void TraceProfiler::SetThreadName(const std::string& name)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(buffers_mutex_);
+	buffer->name = name;
+}
+
+void TraceProfiler::AddGpuEvent(uint32_t queue_family, const char* name, int64_t begin, int64_t end)
+{
+	ThreadBuffer* buffer = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(buffers_mutex_);
+		if (queue_family < gpu_buffers_.size())
+			buffer = gpu_buffers_[queue_family];
+	}
+
+	if (!buffer)
+	{
+		buffer = CreateBuffer("gpu queue family " + std::to_string(queue_family), true);
+
+		std::lock_guard<std::mutex> lock(buffers_mutex_);
+		if (gpu_buffers_.size() <= queue_family)
+			gpu_buffers_.resize(queue_family + 1, nullptr);
+		gpu_buffers_[queue_family] = buffer;
+	}
+
+	AppendEvent(buffer, name, begin, end);
+}
+
+const char* TraceProfiler::InternName(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(buffers_mutex_);
+	return interned_names_.insert(name).first->c_str();
+}
+
+void TraceProfiler::NextFrame()
+{
+	int64_t time = GetTime();
+	if (frame_begin_ >= 0)
+		AddEvent("frame", frame_begin_, time);
+
+	frame_begin_ = time;
+	frame_++;
+
+	if (capture_frame_count_ == 0)
+		return;
+
+	if (capture_begin_ < 0)
+	{
+		capture_begin_ = time;
+		return;
+	}
+
+	capture_boundaries_++;
+	if (capture_boundaries_ == capture_frame_count_)
+		capture_end_ = time;
+
+	// the last frames' gpu zones are read back once their frame slots are reused
+	if (capture_boundaries_ == capture_frame_count_ + TRACE_GPU_LATENCY_FRAMES)
+	{
+		if (WriteTrace(capture_filename_, capture_begin_, capture_end_))
+			std::cout << "Wrote a trace of " << capture_frame_count_ << " frames to " << capture_filename_ << std::endl;
+
+		capture_frame_count_ = 0;
+	}
+}
+
+void TraceProfiler::CaptureFrames(uint32_t frame_count, const std::string& filename)
+{
+	// a capture already in progress is replaced
+	capture_frame_count_ = frame_count;
+	capture_boundaries_ = 0;
+	capture_begin_ = -1;
+	capture_end_ = -1;
+	capture_filename_ = filename;
+}
+
+bool TraceProfiler::WriteTrace(const std::string& filename)
+{
+	return WriteTrace(filename, INT64_MIN, INT64_MAX);
+}
+
+TraceProfiler::ThreadBuffer* TraceProfiler::GetThreadBuffer()
+{
+	thread_local ThreadBuffer* buffer = nullptr;
+	if (!buffer)
+		buffer = CreateBuffer("", false);
+
+	return buffer;
+}
+
+TraceProfiler::ThreadBuffer* TraceProfiler::CreateBuffer(const std::string& name, bool gpu)
+{
+	ThreadBuffer* buffer = new ThreadBuffer();
+	buffer->gpu = gpu;
+	buffer->event_count = 0;
+
+	std::lock_guard<std::mutex> lock(buffers_mutex_);
+	buffer->thread_id = static_cast<uint32_t>(buffers_.size());
+	buffer->name = name.empty() ? "thread " + std::to_string(buffer->thread_id) : name;
+	buffers_.push_back(buffer);
+
+	return buffer;
+}
+
+bool TraceProfiler::WriteTrace(const std::string& filename, int64_t begin, int64_t end)
+{
+	std::ofstream file(filename, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "Failed to open trace file " << filename << std::endl;
+		return false;
+	}
+
+	std::vector<ThreadBuffer*> buffers;
+	{
+		std::lock_guard<std::mutex> lock(buffers_mutex_);
+		buffers = buffers_;
+	}
+
+	// cpu threads and gpu queues are shown as two processes, timestamps in microseconds
+	std::string trace = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	trace += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"cpu\"}},\n";
+	trace += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"gpu\"}}";
+
+	uint32_t dropped_count = 0;
+	std::vector<TraceEvent> events;
+	for (ThreadBuffer* buffer : buffers)
+	{
+		std::string pid = buffer->gpu ? "2" : "1";
+		std::string tid = std::to_string(buffer->thread_id);
+		{
+			std::lock_guard<std::mutex> lock(buffers_mutex_);
+			trace += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{\"name\":\"" + EscapeName(buffer->name.c_str()) + "\"}}";
+		}
+
+		// the owning thread keeps writing while its buffer is copied, zones it may have overwritten meanwhile are discarded
+		uint64_t event_count = buffer->event_count.load(std::memory_order_acquire);
+		uint64_t first_event = (event_count > TRACE_RING_BUFFER_SIZE) ? event_count - TRACE_RING_BUFFER_SIZE : 0;
+
+		events.clear();
+		for (uint64_t i = first_event; i < event_count; i++)
+			events.push_back(buffer->events[i % TRACE_RING_BUFFER_SIZE]);
+
+		uint64_t written_count = buffer->event_count.load(std::memory_order_acquire);
+		uint64_t overwritten_count = (written_count > TRACE_RING_BUFFER_SIZE) ? std::min(written_count - TRACE_RING_BUFFER_SIZE, event_count) : 0;
+		size_t valid_start = static_cast<size_t>(std::max(overwritten_count, first_event) - first_event);
+
+		// the ring no longer holds the beginning of the window
+		if (valid_start < events.size() && events[valid_start].begin > begin && begin != INT64_MIN && first_event + valid_start > 0)
+			dropped_count++;
+
+		for (size_t i = valid_start; i < events.size(); i++)
+		{
+			const TraceEvent& event = events[i];
+			if (event.end < begin || event.begin > end)
+				continue;
+
+			trace += ",\n{\"name\":\"" + EscapeName(event.name) + "\",\"ph\":\"X\",\"pid\":" + pid + ",\"tid\":" + tid;
+			trace += ",\"ts\":" + std::to_string(event.begin / 1000.0) + ",\"dur\":" + std::to_string((event.end - event.begin) / 1000.0) + "}";
+		}
+	}
+
+	trace += "\n]}\n";
+	file << trace;
+
+	if (dropped_count > 0)
+		std::cout << "Trace ring buffers of " << dropped_count << " threads overflowed, increase TRACE_RING_BUFFER_SIZE for a complete trace" << std::endl;
+
+	return true;
+}
+
+void TraceProfiler::AppendEvent(ThreadBuffer* buffer, const char* name, int64_t begin, int64_t end)
+{
+	// only the owning thread writes, the count is published after the zone so readers never see a partial one
+	uint64_t event_count = buffer->event_count.load(std::memory_order_relaxed);
+
+	TraceEvent& event = buffer->events[event_count % TRACE_RING_BUFFER_SIZE];
+	event.name = name;
+	event.begin = begin;
+	event.end = end;
+
+	buffer->event_count.store(event_count + 1, std::memory_order_release);
+}
+
+std::string TraceProfiler::EscapeName(const char* name)
+{
+	std::string escaped;
+	for (const char* c = name; *c; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			escaped += '\\';
+		escaped += *c;
+	}
+
+	return escaped;
+}
@@ -0,0 +1,122 @@
+#ifndef _TRACE_PROFILER_H_
+#define _TRACE_PROFILER_H_
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <set>
+
+// define as 0 to compile every trace zone out
+#ifndef ENABLE_CPU_TRACE
+#define ENABLE_CPU_TRACE 1
+#endif
+
+#define TRACE_RING_BUFFER_SIZE 16384	// zones kept per thread, older zones are overwritten
+#define TRACE_CAPTURE_FRAMES 8
+#define TRACE_GPU_LATENCY_FRAMES 4		// frames a capture is held open for after its last frame so its gpu zones have been read back
+#define TRACE_OUTPUT_DIRECTORY "../res/data/performance_data/"
+
+#if ENABLE_CPU_TRACE
+#define TRACE_CONCATENATE_(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_(a, b)
+
+// zone names are not copied, they must be string literals or interned with TraceProfiler::InternName
+#define TRACE_SCOPE(name) TraceZone TRACE_CONCATENATE(trace_zone_, __LINE__)(name)
+#define TRACE_FUNCTION() TRACE_SCOPE(__FUNCTION__)
+#define TRACE_THREAD_NAME(name) TraceProfiler::SetThreadName(name)
+#define TRACE_FRAME() TraceProfiler::NextFrame()
+#define TRACE_GPU_EVENT(queue_family, name, begin, end) TraceProfiler::AddGpuEvent(queue_family, name, begin, end)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_FUNCTION()
+#define TRACE_THREAD_NAME(name)
+#define TRACE_FRAME()
+#define TRACE_GPU_EVENT(queue_family, name, begin, end)
+#endif
+
+// a completed zone, nanoseconds since the profiler's epoch
+struct TraceEvent
+{
+	const char* name;
+	int64_t begin;
+	int64_t end;
+};
+
+// records scoped cpu zones into a ring buffer per thread along with gpu zones placed on the same timeline,
+// and writes them out as chrome trace event json, viewable in chrome://tracing or perfetto
+class TraceProfiler
+{
+protected:
+	// written only by its own thread, read when a trace is written
+	struct ThreadBuffer
+	{
+		uint32_t thread_id;
+		std::string name;
+		bool gpu;		// a gpu queue rather than a cpu thread
+
+		TraceEvent events[TRACE_RING_BUFFER_SIZE];
+		std::atomic<uint64_t> event_count;
+	};
+
+public:
+	static int64_t GetTime();
+
+	static void AddEvent(const char* name, int64_t begin, int64_t end);
+	static void SetThreadName(const std::string& name);
+
+	// gpu zones are added by the thread reading the timestamps back, times already converted to the profiler's clock
+	static void AddGpuEvent(uint32_t queue_family, const char* name, int64_t begin, int64_t end);
+
+	// returns a copy of the name that lives as long as the program, for names built at runtime
+	static const char* InternName(const std::string& name);
+
+	// marks a frame boundary, finishing a frame range capture once its last frame has ended
+	static void NextFrame();
+
+	// write the zones of the next frame_count frames once they have completed
+	static void CaptureFrames(uint32_t frame_count, const std::string& filename);
+	inline static bool IsCapturing() { return capture_frame_count_ > 0; }
+
+	// write every zone still held in the ring buffers
+	static bool WriteTrace(const std::string& filename);
+
+protected:
+	static ThreadBuffer* GetThreadBuffer();
+	static ThreadBuffer* CreateBuffer(const std::string& name, bool gpu);
+	static bool WriteTrace(const std::string& filename, int64_t begin, int64_t end);
+	static void AppendEvent(ThreadBuffer* buffer, const char* name, int64_t begin, int64_t end);
+	static std::string EscapeName(const char* name);
+
+protected:
+	// buffers are never freed so zones from threads that have exited can still be written
+	static std::mutex buffers_mutex_;
+	static std::vector<ThreadBuffer*> buffers_;
+	static std::vector<ThreadBuffer*> gpu_buffers_;		// per queue family
+	static std::set<std::string> interned_names_;
+
+	static uint64_t frame_;
+	static int64_t frame_begin_;
+
+	// frame range capture, begins at the next frame boundary
+	static uint32_t capture_frame_count_;
+	static uint32_t capture_boundaries_;	// frame boundaries passed since the capture began
+	static int64_t capture_begin_;
+	static int64_t capture_end_;
+	static std::string capture_filename_;
+};
+
+// records a zone from its construction to its destruction
+class TraceZone
+{
+public:
+	inline TraceZone(const char* name) : name_(name), begin_(TraceProfiler::GetTime()) {}
+	inline ~TraceZone() { TraceProfiler::AddEvent(name_, begin_, TraceProfiler::GetTime()); }
+
+protected:
+	const char* name_;
+	int64_t begin_;
+};
+
+#endif
\ No newline at end of file
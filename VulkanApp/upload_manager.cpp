@@ -0,0 +1,552 @@
+#include "upload_manager.h"
+#include "trace_profiler.h"
+#include "device.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+VulkanUploadManager::VulkanUploadManager()
+{
+	devices_ = nullptr;
+	logical_device_ = VK_NULL_HANDLE;
+	queue_ = VK_NULL_HANDLE;
+	command_pool_ = VK_NULL_HANDLE;
+
+	ring_buffer_ = VK_NULL_HANDLE;
+	ring_buffer_memory_ = {};
+	ring_data_ = nullptr;
+	ring_size_ = 0;
+	ring_head_ = 0;
+	ring_tail_ = 0;
+
+	current_batch_ = 0;
+	next_token_ = 1;
+	completed_token_ = 0;
+
+	statistics_ = {};
+}
+
+void VulkanUploadManager::Init(VulkanDevices* devices, VkQueue queue, uint32_t queue_family, VkDeviceSize ring_size)
+{
+	devices_ = devices;
+	logical_device_ = devices->GetLogicalDevice();
+	queue_ = queue;
+	ring_size_ = ring_size;
+
+	// create the command pool the batches are recorded from
+	VkCommandPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.queueFamilyIndex = queue_family;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	if (vkCreateCommandPool(logical_device_, &pool_info, nullptr, &command_pool_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create upload command pool!");
+	}
+
+	// create the batch command buffers and fences
+	VkFenceCreateInfo fence_info = {};
+	fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	for (int i = 0; i < UPLOAD_BATCH_COUNT; i++)
+	{
+		UploadBatch& batch = batches_[i];
+		devices_->CreateCommandBuffers(command_pool_, &batch.command_buffer);
+
+		if (vkCreateFence(logical_device_, &fence_info, nullptr, &batch.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create upload fence!");
+		}
+
+		batch.state = BatchState::FREE;
+		batch.token = 0;
+		batch.ring_end = 0;
+		batch.command_count = 0;
+		batch.pending_writes = 0;
+	}
+
+	// create the staging ring and keep it mapped for the lifetime of the manager
+	devices_->CreateBuffer(ring_size_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ring_buffer_, ring_buffer_memory_);
+	ring_data_ = static_cast<unsigned char*>(ring_buffer_memory_.mapped_data);
+}
+
+void VulkanUploadManager::Cleanup()
+{
+	// make sure nothing is still reading from the staging memory
+	WaitIdle();
+
+	for (int i = 0; i < UPLOAD_BATCH_COUNT; i++)
+	{
+		vkDestroyFence(logical_device_, batches_[i].fence, nullptr);
+	}
+
+	vkDestroyCommandPool(logical_device_, command_pool_, nullptr);
+
+	// clean up the staging ring
+	vkDestroyBuffer(logical_device_, ring_buffer_, nullptr);
+	devices_->FreeMemory(ring_buffer_memory_);
+	ring_data_ = nullptr;
+}
+
+UploadToken VulkanUploadManager::UploadToBuffer(VkBuffer dst_buffer, const void* data, VkDeviceSize size, VkDeviceSize dst_offset)
+{
+	std::unique_lock<std::mutex> lock(upload_mutex_);
+	if (size == 0)
+		return completed_token_;
+
+	StagingAllocation allocation = AllocateStaging(lock, size);
+
+	// copy into the staging memory without holding the lock so producers can overlap
+	lock.unlock();
+	memcpy(allocation.mapped_data, data, static_cast<size_t>(size));
+	lock.lock();
+
+	UploadBatch& batch = batches_[allocation.batch_index];
+
+	VkBufferCopy copy_region = {};
+	copy_region.srcOffset = allocation.offset;
+	copy_region.dstOffset = dst_offset;
+	copy_region.size = size;
+
+	vkCmdCopyBuffer(batch.command_buffer, allocation.buffer, dst_buffer, 1, &copy_region);
+	batch.command_count++;
+
+	statistics_.upload_count++;
+	statistics_.bytes_uploaded += size;
+
+	UploadToken token = batch.token;
+	FinishStaging(allocation);
+
+	return token;
+}
+
+UploadToken VulkanUploadManager::UploadToImage(VkImage dst_image, const void* data, VkDeviceSize size, uint32_t width, uint32_t height, VkImageLayout final_layout)
+{
+	std::unique_lock<std::mutex> lock(upload_mutex_);
+	StagingAllocation allocation = AllocateStaging(lock, size);
+
+	lock.unlock();
+	memcpy(allocation.mapped_data, data, static_cast<size_t>(size));
+	lock.lock();
+
+	UploadBatch& batch = batches_[allocation.batch_index];
+
+	RecordImageBarrier(batch.command_buffer, dst_image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = allocation.offset;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent =
+	{
+		width,
+		height,
+		1
+	};
+
+	vkCmdCopyBufferToImage(batch.command_buffer, allocation.buffer, dst_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	RecordImageBarrier(batch.command_buffer, dst_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, final_layout);
+	batch.command_count++;
+
+	statistics_.upload_count++;
+	statistics_.bytes_uploaded += size;
+
+	UploadToken token = batch.token;
+	FinishStaging(allocation);
+
+	return token;
+}
+
+UploadToken VulkanUploadManager::BlitImage(VkImage src_image, VkOffset3D src_dimensions, VkImage dst_image, VkOffset3D dst_dimensions)
+{
+	std::unique_lock<std::mutex> lock(upload_mutex_);
+	UploadBatch& batch = BeginRecording();
+
+	RecordImageBarrier(batch.command_buffer, dst_image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	VkImageBlit image_blit = {};
+	image_blit.srcOffsets[0] = { 0, 0, 0 };
+	image_blit.srcOffsets[1] = src_dimensions;
+	image_blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	image_blit.srcSubresource.baseArrayLayer = 0;
+	image_blit.srcSubresource.layerCount = 1;
+	image_blit.srcSubresource.mipLevel = 0;
+
+	image_blit.dstOffsets[0] = { 0, 0, 0 };
+	image_blit.dstOffsets[1] = dst_dimensions;
+	image_blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	image_blit.dstSubresource.baseArrayLayer = 0;
+	image_blit.dstSubresource.layerCount = 1;
+	image_blit.dstSubresource.mipLevel = 0;
+
+	vkCmdBlitImage(batch.command_buffer, src_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_blit, VK_FILTER_LINEAR);
+
+	RecordImageBarrier(batch.command_buffer, dst_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	batch.command_count++;
+
+	return batch.token;
+}
+
+void VulkanUploadManager::ReleaseAfterUpload(std::function<void()> release_callback)
+{
+	std::unique_lock<std::mutex> lock(upload_mutex_);
+	UploadBatch& batch = BeginRecording();
+	batch.release_callbacks.push_back(release_callback);
+}
+
+UploadToken VulkanUploadManager::Flush()
+{
+	TRACE_FUNCTION();
+
+	std::unique_lock<std::mutex> lock(upload_mutex_);
+
+	UploadBatch& batch = batches_[current_batch_];
+	if (batch.state != BatchState::RECORDING)
+		return next_token_ - 1;
+
+	// an empty batch does not need submitting, everything before it already has been
+	if (batch.command_count == 0 && batch.pending_writes == 0 && batch.release_callbacks.empty())
+		return batch.token - 1;
+
+	UploadToken token = batch.token;
+	SubmitBatch(lock, current_batch_);
+
+	return token;
+}
+
+void VulkanUploadManager::WaitForToken(UploadToken token)
+{
+	TRACE_FUNCTION();
+
+	std::unique_lock<std::mutex> lock(upload_mutex_);
+
+	// submit the batch the token refers to if it is still being recorded
+	UploadBatch& batch = batches_[current_batch_];
+	if (batch.state == BatchState::RECORDING && token >= batch.token)
+	{
+		SubmitBatch(lock, current_batch_);
+	}
+
+	while (completed_token_ < token)
+	{
+		bool batch_in_flight = false;
+		for (int i = 0; i < UPLOAD_BATCH_COUNT; i++)
+		{
+			if (batches_[i].state == BatchState::IN_FLIGHT)
+				batch_in_flight = true;
+		}
+
+		if (!batch_in_flight)
+			break;
+
+		WaitForOldestBatch();
+	}
+}
+
+bool VulkanUploadManager::IsTokenComplete(UploadToken token)
+{
+	std::unique_lock<std::mutex> lock(upload_mutex_);
+	RetireCompletedBatches();
+	return completed_token_ >= token;
+}
+
+void VulkanUploadManager::WaitIdle()
+{
+	TRACE_FUNCTION();
+
+	WaitForToken(Flush());
+}
+
+UploadStatistics VulkanUploadManager::GetStatistics()
+{
+	std::unique_lock<std::mutex> lock(upload_mutex_);
+	return statistics_;
+}
+
+VulkanUploadManager::StagingAllocation VulkanUploadManager::AllocateStaging(std::unique_lock<std::mutex>& lock, VkDeviceSize size)
+{
+	StagingAllocation allocation = {};
+
+	// uploads that can never fit in the ring get a dedicated staging buffer released with their batch
+	if (size > ring_size_)
+	{
+		UploadBatch& batch = BeginRecording();
+
+		VkBuffer staging_buffer;
+		MemoryAllocation staging_buffer_memory;
+		devices_->CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory, AllocationStrategy::LINEAR);
+		allocation.mapped_data = staging_buffer_memory.mapped_data;
+
+		VulkanDevices* devices = devices_;
+		batch.release_callbacks.push_back([devices, staging_buffer, staging_buffer_memory]() mutable
+		{
+			vkDestroyBuffer(devices->GetLogicalDevice(), staging_buffer, nullptr);
+			devices->FreeMemory(staging_buffer_memory);
+		});
+
+		allocation.buffer = staging_buffer;
+		allocation.offset = 0;
+		allocation.batch_index = current_batch_;
+		batch.pending_writes++;
+
+		statistics_.dedicated_staging_count++;
+		return allocation;
+	}
+
+	VkDeviceSize aligned_size = (size + UPLOAD_ALIGNMENT - 1) & ~((VkDeviceSize)UPLOAD_ALIGNMENT - 1);
+	bool stalled = false;
+
+	while (true)
+	{
+		UploadBatch& batch = BeginRecording();
+
+		// allocations never straddle the end of the ring, skip to the start instead
+		uint64_t offset = (ring_head_ + UPLOAD_ALIGNMENT - 1) & ~((uint64_t)UPLOAD_ALIGNMENT - 1);
+		if ((offset % ring_size_) + aligned_size > ring_size_)
+		{
+			offset = (offset / ring_size_ + 1) * ring_size_;
+		}
+
+		if (offset + aligned_size - ring_tail_ <= ring_size_)
+		{
+			ring_head_ = offset + aligned_size;
+			batch.ring_end = ring_head_;
+			batch.pending_writes++;
+
+			allocation.buffer = ring_buffer_;
+			allocation.offset = offset % ring_size_;
+			allocation.mapped_data = ring_data_ + allocation.offset;
+			allocation.batch_index = current_batch_;
+			return allocation;
+		}
+
+		// the ring is full, free space by retiring or submitting batches
+		if (!stalled)
+		{
+			statistics_.ring_stalls++;
+			stalled = true;
+		}
+
+		RetireCompletedBatches();
+
+		bool batch_in_flight = false;
+		for (int i = 0; i < UPLOAD_BATCH_COUNT; i++)
+		{
+			if (batches_[i].state == BatchState::IN_FLIGHT)
+				batch_in_flight = true;
+		}
+
+		if (batch_in_flight)
+		{
+			WaitForOldestBatch();
+		}
+		else if (batch.command_count > 0 || batch.pending_writes > 0)
+		{
+			SubmitBatch(lock, current_batch_);
+		}
+		else
+		{
+			// nothing references the ring so restart at the next wrap point
+			ring_head_ = ((ring_head_ + ring_size_ - 1) / ring_size_) * ring_size_;
+			ring_tail_ = ring_head_;
+			batch.ring_end = ring_head_;
+		}
+	}
+}
+
+void VulkanUploadManager::FinishStaging(const StagingAllocation& allocation)
+{
+	UploadBatch& batch = batches_[allocation.batch_index];
+	batch.pending_writes--;
+
+	if (batch.pending_writes == 0)
+		writes_complete_.notify_all();
+}
+
+VulkanUploadManager::UploadBatch& VulkanUploadManager::BeginRecording()
+{
+	UploadBatch& batch = batches_[current_batch_];
+
+	// batches are reused round robin so the slot may still be on the device
+	if (batch.state == BatchState::IN_FLIGHT)
+	{
+		RetireBatch(current_batch_);
+	}
+
+	if (batch.state == BatchState::FREE)
+	{
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(batch.command_buffer, &begin_info);
+
+		batch.state = BatchState::RECORDING;
+		batch.token = next_token_++;
+		batch.ring_end = ring_head_;
+		batch.command_count = 0;
+		batch.pending_writes = 0;
+	}
+
+	return batch;
+}
+
+void VulkanUploadManager::SubmitBatch(std::unique_lock<std::mutex>& lock, uint32_t batch_index)
+{
+	UploadBatch& batch = batches_[batch_index];
+	if (batch.state != BatchState::RECORDING)
+		return;
+
+	// wait for producers still copying into this batch's staging memory
+	UploadToken token = batch.token;
+	writes_complete_.wait(lock, [&batch, token]() { return batch.pending_writes == 0 || batch.state != BatchState::RECORDING || batch.token != token; });
+
+	if (batch.state != BatchState::RECORDING || batch.token != token)
+		return;
+
+	// make the uploaded data visible to all work submitted after this batch
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	vkCmdPipelineBarrier(batch.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	if (vkEndCommandBuffer(batch.command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record upload command buffer!");
+	}
+
+	VkSubmitInfo submit_info = {};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &batch.command_buffer;
+
+	if (vkQueueSubmit(queue_, 1, &submit_info, batch.fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit upload command buffer!");
+	}
+
+	batch.state = BatchState::IN_FLIGHT;
+	statistics_.batches_submitted++;
+	devices_->CountQueueSubmit();
+
+	current_batch_ = (batch_index + 1) % UPLOAD_BATCH_COUNT;
+}
+
+void VulkanUploadManager::RetireBatch(uint32_t batch_index)
+{
+	UploadBatch& batch = batches_[batch_index];
+
+	vkWaitForFences(logical_device_, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+	vkResetFences(logical_device_, 1, &batch.fence);
+	devices_->CountIdleWait();
+
+	for (std::function<void()>& release_callback : batch.release_callbacks)
+	{
+		release_callback();
+	}
+	batch.release_callbacks.clear();
+
+	// batches complete in submission order so the tail only moves forward
+	ring_tail_ = std::max(ring_tail_, batch.ring_end);
+	completed_token_ = std::max(completed_token_, batch.token);
+	batch.state = BatchState::FREE;
+}
+
+void VulkanUploadManager::RetireCompletedBatches()
+{
+	for (int i = 0; i < UPLOAD_BATCH_COUNT; i++)
+	{
+		// walk the slots from oldest to newest, the recording slot is skipped
+		uint32_t batch_index = (current_batch_ + i) % UPLOAD_BATCH_COUNT;
+		UploadBatch& batch = batches_[batch_index];
+
+		if (batch.state != BatchState::IN_FLIGHT)
+			continue;
+
+		if (vkGetFenceStatus(logical_device_, batch.fence) != VK_SUCCESS)
+			break;
+
+		RetireBatch(batch_index);
+	}
+}
+
+void VulkanUploadManager::WaitForOldestBatch()
+{
+	for (int i = 0; i < UPLOAD_BATCH_COUNT; i++)
+	{
+		uint32_t batch_index = (current_batch_ + i) % UPLOAD_BATCH_COUNT;
+		if (batches_[batch_index].state == BatchState::IN_FLIGHT)
+		{
+			RetireBatch(batch_index);
+			return;
+		}
+	}
+}
+
+void VulkanUploadManager::RecordImageBarrier(VkCommandBuffer command_buffer, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = old_layout;
+	barrier.newLayout = new_layout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	VkPipelineStageFlags source_stage;
+	VkPipelineStageFlags destination_stage;
+
+	// set up source properties
+	if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED)
+	{
+		barrier.srcAccessMask = 0;
+		source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	}
+	else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	else
+	{
+		throw std::runtime_error("unsupported upload layout transition!");
+	}
+
+	// set up destination properties
+	if (new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+	{
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	else if (new_layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+	{
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	else if (new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+	{
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	}
+	else
+	{
+		throw std::runtime_error("unsupported upload layout transition!");
+	}
+
+	vkCmdPipelineBarrier(command_buffer, source_stage, destination_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#ifndef _UPLOAD_MANAGER_H_
+#define _UPLOAD_MANAGER_H_
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+#include "memory_allocator.h"
+
+#define UPLOAD_RING_SIZE 67108864
+#define UPLOAD_BATCH_COUNT 4
+#define UPLOAD_ALIGNMENT 16
+
+class VulkanDevices;
+
+// identifies the batch an upload was recorded into, tokens increase monotonically
+typedef uint64_t UploadToken;
+
+struct UploadStatistics
+{
+	uint64_t upload_count;
+	uint64_t bytes_uploaded;
+	uint64_t batches_submitted;
+	uint64_t ring_stalls;
+	uint64_t dedicated_staging_count;
+};
+
+class VulkanUploadManager
+{
+protected:
+	enum class BatchState
+	{
+		FREE,
+		RECORDING,
+		IN_FLIGHT
+	};
+
+	struct UploadBatch
+	{
+		VkCommandBuffer command_buffer;
+		VkFence fence;
+		BatchState state;
+		UploadToken token;
+		uint64_t ring_end;
+		uint32_t command_count;
+		uint32_t pending_writes;
+		std::vector<std::function<void()>> release_callbacks;
+	};
+
+	struct StagingAllocation
+	{
+		VkBuffer buffer;
+		VkDeviceSize offset;
+		void* mapped_data;
+		uint32_t batch_index;
+	};
+
+public:
+	VulkanUploadManager();
+
+	void Init(VulkanDevices* devices, VkQueue queue, uint32_t queue_family, VkDeviceSize ring_size = UPLOAD_RING_SIZE);
+	void Cleanup();
+
+	// copy data into a device buffer, the data is staged before returning so it may be freed immediately
+	UploadToken UploadToBuffer(VkBuffer dst_buffer, const void* data, VkDeviceSize size, VkDeviceSize dst_offset = 0);
+
+	// copy tightly packed rgba8 data into an image, transitioning it from undefined to final_layout
+	UploadToken UploadToImage(VkImage dst_image, const void* data, VkDeviceSize size, uint32_t width, uint32_t height, VkImageLayout final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	// blit a transfer src image into an undefined image, leaving the destination shader readable
+	UploadToken BlitImage(VkImage src_image, VkOffset3D src_dimensions, VkImage dst_image, VkOffset3D dst_dimensions);
+
+	// run a callback once every upload recorded so far has completed on the device
+	void ReleaseAfterUpload(std::function<void()> release_callback);
+
+	UploadToken Flush();
+	void WaitForToken(UploadToken token);
+	bool IsTokenComplete(UploadToken token);
+	void WaitIdle();
+
+	UploadStatistics GetStatistics();
+
+protected:
+	StagingAllocation AllocateStaging(std::unique_lock<std::mutex>& lock, VkDeviceSize size);
+	void FinishStaging(const StagingAllocation& allocation);
+
+	UploadBatch& BeginRecording();
+	void SubmitBatch(std::unique_lock<std::mutex>& lock, uint32_t batch_index);
+	void RetireBatch(uint32_t batch_index);
+	void RetireCompletedBatches();
+	void WaitForOldestBatch();
+
+	void RecordImageBarrier(VkCommandBuffer command_buffer, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout);
+
+protected:
+	VulkanDevices* devices_;
+	VkDevice logical_device_;
+	VkQueue queue_;
+
+	VkCommandPool command_pool_;
+	UploadBatch batches_[UPLOAD_BATCH_COUNT];
+	uint32_t current_batch_;
+	UploadToken next_token_;
+	UploadToken completed_token_;
+
+	// persistently mapped staging ring, head and tail are virtual offsets that only grow
+	VkBuffer ring_buffer_;
+	MemoryAllocation ring_buffer_memory_;
+	unsigned char* ring_data_;
+	VkDeviceSize ring_size_;
+	uint64_t ring_head_;
+	uint64_t ring_tail_;
+
+	std::mutex upload_mutex_;
+	std::condition_variable writes_complete_;
+
+	UploadStatistics statistics_;
+};
+
+#endif
\ No newline at end of file
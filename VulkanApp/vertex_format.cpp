@@ -0,0 +1,173 @@
+#include "vertex_format.h"
+#include "mesh.h"
+#include "primitive_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+std::string VertexPacker::GetFormatName(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::FLOAT: return "float";
+	case VertexFormat::PACKED: return "packed";
+	}
+
+	return "unknown";
+}
+
+bool VertexPacker::FindFormat(const std::string& name, VertexFormat& format)
+{
+	for (int i = 0; i < VERTEX_FORMAT_COUNT; i++)
+	{
+		if (GetFormatName(static_cast<VertexFormat>(i)) == name)
+		{
+			format = static_cast<VertexFormat>(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint32_t VertexPacker::GetVertexStride(VertexFormat format)
+{
+	return (format == VertexFormat::PACKED) ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+std::vector<VkVertexInputBindingDescription> VertexPacker::GetBindingDescriptions(VertexFormat format)
+{
+	std::vector<VkVertexInputBindingDescription> binding_descriptions;
+
+	VkVertexInputBindingDescription vertex_binding = {};
+	vertex_binding.binding = 0;
+	vertex_binding.stride = GetVertexStride(format);
+	vertex_binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	binding_descriptions.push_back(vertex_binding);
+
+	// the shape buffer is bound as a per instance stream, the draws' first instance is their shape index
+	if (format == VertexFormat::PACKED)
+	{
+		VkVertexInputBindingDescription shape_binding = {};
+		shape_binding.binding = 1;
+		shape_binding.stride = sizeof(ShapeData);
+		shape_binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+		binding_descriptions.push_back(shape_binding);
+	}
+
+	return binding_descriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription> VertexPacker::GetAttributeDescriptions(VertexFormat format)
+{
+	if (format == VertexFormat::FLOAT)
+	{
+		auto attribute_descriptions = Vertex::GetAttributeDescriptions();
+		return std::vector<VkVertexInputAttributeDescription>(attribute_descriptions.begin(), attribute_descriptions.end());
+	}
+
+	std::vector<VkVertexInputAttributeDescription> attribute_descriptions(3);
+
+	// the packed vertex, decoded in the shader
+	attribute_descriptions[0].binding = 0;
+	attribute_descriptions[0].location = 0;
+	attribute_descriptions[0].format = VK_FORMAT_R32G32B32A32_UINT;
+	attribute_descriptions[0].offset = 0;
+
+	// the bounds of the vertex's shape
+	attribute_descriptions[1].binding = 1;
+	attribute_descriptions[1].location = 1;
+	attribute_descriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	attribute_descriptions[1].offset = offsetof(ShapeData, min_bounding_vertex);
+
+	attribute_descriptions[2].binding = 1;
+	attribute_descriptions[2].location = 2;
+	attribute_descriptions[2].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	attribute_descriptions[2].offset = offsetof(ShapeData, max_bounding_vertex);
+
+	return attribute_descriptions;
+}
+
+std::string VertexPacker::GetShaderFilename(const std::string& filename, VertexFormat format)
+{
+	if (format == VertexFormat::FLOAT)
+		return filename;
+
+	// the suffix goes before the first extension of the file name, so shader.frag.spv becomes shader_packed.frag.spv
+	size_t name_start = filename.find_last_of("/\\");
+	name_start = (name_start == std::string::npos) ? 0 : name_start + 1;
+
+	size_t extension_start = filename.find('.', name_start);
+	if (extension_start == std::string::npos)
+		extension_start = filename.size();
+
+	return filename.substr(0, extension_start) + PACKED_VERTEX_SHADER_SUFFIX + filename.substr(extension_start);
+}
+
+PackedVertex VertexPacker::Pack(const Vertex& vertex, const glm::vec4& min_vertex, const glm::vec4& max_vertex)
+{
+	PackedVertex packed_vertex = {};
+
+	// the position is stored as a fraction of the shape's extent, a flat axis stores zero
+	glm::vec3 extent = glm::vec3(max_vertex) - glm::vec3(min_vertex);
+	glm::vec3 position = glm::vec3(vertex.pos_mat_index) - glm::vec3(min_vertex);
+	for (int i = 0; i < 3; i++)
+	{
+		position[i] = (extent[i] > 0.0f) ? std::max(0.0f, std::min(1.0f, position[i] / extent[i])) : 0.0f;
+	}
+
+	uint32_t material_index = static_cast<uint32_t>(vertex.pos_mat_index.w);
+	if (material_index > PACKED_VERTEX_MAX_MATERIAL_INDEX)
+	{
+		throw std::runtime_error("material index " + std::to_string(material_index) + " does not fit in a packed vertex!");
+	}
+
+	packed_vertex.position_xy = glm::packUnorm2x16(glm::vec2(position.x, position.y));
+	packed_vertex.position_z_material = (glm::packUnorm2x16(glm::vec2(position.z, 0.0f)) & 0xFFFF) | (material_index << 16);
+
+	// the normal is re-encoded rather than converted, the octahedron has the more even precision of the two
+	glm::vec3 normal = SpheremapDecode(glm::vec2(vertex.encoded_normal_tex.x, vertex.encoded_normal_tex.y));
+	packed_vertex.normal = glm::packSnorm2x16(OctahedronEncode(normal));
+
+	packed_vertex.tex_coord = glm::packHalf2x16(glm::vec2(vertex.encoded_normal_tex.z, vertex.encoded_normal_tex.w));
+
+	return packed_vertex;
+}
+
+void VertexPacker::Pack(const Vertex* vertices, uint32_t vertex_count, const glm::vec4& min_vertex, const glm::vec4& max_vertex, std::vector<PackedVertex>& packed_vertices)
+{
+	packed_vertices.resize(vertex_count);
+	for (uint32_t i = 0; i < vertex_count; i++)
+	{
+		packed_vertices[i] = Pack(vertices[i], min_vertex, max_vertex);
+	}
+}
+
+glm::vec3 VertexPacker::SpheremapDecode(glm::vec2 encoded_normal)
+{
+	// matches the decode in the shaders, so a packed vertex has the normal the float layout would shade with
+	glm::vec2 nn = encoded_normal * 2.0f - glm::vec2(1.0f, 1.0f);
+	float l = 1.0f - glm::dot(nn, nn);
+	nn *= sqrt(std::max(l, 0.0f));
+	return glm::vec3(nn * 2.0f, l * 2.0f - 1.0f);
+}
+
+glm::vec2 VertexPacker::OctahedronEncode(glm::vec3 normal)
+{
+	float length = fabs(normal.x) + fabs(normal.y) + fabs(normal.z);
+	if (length == 0.0f)
+		return glm::vec2(0.0f, 0.0f);
+
+	normal /= length;
+
+	// the lower hemisphere is folded over the diagonals
+	glm::vec2 encoded = glm::vec2(normal.x, normal.y);
+	if (normal.z < 0.0f)
+	{
+		encoded.x = (1.0f - fabs(normal.y)) * ((normal.x >= 0.0f) ? 1.0f : -1.0f);
+		encoded.y = (1.0f - fabs(normal.x)) * ((normal.y >= 0.0f) ? 1.0f : -1.0f);
+	}
+
+	return encoded;
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef _VERTEX_FORMAT_H_
+#define _VERTEX_FORMAT_H_
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#define DEFAULT_VERTEX_FORMAT VertexFormat::FLOAT
+#define PACKED_VERTEX_SHADER_SUFFIX "_packed"		// inserted before the extensions of a shader compiled with PACKED_VERTEX_FORMAT defined
+#define PACKED_VERTEX_MAX_MATERIAL_INDEX 0xFFFF
+#define VERTEX_FORMAT_COUNT 2
+
+struct Vertex;
+
+// the layout of the primitive buffer's vertices, chosen when the renderer is initialized
+enum class VertexFormat
+{
+	FLOAT,		// Vertex, 32 bytes
+	PACKED		// PackedVertex, 16 bytes
+};
+
+// the layout decoded by res/shaders/vertex_format.glsl, the position is quantized within the bounds of its
+// shape, which the raster shaders read as per instance attributes and the resolve shaders from the shape buffer
+struct PackedVertex
+{
+	uint32_t position_xy;			// unorm16 x and y
+	uint32_t position_z_material;	// unorm16 z, the material index in the high 16 bits
+	uint32_t normal;				// octahedral snorm16 x and y
+	uint32_t tex_coord;				// half float u and v
+};
+
+class VertexPacker
+{
+public:
+	static std::string GetFormatName(VertexFormat format);
+	static bool FindFormat(const std::string& name, VertexFormat& format);
+
+	static uint32_t GetVertexStride(VertexFormat format);
+	static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions(VertexFormat format);
+	static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions(VertexFormat format);
+
+	// the shader variant that reads the format's vertices
+	static std::string GetShaderFilename(const std::string& filename, VertexFormat format);
+
+	// throws when a material index does not fit in 16 bits
+	static PackedVertex Pack(const Vertex& vertex, const glm::vec4& min_vertex, const glm::vec4& max_vertex);
+	static void Pack(const Vertex* vertices, uint32_t vertex_count, const glm::vec4& min_vertex, const glm::vec4& max_vertex, std::vector<PackedVertex>& packed_vertices);
+
+protected:
+	static glm::vec3 SpheremapDecode(glm::vec2 encoded_normal);
+	static glm::vec2 OctahedronEncode(glm::vec3 normal);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "vertex_welder.h"
+
+#include <tiny_obj_loader.h>
+#include <unordered_map>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+VertexWelder::VertexWelder()
+{
+	slot_mask_ = 0;
+	vertices_ = nullptr;
+}
+
+void VertexWelder::Reset(size_t max_vertex_count, std::vector<Vertex>* vertices)
+{
+	// the table is kept at most half full so probe sequences stay short
+	size_t slot_count = 16;
+	while (slot_count < max_vertex_count * 2)
+		slot_count <<= 1;
+
+	Slot empty_slot = { 0, VERTEX_WELDER_EMPTY_SLOT };
+	slots_.assign(slot_count, empty_slot);
+	slot_mask_ = slot_count - 1;
+
+	vertices_ = vertices;
+	vertices_->clear();
+}
+
+uint32_t VertexWelder::Weld(const Vertex& vertex)
+{
+	uint32_t hash = static_cast<uint32_t>(std::hash<Vertex>()(vertex));
+
+	// linear probing, the stored hash avoids reading the vertices of most other slots
+	for (size_t slot_index = hash & slot_mask_;; slot_index = (slot_index + 1) & slot_mask_)
+	{
+		Slot& slot = slots_[slot_index];
+		if (slot.vertex_index == VERTEX_WELDER_EMPTY_SLOT)
+		{
+			slot.hash = hash;
+			slot.vertex_index = static_cast<uint32_t>(vertices_->size());
+			vertices_->push_back(vertex);
+			return slot.vertex_index;
+		}
+
+		if (slot.hash == hash && (*vertices_)[slot.vertex_index] == vertex)
+			return slot.vertex_index;
+	}
+}
+
+// the vec3 and vec2 hash the loader used before the welder
+struct BenchmarkLegacyVertexHash
+{
+	size_t operator()(Vertex const& vertex) const
+	{
+		return (std::hash<glm::vec3>()(vertex.pos_mat_index) ^ (std::hash<glm::vec2>()(vertex.encoded_normal_tex) << 1));
+	}
+};
+
+void VertexWelder::RunBenchmark(const std::string& filename, uint32_t iterations)
+{
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string err;
+
+	std::cout << "Loading model file: " << filename << std::endl;
+	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename.c_str(), "../res/materials/"))
+	{
+		throw std::runtime_error(err);
+	}
+
+	// the vertices are created up front so only the welding is timed, the material id stands in for the material index
+	std::vector<std::vector<Vertex>> shape_vertices(shapes.size());
+	size_t index_count = 0;
+	for (size_t s = 0; s < shapes.size(); s++)
+	{
+		const tinyobj::mesh_t& mesh = shapes[s].mesh;
+		for (size_t i = 0; i < mesh.indices.size(); i++)
+		{
+			Vertex vertex = Mesh::CreateVertex(attrib, mesh.indices[i]);
+			vertex.pos_mat_index.w = static_cast<float>(std::max(mesh.material_ids[i / 3], 0));
+			shape_vertices[s].push_back(vertex);
+		}
+		index_count += mesh.indices.size();
+	}
+
+	if (index_count == 0)
+	{
+		std::cout << "The model contains no indices to weld" << std::endl;
+		return;
+	}
+
+	double legacy_time = 0.0, welder_time = 0.0;
+	size_t legacy_unique_count = 0, welder_unique_count = 0;
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+
+	for (uint32_t iteration = 0; iteration < iterations; iteration++)
+	{
+		// the unordered map with its two lookups per index
+		legacy_unique_count = 0;
+		auto legacy_start = std::chrono::high_resolution_clock::now();
+		for (const std::vector<Vertex>& shape : shape_vertices)
+		{
+			std::unordered_map<Vertex, uint32_t, BenchmarkLegacyVertexHash> unique_vertices = {};
+			vertices.clear();
+			indices.clear();
+			for (const Vertex& vertex : shape)
+			{
+				if (unique_vertices.count(vertex) == 0)
+				{
+					unique_vertices[vertex] = static_cast<uint32_t>(vertices.size());
+					vertices.push_back(vertex);
+				}
+				indices.push_back(unique_vertices[vertex]);
+			}
+			legacy_unique_count += vertices.size();
+		}
+		legacy_time += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - legacy_start).count();
+
+		// the welder
+		welder_unique_count = 0;
+		VertexWelder welder;
+		auto welder_start = std::chrono::high_resolution_clock::now();
+		for (const std::vector<Vertex>& shape : shape_vertices)
+		{
+			welder.Reset(shape.size(), &vertices);
+			indices.clear();
+			for (const Vertex& vertex : shape)
+				indices.push_back(welder.Weld(vertex));
+			welder_unique_count += vertices.size();
+		}
+		welder_time += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - welder_start).count();
+	}
+
+	double legacy_throughput = (index_count * iterations) / (legacy_time * 1000.0);
+	double welder_throughput = (index_count * iterations) / (welder_time * 1000.0);
+
+	std::cout << "Welded " << index_count << " indices in " << shapes.size() << " shapes, " << iterations << " iterations" << std::endl;
+	std::cout << "\tunordered map: " << legacy_throughput << " M indices/s, " << legacy_unique_count << " unique vertices" << std::endl;
+	std::cout << "\tvertex welder: " << welder_throughput << " M indices/s, " << welder_unique_count << " unique vertices" << std::endl;
+	std::cout << "\tspeedup: " << legacy_time / welder_time << "x" << std::endl;
+
+	if (legacy_unique_count != welder_unique_count)
+	{
+		throw std::runtime_error("vertex welder produced a different number of unique vertices!");
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef _VERTEX_WELDER_H_
+#define _VERTEX_WELDER_H_
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "mesh.h"
+
+#define VERTEX_WELDER_EMPTY_SLOT 0xFFFFFFFF
+#define VERTEX_WELDER_BENCHMARK_ITERATIONS 5
+
+// deduplicates vertices with an open addressing table that is sized up front, so welding a vertex
+// is a single probe sequence with no allocation other than appending a new vertex
+class VertexWelder
+{
+protected:
+	struct Slot
+	{
+		uint32_t hash;
+		uint32_t vertex_index;
+	};
+
+public:
+	VertexWelder();
+
+	// clears the table and sizes it for up to max_vertex_count unique vertices, vertices are added to the given array
+	void Reset(size_t max_vertex_count, std::vector<Vertex>* vertices);
+
+	// returns the index of an equal vertex, adding the vertex when there is none
+	uint32_t Weld(const Vertex& vertex);
+
+	// welds the vertices of every shape in an obj with the unordered map the loader used before the welder
+	// and with the welder, then prints the throughput of each in millions of indices per second
+	static void RunBenchmark(const std::string& filename, uint32_t iterations = VERTEX_WELDER_BENCHMARK_ITERATIONS);
+
+protected:
+	std::vector<Slot> slots_;
+	size_t slot_mask_;
+	std::vector<Vertex>* vertices_;
+};
+
+#endif
\ No newline at end of file
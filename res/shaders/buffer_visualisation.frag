@@ -1,17 +1,372 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+#ifdef PACKED_VERTEX_FORMAT
+#extension GL_GOOGLE_include_directive : require
+#include "vertex_format.glsl"
+#endif
+
+#define PEEL_COUNT 4
+
+// the views, matching BufferVisualisationMode
+#define VIEW_DEPTH 0
+#define VIEW_OVERDRAW 1
+#define VIEW_LIGHT_COUNT 2
+#define VIEW_PEEL_OCCUPANCY 3
+#define VIEW_SHAPE_ID 4
+#define VIEW_TRIANGLE_ID 5
+#define VIEW_CULLING 6
+#define VIEW_SHADOW_TEXEL_DENSITY 7
+
+// counts at which the heatmaps saturate
+#define OVERDRAW_HEAT_MAX 8.0f
+#define LIGHT_COUNT_HEAT_MAX 16.0f
+
 // inputs
+layout(origin_upper_left) in vec4 gl_FragCoord;
 layout(location = 0) in vec2 fragTexCoord;
 
-layout(binding = 0) uniform sampler bufferSampler;
-layout(binding = 1) uniform texture2D bufferTexture;
+// required structs
+struct LightData
+{
+	vec4 lightPosition;
+	vec4 lightDirection;
+	vec4 lightColor;
+	float lightRange;
+	float lightIntensity;
+	float lightType;
+	float shadowsEnabled;
+	mat4 viewProjMatrices[6];
+	uint shadowMapIndex;
+	uint padding[3];
+};
+
+struct StorageVertex
+{
+	vec4 pos_mat_index;
+	vec4 encoded_normal_tex_coord;
+};
+
+struct Shape
+{
+	uvec4 offsets;
+	vec4 min_vertex;
+	vec4 max_vertex;
+};
+
+struct IndirectDrawCommand
+{
+	uint	indexCount;
+	uint	instanceCount;
+	uint	firstIndex;
+	int		vertexOffset;
+	uint	firstInstance;
+	uint	padding[3];
+};
+
+// uniform buffers
+layout(binding = 0) buffer LightingBuffer
+{
+	vec4 scene_data;
+	vec4 camera_data;
+	LightData lights[];
+} light_data;
+
+layout(binding = 1) uniform VisualisationBuffer
+{
+	vec4 screenDimensions;
+	mat4 invView;
+	mat4 invProj;
+	uvec4 viewData;		// view, shape count
+} visualisation_data;
+
+// textures
+layout(binding = 2) uniform sampler bufferSampler;
+layout(binding = 3) uniform utexture2D visibilityBuffers[PEEL_COUNT];
+layout(binding = 4) uniform texture2D depthBuffers[PEEL_COUNT];
+layout(binding = 5) uniform texture2D overdrawBuffer;
+layout(binding = 6) uniform texture2D shadowMaps[96];
+
+// vertex, index, shape and draw buffers
+layout(binding = 7) buffer VertexBuffer
+{
+#ifdef PACKED_VERTEX_FORMAT
+	uvec4 _vertices[];
+#else
+	StorageVertex _vertices[];
+#endif
+};
+
+layout(binding = 8) buffer IndexBuffer
+{
+	uint _indices[];
+};
+
+layout(binding = 9) buffer ShapeBuffer
+{
+	Shape _shapes[];
+};
+
+layout(binding = 10) buffer DrawCommandBuffer
+{
+	IndirectDrawCommand _draw_commands[];
+};
 
 // outputs
 layout(location = 0) out vec4 outColor;
 
+#define SHAPE_ID_BITS 12
+#define SHAPE_ID_MASK 4095
+
+vec3 PositionFromDepth(float depth, vec2 uv)
+{
+	vec4 clipPos = vec4(uv * 2.0 - 1.0, depth, 1.0);
+	vec4 viewPos = visualisation_data.invProj * clipPos;
+
+	viewPos /= viewPos.w;
+
+	vec4 worldPos = visualisation_data.invView * viewPos;
+
+	return worldPos.xyz;
+}
+
+// blue through green to red as the value goes from zero to one
+vec3 HeatRamp(float value)
+{
+	value = clamp(value, 0.0f, 1.0f);
+
+	float red = smoothstep(0.5f, 0.8f, value);
+	float green = smoothstep(0.0f, 0.3f, value) - smoothstep(0.7f, 1.0f, value);
+	float blue = 1.0f - smoothstep(0.2f, 0.5f, value);
+
+	return vec3(red, green, blue);
+}
+
+// hash the id so neighbouring ids get unrelated colours
+vec3 IDColor(uint id)
+{
+	id = (id ^ 61u) ^ (id >> 16);
+	id *= 9u;
+	id = id ^ (id >> 4);
+	id *= 0x27d4eb2du;
+	id = id ^ (id >> 15);
+
+	return vec3((id >> 16) & 255u, (id >> 8) & 255u, id & 255u) / 255.0f;
+}
+
+#ifdef PACKED_VERTEX_FORMAT
+vec3 LoadPosition(uint index, uint shapeID)
+{
+	return DecodePackedPosition(_vertices[index], _shapes[shapeID].min_vertex.xyz, _shapes[shapeID].max_vertex.xyz);
+}
+#endif
+
+vec3 TriangleNormal(uint visibilityData, vec3 cameraVec)
+{
+	uint triID = visibilityData >> SHAPE_ID_BITS;
+	uint shapeID = (visibilityData & SHAPE_ID_MASK);
+	uvec2 offsets = _shapes[shapeID].offsets.xy;
+
+	uint indexLoc = offsets.y + (triID * 3);
+#ifdef PACKED_VERTEX_FORMAT
+	vec3 p0 = LoadPosition(_indices[indexLoc + 0] + offsets.x, shapeID);
+	vec3 p1 = LoadPosition(_indices[indexLoc + 1] + offsets.x, shapeID);
+	vec3 p2 = LoadPosition(_indices[indexLoc + 2] + offsets.x, shapeID);
+#else
+	vec3 p0 = _vertices[_indices[indexLoc + 0] + offsets.x].pos_mat_index.xyz;
+	vec3 p1 = _vertices[_indices[indexLoc + 1] + offsets.x].pos_mat_index.xyz;
+	vec3 p2 = _vertices[_indices[indexLoc + 2] + offsets.x].pos_mat_index.xyz;
+#endif
+
+	// the winding is not known, the visible side faces the camera
+	vec3 normal = normalize(cross(p1 - p0, p2 - p0));
+	return (dot(normal, cameraVec) < 0.0f) ? -normal : normal;
+}
+
+// the lights that get past the shading pass's early outs, each of these samples its shadow map
+uint CountLights(vec3 worldPosition, vec3 worldNormal)
+{
+	uint lightCount = 0;
+	for(uint l = 0; l < light_data.scene_data.w; l++)
+	{
+		LightData light = light_data.lights[l];
+		if(light.lightIntensity <= 0.0f)
+			continue;
+
+		vec3 rayDir = -light.lightDirection.xyz;
+		float attenuation = 1.0f;
+		if(light.lightType == 1.0f || light.lightType == 2.0f)
+		{
+			rayDir = light.lightPosition.xyz - worldPosition;
+			float dist = length(rayDir);
+			rayDir /= dist;
+
+			attenuation = max(0, 1.0f - ((dist * dist) / (light.lightRange * light.lightRange)));
+			if(light.lightType == 2.0f && attenuation > 0)
+				attenuation = max(0, attenuation * pow(dot(rayDir, light.lightDirection.xyz), 8));
+		}
+
+		if(dot(worldNormal, rayDir) > 0.0f && attenuation > 0.0f)
+			lightCount++;
+	}
+
+	return lightCount;
+}
+
+// shadow map texels per screen pixel of the worst sampled shadow falling on the pixel, zero when none does
+float ShadowTexelDensity(vec3 worldPosition)
+{
+	float density = 0.0f;
+	for(uint l = 0; l < light_data.scene_data.w; l++)
+	{
+		LightData light = light_data.lights[l];
+		if(light.shadowsEnabled <= 0)
+			continue;
+
+		// pick the shadow map as the shading pass does
+		uint face = 0;
+		vec3 rayDir = worldPosition - light.lightPosition.xyz;
+		if(light.lightType == 1.0f)
+		{
+			vec3 absDir = abs(rayDir);
+			float dir = max(max(absDir.x, absDir.y), absDir.z);
+			if(dir == absDir.x)
+				face = (rayDir.x > 0) ? 0 : 1;
+			else if(dir == absDir.y)
+				face = (rayDir.y > 0) ? 2 : 3;
+			else
+				face = (rayDir.z > 0) ? 4 : 5;
+		}
+
+		vec4 lightSpacePos = light.viewProjMatrices[face] * vec4(worldPosition, 1.0f);
+		lightSpacePos = lightSpacePos / lightSpacePos.w;
+		vec2 projTexCoord = lightSpacePos.xy * 0.5 + 0.5;
+
+		// the derivatives are taken before the per pixel branches, along the screen axis the shadow is stretched most
+		vec2 texelCoord = projTexCoord * vec2(textureSize(sampler2D(shadowMaps[light.shadowMapIndex + face], bufferSampler), 0));
+		float texelsPerPixel = min(length(dFdx(texelCoord)), length(dFdy(texelCoord)));
+
+		bool inRange = (light.lightType == 0.0f) || (length(rayDir) < light.lightRange);
+		bool inMap = (clamp(projTexCoord, 0.0f, 1.0f) == projTexCoord);
+		if(light.lightIntensity > 0.0f && inRange && inMap)
+		{
+			if(density == 0.0f || texelsPerPixel < density)
+				density = texelsPerPixel;
+		}
+	}
+
+	return density;
+}
+
+// the culled shapes whose bounds the pixel's view ray passes through
+uint CountCulledBounds(vec3 rayOrigin, vec3 rayDir)
+{
+	vec3 invDir = 1.0f / rayDir;
+
+	uint hitCount = 0;
+	for(uint s = 0; s < visualisation_data.viewData.y; s++)
+	{
+		if(_draw_commands[s].instanceCount > 0)
+			continue;
+
+		vec3 t0 = (_shapes[s].min_vertex.xyz - rayOrigin) * invDir;
+		vec3 t1 = (_shapes[s].max_vertex.xyz - rayOrigin) * invDir;
+		vec3 tMin = min(t0, t1);
+		vec3 tMax = max(t0, t1);
+
+		float tNear = max(max(tMin.x, tMin.y), tMin.z);
+		float tFar = min(min(tMax.x, tMax.y), tMax.z);
+		if(tNear <= tFar && tFar > 0.0f)
+			hitCount++;
+	}
+
+	return hitCount;
+}
 
 void main()
 {
-	outColor = texture(sampler2D(bufferTexture, bufferSampler), fragTexCoord);
+	ivec2 bufferCoord = ivec2(gl_FragCoord.xy);
+	uint view = visualisation_data.viewData.x;
+
+	// the nearest surface is in the first peel layer
+	uint visibilityData = texelFetch(usampler2D(visibilityBuffers[0], bufferSampler), bufferCoord, 0).r;
+	float depth = texelFetch(sampler2D(depthBuffers[0], bufferSampler), bufferCoord, 0).r;
+	vec3 worldPosition = PositionFromDepth(depth, fragTexCoord);
+	vec3 cameraVec = light_data.camera_data.xyz - worldPosition;
+
+	vec3 color = vec3(0.0f, 0.0f, 0.0f);
+
+	if(view == VIEW_DEPTH)
+	{
+		color = vec3(depth);
+	}
+	else if(view == VIEW_OVERDRAW)
+	{
+		// the fragments the visibility pass wrote to the pixel, one is the ideal of a front to back draw order
+		float overdraw = texelFetch(sampler2D(overdrawBuffer, bufferSampler), bufferCoord, 0).r;
+		if(overdraw > 0.0f)
+			color = HeatRamp((overdraw - 1.0f) / (OVERDRAW_HEAT_MAX - 1.0f));
+	}
+	else if(view == VIEW_LIGHT_COUNT)
+	{
+		if(visibilityData != 0)
+		{
+			uint lightCount = CountLights(worldPosition, TriangleNormal(visibilityData, cameraVec));
+			color = (lightCount > 0) ? HeatRamp(float(lightCount - 1) / (LIGHT_COUNT_HEAT_MAX - 1.0f)) : vec3(0.1f, 0.1f, 0.1f);
+		}
+	}
+	else if(view == VIEW_PEEL_OCCUPANCY)
+	{
+		// the layers are peeled front to back so the occupied ones are contiguous
+		uint layerCount = 0;
+		for(int i = 0; i < PEEL_COUNT; i++)
+		{
+			if(texelFetch(usampler2D(visibilityBuffers[i], bufferSampler), bufferCoord, 0).r == 0)
+				break;
+			layerCount++;
+		}
+
+		// surfaces behind the last layer are dropped where every layer is occupied
+		if(layerCount == PEEL_COUNT)
+			color = vec3(1.0f, 0.0f, 1.0f);
+		else if(layerCount > 0)
+			color = HeatRamp(float(layerCount - 1) / float(PEEL_COUNT - 2));
+	}
+	else if(view == VIEW_SHAPE_ID)
+	{
+		if(visibilityData != 0)
+			color = IDColor(visibilityData & SHAPE_ID_MASK);
+	}
+	else if(view == VIEW_TRIANGLE_ID)
+	{
+		if(visibilityData != 0)
+			color = IDColor(visibilityData);
+	}
+	else if(view == VIEW_CULLING)
+	{
+		// the drawn surfaces in green under the bounds of the culled shapes in red, culled bounds
+		// the view ray passes through are draws that were not needed, or were culled wrongly
+		vec3 farPosition = PositionFromDepth(1.0f, fragTexCoord);
+		vec3 rayDir = normalize(farPosition - light_data.camera_data.xyz);
+		uint culledCount = CountCulledBounds(light_data.camera_data.xyz, rayDir);
+
+		if(visibilityData != 0)
+		{
+			uint shapeID = (visibilityData & SHAPE_ID_MASK);
+			float shade = 0.4f + 0.6f * dot(IDColor(shapeID), vec3(0.2126f, 0.7152f, 0.0722f));
+			color = vec3(0.0f, 1.0f, 0.0f) * shade;
+		}
+
+		if(culledCount > 0)
+			color = mix(color, vec3(1.0f, 0.0f, 0.0f), min(0.25f + 0.25f * culledCount, 1.0f));
+	}
+	else if(view == VIEW_SHADOW_TEXEL_DENSITY)
+	{
+		// red where shadow texels cover several pixels and alias, blue where their resolution is wasted
+		float density = ShadowTexelDensity(worldPosition);
+		if(visibilityData != 0)
+			color = (density > 0.0f) ? HeatRamp(0.5f - 0.125f * log2(density)) : vec3(0.1f, 0.1f, 0.1f);
+	}
+
+	outColor = vec4(color, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,32 @@
+@echo off
+rem compiles the packed vertex format variants of the shaders, named as VertexPacker::GetShaderFilename expects
+rem   compile_packed_shader.bat                      every variant the renderer loads
+rem   compile_packed_shader.bat shader               one shader
+rem   compile_packed_shader.bat shader sample_count  a multisampled resolve shader, e.g. _msaa.frag 4 writes _msaa_04_packed.frag.spv
+set GLSLANG=C:\VulkanSDK\glslang\build\StandAlone\Release\glslangValidator.exe
+
+if not "%~1"=="" (
+	call :compile %1 %2
+	goto done
+)
+
+for %%s in (g_buffer.vert default_material.vert shadow_map.vert visibility.vert visibility_front_peel.vert visibility_deferred.frag visibility_peel_deferred.frag) do call :compile %~dp0%%s
+for %%n in (2 4 8) do (
+	call :compile %~dp0visibility_deferred_msaa.frag %%n
+	call :compile %~dp0visibility_peel_deferred_msaa.frag %%n
+)
+call :compile %~dp0buffer_visualisation.frag
+
+:done
+pause
+goto :eof
+
+:compile
+if "%~2"=="" (
+	%GLSLANG% -V -DPACKED_VERTEX_FORMAT %1 -o %~dpn1_packed%~x1.spv
+	goto :eof
+)
+set SAMPLES=0%~2
+set SAMPLES=%SAMPLES:~-2%
+%GLSLANG% -V -DPACKED_VERTEX_FORMAT -DMSAA_COUNT=%~2 %1 -o %~dpn1_%SAMPLES%_packed%~x1.spv
+goto :eof
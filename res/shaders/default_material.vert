@@ -1,8 +1,17 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+#ifdef PACKED_VERTEX_FORMAT
+#extension GL_GOOGLE_include_directive : require
+#include "vertex_format.glsl"
+
+layout(location = 0) in uvec4 inPackedVertex;
+layout(location = 1) in vec4 inShapeMinVertex;
+layout(location = 2) in vec4 inShapeMaxVertex;
+#else
 layout(location = 0) in vec4 inPositionMatIndex;
 layout(location = 1) in vec4 inEncodedNormalTexCoord;
+#endif
 
 layout(binding = 0) uniform UniformBufferObject
 {
@@ -32,9 +41,18 @@ vec3 SphereMapDecode(vec2 encoded_normal)
 
 void main()
 {
+#ifdef PACKED_VERTEX_FORMAT
+	vec3 position = DecodePackedPosition(inPackedVertex, inShapeMinVertex.xyz, inShapeMaxVertex.xyz);
+	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(position, 1.0);
+	fragTexCoord = DecodePackedTexCoord(inPackedVertex);
+	normal = normalize(DecodePackedNormal(inPackedVertex) * mat3(ubo.model));
+	worldPosition = ubo.model * vec4(position, 1.0);
+	matIndex = DecodePackedMaterialIndex(inPackedVertex);
+#else
 	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPositionMatIndex.xyz, 1.0);
 	fragTexCoord = inEncodedNormalTexCoord.zw;
 	normal = normalize(SphereMapDecode(inEncodedNormalTexCoord.xy) * mat3(ubo.model));
 	worldPosition = ubo.model * vec4(inPositionMatIndex.xyz, 1.0);
 	matIndex = uint(inPositionMatIndex.w);
+#endif
 }
\ No newline at end of file
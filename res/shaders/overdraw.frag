@@ -0,0 +1,57 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// inputs
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) flat in uint matIndex;
+layout(location = 2) flat in uint shapeID;
+
+struct MaterialData
+{
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	vec4 transmittance;
+	vec4 emissive;
+	float shininess;
+	float ior;
+	float dissolve;
+	float illum;
+	uint ambient_map_index;
+	uint diffuse_map_index;
+	uint specular_map_index;
+	uint specular_highlight_map_index;
+	uint emissive_map_index;
+	uint bump_map_index;
+	uint alpha_map_index;
+	uint reflection_map_index;
+};
+
+layout(binding = 1) uniform MaterialUberBuffer
+{
+	MaterialData materials[512];
+} material_data;
+
+// textures
+layout(binding = 2) uniform sampler mapSampler;
+layout(binding = 3) uniform texture2D alphaMaps[512];
+
+// outputs
+layout(location = 0) out float outOverdraw;
+
+void main()
+{
+	// discard the same pixels as the visibility pass so only its shaded fragments are counted
+	float alpha = material_data.materials[matIndex].dissolve;
+	uint alpha_map_index = material_data.materials[matIndex].alpha_map_index;
+	if(alpha_map_index > 0)
+	{
+		alpha = alpha * texture(sampler2D(alphaMaps[alpha_map_index - 1], mapSampler), fragTexCoord).r;
+	}
+
+	if(alpha < 1.0f)
+		discard;
+
+	// every fragment that passes the depth test adds one, the target is blended additively
+	outOverdraw = 1.0f;
+}
\ No newline at end of file
@@ -1,6 +1,15 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+#ifdef PACKED_VERTEX_FORMAT
+#extension GL_GOOGLE_include_directive : require
+#include "vertex_format.glsl"
+
+layout(location = 0) in uvec4 inPackedVertex;
+layout(location = 1) in vec4 inShapeMinVertex;
+layout(location = 2) in vec4 inShapeMaxVertex;
+#endif
+
 layout(binding = 0) uniform UniformBufferObject
 {
 	mat4 model;
@@ -22,10 +31,17 @@ vec2 positions[6] = vec2[](
     vec2(1.0, 1.0)
 );
 
+#ifndef PACKED_VERTEX_FORMAT
 layout(location = 0) in vec4 inPositionMatIndex;
 layout(location = 1) in vec4 inEncodedNormalTexCoord;
+#endif
 
 void main()
 {
+#ifdef PACKED_VERTEX_FORMAT
+	vec3 position = DecodePackedPosition(inPackedVertex, inShapeMinVertex.xyz, inShapeMaxVertex.xyz);
+	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(position, 1.0);
+#else
 	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPositionMatIndex.xyz, 1.0);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,34 @@
+// decodes the primitive buffer's packed vertices, included by the shaders compiled with PACKED_VERTEX_FORMAT defined
+// x: position x and y, unorm16 within the shape's bounds
+// y: position z, unorm16 within the shape's bounds, and the material index in the high 16 bits
+// z: octahedral normal, snorm16 x and y
+// w: texture coordinates, half float u and v
+
+vec3 DecodePackedPosition(uvec4 packedVertex, vec3 minVertex, vec3 maxVertex)
+{
+	vec3 position = vec3(unpackUnorm2x16(packedVertex.x), unpackUnorm2x16(packedVertex.y).x);
+	return mix(minVertex, maxVertex, position);
+}
+
+vec3 DecodePackedNormal(uvec4 packedVertex)
+{
+	vec2 encoded = unpackSnorm2x16(packedVertex.z);
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+
+	// unfold the lower hemisphere
+	float t = max(-normal.z, 0.0);
+	normal.x += (normal.x >= 0.0) ? -t : t;
+	normal.y += (normal.y >= 0.0) ? -t : t;
+
+	return normalize(normal);
+}
+
+vec2 DecodePackedTexCoord(uvec4 packedVertex)
+{
+	return unpackHalf2x16(packedVertex.w);
+}
+
+uint DecodePackedMaterialIndex(uvec4 packedVertex)
+{
+	return packedVertex.y >> 16;
+}
\ No newline at end of file
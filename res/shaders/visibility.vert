@@ -1,8 +1,17 @@
 #version 460
 #extension GL_ARB_separate_shader_objects : enable
 
+#ifdef PACKED_VERTEX_FORMAT
+#extension GL_GOOGLE_include_directive : require
+#include "vertex_format.glsl"
+
+layout(location = 0) in uvec4 inPackedVertex;
+layout(location = 1) in vec4 inShapeMinVertex;
+layout(location = 2) in vec4 inShapeMaxVertex;
+#else
 layout(location = 0) in vec4 inPositionMatIndex;
 layout(location = 1) in vec4 inEncodedNormalTexCoord;
+#endif
 
 layout(binding = 0) uniform TransformBufferObject
 {
@@ -22,8 +31,15 @@ layout(location = 2) out uint shapeID;
 
 void main()
 {
+#ifdef PACKED_VERTEX_FORMAT
+	vec3 position = DecodePackedPosition(inPackedVertex, inShapeMinVertex.xyz, inShapeMaxVertex.xyz);
+	gl_Position = transforms.proj * transforms.view * transforms.model * vec4(position, 1.0);
+	fragTexCoord = DecodePackedTexCoord(inPackedVertex);
+	matIndex = DecodePackedMaterialIndex(inPackedVertex);
+#else
 	gl_Position = transforms.proj * transforms.view * transforms.model * vec4(inPositionMatIndex.xyz, 1.0);
 	fragTexCoord = inEncodedNormalTexCoord.zw;
 	matIndex = uint(inPositionMatIndex.w);
+#endif
 	shapeID = uint(gl_BaseInstance);
 }
\ No newline at end of file
@@ -1,8 +1,15 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+#ifdef PACKED_VERTEX_FORMAT
+#extension GL_GOOGLE_include_directive : require
+#include "vertex_format.glsl"
+#endif
+
 // defines
+#ifndef MSAA_COUNT
 #define MSAA_COUNT 2
+#endif
 #define PEEL_COUNT 4
 
 // inputs
@@ -98,7 +105,11 @@ layout(binding = 14) uniform sampler bufferSampler;
 // vertex, index and shape buffers
 layout(binding = 15) buffer VertexBuffer
 {
+#ifdef PACKED_VERTEX_FORMAT
+	uvec4 _vertices[];
+#else
 	StorageVertex _vertices[];
+#endif
 };
 
 layout(binding = 16) buffer IndexBuffer
@@ -404,16 +415,30 @@ vec3 Intersect(vec3 p, vec3 v0, vec3 v1, vec3 v2)
 	return weights;
 }
 
+#ifdef PACKED_VERTEX_FORMAT
+// the shape whose vertices LoadVertex reads, its bounds dequantize the packed positions
+uint loadShapeID;
+#endif
+
 Vertex LoadVertex(uint index)
 {
 	Vertex vertex;
 
+#ifdef PACKED_VERTEX_FORMAT
+	uvec4 packedVertex = _vertices[index];
+
+	vertex.pos = DecodePackedPosition(packedVertex, _shapes[loadShapeID].min_vertex.xyz, _shapes[loadShapeID].max_vertex.xyz);
+	vertex.tex_coord = DecodePackedTexCoord(packedVertex);
+	vertex.normal = DecodePackedNormal(packedVertex);
+	vertex.mat_index = DecodePackedMaterialIndex(packedVertex);
+#else
 	StorageVertex storageVertex = _vertices[index];
 
 	vertex.pos = storageVertex.pos_mat_index.xyz;
 	vertex.tex_coord = storageVertex.encoded_normal_tex_coord.zw;
 	vertex.normal = SphereMapDecode(storageVertex.encoded_normal_tex_coord.xy);
 	vertex.mat_index = uint(storageVertex.pos_mat_index.w);
+#endif
 	
 	return vertex;   
 }
@@ -496,6 +521,9 @@ void main()
 			
 			// load depth
 			float depth = texelFetch(sampler2DMS(depthBuffers[i], bufferSampler), ivec2(gl_FragCoord.xy), sample_num).r;
+#ifdef PACKED_VERTEX_FORMAT
+			loadShapeID = shapeID;
+#endif
 			Vertex vertex = LoadAndInterpolateVertex(offsets.x, offsets.y, triID, depth, gl_FragCoord.xy);
 			worldPosition = vertex.pos;
 			worldNormal = vertex.normal;